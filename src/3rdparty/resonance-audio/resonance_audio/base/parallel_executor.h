@@ -0,0 +1,54 @@
+/*
+Copyright 2022 The Qt Company Ltd.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS-IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef RESONANCE_AUDIO_BASE_PARALLEL_EXECUTOR_H_
+#define RESONANCE_AUDIO_BASE_PARALLEL_EXECUTOR_H_
+
+#include <cstddef>
+
+namespace vraudio {
+
+// Interface to a pool of threads the audio graph can use to process independent
+// parts of the graph in parallel. Implementations are provided by the client,
+// and are expected to neither allocate nor block on anything but the worker
+// threads inside |Execute|, as it is called from the audio thread.
+class ParallelExecutor {
+ public:
+  // Function processing the task with index |task| of a job.
+  typedef void (*TaskFunction)(void* context, size_t task);
+
+  virtual ~ParallelExecutor() {}
+
+  // Returns the number of threads tasks are distributed over, including the
+  // calling thread.
+  //
+  // @return Number of threads.
+  virtual size_t GetNumThreads() const = 0;
+
+  // Calls |function| for all tasks in [0, |num_tasks|), distributed over all
+  // threads, and returns once all of them have finished. Tasks are processed in
+  // no particular order.
+  //
+  // @param num_tasks Number of tasks.
+  // @param function Function processing a single task.
+  // @param context Context pointer passed to |function|.
+  virtual void Execute(size_t num_tasks, TaskFunction function,
+                       void* context) = 0;
+};
+
+}  // namespace vraudio
+
+#endif  // RESONANCE_AUDIO_BASE_PARALLEL_EXECUTOR_H_
@@ -45,7 +45,7 @@ struct SourceParameters {
   float gain = 1.0f;
 
   // Source gain attenuation factors to be calculated per each buffer.
-  float attenuations[kNumAttenuationTypes];
+  float attenuations[kNumAttenuationTypes] = {};
 
   // Distance attenuation. Value 1 represents no attenuation should be applied,
   // value 0 will fully attenuate the volume. Range [0, 1].
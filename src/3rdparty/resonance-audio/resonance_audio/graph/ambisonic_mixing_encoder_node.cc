@@ -31,39 +31,102 @@ AmbisonicMixingEncoderNode::AmbisonicMixingEncoderNode(
       ambisonic_order_(ambisonic_order),
       gain_mixer_(GetNumPeriphonicComponents(ambisonic_order_),
                   system_settings_.GetFramesPerBuffer()),
-      coefficients_(GetNumPeriphonicComponents(ambisonic_order_)) {}
+      coefficients_(GetNumPeriphonicComponents(ambisonic_order_)),
+      parallel_executor_(nullptr),
+      parallel_input_(nullptr),
+      partition_mixer_(GetNumPeriphonicComponents(ambisonic_order_),
+                       system_settings_.GetFramesPerBuffer()) {}
+
+AmbisonicMixingEncoderNode::Partition::Partition(size_t num_channels,
+                                                 size_t frames_per_buffer)
+    : gain_mixer(num_channels, frames_per_buffer), coefficients(num_channels) {}
+
+void AmbisonicMixingEncoderNode::SetParallelExecutor(
+    ParallelExecutor* executor) {
+  parallel_executor_ = executor;
+  partitions_.clear();
+  const size_t num_partitions =
+      executor != nullptr ? executor->GetNumThreads() : 0;
+  if (num_partitions < 2) {
+    return;
+  }
+  // Allocate everything up front, so encoding doesn't allocate.
+  for (size_t i = 0; i < num_partitions; ++i) {
+    partitions_.emplace_back(
+        new Partition(GetNumPeriphonicComponents(ambisonic_order_),
+                      system_settings_.GetFramesPerBuffer()));
+  }
+}
 
 const AudioBuffer* AmbisonicMixingEncoderNode::AudioProcess(
     const NodeInput& input) {
 
-
-  const WorldPosition& listener_position = system_settings_.GetHeadPosition();
-  const WorldRotation& listener_rotation = system_settings_.GetHeadRotation();
+  if (!partitions_.empty()) {
+    parallel_input_ = &input;
+    parallel_executor_->Execute(partitions_.size(), &EncodePartition, this);
+    parallel_input_ = nullptr;
+
+    // Sum up in a fixed order, so the result doesn't depend on scheduling.
+    partition_mixer_.Reset();
+    for (const auto& partition : partitions_) {
+      const AudioBuffer* partition_output = partition->gain_mixer.GetOutput();
+      if (partition_output != nullptr) {
+        partition_mixer_.AddInput(*partition_output);
+      }
+    }
+    return partition_mixer_.GetOutput();
+  }
 
   gain_mixer_.Reset();
   for (auto& input_buffer : input.GetInputBuffers()) {
-    const int source_id = input_buffer->source_id();
-    const auto source_parameters =
-        system_settings_.GetSourceParameters(source_id);
-    DCHECK_NE(source_id, kInvalidSourceId);
-    DCHECK_EQ(input_buffer->num_channels(), 1U);
-
-    // Compute the relative source direction in spherical angles.
-    const ObjectTransform& source_transform =
-        source_parameters->object_transform;
-    WorldPosition relative_direction;
-    GetRelativeDirection(listener_position, listener_rotation,
-                         source_transform.position, &relative_direction);
-    const SphericalAngle source_direction =
-        SphericalAngle::FromWorldPosition(relative_direction);
-
-    lookup_table_.GetEncodingCoeffs(ambisonic_order_, source_direction,
-                                    source_parameters->spread_deg,
-                                    &coefficients_);
-
-    gain_mixer_.AddInputChannel((*input_buffer)[0], source_id, coefficients_);
+    EncodeInput(*input_buffer, &gain_mixer_, &coefficients_);
   }
   return gain_mixer_.GetOutput();
 }
 
+void AmbisonicMixingEncoderNode::EncodeInput(const AudioBuffer& input_buffer,
+                                             GainMixer* gain_mixer,
+                                             std::vector<float>* coefficients) {
+  const WorldPosition& listener_position = system_settings_.GetHeadPosition();
+  const WorldRotation& listener_rotation = system_settings_.GetHeadRotation();
+
+  const int source_id = input_buffer.source_id();
+  const auto source_parameters =
+      system_settings_.GetSourceParameters(source_id);
+  DCHECK_NE(source_id, kInvalidSourceId);
+  DCHECK_EQ(input_buffer.num_channels(), 1U);
+
+  // Compute the relative source direction in spherical angles.
+  const ObjectTransform& source_transform =
+      source_parameters->object_transform;
+  WorldPosition relative_direction;
+  GetRelativeDirection(listener_position, listener_rotation,
+                       source_transform.position, &relative_direction);
+  const SphericalAngle source_direction =
+      SphericalAngle::FromWorldPosition(relative_direction);
+
+  lookup_table_.GetEncodingCoeffs(ambisonic_order_, source_direction,
+                                  source_parameters->spread_deg,
+                                  coefficients);
+
+  gain_mixer->AddInputChannel(input_buffer[0], source_id, *coefficients);
+}
+
+void AmbisonicMixingEncoderNode::EncodePartition(void* context, size_t task) {
+  auto* node = static_cast<AmbisonicMixingEncoderNode*>(context);
+  Partition* partition = node->partitions_[task].get();
+  const size_t num_partitions = node->partitions_.size();
+
+  partition->gain_mixer.Reset();
+  // Sources stay in the same partition, so their gain ramps are continuous.
+  for (auto& input_buffer : node->parallel_input_->GetInputBuffers()) {
+    if (static_cast<size_t>(input_buffer->source_id()) % num_partitions !=
+        task) {
+      continue;
+    }
+    node->EncodeInput(*input_buffer, &partition->gain_mixer,
+                      &partition->coefficients);
+  }
+}
+
 }  // namespace vraudio
@@ -17,12 +17,15 @@ limitations under the License.
 #ifndef RESONANCE_AUDIO_GRAPH_AMBISONIC_MIXING_ENCODER_NODE_H_
 #define RESONANCE_AUDIO_GRAPH_AMBISONIC_MIXING_ENCODER_NODE_H_
 
+#include <memory>
 #include <vector>
 
 #include "ambisonics/ambisonic_lookup_table.h"
 #include "base/audio_buffer.h"
+#include "base/parallel_executor.h"
 #include "base/spherical_angle.h"
 #include "dsp/gain_mixer.h"
+#include "dsp/mixer.h"
 #include "graph/system_settings.h"
 #include "node/processing_node.h"
 
@@ -48,6 +51,15 @@ class AmbisonicMixingEncoderNode : public ProcessingNode {
     return false;
   }
 
+  // Distributes the encoding of the sources over the threads of |executor|.
+  // Sources are split into one partition per thread by their id, and the
+  // partitions are summed up in a fixed order. Must not be called while the
+  // graph is being processed.
+  //
+  // @param executor Executor to use, or nullptr to encode all sources on the
+  //     calling thread.
+  void SetParallelExecutor(ParallelExecutor* executor);
+
  protected:
   // Implements ProcessingNode.
   const AudioBuffer* AudioProcess(const NodeInput& input) override;
@@ -64,6 +76,31 @@ class AmbisonicMixingEncoderNode : public ProcessingNode {
 
   // Encoding coefficient values to be applied to encode the input.
   std::vector<float> coefficients_;
+
+  // Encoder state of one partition of the sources when encoding in parallel.
+  struct Partition {
+    Partition(size_t num_channels, size_t frames_per_buffer);
+
+    GainMixer gain_mixer;
+    std::vector<float> coefficients;
+  };
+
+  // Encodes |input_buffer| and adds it to |gain_mixer|.
+  void EncodeInput(const AudioBuffer& input_buffer, GainMixer* gain_mixer,
+                   std::vector<float>* coefficients);
+
+  // Encodes the sources of the partition with index |task|, see
+  // |ParallelExecutor::TaskFunction|.
+  static void EncodePartition(void* context, size_t task);
+
+  ParallelExecutor* parallel_executor_;
+  std::vector<std::unique_ptr<Partition>> partitions_;
+
+  // Input of the current |AudioProcess| call while encoding in parallel.
+  const NodeInput* parallel_input_;
+
+  // Sums up the outputs of all partitions.
+  Mixer partition_mixer_;
 };
 
 }  // namespace vraudio
@@ -36,7 +36,8 @@ GraphManager::GraphManager(const SystemSettings& system_settings)
       config_(GlobalConfig()),
       system_settings_(system_settings),
       fft_manager_(system_settings.GetFramesPerBuffer()),
-      output_node_(std::make_shared<SinkNode>()) {
+      output_node_(std::make_shared<SinkNode>()),
+      parallel_executor_(nullptr) {
   CHECK_LE(system_settings.GetFramesPerBuffer(), kMaxSupportedNumFrames);
 
   stereo_mixer_node_ =
@@ -127,6 +128,7 @@ void GraphManager::CreateSoundObjectSource(SourceId sound_object_source_id,
     auto occlusion_node = std::make_shared<OcclusionNode>(
         sound_object_source_id, system_settings_);
     occlusion_node->Connect(direct_attenuation_node);
+    direct_rendering_nodes_[sound_object_source_id] = occlusion_node;
     auto near_field_effect_node = std::make_shared<NearFieldEffectNode>(
         sound_object_source_id, system_settings_);
 
@@ -243,16 +245,43 @@ void GraphManager::DestroySource(SourceId source_id) {
     output_node_->CleanUp();
     // Unregister the source from |source_nodes_|.
     source_nodes_.erase(source_id);
+    direct_rendering_nodes_.erase(source_id);
   }
 }
 
 std::shared_ptr<SinkNode> GraphManager::GetSinkNode() { return output_node_; }
 
 void GraphManager::Process() {
-
+  if (parallel_executor_ != nullptr &&
+      parallel_executor_->GetNumThreads() > 1) {
+    // Nodes only process once per buffer, so the outputs of the direct
+    // rendering paths are picked up by the graph traversal below.
+    parallel_executor_->Execute(parallel_executor_->GetNumThreads(),
+                                &ProcessSourcePartition, this);
+  }
   output_node_->ReadInputs();
 }
 
+void GraphManager::SetParallelExecutor(ParallelExecutor* executor) {
+  parallel_executor_ = executor;
+  for (const auto& encoder_node_itr : ambisonic_mixing_encoder_nodes_) {
+    encoder_node_itr.second->SetParallelExecutor(executor);
+  }
+}
+
+void GraphManager::ProcessSourcePartition(void* context, size_t task) {
+  auto* graph_manager = static_cast<GraphManager*>(context);
+  const size_t num_partitions =
+      graph_manager->parallel_executor_->GetNumThreads();
+  // The nodes of a source only depend on system settings and the source's own
+  // parameters, so sources can be processed independently.
+  for (const auto& node_itr : graph_manager->direct_rendering_nodes_) {
+    if (static_cast<size_t>(node_itr.first) % num_partitions == task) {
+      node_itr.second->Process();
+    }
+  }
+}
+
 AudioBuffer* GraphManager::GetMutableAudioBuffer(SourceId source_id) {
   auto source_node = LookupSourceNode(source_id);
   if (source_node == nullptr) {
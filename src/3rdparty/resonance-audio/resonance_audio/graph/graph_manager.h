@@ -24,6 +24,7 @@ limitations under the License.
 #include "ambisonics/ambisonic_lookup_table.h"
 #include "base/audio_buffer.h"
 #include "base/constants_and_types.h"
+#include "base/parallel_executor.h"
 #include "config/global_config.h"
 #include "dsp/fft_manager.h"
 #include "dsp/resampler.h"
@@ -32,6 +33,7 @@ limitations under the License.
 #include "graph/buffered_source_node.h"
 #include "graph/gain_mixer_node.h"
 #include "graph/mixer_node.h"
+#include "graph/occlusion_node.h"
 #include "graph/reflections_node.h"
 #include "graph/reverb_node.h"
 #include "graph/stereo_mixing_panner_node.h"
@@ -58,6 +60,15 @@ class GraphManager {
   // Triggers processing of the audio graph for all the connected nodes.
   void Process();
 
+  // Sets the executor used to process the sound object sources in parallel.
+  // The direct rendering path of each source and the Ambisonic encoding are
+  // distributed over its threads, the rest of the graph is processed on the
+  // calling thread. Must not be called while the graph is being processed.
+  //
+  // @param executor Executor to use, or nullptr to process the whole graph on
+  //     the calling thread.
+  void SetParallelExecutor(ParallelExecutor* executor);
+
   // Returns a mutable pointer to the |AudioBuffer| of an audio source with
   // given |source_id|. Calls to this method must be synchronized with the audio
   // graph processing.
@@ -254,6 +265,10 @@ class GraphManager {
   void UpdateRoomReverb();
 
  private:
+  // Processes the direct rendering nodes of the sources in the partition with
+  // index |task|, see |ParallelExecutor::TaskFunction|.
+  static void ProcessSourcePartition(void* context, size_t task);
+
   // Initializes the Ambisonic renderer subgraph for the speficied Ambisonic
   // order and connects it to the |StereoMixerNode|.
   //
@@ -397,6 +412,14 @@ class GraphManager {
   // allows look up by id.
   std::unordered_map<SourceId, std::shared_ptr<BufferedSourceNode>>
       source_nodes_;
+
+  // Last node of the per source direct rendering path of each sound object
+  // source, used to process the sources in parallel.
+  std::unordered_map<SourceId, std::shared_ptr<OcclusionNode>>
+      direct_rendering_nodes_;
+
+  // Executor to process sources in parallel, or nullptr.
+  ParallelExecutor* parallel_executor_;
 };
 
 }  // namespace vraudio
@@ -455,6 +455,15 @@ const AudioBuffer *ResonanceAudioApiImpl::GetReverbBuffer() const {
     return graph_manager_->GetReverbBuffer();
 }
 
+const SourceParameters* ResonanceAudioApiImpl::GetSourceParameters(
+    SourceId source_id) const {
+  return system_settings_.GetSourceParameters(source_id);
+}
+
+void ResonanceAudioApiImpl::SetParallelExecutor(ParallelExecutor* executor) {
+  graph_manager_->SetParallelExecutor(executor);
+}
+
 void ResonanceAudioApiImpl::ProcessNextBuffer() {
 #if defined(ENABLE_TRACING) && !ION_PRODUCTION
   // This enables tracing on the audio thread.
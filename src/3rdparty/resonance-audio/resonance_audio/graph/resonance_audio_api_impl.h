@@ -129,9 +129,24 @@ class ResonanceAudioApiImpl : public ResonanceAudioApi {
   // @return Pointer to room reverb stereo buffer.
   const AudioBuffer* GetReverbBuffer() const;
 
+  // Returns the parameters of the source with given |source_id|, including the
+  // attenuations calculated for the last processed buffer. Must only be called
+  // from the audio thread.
+  //
+  // @param source_id Source id.
+  // @return Pointer to source parameters, nullptr if |source_id| not found.
+  const SourceParameters* GetSourceParameters(SourceId source_id) const;
+
   // Triggers processing of the audio graph with the updated system properties.
   void ProcessNextBuffer();
 
+  // Sets the executor used to process sources in parallel, see
+  // |GraphManager::SetParallelExecutor|. Must not be called while the audio
+  // graph is being processed.
+  //
+  // @param executor Executor to use, or nullptr to process on a single thread.
+  void SetParallelExecutor(ParallelExecutor* executor);
+
  private:
   // This method triggers the processing of the audio graph and outputs a
   // binaural stereo output buffer.
@@ -55,6 +55,9 @@
 #include "qalsaaudiodevice_p.h"
 #include <QLoggingCategory>
 
+#include <climits>
+#include <cstring>
+
 QT_BEGIN_NAMESPACE
 
 Q_LOGGING_CATEGORY(lcAlsaOutput, "qt.multimedia.alsa.output")
@@ -72,7 +75,7 @@ QAlsaAudioSink::QAlsaAudioSink(const QByteArray &device)
     period_size = 0;
     buffer_time = 100000;
     period_time = 20000;
-    totalTimeValue = 0;
+    totalTimeValue.storeRelaxed(0);
     audioBuffer = 0;
     errorState = QAudio::NoError;
     deviceState = QAudio::StoppedState;
@@ -196,6 +199,16 @@ int QAlsaAudioSink::setFormat()
 }
 
 void QAlsaAudioSink::start(QIODevice* device)
+{
+    startPull(device, nullptr);
+}
+
+void QAlsaAudioSink::startWithAdapter(std::unique_ptr<QAudioRenderAdapter> adapter)
+{
+    startPull(nullptr, std::move(adapter));
+}
+
+void QAlsaAudioSink::startPull(QIODevice *device, std::unique_ptr<QAudioRenderAdapter> adapter)
 {
     if(deviceState != QAudio::StoppedState)
         deviceState = QAudio::StoppedState;
@@ -212,6 +225,7 @@ void QAlsaAudioSink::start(QIODevice* device)
 
     pullMode = true;
     audioSource = device;
+    renderAdapter = std::move(adapter);
 
     deviceState = QAudio::ActiveState;
 
@@ -234,6 +248,7 @@ QIODevice* QAlsaAudioSink::start()
     }
 
     close();
+    renderAdapter.reset();
 
     audioSource = new AlsaOutputPrivate(this);
     audioSource->open(QIODevice::WriteOnly|QIODevice::Unbuffered);
@@ -324,7 +339,16 @@ bool QAlsaAudioSink::open()
         }
     }
     if ( !fatal ) {
+        // Writing straight into the hardware ring saves a copy, and the gain
+        // gets applied on the way in
+        static const bool user_mmap = qEnvironmentVariableIntValue("QT_ALSA_OUTPUT_MMAP");
+        access = user_mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
         err = snd_pcm_hw_params_set_access( handle, hwparams, access );
+        if ( err < 0 && access == SND_PCM_ACCESS_MMAP_INTERLEAVED ) {
+            qCDebug(lcAlsaOutput) << "mmap access not supported, falling back to read/write";
+            access = SND_PCM_ACCESS_RW_INTERLEAVED;
+            err = snd_pcm_hw_params_set_access( handle, hwparams, access );
+        }
         if ( err < 0 ) {
             fatal = true;
             errMessage = QString::fromLatin1("QAudioSink: snd_pcm_hw_params_set_access: err = %1").arg(err);
@@ -447,20 +471,25 @@ bool QAlsaAudioSink::open()
     // Step 5: Setup timer
     bytesAvailable = bytesFree();
 
-    // Step 6: Start audio processing
-    timer->start(period_time/1000);
-
     elapsedTimeOffset = 0;
     errorState  = QAudio::NoError;
-    totalTimeValue = 0;
+    totalTimeValue.storeRelaxed(0);
+    appliedVolume = float(m_volume);
     opened = true;
 
+    // Step 6: Start audio processing
+    if (useIOThread())
+        startIO();
+    else
+        timer->start(period_time/1000);
+
     return true;
 }
 
 void QAlsaAudioSink::close()
 {
     timer->stop();
+    stopIO();
 
     if ( handle ) {
         snd_pcm_drain( handle );
@@ -469,6 +498,7 @@ void QAlsaAudioSink::close()
         delete [] audioBuffer;
         audioBuffer=0;
     }
+    ringBuffer.reset();
     if(!pullMode && audioSource) {
         delete audioSource;
         audioSource = 0;
@@ -484,6 +514,9 @@ qsizetype QAlsaAudioSink::bytesFree() const
     if(deviceState != QAudio::ActiveState && deviceState != QAudio::IdleState)
         return 0;
 
+    if (ringBuffer)
+        return ringBuffer->free();
+
     int frames = snd_pcm_avail_update(handle);
     if (frames == -EPIPE) {
         // Try and handle buffer underrun
@@ -522,16 +555,18 @@ qint64 QAlsaAudioSink::write( const char *data, qint64 len )
 
     frames = snd_pcm_bytes_to_frames(handle, space);
 
-    if (m_volume < 1.0f) {
+    if (access == SND_PCM_ACCESS_MMAP_INTERLEAVED) {
+        err = writeMmap(data, frames);
+    } else if (needsVolume()) {
         QVarLengthArray<char, 4096> out(space);
-        QAudioHelperInternal::qMultiplySamples(m_volume, settings, data, out.data(), space);
+        applyVolume(data, out.data(), space);
         err = snd_pcm_writei(handle, out.constData(), frames);
     } else {
         err = snd_pcm_writei(handle, data, frames);
     }
 
     if(err > 0) {
-        totalTimeValue += err;
+        totalTimeValue.fetchAndAddRelaxed(err);
         resuming = false;
         errorState = QAudio::NoError;
         if (deviceState != QAudio::ActiveState) {
@@ -552,6 +587,53 @@ qint64 QAlsaAudioSink::write( const char *data, qint64 len )
     return 0;
 }
 
+// Copies frames into the areas of the mmap'ed device buffer, applying the
+// volume while doing so. Returns the number of frames committed or an error.
+snd_pcm_sframes_t QAlsaAudioSink::writeMmap(const char *data, snd_pcm_uframes_t frames)
+{
+    const snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+    if (avail < 0)
+        return avail;
+    frames = qMin(frames, snd_pcm_uframes_t(avail));
+
+    snd_pcm_sframes_t written = 0;
+    while (frames > 0) {
+        const snd_pcm_channel_area_t *areas = nullptr;
+        snd_pcm_uframes_t offset = 0;
+        snd_pcm_uframes_t chunk = frames;
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &chunk);
+        if (err < 0)
+            return written ? written : err;
+
+        // interleaved access: all channels share the first area
+        char *dst = static_cast<char *>(areas[0].addr) + areas[0].first/8 + offset*areas[0].step/8;
+        const int bytes = snd_pcm_frames_to_bytes(handle, chunk);
+        if (needsVolume())
+            applyVolume(data, dst, bytes);
+        else
+            memcpy(dst, data, bytes);
+
+        const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, chunk);
+        if (committed < 0)
+            return written ? written : committed;
+        written += committed;
+        if (snd_pcm_uframes_t(committed) != chunk)
+            break;
+        data += bytes;
+        frames -= chunk;
+    }
+    return written;
+}
+
+// Ramps from the volume the previous data was written with to the current
+// one over the buffer, so volume changes don't click
+void QAlsaAudioSink::applyVolume(const char *src, char *dst, qint64 len)
+{
+    const float volume = float(m_volume);
+    QAudioHelperInternal::qMultiplySamples(appliedVolume, volume, settings, src, dst, int(len));
+    appliedVolume = volume;
+}
+
 void QAlsaAudioSink::setBufferSize(qsizetype value)
 {
     if(deviceState == QAudio::StoppedState)
@@ -565,7 +647,7 @@ qsizetype QAlsaAudioSink::bufferSize() const
 
 qint64 QAlsaAudioSink::processedUSecs() const
 {
-    return qint64(1000000) * totalTimeValue / settings.sampleRate();
+    return qint64(1000000) * totalTimeValue.loadRelaxed() / settings.sampleRate();
 }
 
 void QAlsaAudioSink::resume()
@@ -589,7 +671,10 @@ void QAlsaAudioSink::resume()
         deviceState = pullMode ? QAudio::ActiveState : QAudio::IdleState;
 
         errorState = QAudio::NoError;
-        timer->start(period_time/1000);
+        if (useIOThread())
+            startIO();
+        else
+            timer->start(period_time/1000);
         emit stateChanged(deviceState);
     }
 }
@@ -607,6 +692,7 @@ QAudioFormat QAlsaAudioSink::format() const
 void QAlsaAudioSink::suspend()
 {
     if(deviceState == QAudio::ActiveState || deviceState == QAudio::IdleState || resuming) {
+        stopIO();
         snd_pcm_drain(handle);
         timer->stop();
         deviceState = QAudio::SuspendedState;
@@ -699,8 +785,214 @@ bool QAlsaAudioSink::deviceReady()
     return true;
 }
 
+QAudioIOThread::Metrics QAlsaAudioSink::ioMetrics() const
+{
+    return ioThread ? ioThread->metrics() : QAudioIOThread::Metrics{};
+}
+
+void QAlsaAudioSink::startIO()
+{
+    if (!ioThread) {
+        ioThread = std::make_unique<QAudioIOThread>(QStringLiteral("ALSA output"),
+                                                    [this] { return processIO(); });
+    }
+    // Data written in push mode is passed to the audio thread through a ring
+    if (!pullMode && !ringBuffer)
+        ringBuffer = std::make_unique<QAudioRingBuffer>(buffer_size);
+
+    ioState = deviceState;
+    ioError = QAudio::NoError;
+    ioThread->start(period_time);
+}
+
+void QAlsaAudioSink::stopIO()
+{
+    if (ioThread)
+        ioThread->stop();
+}
+
+// Runs on the audio thread: waits until the device can take at least a
+// period, then fills as many whole periods as there is data for.
+bool QAlsaAudioSink::processIO()
+{
+    int err = snd_pcm_wait(handle, qMax(1u, 2 * period_time / 1000));
+    if (err < 0)
+        return recoverIO(err);
+
+    ioThread->callbackStarted();
+
+    snd_pcm_sframes_t frames = snd_pcm_avail_update(handle);
+    if (frames < 0)
+        return recoverIO(frames);
+
+    frames = qMin(frames, snd_pcm_sframes_t(buffer_frames));
+    if (frames < snd_pcm_sframes_t(period_frames))
+        return true;
+    frames -= frames % snd_pcm_sframes_t(period_frames);
+
+    const snd_pcm_sframes_t written = access == SND_PCM_ACCESS_MMAP_INTERLEAVED
+            ? writeMmapIO(frames) : writeIO(frames);
+    if (written < 0)
+        return false;
+
+    if (written == 0) {
+        // Nothing to play; report an underrun once the device runs dry
+        if (frames > snd_pcm_sframes_t(buffer_frames - period_frames))
+            postIOState(QAudio::IdleState, QAudio::UnderrunError);
+        ioThread->waitForWake(period_time);
+        return true;
+    }
+
+    postIOState(QAudio::ActiveState, QAudio::NoError);
+    return true;
+}
+
+// Reads whole frames from whatever feeds the audio thread
+qint64 QAlsaAudioSink::readIO(char *data, qint64 maxLen)
+{
+    if (renderAdapter)
+        return renderAdapter->render(data, maxLen);
+
+    const int bytesPerFrame = snd_pcm_frames_to_bytes(handle, 1);
+    if (pullMode) {
+        qint64 len = audioSource->read(data, maxLen);
+        const qint64 partial = len > 0 ? len % bytesPerFrame : 0;
+        if (partial) {
+            audioSource->seek(audioSource->pos() - partial);
+            len -= partial;
+        }
+        return len;
+    }
+
+    const int whole = ringBuffer->used() / bytesPerFrame * bytesPerFrame;
+    return ringBuffer->read(data, qMin<qint64>(whole, maxLen));
+}
+
+// Like readIO(), but with the volume applied. dst only gets written once:
+// render callbacks get the gain while converting from float, other data is
+// read into audioBuffer and scaled from there into dst.
+qint64 QAlsaAudioSink::readVolumeIO(char *dst, qint64 maxLen)
+{
+    if (!needsVolume())
+        return readIO(dst, maxLen);
+
+    const float volume = float(m_volume);
+    // a volume change is ramped over the next buffer below
+    if (renderAdapter && appliedVolume == volume)
+        return renderAdapter->render(dst, maxLen, volume);
+
+    const qint64 len = readIO(audioBuffer, maxLen);
+    if (len > 0)
+        applyVolume(audioBuffer, dst, len);
+    return len;
+}
+
+// Writes up to frames frames through audioBuffer. Returns the number of
+// frames written, or -1 if the stream had to be stopped.
+snd_pcm_sframes_t QAlsaAudioSink::writeIO(snd_pcm_sframes_t frames)
+{
+    const qint64 len = readVolumeIO(audioBuffer, snd_pcm_frames_to_bytes(handle, frames));
+    if (len < 0) {
+        postIOState(QAudio::StoppedState, QAudio::IOError);
+        return -1;
+    }
+
+    const char *data = audioBuffer;
+    const snd_pcm_sframes_t total = snd_pcm_bytes_to_frames(handle, len);
+    snd_pcm_sframes_t remaining = total;
+    while (remaining > 0 && !ioThread->isStopRequested()) {
+        snd_pcm_sframes_t written = snd_pcm_writei(handle, data, remaining);
+        if (written < 0) {
+            if (!recoverIO(written))
+                return -1;
+            continue;
+        }
+        totalTimeValue.fetchAndAddRelaxed(written);
+        data += snd_pcm_frames_to_bytes(handle, written);
+        remaining -= written;
+    }
+    return total;
+}
+
+// Like writeIO(), but the data ends up directly in the mmap'ed device buffer,
+// with the volume applied on the way there
+snd_pcm_sframes_t QAlsaAudioSink::writeMmapIO(snd_pcm_sframes_t frames)
+{
+    snd_pcm_sframes_t written = 0;
+    while (frames > 0 && !ioThread->isStopRequested()) {
+        const snd_pcm_channel_area_t *areas = nullptr;
+        snd_pcm_uframes_t offset = 0;
+        snd_pcm_uframes_t chunk = frames;
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &chunk);
+        if (err < 0)
+            return recoverIO(err) ? written : -1;
+
+        char *dst = static_cast<char *>(areas[0].addr) + areas[0].first/8 + offset*areas[0].step/8;
+        const qint64 len = readVolumeIO(dst, snd_pcm_frames_to_bytes(handle, chunk));
+        if (len < 0) {
+            snd_pcm_mmap_commit(handle, offset, 0);
+            postIOState(QAudio::StoppedState, QAudio::IOError);
+            return -1;
+        }
+
+        const snd_pcm_uframes_t filled = snd_pcm_bytes_to_frames(handle, len);
+        const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, filled);
+        if (committed < 0)
+            return recoverIO(committed) ? written : -1;
+        totalTimeValue.fetchAndAddRelaxed(committed);
+        written += committed;
+        // the source ran dry
+        if (filled < chunk)
+            break;
+        frames -= chunk;
+    }
+    return written;
+}
+
+bool QAlsaAudioSink::recoverIO(int err)
+{
+    if (err == -EPIPE)
+        ioThread->underrun();
+
+    if (snd_pcm_recover(handle, err, 1) < 0) {
+        postIOState(QAudio::StoppedState, QAudio::FatalError);
+        return false;
+    }
+    return true;
+}
+
+// Hands state changes detected on the audio thread to the thread owning the sink
+void QAlsaAudioSink::postIOState(QAudio::State state, QAudio::Error error)
+{
+    if (ioState == state && ioError == error)
+        return;
+    ioState = state;
+    ioError = error;
+    QMetaObject::invokeMethod(this, [this, state, error] { ioStateChanged(state, error); },
+                              Qt::QueuedConnection);
+}
+
+void QAlsaAudioSink::ioStateChanged(QAudio::State state, QAudio::Error error)
+{
+    if (deviceState == QAudio::StoppedState || deviceState == QAudio::SuspendedState)
+        return;
+
+    if (state == QAudio::StoppedState)
+        close();
+
+    if (errorState != error) {
+        errorState = error;
+        emit errorChanged(errorState);
+    }
+    if (deviceState != state) {
+        deviceState = state;
+        emit stateChanged(deviceState);
+    }
+}
+
 void QAlsaAudioSink::reset()
 {
+    stopIO();
     if(handle)
         snd_pcm_reset(handle);
 
@@ -728,6 +1020,12 @@ qint64 AlsaOutputPrivate::writeData(const char* data, qint64 len)
     qint64 written = 0;
     if((audioDevice->deviceState == QAudio::ActiveState)
             ||(audioDevice->deviceState == QAudio::IdleState)) {
+        if (audioDevice->ringBuffer) {
+            // The audio thread plays the data, don't block the writer on it
+            written = audioDevice->ringBuffer->write(data, int(qMin<qint64>(len, INT_MAX)));
+            audioDevice->ioThread->wake();
+            return written;
+        }
         while(written < len) {
             int chunk = audioDevice->write(data+written,(len-written));
             if(chunk <= 0)
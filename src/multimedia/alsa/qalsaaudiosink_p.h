@@ -64,6 +64,10 @@
 #include <QtMultimedia/qaudio.h>
 #include <QtMultimedia/qaudiodevice.h>
 #include <private/qaudiosystem_p.h>
+#include <private/qaudioiothread_p.h>
+#include <private/qaudiocallback_p.h>
+
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 
@@ -79,6 +83,7 @@ public:
 
     void start(QIODevice* device) override;
     QIODevice* start() override;
+    void startWithAdapter(std::unique_ptr<QAudioRenderAdapter> adapter) override;
     void stop() override;
     void reset() override;
     void suspend() override;
@@ -94,6 +99,7 @@ public:
     void setVolume(qreal) override;
     qreal volume() const override;
 
+    QAudioIOThread::Metrics ioMetrics() const override;
 
     QIODevice* audioSource;
     QAudioFormat settings;
@@ -113,7 +119,7 @@ private:
     bool resuming;
     int buffer_size;
     int period_size;
-    qint64 totalTimeValue;
+    QAtomicInteger<qint64> totalTimeValue;
     unsigned int buffer_time;
     unsigned int period_time;
     snd_pcm_uframes_t buffer_frames;
@@ -123,6 +129,22 @@ private:
     int setFormat();
     bool open();
     void close();
+    snd_pcm_sframes_t writeMmap(const char *data, snd_pcm_uframes_t frames);
+    bool needsVolume() const { return m_volume < 1.0f || appliedVolume < 1.0f; }
+    void applyVolume(const char *src, char *dst, qint64 len);
+
+    void startPull(QIODevice *device, std::unique_ptr<QAudioRenderAdapter> adapter);
+    bool useIOThread() const { return renderAdapter || QAudioIOThread::isRequested(); }
+    void startIO();
+    void stopIO();
+    bool processIO();
+    qint64 readIO(char *data, qint64 maxLen);
+    qint64 readVolumeIO(char *dst, qint64 maxLen);
+    snd_pcm_sframes_t writeIO(snd_pcm_sframes_t frames);
+    snd_pcm_sframes_t writeMmapIO(snd_pcm_sframes_t frames);
+    bool recoverIO(int err);
+    void postIOState(QAudio::State state, QAudio::Error error);
+    void ioStateChanged(QAudio::State state, QAudio::Error error);
 
     QTimer* timer;
     QByteArray m_device;
@@ -134,6 +156,16 @@ private:
     snd_pcm_format_t pcmformat;
     snd_pcm_hw_params_t *hwparams;
     qreal m_volume;
+    // The volume the last written data ended with, ramped from on changes
+    float appliedVolume = 1.0f;
+
+    // Only used when the device is driven from its own thread
+    std::unique_ptr<QAudioIOThread> ioThread;
+    std::unique_ptr<QAudioRingBuffer> ringBuffer;
+    QAudio::State ioState = QAudio::StoppedState;
+    QAudio::Error ioError = QAudio::NoError;
+    // Set when started with a render callback, which always uses the audio thread
+    std::unique_ptr<QAudioRenderAdapter> renderAdapter;
 };
 
 class AlsaOutputPrivate : public QIODevice
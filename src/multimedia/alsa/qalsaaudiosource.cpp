@@ -68,7 +68,7 @@ QAlsaAudioSource::QAlsaAudioSource(const QByteArray &device)
     period_size = 0;
     buffer_time = 100000;
     period_time = 20000;
-    totalTimeValue = 0;
+    totalTimeValue.storeRelaxed(0);
     errorState = QAudio::NoError;
     deviceState = QAudio::StoppedState;
     audioSource = 0;
@@ -212,6 +212,7 @@ void QAlsaAudioSource::start(QIODevice* device)
 
     pullMode = true;
     audioSource = device;
+    captureAdapter.reset();
 
     deviceState = QAudio::ActiveState;
 
@@ -232,6 +233,7 @@ QIODevice* QAlsaAudioSource::start()
     pullMode = false;
     audioSource = new AlsaInputPrivate(this);
     audioSource->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    captureAdapter.reset();
 
     deviceState = QAudio::IdleState;
 
@@ -243,6 +245,27 @@ QIODevice* QAlsaAudioSource::start()
     return audioSource;
 }
 
+void QAlsaAudioSource::startWithCallback(const QAudioSource::CaptureCallback &callback,
+                                         int blockFrames)
+{
+    if(deviceState != QAudio::StoppedState)
+        close();
+
+    if(!pullMode && audioSource)
+        delete audioSource;
+
+    pullMode = true;
+    audioSource = nullptr;
+    captureAdapter = std::make_unique<QAudioCaptureAdapter>(callback, settings, blockFrames);
+
+    deviceState = QAudio::ActiveState;
+
+    if( !open() )
+        return;
+
+    emit stateChanged(deviceState);
+}
+
 void QAlsaAudioSource::stop()
 {
     if(deviceState == QAudio::StoppedState)
@@ -404,23 +427,29 @@ bool QAlsaAudioSource::open()
     // Step 5: Setup timer
     bytesAvailable = checkBytesReady();
 
+    errorState  = QAudio::NoError;
+
+    totalTimeValue.storeRelaxed(0);
+
+    // Step 6: Start audio processing
+    if (captureAdapter) {
+        startIO();
+        return true;
+    }
+
     if(pullMode)
         connect(audioSource,SIGNAL(readyRead()),this,SLOT(userFeed()));
 
-    // Step 6: Start audio processing
     chunks = buffer_size/period_size;
     timer->start(period_time*chunks/2000);
 
-    errorState  = QAudio::NoError;
-
-    totalTimeValue = 0;
-
     return true;
 }
 
 void QAlsaAudioSource::close()
 {
     timer->stop();
+    stopIO();
 
     if ( handle ) {
         snd_pcm_drop( handle );
@@ -615,10 +644,14 @@ void QAlsaAudioSource::resume()
 
             bytesAvailable = buffer_size;
         }
-        resuming = true;
         deviceState = QAudio::ActiveState;
-        int chunks = buffer_size/period_size;
-        timer->start(period_time*chunks/2000);
+        if (captureAdapter) {
+            startIO();
+        } else {
+            resuming = true;
+            int chunks = buffer_size/period_size;
+            timer->start(period_time*chunks/2000);
+        }
         emit stateChanged(deviceState);
     }
 }
@@ -635,7 +668,7 @@ qsizetype QAlsaAudioSource::bufferSize() const
 
 qint64 QAlsaAudioSource::processedUSecs() const
 {
-    qint64 result = qint64(1000000) * totalTimeValue /
+    qint64 result = qint64(1000000) * totalTimeValue.loadRelaxed() /
         settings.bytesPerFrame() /
         settings.sampleRate();
 
@@ -645,8 +678,9 @@ qint64 QAlsaAudioSource::processedUSecs() const
 void QAlsaAudioSource::suspend()
 {
     if(deviceState == QAudio::ActiveState||resuming) {
-        snd_pcm_drain(handle);
         timer->stop();
+        stopIO();
+        snd_pcm_drain(handle);
         deviceState = QAudio::SuspendedState;
         emit stateChanged(deviceState);
     }
@@ -695,6 +729,106 @@ bool QAlsaAudioSource::deviceReady()
     return true;
 }
 
+QAudioIOThread::Metrics QAlsaAudioSource::ioMetrics() const
+{
+    return ioThread ? ioThread->metrics() : QAudioIOThread::Metrics{};
+}
+
+void QAlsaAudioSource::startIO()
+{
+    if (!ioThread) {
+        ioThread = std::make_unique<QAudioIOThread>(QStringLiteral("ALSA input"),
+                                                    [this] { return processIO(); });
+    }
+    ioBuffer.resize(snd_pcm_frames_to_bytes(handle, buffer_frames));
+
+    ioState = deviceState;
+    ioError = QAudio::NoError;
+    ioThread->start(period_time);
+}
+
+void QAlsaAudioSource::stopIO()
+{
+    if (ioThread)
+        ioThread->stop();
+}
+
+// Runs on the audio thread: waits until at least a period got captured, then
+// hands all whole periods to the capture callback
+bool QAlsaAudioSource::processIO()
+{
+    int err = snd_pcm_wait(handle, qMax(1u, 2 * period_time / 1000));
+    if (err < 0)
+        return recoverIO(err);
+
+    ioThread->callbackStarted();
+
+    snd_pcm_sframes_t frames = snd_pcm_avail_update(handle);
+    if (frames < 0)
+        return recoverIO(frames);
+
+    frames = qMin(frames, snd_pcm_sframes_t(buffer_frames));
+    frames -= frames % snd_pcm_sframes_t(qMax<snd_pcm_uframes_t>(1, period_frames));
+    while (frames > 0 && !ioThread->isStopRequested()) {
+        const snd_pcm_sframes_t read = snd_pcm_readi(handle, ioBuffer.data(), frames);
+        if (read < 0)
+            return recoverIO(read);
+        const qint64 len = snd_pcm_frames_to_bytes(handle, read);
+        captureAdapter->capture(ioBuffer.constData(), len, float(m_volume));
+        totalTimeValue.fetchAndAddRelaxed(len);
+        frames -= read;
+    }
+
+    postIOState(QAudio::ActiveState, QAudio::NoError);
+    return true;
+}
+
+bool QAlsaAudioSource::recoverIO(int err)
+{
+    if (err == -EPIPE)
+        ioThread->underrun();
+
+    if (snd_pcm_recover(handle, err, 1) < 0) {
+        postIOState(QAudio::StoppedState, QAudio::FatalError);
+        return false;
+    }
+    // unlike playback, capture doesn't start again by itself once prepared
+    if (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED && snd_pcm_start(handle) < 0) {
+        postIOState(QAudio::StoppedState, QAudio::FatalError);
+        return false;
+    }
+    return true;
+}
+
+// Hands state changes detected on the audio thread to the thread owning the source
+void QAlsaAudioSource::postIOState(QAudio::State state, QAudio::Error error)
+{
+    if (ioState == state && ioError == error)
+        return;
+    ioState = state;
+    ioError = error;
+    QMetaObject::invokeMethod(this, [this, state, error] { ioStateChanged(state, error); },
+                              Qt::QueuedConnection);
+}
+
+void QAlsaAudioSource::ioStateChanged(QAudio::State state, QAudio::Error error)
+{
+    if (deviceState == QAudio::StoppedState || deviceState == QAudio::SuspendedState)
+        return;
+
+    if (state == QAudio::StoppedState)
+        close();
+
+    if (errorState != error) {
+        errorState = error;
+        emit errorChanged(errorState);
+    }
+    if (deviceState != state) {
+        deviceState = state;
+        emit stateChanged(deviceState);
+    }
+}
+
 void QAlsaAudioSource::reset()
 {
     if(handle)
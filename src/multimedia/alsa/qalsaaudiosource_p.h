@@ -65,6 +65,10 @@
 #include <QtMultimedia/qaudio.h>
 #include <QtMultimedia/qaudiodevice.h>
 #include <private/qaudiosystem_p.h>
+#include <private/qaudioiothread_p.h>
+#include <private/qaudiocallback_p.h>
+
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 
@@ -119,9 +123,13 @@ public:
     QAudioFormat format() const override;
     void setVolume(qreal) override;
     qreal volume() const override;
+
+    void startWithCallback(const QAudioSource::CaptureCallback &callback, int blockFrames) override;
+    QAudioIOThread::Metrics ioMetrics() const override;
+
     bool resuming;
     snd_pcm_t* handle;
-    qint64 totalTimeValue;
+    QAtomicInteger<qint64> totalTimeValue;
     QIODevice* audioSource;
     QAudioFormat settings;
     QAudio::Error errorState;
@@ -139,6 +147,13 @@ private:
     void close();
     void drain();
 
+    void startIO();
+    void stopIO();
+    bool processIO();
+    bool recoverIO(int err);
+    void postIOState(QAudio::State state, QAudio::Error error);
+    void ioStateChanged(QAudio::State state, QAudio::Error error);
+
     QTimer* timer;
     qint64 elapsedTimeOffset;
     RingBuffer ringBuffer;
@@ -155,6 +170,14 @@ private:
     snd_pcm_format_t pcmformat;
     snd_pcm_hw_params_t *hwparams;
     qreal m_volume;
+
+    // Only used when started with a capture callback, which reads the device
+    // from its own thread
+    std::unique_ptr<QAudioCaptureAdapter> captureAdapter;
+    std::unique_ptr<QAudioIOThread> ioThread;
+    QByteArray ioBuffer;
+    QAudio::State ioState = QAudio::StoppedState;
+    QAudio::Error ioError = QAudio::NoError;
 };
 
 class AlsaInputPrivate : public QIODevice
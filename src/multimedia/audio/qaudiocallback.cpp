@@ -0,0 +1,185 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiocallback_p.h"
+#include "qaudiohelpers_p.h"
+
+QT_BEGIN_NAMESPACE
+
+namespace {
+
+// The sample format conversion is done on interleaved floats by the audio
+// helpers, so the planes are only copied here
+void interleave(float *dst, float *const *planes, int channels, int offset, int frames)
+{
+    for (int c = 0; c < channels; ++c) {
+        const float *src = planes[c] + offset;
+        float *d = dst + c;
+        for (int i = 0; i < frames; ++i, d += channels)
+            *d = src[i];
+    }
+}
+
+void deinterleave(float *const *planes, const float *src, int channels, int offset, int frames)
+{
+    for (int c = 0; c < channels; ++c) {
+        float *dst = planes[c] + offset;
+        const float *s = src + c;
+        for (int i = 0; i < frames; ++i, s += channels)
+            dst[i] = *s;
+    }
+}
+
+} // namespace
+
+QAudioRenderAdapter::QAudioRenderAdapter(const QAudioSink::RenderCallback &callback,
+                                         const QAudioFormat &format, int blockFrames)
+    : m_callback(callback),
+      m_format(format),
+      m_blockFrames(qMax(1, blockFrames)),
+      m_consumed(m_blockFrames)
+{
+    const int channels = qMax(1, format.channelCount());
+    m_block.resize(size_t(channels)*m_blockFrames);
+    m_interleaved.resize(size_t(channels)*m_blockFrames);
+    for (int c = 0; c < channels; ++c)
+        m_planes.push_back(m_block.data() + size_t(c)*m_blockFrames);
+}
+
+QAudioRenderAdapter::QAudioRenderAdapter(const InterleavedCallback &callback,
+                                         const QAudioFormat &format, int blockFrames)
+    : m_interleavedCallback(callback),
+      m_format(format),
+      m_blockFrames(qMax(1, blockFrames)),
+      m_consumed(m_blockFrames)
+{
+    // the callback renders straight into m_interleaved, no planes needed
+    m_interleaved.resize(size_t(qMax(1, format.channelCount()))*m_blockFrames);
+}
+
+qint64 QAudioRenderAdapter::render(char *data, qint64 len, float gain)
+{
+    const int bytesPerFrame = m_format.bytesPerFrame();
+    if (bytesPerFrame <= 0)
+        return 0;
+
+    const int channels = qMax(1, m_format.channelCount());
+    const qint64 frames = len/bytesPerFrame;
+    for (qint64 done = 0; done < frames;) {
+        if (m_consumed == m_blockFrames) {
+            if (m_interleavedCallback)
+                m_interleavedCallback(m_interleaved.data(), m_blockFrames);
+            else
+                m_callback(m_planes.data(), m_blockFrames);
+            m_consumed = 0;
+        }
+        const int n = int(qMin<qint64>(frames - done, m_blockFrames - m_consumed));
+        const float *src = m_interleaved.data();
+        if (m_interleavedCallback)
+            src += size_t(m_consumed)*channels;
+        else
+            interleave(m_interleaved.data(), m_planes.data(), channels, m_consumed, n);
+        QAudioHelperInternal::qConvertFromFloat(src, m_format,
+                                                data + done*bytesPerFrame, n*channels, gain);
+        m_consumed += n;
+        done += n;
+    }
+    return frames*bytesPerFrame;
+}
+
+QAudioCaptureAdapter::QAudioCaptureAdapter(const QAudioSource::CaptureCallback &callback,
+                                           const QAudioFormat &format, int blockFrames)
+    : m_callback(callback),
+      m_format(format),
+      m_blockFrames(qMax(1, blockFrames))
+{
+    const int channels = qMax(1, format.channelCount());
+    m_block.resize(size_t(channels)*m_blockFrames);
+    m_interleaved.resize(size_t(channels)*m_blockFrames);
+    for (int c = 0; c < channels; ++c)
+        m_planes.push_back(m_block.data() + size_t(c)*m_blockFrames);
+}
+
+void QAudioCaptureAdapter::capture(const char *data, qint64 len, float gain)
+{
+    const int bytesPerFrame = m_format.bytesPerFrame();
+    if (bytesPerFrame <= 0)
+        return;
+
+    const int channels = int(m_planes.size());
+    const qint64 frames = len/bytesPerFrame;
+    for (qint64 done = 0; done < frames;) {
+        const int n = int(qMin<qint64>(frames - done, m_blockFrames - m_filled));
+        QAudioHelperInternal::qConvertToFloat(m_format, data + done*bytesPerFrame,
+                                              m_interleaved.data(), n*channels, gain);
+        deinterleave(m_planes.data(), m_interleaved.data(), channels, m_filled, n);
+        m_filled += n;
+        done += n;
+        if (m_filled == m_blockFrames) {
+            m_callback(m_planes.data(), m_blockFrames);
+            m_filled = 0;
+        }
+    }
+}
+
+QAudioRenderDevice::QAudioRenderDevice(std::unique_ptr<QAudioRenderAdapter> adapter)
+    : m_adapter(std::move(adapter))
+{
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+qint64 QAudioRenderDevice::readData(char *data, qint64 len)
+{
+    return m_adapter->render(data, len);
+}
+
+QAudioCaptureDevice::QAudioCaptureDevice(const QAudioSource::CaptureCallback &callback,
+                                         const QAudioFormat &format, int blockFrames)
+    : m_adapter(callback, format, blockFrames)
+{
+    open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+}
+
+qint64 QAudioCaptureDevice::writeData(const char *data, qint64 len)
+{
+    m_adapter.capture(data, len);
+    return len;
+}
+
+QT_END_NAMESPACE
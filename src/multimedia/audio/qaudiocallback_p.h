@@ -0,0 +1,161 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QAUDIOCALLBACK_P_H
+#define QAUDIOCALLBACK_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtMultimedia/qaudioformat.h>
+#include <QtMultimedia/qaudiosink.h>
+#include <QtMultimedia/qaudiosource.h>
+#include <QtCore/qiodevice.h>
+#include <private/qglobal_p.h>
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+// Calls a QAudioSink::RenderCallback with blocks of a fixed size and
+// interleaves the result into the sample format of the device. Requests that
+// don't line up with the block size are served from the rest of the previous
+// block. render() does not allocate and can be called from the audio thread.
+class Q_MULTIMEDIA_EXPORT QAudioRenderAdapter
+{
+public:
+    // Fills out with frames interleaved float frames. Used by renderers that
+    // produce interleaved data anyway, so it doesn't get split into planes
+    // only to be interleaved again for the device.
+    using InterleavedCallback = std::function<void(float *out, int frames)>;
+
+    QAudioRenderAdapter(const QAudioSink::RenderCallback &callback, const QAudioFormat &format,
+                        int blockFrames);
+    QAudioRenderAdapter(const InterleavedCallback &callback, const QAudioFormat &format,
+                        int blockFrames);
+
+    // Fills all whole frames fitting into len bytes, scaled by gain, and
+    // returns the number of bytes written
+    qint64 render(char *data, qint64 len, float gain = 1.f);
+
+    int blockFrames() const { return m_blockFrames; }
+
+private:
+    QAudioSink::RenderCallback m_callback;
+    InterleavedCallback m_interleavedCallback;
+    QAudioFormat m_format;
+    int m_blockFrames = 0;
+    int m_consumed = 0;
+    std::vector<float> m_block;
+    std::vector<float> m_interleaved;
+    std::vector<float *> m_planes;
+};
+
+// The counterpart of QAudioRenderAdapter for QAudioSource: collects captured
+// frames in the device format and hands them out as planar float blocks.
+class Q_MULTIMEDIA_EXPORT QAudioCaptureAdapter
+{
+public:
+    QAudioCaptureAdapter(const QAudioSource::CaptureCallback &callback, const QAudioFormat &format,
+                         int blockFrames);
+
+    // Consumes all whole frames in len bytes, scaled by gain, calling the
+    // callback for every block that got completed
+    void capture(const char *data, qint64 len, float gain = 1.f);
+
+    int blockFrames() const { return m_blockFrames; }
+
+private:
+    QAudioSource::CaptureCallback m_callback;
+    QAudioFormat m_format;
+    int m_blockFrames = 0;
+    int m_filled = 0;
+    std::vector<float> m_block;
+    std::vector<float> m_interleaved;
+    std::vector<float *> m_planes;
+};
+
+// QIODevice front ends for backends that only know about QIODevice
+class QAudioRenderDevice : public QIODevice
+{
+public:
+    explicit QAudioRenderDevice(std::unique_ptr<QAudioRenderAdapter> adapter);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return std::numeric_limits<qint64>::max(); }
+    bool atEnd() const override { return false; }
+
+protected:
+    qint64 readData(char *data, qint64 len) override;
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    std::unique_ptr<QAudioRenderAdapter> m_adapter;
+};
+
+class QAudioCaptureDevice : public QIODevice
+{
+public:
+    QAudioCaptureDevice(const QAudioSource::CaptureCallback &callback, const QAudioFormat &format,
+                        int blockFrames);
+
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char *, qint64) override { return -1; }
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    QAudioCaptureAdapter m_adapter;
+};
+
+QT_END_NAMESPACE
+
+#endif // QAUDIOCALLBACK_P_H
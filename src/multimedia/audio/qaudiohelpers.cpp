@@ -40,59 +40,175 @@
 #include "qaudiohelpers_p.h"
 
 #include <QDebug>
+#include <private/qsimd_p.h>
 
 QT_BEGIN_NAMESPACE
 
 namespace QAudioHelperInternal
 {
 
-template<class T> void adjustSamples(qreal factor, const void *src, void *dst, int samples)
+namespace {
+
+template<typename T>
+void QT_FASTCALL gainKernel(const void *src, void *dst, int samples, float gain, float step)
+{
+    gainSamples(static_cast<const T *>(src), static_cast<T *>(dst), 0, samples, gain, step);
+}
+
+template<typename T>
+void QT_FASTCALL fromFloatKernel(const float *src, void *dst, int samples, float gain, float step)
+{
+    fromFloatSamples(src, static_cast<T *>(dst), 0, samples,
+                     gain*Sample<T>::scale, step*Sample<T>::scale);
+}
+
+template<typename T>
+void QT_FASTCALL toFloatKernel(const void *src, float *dst, int samples, float gain, float step)
 {
-    const T *pSrc = (const T *)src;
-    T *pDst = (T*)dst;
-    for ( int i = 0; i < samples; i++ )
-        pDst[i] = pSrc[i] * factor;
+    toFloatSamples(static_cast<const T *>(src), dst, 0, samples,
+                   gain/Sample<T>::scale, step/Sample<T>::scale);
 }
 
-// Unsigned samples are biased around 0x80/0x8000 :/
-// This makes a pure template solution a bit unwieldy but possible
-template<class T> struct signedVersion {};
-template<> struct signedVersion<quint8>
+}
+
+const Kernels &genericKernels()
 {
-    using TS = qint8;
-    enum {offset = 0x80};
-};
+    static const Kernels k = {
+        { nullptr, gainKernel<quint8>, gainKernel<qint16>, gainKernel<qint32>, gainKernel<float> },
+        { nullptr, fromFloatKernel<quint8>, fromFloatKernel<qint16>,
+          fromFloatKernel<qint32>, fromFloatKernel<float> },
+        { nullptr, toFloatKernel<quint8>, toFloatKernel<qint16>,
+          toFloatKernel<qint32>, toFloatKernel<float> }
+    };
+    return k;
+}
+
+// The SIMD kernels only replace some of the generic ones
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+void QT_FASTCALL qt_gain_UInt8_sse2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Int16_sse2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Int32_sse2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Float_sse2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_convert_Float_to_Int16_sse2(const float *, void *, int, float, float);
+void QT_FASTCALL qt_convert_Int16_to_Float_sse2(const void *, float *, int, float, float);
+
+static Kernels sse2Kernels()
+{
+    Kernels k = genericKernels();
+    k.gain[QAudioFormat::UInt8] = qt_gain_UInt8_sse2;
+    k.gain[QAudioFormat::Int16] = qt_gain_Int16_sse2;
+    k.gain[QAudioFormat::Int32] = qt_gain_Int32_sse2;
+    k.gain[QAudioFormat::Float] = qt_gain_Float_sse2;
+    k.fromFloat[QAudioFormat::Int16] = qt_convert_Float_to_Int16_sse2;
+    k.toFloat[QAudioFormat::Int16] = qt_convert_Int16_to_Float_sse2;
+    return k;
+}
+#endif
+
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+void QT_FASTCALL qt_gain_UInt8_avx2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Int16_avx2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Int32_avx2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Float_avx2(const void *, void *, int, float, float);
+void QT_FASTCALL qt_convert_Float_to_Int16_avx2(const float *, void *, int, float, float);
+void QT_FASTCALL qt_convert_Int16_to_Float_avx2(const void *, float *, int, float, float);
+
+static Kernels avx2Kernels()
+{
+    Kernels k = genericKernels();
+    k.gain[QAudioFormat::UInt8] = qt_gain_UInt8_avx2;
+    k.gain[QAudioFormat::Int16] = qt_gain_Int16_avx2;
+    k.gain[QAudioFormat::Int32] = qt_gain_Int32_avx2;
+    k.gain[QAudioFormat::Float] = qt_gain_Float_avx2;
+    k.fromFloat[QAudioFormat::Int16] = qt_convert_Float_to_Int16_avx2;
+    k.toFloat[QAudioFormat::Int16] = qt_convert_Int16_to_Float_avx2;
+    return k;
+}
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+void QT_FASTCALL qt_gain_UInt8_neon(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Int16_neon(const void *, void *, int, float, float);
+void QT_FASTCALL qt_gain_Float_neon(const void *, void *, int, float, float);
+void QT_FASTCALL qt_convert_Float_to_Int16_neon(const float *, void *, int, float, float);
+void QT_FASTCALL qt_convert_Int16_to_Float_neon(const void *, float *, int, float, float);
 
-template<class T> void adjustUnsignedSamples(qreal factor, const void *src, void *dst, int samples)
+// 32 bit samples need double precision, which 32 bit NEON lacks, so they
+// stay with the generic kernel
+static Kernels neonKernels()
 {
-    const T *pSrc = (const T *)src;
-    T *pDst = (T*)dst;
-    for ( int i = 0; i < samples; i++ ) {
-        pDst[i] = signedVersion<T>::offset + ((typename signedVersion<T>::TS)(pSrc[i] - signedVersion<T>::offset) * factor);
-    }
+    Kernels k = genericKernels();
+    k.gain[QAudioFormat::UInt8] = qt_gain_UInt8_neon;
+    k.gain[QAudioFormat::Int16] = qt_gain_Int16_neon;
+    k.gain[QAudioFormat::Float] = qt_gain_Float_neon;
+    k.fromFloat[QAudioFormat::Int16] = qt_convert_Float_to_Int16_neon;
+    k.toFloat[QAudioFormat::Int16] = qt_convert_Int16_to_Float_neon;
+    return k;
+}
+#endif
+
+QList<NamedKernels> simdKernels()
+{
+    QList<NamedKernels> result;
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+    if (qCpuHasFeature(AVX2))
+        result.append({ "avx2", avx2Kernels() });
+#endif
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+    if (qCpuHasFeature(SSE2))
+        result.append({ "sse2", sse2Kernels() });
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    if (qCpuHasFeature(NEON))
+        result.append({ "neon", neonKernels() });
+#endif
+    return result;
+}
+
+// Picks the best kernels for the CPU once; thread safe, as the sinks and
+// sources call into this from their own threads
+const Kernels &kernels()
+{
+    static const Kernels k = [] {
+        const QList<NamedKernels> simd = simdKernels();
+        return simd.isEmpty() ? genericKernels() : simd.constFirst().kernels;
+    }();
+    return k;
 }
 
 void qMultiplySamples(qreal factor, const QAudioFormat &format, const void* src, void* dest, int len)
 {
+    qMultiplySamples(float(factor), float(factor), format, src, dest, len);
+}
+
+void qMultiplySamples(float startGain, float endGain, const QAudioFormat &format,
+                      const void *src, void *dest, int len)
+{
+    const auto sampleFormat = format.sampleFormat();
+    if (sampleFormat == QAudioFormat::Unknown || sampleFormat == QAudioFormat::NSampleFormats)
+        return;
+
     const int samplesCount = len / qMax(1, format.bytesPerSample());
+    if (samplesCount <= 0)
+        return;
+    const float step = (endGain - startGain)/samplesCount;
+    kernels().gain[sampleFormat](src, dest, samplesCount, startGain, step);
+}
 
-    switch (format.sampleFormat()) {
-    case QAudioFormat::Unknown:
-    case QAudioFormat::NSampleFormats:
+void qConvertFromFloat(const float *src, const QAudioFormat &format, void *dest, int samples, float gain)
+{
+    const auto sampleFormat = format.sampleFormat();
+    if (sampleFormat == QAudioFormat::Unknown || sampleFormat == QAudioFormat::NSampleFormats)
+        return;
+    kernels().fromFloat[sampleFormat](src, dest, samples, gain, 0.f);
+}
+
+void qConvertToFloat(const QAudioFormat &format, const void *src, float *dest, int samples, float gain)
+{
+    const auto sampleFormat = format.sampleFormat();
+    if (sampleFormat == QAudioFormat::Unknown || sampleFormat == QAudioFormat::NSampleFormats)
         return;
-    case QAudioFormat::UInt8:
-        QAudioHelperInternal::adjustUnsignedSamples<quint8>(factor,src,dest,samplesCount);
-        break;
-    case QAudioFormat::Int16:
-        QAudioHelperInternal::adjustSamples<qint16>(factor,src,dest,samplesCount);
-        break;
-    case QAudioFormat::Int32:
-        QAudioHelperInternal::adjustSamples<qint32>(factor,src,dest,samplesCount);
-        break;
-    case QAudioFormat::Float:
-        QAudioHelperInternal::adjustSamples<float>(factor,src,dest,samplesCount);
-        break;
-    }
+    kernels().toFloat[sampleFormat](src, dest, samples, gain, 0.f);
 }
 }
 
@@ -0,0 +1,193 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiohelpers_p.h"
+
+#include <private/qsimd_p.h>
+
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+
+QT_BEGIN_NAMESPACE
+
+namespace QAudioHelperInternal
+{
+
+namespace {
+
+// Gains of the eight samples starting at i
+inline __m256 gains(float gain, float step, __m256 lanes, int i)
+{
+    return _mm256_add_ps(_mm256_set1_ps(gain + step*i), lanes);
+}
+
+inline __m256 laneSteps(float step)
+{
+    return _mm256_mul_ps(_mm256_set1_ps(step), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+}
+
+inline void int16ToFloat(__m256i v, __m256 &lo, __m256 &hi)
+{
+    lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+    hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+}
+
+// Rounds to nearest and saturates; the pack works per 128 bit lane, so the
+// 64 bit blocks have to be put back in order
+inline __m256i floatToInt16(__m256 lo, __m256 hi)
+{
+    const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(lo), _mm256_cvtps_epi32(hi));
+    return _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+}
+
+void QT_FASTCALL qt_gain_UInt8_avx2(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const quint8 *>(src);
+    auto *d = static_cast<quint8 *>(dst);
+    const __m256 lanes = laneSteps(step);
+    const __m128i bias = _mm_set1_epi8(char(UInt8Offset));
+
+    int i = 0;
+    for (; i < samples - 15; i += 16) {
+        // remove the bias, then sign extend
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), bias);
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(v, 8)));
+        lo = _mm256_mul_ps(lo, gains(gain, step, lanes, i));
+        hi = _mm256_mul_ps(hi, gains(gain, step, lanes, i + 8));
+        const __m256i words = floatToInt16(lo, hi);
+        const __m128i r = _mm_packs_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), _mm_xor_si128(r, bias));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Int16_avx2(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const qint16 *>(src);
+    auto *d = static_cast<qint16 *>(dst);
+    const __m256 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 15; i += 16) {
+        __m256 lo, hi;
+        int16ToFloat(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)), lo, hi);
+        lo = _mm256_mul_ps(lo, gains(gain, step, lanes, i));
+        hi = _mm256_mul_ps(hi, gains(gain, step, lanes, i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i), floatToInt16(lo, hi));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Int32_avx2(const void *src, void *dst, int samples, float gain, float step)
+{
+    // scaled in double, like gainSamples() does for 32 bit samples
+    auto *s = static_cast<const qint32 *>(src);
+    auto *d = static_cast<qint32 *>(dst);
+    const __m256d lanes = _mm256_mul_pd(_mm256_set1_pd(step), _mm256_setr_pd(0., 1., 2., 3.));
+    const __m256d max = _mm256_set1_pd(2147483647.);
+    const __m256d min = _mm256_set1_pd(-2147483648.);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+        __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(v));
+        __m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1));
+        lo = _mm256_mul_pd(lo, _mm256_add_pd(_mm256_set1_pd(double(gain) + double(step)*i), lanes));
+        hi = _mm256_mul_pd(hi, _mm256_add_pd(_mm256_set1_pd(double(gain) + double(step)*(i + 4)), lanes));
+        lo = _mm256_max_pd(_mm256_min_pd(lo, max), min);
+        hi = _mm256_max_pd(_mm256_min_pd(hi, max), min);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i),
+                            _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvtpd_epi32(lo)),
+                                                    _mm256_cvtpd_epi32(hi), 1));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Float_avx2(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const float *>(src);
+    auto *d = static_cast<float *>(dst);
+    const __m256 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8)
+        _mm256_storeu_ps(d + i, _mm256_mul_ps(_mm256_loadu_ps(s + i), gains(gain, step, lanes, i)));
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_convert_Float_to_Int16_avx2(const float *src, void *dst, int samples, float gain, float step)
+{
+    auto *d = static_cast<qint16 *>(dst);
+    gain *= Int16Scale;
+    step *= Int16Scale;
+    const __m256 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 15; i += 16) {
+        const __m256 lo = _mm256_mul_ps(_mm256_loadu_ps(src + i), gains(gain, step, lanes, i));
+        const __m256 hi = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), gains(gain, step, lanes, i + 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(d + i), floatToInt16(lo, hi));
+    }
+    fromFloatSamples(src, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_convert_Int16_to_Float_avx2(const void *src, float *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const qint16 *>(src);
+    gain /= Int16Scale;
+    step /= Int16Scale;
+    const __m256 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 15; i += 16) {
+        __m256 lo, hi;
+        int16ToFloat(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)), lo, hi);
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(lo, gains(gain, step, lanes, i)));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(hi, gains(gain, step, lanes, i + 8)));
+    }
+    toFloatSamples(s, dst, i, samples, gain, step);
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,177 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiohelpers_p.h"
+
+#include <private/qsimd_p.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+QT_BEGIN_NAMESPACE
+
+namespace QAudioHelperInternal
+{
+
+namespace {
+
+// Gains of the four samples starting at i
+inline float32x4_t gains(float gain, float step, float32x4_t lanes, int i)
+{
+    return vaddq_f32(vdupq_n_f32(gain + step*i), lanes);
+}
+
+inline float32x4_t laneSteps(float step)
+{
+    static const float lanes[4] = { 0.f, 1.f, 2.f, 3.f };
+    return vmulq_n_f32(vld1q_f32(lanes), step);
+}
+
+inline int32x4_t roundToInt(float32x4_t v)
+{
+#if defined(Q_PROCESSOR_ARM_64)
+    return vcvtnq_s32_f32(v);
+#else
+    // vcvtq rounds towards zero
+    const uint32x4_t negative = vcltq_f32(v, vdupq_n_f32(0.f));
+    return vcvtq_s32_f32(vaddq_f32(v, vbslq_f32(negative, vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f))));
+#endif
+}
+
+inline void int16ToFloat(int16x8_t v, float32x4_t &lo, float32x4_t &hi)
+{
+    lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+    hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+}
+
+// Rounds to nearest and saturates
+inline int16x8_t floatToInt16(float32x4_t lo, float32x4_t hi)
+{
+    return vcombine_s16(vqmovn_s32(roundToInt(lo)), vqmovn_s32(roundToInt(hi)));
+}
+
+}
+
+void QT_FASTCALL qt_gain_UInt8_neon(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const quint8 *>(src);
+    auto *d = static_cast<quint8 *>(dst);
+    const float32x4_t lanes = laneSteps(step);
+    const uint8x8_t bias = vdup_n_u8(UInt8Offset);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        // remove the bias, then sign extend
+        const int8x8_t v = vreinterpret_s8_u8(veor_u8(vld1_u8(s + i), bias));
+        float32x4_t lo, hi;
+        int16ToFloat(vmovl_s8(v), lo, hi);
+        lo = vmulq_f32(lo, gains(gain, step, lanes, i));
+        hi = vmulq_f32(hi, gains(gain, step, lanes, i + 4));
+        const int8x8_t r = vqmovn_s16(floatToInt16(lo, hi));
+        vst1_u8(d + i, veor_u8(vreinterpret_u8_s8(r), bias));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Int16_neon(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const qint16 *>(src);
+    auto *d = static_cast<qint16 *>(dst);
+    const float32x4_t lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        float32x4_t lo, hi;
+        int16ToFloat(vld1q_s16(s + i), lo, hi);
+        lo = vmulq_f32(lo, gains(gain, step, lanes, i));
+        hi = vmulq_f32(hi, gains(gain, step, lanes, i + 4));
+        vst1q_s16(d + i, floatToInt16(lo, hi));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Float_neon(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const float *>(src);
+    auto *d = static_cast<float *>(dst);
+    const float32x4_t lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 3; i += 4)
+        vst1q_f32(d + i, vmulq_f32(vld1q_f32(s + i), gains(gain, step, lanes, i)));
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_convert_Float_to_Int16_neon(const float *src, void *dst, int samples, float gain, float step)
+{
+    auto *d = static_cast<qint16 *>(dst);
+    gain *= Int16Scale;
+    step *= Int16Scale;
+    const float32x4_t lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        const float32x4_t lo = vmulq_f32(vld1q_f32(src + i), gains(gain, step, lanes, i));
+        const float32x4_t hi = vmulq_f32(vld1q_f32(src + i + 4), gains(gain, step, lanes, i + 4));
+        vst1q_s16(d + i, floatToInt16(lo, hi));
+    }
+    fromFloatSamples(src, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_convert_Int16_to_Float_neon(const void *src, float *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const qint16 *>(src);
+    gain /= Int16Scale;
+    step /= Int16Scale;
+    const float32x4_t lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        float32x4_t lo, hi;
+        int16ToFloat(vld1q_s16(s + i), lo, hi);
+        vst1q_f32(dst + i, vmulq_f32(lo, gains(gain, step, lanes, i)));
+        vst1q_f32(dst + i + 4, vmulq_f32(hi, gains(gain, step, lanes, i + 4)));
+    }
+    toFloatSamples(s, dst, i, samples, gain, step);
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif
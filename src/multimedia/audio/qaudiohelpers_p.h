@@ -53,12 +53,130 @@
 
 #include <qaudioformat.h>
 #include <private/qglobal_p.h>
+#include <QtCore/qlist.h>
+
+#include <cmath>
 
 QT_BEGIN_NAMESPACE
 
 namespace QAudioHelperInternal
 {
 Q_MULTIMEDIA_EXPORT void qMultiplySamples(qreal factor, const QAudioFormat& format, const void *src, void* dest, int len);
+
+// Applies a gain moving linearly from startGain to endGain over the len bytes,
+// to avoid zipper noise when the volume changes between two buffers
+Q_MULTIMEDIA_EXPORT void qMultiplySamples(float startGain, float endGain, const QAudioFormat &format,
+                                          const void *src, void *dest, int len);
+
+// Convert between normalized float samples and format, applying gain and
+// saturating in the same pass
+Q_MULTIMEDIA_EXPORT void qConvertFromFloat(const float *src, const QAudioFormat &format, void *dest,
+                                           int samples, float gain = 1.f);
+Q_MULTIMEDIA_EXPORT void qConvertToFloat(const QAudioFormat &format, const void *src, float *dest,
+                                         int samples, float gain = 1.f);
+
+// The kernels behind the functions above, one per sample format. gain is
+// the gain of the first sample, step gets added for every following one.
+typedef void (QT_FASTCALL *GainFunc)(const void *src, void *dst, int samples, float gain, float step);
+typedef void (QT_FASTCALL *FromFloatFunc)(const float *src, void *dst, int samples, float gain, float step);
+typedef void (QT_FASTCALL *ToFloatFunc)(const void *src, float *dst, int samples, float gain, float step);
+
+struct Kernels
+{
+    GainFunc gain[QAudioFormat::NSampleFormats];
+    FromFloatFunc fromFloat[QAudioFormat::NSampleFormats];
+    ToFloatFunc toFloat[QAudioFormat::NSampleFormats];
+};
+// the kernels used by the functions above, picked for the CPU
+Q_MULTIMEDIA_EXPORT const Kernels &kernels();
+Q_MULTIMEDIA_EXPORT const Kernels &genericKernels();
+
+struct NamedKernels
+{
+    const char *name;
+    Kernels kernels;
+};
+// all SIMD kernels the CPU can run, for testing
+Q_MULTIMEDIA_EXPORT QList<NamedKernels> simdKernels();
+
+// Scales used for converting from and to float. UInt8 samples are biased
+// around UInt8Offset, like for the gain.
+constexpr float Int16Scale = 32767.f;
+constexpr float Int32Scale = 2147483647.f;
+constexpr float UInt8Scale = 127.f;
+constexpr int UInt8Offset = 0x80;
+
+// Scalar conversions between sample values and unnormalized floats. Also
+// used for the leftovers of the SIMD kernels.
+template<typename T> struct Sample;
+template<> struct Sample<quint8>
+{
+    static constexpr float scale = UInt8Scale;
+    static float toFloat(quint8 v) { return float(int(v) - UInt8Offset); }
+    static quint8 fromFloat(float v) { return quint8(qBound(0L, std::lrint(v) + UInt8Offset, 255L)); }
+};
+template<> struct Sample<qint16>
+{
+    static constexpr float scale = Int16Scale;
+    static float toFloat(qint16 v) { return float(v); }
+    static qint16 fromFloat(float v) { return qint16(qBound(-32768L, std::lrint(v), 32767L)); }
+};
+template<> struct Sample<qint32>
+{
+    static constexpr float scale = Int32Scale;
+    static float toFloat(qint32 v) { return float(v); }
+    static qint32 fromFloat(float v) { return fromDouble(v); }
+    static qint32 fromDouble(double v) { return qint32(std::lrint(qBound(-2147483648., v, 2147483647.))); }
+};
+template<> struct Sample<float>
+{
+    static constexpr float scale = 1.f;
+    static float toFloat(float v) { return v; }
+    static float fromFloat(float v) { return v; }
+};
+
+template<typename T>
+inline void gainSamples(const T *src, T *dst, int from, int to, float gain, float step)
+{
+    for (int i = from; i < to; ++i)
+        dst[i] = Sample<T>::fromFloat(Sample<T>::toFloat(src[i])*(gain + step*i));
+}
+
+template<typename T>
+inline void fromFloatSamples(const float *src, T *dst, int from, int to, float gain, float step)
+{
+    for (int i = from; i < to; ++i)
+        dst[i] = Sample<T>::fromFloat(src[i]*(gain + step*i));
+}
+
+template<typename T>
+inline void toFloatSamples(const T *src, float *dst, int from, int to, float gain, float step)
+{
+    for (int i = from; i < to; ++i)
+        dst[i] = Sample<T>::toFloat(src[i])*(gain + step*i);
+}
+
+// 32 bit samples don't fit into a float mantissa, so they are scaled in double
+template<>
+inline void gainSamples(const qint32 *src, qint32 *dst, int from, int to, float gain, float step)
+{
+    for (int i = from; i < to; ++i)
+        dst[i] = Sample<qint32>::fromDouble(double(src[i])*(double(gain) + double(step)*i));
+}
+
+template<>
+inline void fromFloatSamples(const float *src, qint32 *dst, int from, int to, float gain, float step)
+{
+    for (int i = from; i < to; ++i)
+        dst[i] = Sample<qint32>::fromDouble(double(src[i])*(double(gain) + double(step)*i));
+}
+
+template<>
+inline void toFloatSamples(const qint32 *src, float *dst, int from, int to, float gain, float step)
+{
+    for (int i = from; i < to; ++i)
+        dst[i] = float(double(src[i])*(double(gain) + double(step)*i));
+}
 }
 
 QT_END_NAMESPACE
@@ -0,0 +1,194 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiohelpers_p.h"
+
+#include <private/qsimd_p.h>
+
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+
+QT_BEGIN_NAMESPACE
+
+namespace QAudioHelperInternal
+{
+
+namespace {
+
+// Gains of the four samples starting at i
+inline __m128 gains(float gain, float step, __m128 lanes, int i)
+{
+    return _mm_add_ps(_mm_set1_ps(gain + step*i), lanes);
+}
+
+inline __m128 laneSteps(float step)
+{
+    return _mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+}
+
+inline void int16ToFloat(__m128i v, __m128 &lo, __m128 &hi)
+{
+    lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+    hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+}
+
+// Rounds to nearest and saturates
+inline __m128i floatToInt16(__m128 lo, __m128 hi)
+{
+    return _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+}
+
+}
+
+void QT_FASTCALL qt_gain_UInt8_sse2(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const quint8 *>(src);
+    auto *d = static_cast<quint8 *>(dst);
+    const __m128 lanes = laneSteps(step);
+    const __m128i bias = _mm_set1_epi8(char(UInt8Offset));
+
+    int i = 0;
+    for (; i < samples - 15; i += 16) {
+        // remove the bias, then sign extend to 16 bit
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), bias);
+        const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+        const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+        __m128 f0, f1, f2, f3;
+        int16ToFloat(lo, f0, f1);
+        int16ToFloat(hi, f2, f3);
+        f0 = _mm_mul_ps(f0, gains(gain, step, lanes, i));
+        f1 = _mm_mul_ps(f1, gains(gain, step, lanes, i + 4));
+        f2 = _mm_mul_ps(f2, gains(gain, step, lanes, i + 8));
+        f3 = _mm_mul_ps(f3, gains(gain, step, lanes, i + 12));
+        const __m128i r = _mm_packs_epi16(floatToInt16(f0, f1), floatToInt16(f2, f3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), _mm_xor_si128(r, bias));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Int16_sse2(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const qint16 *>(src);
+    auto *d = static_cast<qint16 *>(dst);
+    const __m128 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        __m128 lo, hi;
+        int16ToFloat(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), lo, hi);
+        lo = _mm_mul_ps(lo, gains(gain, step, lanes, i));
+        hi = _mm_mul_ps(hi, gains(gain, step, lanes, i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), floatToInt16(lo, hi));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Int32_sse2(const void *src, void *dst, int samples, float gain, float step)
+{
+    // scaled in double, like gainSamples() does for 32 bit samples
+    auto *s = static_cast<const qint32 *>(src);
+    auto *d = static_cast<qint32 *>(dst);
+    const __m128d lanes = _mm_mul_pd(_mm_set1_pd(step), _mm_setr_pd(0., 1.));
+    const __m128d max = _mm_set1_pd(2147483647.);
+    const __m128d min = _mm_set1_pd(-2147483648.);
+
+    int i = 0;
+    for (; i < samples - 3; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        __m128d lo = _mm_cvtepi32_pd(v);
+        __m128d hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        lo = _mm_mul_pd(lo, _mm_add_pd(_mm_set1_pd(double(gain) + double(step)*i), lanes));
+        hi = _mm_mul_pd(hi, _mm_add_pd(_mm_set1_pd(double(gain) + double(step)*(i + 2)), lanes));
+        lo = _mm_max_pd(_mm_min_pd(lo, max), min);
+        hi = _mm_max_pd(_mm_min_pd(hi, max), min);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i),
+                         _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi)));
+    }
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_gain_Float_sse2(const void *src, void *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const float *>(src);
+    auto *d = static_cast<float *>(dst);
+    const __m128 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 3; i += 4)
+        _mm_storeu_ps(d + i, _mm_mul_ps(_mm_loadu_ps(s + i), gains(gain, step, lanes, i)));
+    gainSamples(s, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_convert_Float_to_Int16_sse2(const float *src, void *dst, int samples, float gain, float step)
+{
+    auto *d = static_cast<qint16 *>(dst);
+    gain *= Int16Scale;
+    step *= Int16Scale;
+    const __m128 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        const __m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), gains(gain, step, lanes, i));
+        const __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4), gains(gain, step, lanes, i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(d + i), floatToInt16(lo, hi));
+    }
+    fromFloatSamples(src, d, i, samples, gain, step);
+}
+
+void QT_FASTCALL qt_convert_Int16_to_Float_sse2(const void *src, float *dst, int samples, float gain, float step)
+{
+    auto *s = static_cast<const qint16 *>(src);
+    gain /= Int16Scale;
+    step /= Int16Scale;
+    const __m128 lanes = laneSteps(step);
+
+    int i = 0;
+    for (; i < samples - 7; i += 8) {
+        __m128 lo, hi;
+        int16ToFloat(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), lo, hi);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(lo, gains(gain, step, lanes, i)));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(hi, gains(gain, step, lanes, i + 4)));
+    }
+    toFloatSamples(s, dst, i, samples, gain, step);
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif
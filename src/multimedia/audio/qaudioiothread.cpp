@@ -0,0 +1,186 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudioiothread_p.h"
+
+#include <QtCore/qdebug.h>
+#include <QtCore/qloggingcategory.h>
+
+#if defined(Q_OS_UNIX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+Q_LOGGING_CATEGORY(qLcAudioIOThread, "qt.multimedia.audio.iothread")
+
+QAudioRingBuffer::QAudioRingBuffer(int size)
+    : m_buffer(new char[size]),
+      m_size(size)
+{
+}
+
+int QAudioRingBuffer::write(const char *data, int len)
+{
+    const int n = qMin(len, free());
+    const int first = qMin(n, m_size - m_writePos);
+    memcpy(m_buffer.get() + m_writePos, data, first);
+    memcpy(m_buffer.get(), data + first, n - first);
+    m_writePos = (m_writePos + n) % m_size;
+    m_used.fetchAndAddRelease(n);
+    return n;
+}
+
+int QAudioRingBuffer::read(char *data, int len)
+{
+    const int n = qMin(len, used());
+    const int first = qMin(n, m_size - m_readPos);
+    memcpy(data, m_buffer.get() + m_readPos, first);
+    memcpy(data + first, m_buffer.get(), n - first);
+    m_readPos = (m_readPos + n) % m_size;
+    m_used.fetchAndAddRelease(-n);
+    return n;
+}
+
+void QAudioRingBuffer::reset()
+{
+    m_readPos = 0;
+    m_writePos = 0;
+    m_used.storeRelease(0);
+}
+
+/*
+    Audio backends that support it run their device I/O on a QAudioIOThread
+    when QT_AUDIO_IO_THREAD is set to 1. QT_AUDIO_IO_THREAD_PRIORITY gives the
+    SCHED_FIFO priority (1-99) for the thread; without it, or where real-time
+    scheduling isn't permitted, the thread runs at TimeCriticalPriority.
+*/
+QAudioIOThread::QAudioIOThread(const QString &name, std::function<bool()> process)
+    : m_process(std::move(process)),
+      m_priority(qEnvironmentVariableIntValue("QT_AUDIO_IO_THREAD_PRIORITY"))
+{
+    setObjectName(name);
+}
+
+QAudioIOThread::~QAudioIOThread()
+{
+    stop();
+}
+
+bool QAudioIOThread::isRequested()
+{
+    static const bool requested = qEnvironmentVariableIntValue("QT_AUDIO_IO_THREAD") > 0;
+    return requested;
+}
+
+void QAudioIOThread::start(qint64 periodUs)
+{
+    Q_ASSERT(!isRunning());
+    m_periodUs = periodUs;
+    m_lastCallbackUs = -1;
+    m_stopRequested.storeRelease(false);
+    m_wakeup.tryAcquire(m_wakeup.available());
+    QThread::start(QThread::TimeCriticalPriority);
+}
+
+void QAudioIOThread::stop()
+{
+    m_stopRequested.storeRelease(true);
+    wake();
+    wait();
+
+    const Metrics m = metrics();
+    if (m.underruns || m.maxJitterUs)
+        qCDebug(qLcAudioIOThread) << objectName() << "underruns:" << m.underruns
+                                  << "max jitter (us):" << m.maxJitterUs;
+}
+
+void QAudioIOThread::wake()
+{
+    if (!m_wakeup.available())
+        m_wakeup.release();
+}
+
+void QAudioIOThread::waitForWake(qint64 timeoutUs)
+{
+    m_wakeup.tryAcquire(1, qMax<qint64>(1, timeoutUs / 1000));
+}
+
+void QAudioIOThread::callbackStarted()
+{
+    const qint64 now = m_clock.nsecsElapsed() / 1000;
+    if (m_lastCallbackUs >= 0 && m_periodUs > 0) {
+        const qint64 jitter = qAbs(now - m_lastCallbackUs - m_periodUs);
+        m_jitterUs.storeRelaxed(jitter);
+        if (jitter > m_maxJitterUs.loadRelaxed())
+            m_maxJitterUs.storeRelaxed(jitter);
+    }
+    m_lastCallbackUs = now;
+}
+
+QAudioIOThread::Metrics QAudioIOThread::metrics() const
+{
+    return { m_underruns.loadRelaxed(), m_jitterUs.loadRelaxed(), m_maxJitterUs.loadRelaxed() };
+}
+
+void QAudioIOThread::run()
+{
+#if defined(Q_OS_UNIX)
+    if (m_priority > 0) {
+        sched_param param = {};
+        param.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), m_priority,
+                                      sched_get_priority_max(SCHED_FIFO));
+        const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0)
+            qCWarning(qLcAudioIOThread) << "Could not use real-time scheduling for" << objectName()
+                                        << ":" << strerror(err);
+    }
+#endif
+
+    m_clock.start();
+    while (!m_stopRequested.loadAcquire()) {
+        if (!m_process())
+            break;
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,147 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QAUDIOIOTHREAD_H
+#define QAUDIOIOTHREAD_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qsemaphore.h>
+#include <QtCore/qthread.h>
+#include <private/qglobal_p.h>
+
+#include <functional>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+// Byte ring for handing audio data from one producer thread to one consumer
+// thread without locking.
+class Q_MULTIMEDIA_EXPORT QAudioRingBuffer
+{
+public:
+    explicit QAudioRingBuffer(int size);
+
+    int size() const { return m_size; }
+    int used() const { return m_used.loadAcquire(); }
+    int free() const { return m_size - used(); }
+
+    // Producer side, returns the number of bytes that fit
+    int write(const char *data, int len);
+    // Consumer side, returns the number of bytes read
+    int read(char *data, int len);
+
+    // Only while neither side is active
+    void reset();
+
+private:
+    std::unique_ptr<char[]> m_buffer;
+    int m_size = 0;
+    int m_readPos = 0;
+    int m_writePos = 0;
+    QAtomicInt m_used = 0;
+};
+
+// Thread driving an audio device independently of the event loop of the
+// thread owning the sink or source. It repeatedly calls the process function
+// it's given, which is expected to block until the device wants more data,
+// and stops once that returns false.
+class Q_MULTIMEDIA_EXPORT QAudioIOThread : public QThread
+{
+public:
+    struct Metrics
+    {
+        qint64 underruns = 0;
+        // how far the last wake-up was off the device's period
+        qint64 jitterUs = 0;
+        qint64 maxJitterUs = 0;
+    };
+
+    QAudioIOThread(const QString &name, std::function<bool()> process);
+    ~QAudioIOThread() override;
+
+    static bool isRequested();
+
+    void start(qint64 periodUs);
+    void stop();
+    bool isStopRequested() const { return m_stopRequested.loadAcquire(); }
+
+    // Lets the thread wait for data without relying on the device
+    void wake();
+    void waitForWake(qint64 timeoutUs);
+
+    // Bookkeeping for the process function
+    void callbackStarted();
+    void underrun() { m_underruns.fetchAndAddRelaxed(1); }
+
+    Metrics metrics() const;
+
+protected:
+    void run() override;
+
+private:
+    std::function<bool()> m_process;
+    qint64 m_periodUs = 0;
+    int m_priority = 0;
+
+    QElapsedTimer m_clock;
+    qint64 m_lastCallbackUs = -1;
+
+    QAtomicInteger<bool> m_stopRequested = false;
+    QSemaphore m_wakeup;
+
+    QAtomicInteger<qint64> m_underruns = 0;
+    QAtomicInteger<qint64> m_jitterUs = 0;
+    QAtomicInteger<qint64> m_maxJitterUs = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
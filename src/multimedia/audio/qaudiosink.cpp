@@ -195,6 +195,41 @@ QIODevice* QAudioSink::start()
     return d->start();
 }
 
+/*!
+    \typealias QAudioSink::RenderCallback
+    \since 6.5
+
+    Function type used by start(const RenderCallback &, int). It is called with
+    one pointer per channel in \c out, each pointing to \c frames samples in the
+    range [-1, 1] that the callback has to fill.
+*/
+
+/*!
+    \since 6.5
+
+    Starts the audio output and renders audio by calling \a callback with
+    blocks of exactly \a blockFrames frames, one non-interleaved float buffer
+    per channel of format().
+
+    The callback is invoked from a thread owned by the audio backend, without
+    going through QIODevice. It must not block, allocate memory or take locks
+    that the application holds for long, as any delay directly leads to
+    underruns. Conversion to the sample format of the device is done by
+    QAudioSink.
+
+    Backends without a dedicated audio thread drive the callback from the
+    thread the audio sink lives in.
+
+    State changes and errors are reported as with start(QIODevice *).
+*/
+void QAudioSink::start(const RenderCallback &callback, int blockFrames)
+{
+    if (!d || !callback || blockFrames <= 0)
+        return;
+    d->elapsedTime.restart();
+    d->startWithCallback(callback, blockFrames);
+}
+
 /*!
     Stops the audio output, detaching from the system resource.
 
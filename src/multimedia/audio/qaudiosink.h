@@ -49,6 +49,8 @@
 #include <QtMultimedia/qaudioformat.h>
 #include <QtMultimedia/qaudiodevice.h>
 
+#include <functional>
+
 
 QT_BEGIN_NAMESPACE
 
@@ -61,6 +63,8 @@ class Q_MULTIMEDIA_EXPORT QAudioSink : public QObject
     Q_OBJECT
 
 public:
+    using RenderCallback = std::function<void(float *const *out, int frames)>;
+
     explicit QAudioSink(const QAudioFormat &format = QAudioFormat(), QObject *parent = nullptr);
     explicit QAudioSink(const QAudioDevice &audioDeviceInfo, const QAudioFormat &format = QAudioFormat(), QObject *parent = nullptr);
     ~QAudioSink();
@@ -71,6 +75,7 @@ public:
 
     void start(QIODevice *device);
     QIODevice* start();
+    void start(const RenderCallback &callback, int blockFrames);
 
     void stop();
     void reset();
@@ -96,6 +101,7 @@ Q_SIGNALS:
 
 private:
     Q_DISABLE_COPY(QAudioSink)
+    friend class QPlatformAudioSink;
 
     QPlatformAudioSink* d;
 };
@@ -198,6 +198,36 @@ QIODevice* QAudioSource::start()
     return d->start();
 }
 
+/*!
+    \typealias QAudioSource::CaptureCallback
+    \since 6.5
+
+    Function type used by start(const CaptureCallback &, int). It is called with
+    one pointer per channel in \c in, each pointing to \c frames recorded
+    samples in the range [-1, 1].
+*/
+
+/*!
+    \since 6.5
+
+    Starts capturing audio and delivers it by calling \a callback with blocks
+    of exactly \a blockFrames frames, one non-interleaved float buffer per
+    channel of format().
+
+    The buffers are only valid for the duration of the call. The callback is
+    invoked from the thread the audio backend delivers captured data on and
+    should return quickly.
+
+    State changes and errors are reported as with start(QIODevice *).
+*/
+void QAudioSource::start(const CaptureCallback &callback, int blockFrames)
+{
+    if (!d || !callback || blockFrames <= 0)
+        return;
+    d->elapsedTime.start();
+    d->startWithCallback(callback, blockFrames);
+}
+
 /*!
     Returns the QAudioFormat being used.
 */
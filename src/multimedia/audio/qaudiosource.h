@@ -49,6 +49,8 @@
 #include <QtMultimedia/qaudioformat.h>
 #include <QtMultimedia/qaudiodevice.h>
 
+#include <functional>
+
 
 QT_BEGIN_NAMESPACE
 
@@ -59,6 +61,8 @@ class Q_MULTIMEDIA_EXPORT QAudioSource : public QObject
     Q_OBJECT
 
 public:
+    using CaptureCallback = std::function<void(const float *const *in, int frames)>;
+
     explicit QAudioSource(const QAudioFormat &format = QAudioFormat(), QObject *parent = nullptr);
     explicit QAudioSource(const QAudioDevice &audioDeviceInfo, const QAudioFormat &format = QAudioFormat(), QObject *parent = nullptr);
     ~QAudioSource();
@@ -69,6 +73,7 @@ public:
 
     void start(QIODevice *device);
     QIODevice* start();
+    void start(const CaptureCallback &callback, int blockFrames);
 
     void stop();
     void reset();
@@ -0,0 +1,86 @@
+/****************************************************************************
+**
+** Copyright (C) 2021 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiosystem_p.h"
+#include "qaudiocallback_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QPlatformAudioSink::~QPlatformAudioSink() = default;
+
+void QPlatformAudioSink::startWithCallback(const QAudioSink::RenderCallback &callback,
+                                           int blockFrames)
+{
+    startWithAdapter(std::make_unique<QAudioRenderAdapter>(callback, format(), blockFrames));
+}
+
+void QPlatformAudioSink::startWithInterleavedCallback(
+        const std::function<void(float *, int)> &callback, int blockFrames)
+{
+    elapsedTime.restart();
+    startWithAdapter(std::make_unique<QAudioRenderAdapter>(
+            QAudioRenderAdapter::InterleavedCallback(callback), format(), blockFrames));
+}
+
+void QPlatformAudioSink::startWithAdapter(std::unique_ptr<QAudioRenderAdapter> adapter)
+{
+    auto device = std::make_unique<QAudioRenderDevice>(std::move(adapter));
+    start(device.get());
+    // the previous device is only released once the backend switched over
+    m_callbackDevice = std::move(device);
+}
+
+QPlatformAudioSink *QPlatformAudioSink::get(const QAudioSink &sink)
+{
+    return sink.d;
+}
+
+QPlatformAudioSource::~QPlatformAudioSource() = default;
+
+void QPlatformAudioSource::startWithCallback(const QAudioSource::CaptureCallback &callback,
+                                             int blockFrames)
+{
+    auto device = std::make_unique<QAudioCaptureDevice>(callback, format(), blockFrames);
+    start(device.get());
+    m_callbackDevice = std::move(device);
+}
+
+QT_END_NAMESPACE
+
+#include "moc_qaudiosystem_p.cpp"
@@ -56,19 +56,28 @@
 #include <QtMultimedia/qaudio.h>
 #include <QtMultimedia/qaudioformat.h>
 #include <QtMultimedia/qaudiodevice.h>
+#include <QtMultimedia/qaudiosink.h>
+#include <QtMultimedia/qaudiosource.h>
 
 #include <QtCore/qelapsedtimer.h>
 #include <QtCore/private/qglobal_p.h>
 
+#include <private/qaudioiothread_p.h>
+
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 
 class QIODevice;
+class QAudioRenderAdapter;
 
 class Q_MULTIMEDIA_EXPORT QPlatformAudioSink : public QObject
 {
     Q_OBJECT
 
 public:
+    ~QPlatformAudioSink() override;
+
     virtual void start(QIODevice *device) = 0;
     virtual QIODevice* start() = 0;
     virtual void stop() = 0;
@@ -86,8 +95,27 @@ public:
     virtual void setVolume(qreal) {}
     virtual qreal volume() const { return 1.0; }
 
+    void startWithCallback(const QAudioSink::RenderCallback &callback, int blockFrames);
+    // For renderers producing interleaved float frames, like QAudioEngine
+    void startWithInterleavedCallback(const std::function<void(float *, int)> &callback,
+                                      int blockFrames);
+
+    // Backends with their own audio thread override this to call the adapter
+    // directly; the default pulls from an internal QIODevice wrapping it.
+    virtual void startWithAdapter(std::unique_ptr<QAudioRenderAdapter> adapter);
+
+    // Underruns and wake-up jitter of the audio thread driving the device. Backends
+    // without their own audio thread don't measure anything. Can be called from any
+    // thread, including the one calling the render callback.
+    virtual QAudioIOThread::Metrics ioMetrics() const { return {}; }
+
+    static QPlatformAudioSink *get(const QAudioSink &sink);
+
     QElapsedTimer elapsedTime;
 
+private:
+    std::unique_ptr<QIODevice> m_callbackDevice;
+
 Q_SIGNALS:
     void errorChanged(QAudio::Error error);
     void stateChanged(QAudio::State state);
@@ -98,6 +126,8 @@ class Q_MULTIMEDIA_EXPORT QPlatformAudioSource : public QObject
     Q_OBJECT
 
 public:
+    ~QPlatformAudioSource() override;
+
     virtual void start(QIODevice *device) = 0;
     virtual QIODevice* start() = 0;
     virtual void stop() = 0;
@@ -115,8 +145,19 @@ public:
     virtual void setVolume(qreal) = 0;
     virtual qreal volume() const = 0;
 
+    // Backends with their own audio thread override this to call a
+    // QAudioCaptureAdapter directly; the default writes into a QIODevice wrapping it.
+    virtual void startWithCallback(const QAudioSource::CaptureCallback &callback, int blockFrames);
+
+    // Like QPlatformAudioSink::ioMetrics(), overruns of the capture buffer are
+    // counted as underruns
+    virtual QAudioIOThread::Metrics ioMetrics() const { return {}; }
+
     QElapsedTimer elapsedTime;
 
+private:
+    std::unique_ptr<QIODevice> m_callbackDevice;
+
 Q_SIGNALS:
     void errorChanged(QAudio::Error error);
     void stateChanged(QAudio::State state);
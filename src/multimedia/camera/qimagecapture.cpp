@@ -330,6 +330,43 @@ int QImageCapture::capture()
     return -1;
 }
 
+/*!
+    \since 6.5
+
+    Captures \a count consecutive frames from the camera and saves them to
+    \a location, the same way captureToFile() does. Where the back end
+    generates the file names, the images of a burst are numbered.
+
+    The frames are taken at the camera's frame rate, and only encoded once
+    all of them have been captured. Returns the capture Id of the first
+    image; the other images of the burst follow with consecutive Ids.
+
+    Back ends can limit the number of images they encode at a time. A burst
+    that does not fit is rejected with an errorOccurred() signal rather than
+    captured partially. Back ends that don't support burst capture report
+    NotSupportedFeatureError.
+
+    \sa captureToFile(), isReadyForCapture()
+*/
+int QImageCapture::captureBurst(int count, const QString &location)
+{
+    Q_D(QImageCapture);
+
+    d->unsetError();
+
+    if (!d->control) {
+        d->_q_error(-1, NotSupportedFeatureError, QPlatformImageCapture::msgCameraNotReady());
+        return -1;
+    }
+
+    if (!isReadyForCapture()) {
+        d->_q_error(-1, NotReadyError, tr("Could not capture in stopped state"));
+        return -1;
+    }
+
+    return d->control->captureBurst(location, qMax(count, 1));
+}
+
 /*!
     \enum QImageCapture::Error
 
@@ -132,6 +132,7 @@ public:
 public Q_SLOTS:
     int captureToFile(const QString &location = QString());
     int capture();
+    int captureBurst(int count, const QString &location = QString());
 
 Q_SIGNALS:
     void errorChanged();
@@ -48,6 +48,25 @@ QPlatformImageCapture::QPlatformImageCapture(QImageCapture *parent)
 {
 }
 
+/*
+    Captures \a count consecutive frames and saves them like capture() does,
+    numbering the file names. Returns the id of the first image; the others
+    follow with consecutive ids.
+
+    Back ends that don't support burst capture report NotSupportedFeatureError.
+*/
+int QPlatformImageCapture::captureBurst(const QString &fileName, int count)
+{
+    Q_UNUSED(fileName);
+    Q_UNUSED(count);
+    // emit error in the next event loop, so the caller can handle the -1 id first
+    QMetaObject::invokeMethod(this, "error", Qt::QueuedConnection,
+                              Q_ARG(int, -1),
+                              Q_ARG(int, QImageCapture::NotSupportedFeatureError),
+                              Q_ARG(QString, QImageCapture::tr("Burst capture is not supported.")));
+    return -1;
+}
+
 QString QPlatformImageCapture::msgCameraNotReady()
 {
     return QImageCapture::tr("Camera is not ready.");
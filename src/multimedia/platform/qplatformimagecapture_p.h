@@ -96,6 +96,7 @@ public:
 
     virtual int capture(const QString &fileName) = 0;
     virtual int captureToBuffer() = 0;
+    virtual int captureBurst(const QString &fileName, int count);
 
     virtual QImageEncoderSettings imageSettings() const = 0;
     virtual void setImageSettings(const QImageEncoderSettings &settings) = 0;
@@ -68,4 +68,9 @@ void QPlatformMediaPlayer::error(int error, const QString &errorString)
     player->d_func()->setError(error, errorString);
 }
 
+void QPlatformMediaPlayer::nextMediaStarted()
+{
+    player->d_func()->nextMediaStarted();
+}
+
 QT_END_NAMESPACE
@@ -83,6 +83,15 @@ public:
 
     virtual bool isSeekable() const { return m_seekable; }
 
+    // Time in microseconds from a seek until the first frame at the new position
+    // was rendered, for the last seek and the slowest one of the current media
+    struct SeekStatistics
+    {
+        qint64 lastLatency = 0;
+        qint64 maxLatency = 0;
+    };
+    virtual SeekStatistics seekStatistics() const { return {}; }
+
     virtual QMediaTimeRange availablePlaybackRanges() const = 0;
 
     virtual qreal playbackRate() const = 0;
@@ -91,6 +100,10 @@ public:
     virtual QUrl media() const = 0;
     virtual const QIODevice *mediaStream() const = 0;
     virtual void setMedia(const QUrl &media, QIODevice *stream) = 0;
+    // Media to continue with once the current one ended. Back ends that can play
+    // it back to back call nextMediaStarted() when they switched to it, otherwise
+    // QMediaPlayer switches the source at the end of the current media.
+    virtual void setNextMedia(const QUrl & /*media*/) {}
 
     virtual void play() = 0;
     virtual void pause() = 0;
@@ -146,6 +159,7 @@ public:
     void stateChanged(QMediaPlayer::PlaybackState newState);
     void mediaStatusChanged(QMediaPlayer::MediaStatus status);
     void error(int error, const QString &errorString);
+    void nextMediaStarted();
 
     void resetCurrentLoop() { m_currentLoop = 0; }
     bool doLoop() {
@@ -81,6 +81,11 @@ void QPlatformMediaRecorder::actualLocationChanged(const QUrl &location)
     emit q->actualLocationChanged(location);
 }
 
+void QPlatformMediaRecorder::segmentFinished(const QUrl &location)
+{
+    emit q->segmentFinished(location);
+}
+
 void QPlatformMediaRecorder::error(QMediaRecorder::Error error, const QString &errorString)
 {
     if (error == m_error && errorString == m_errorString)
@@ -80,6 +80,12 @@ class Q_MULTIMEDIA_EXPORT QMediaEncoderSettings
     QSize m_videoResolution = QSize(-1, -1);
     int m_videoFrameRate = -1;
     int m_videoBitRate = -1;
+
+    // splitting the recording into several files, 0 disables the respective limit
+    qint64 m_segmentDuration = 0;
+    qint64 m_segmentSize = 0;
+    bool m_fragmented = false;
+    qint64 m_preEventDuration = 0;
 public:
 
     QMediaFormat mediaFormat() const { return m_format; }
@@ -116,6 +122,21 @@ public:
     int audioSampleRate() const { return m_audioSampleRate; }
     void setAudioSampleRate(int rate) { m_audioSampleRate = rate; }
 
+    // in milliseconds
+    qint64 segmentDuration() const { return m_segmentDuration; }
+    void setSegmentDuration(qint64 duration) { m_segmentDuration = duration; }
+
+    // in bytes
+    qint64 segmentSize() const { return m_segmentSize; }
+    void setSegmentSize(qint64 size) { m_segmentSize = size; }
+
+    bool isFragmented() const { return m_fragmented; }
+    void setFragmented(bool fragmented) { m_fragmented = fragmented; }
+
+    // in milliseconds, 0 writes the recording right away
+    qint64 preEventDuration() const { return m_preEventDuration; }
+    void setPreEventDuration(qint64 duration) { m_preEventDuration = duration; }
+
     bool operator==(const QMediaEncoderSettings &other) const
     {
         return m_format == other.m_format &&
@@ -126,7 +147,11 @@ public:
                m_audioChannels == other.m_audioChannels &&
                m_videoResolution == other.m_videoResolution &&
                m_videoFrameRate == other.m_videoFrameRate &&
-               m_videoBitRate == other.m_videoBitRate;
+               m_videoBitRate == other.m_videoBitRate &&
+               m_segmentDuration == other.m_segmentDuration &&
+               m_segmentSize == other.m_segmentSize &&
+               m_fragmented == other.m_fragmented &&
+               m_preEventDuration == other.m_preEventDuration;
     }
 
     bool operator!=(const QMediaEncoderSettings &other) const
@@ -136,6 +161,29 @@ public:
 class Q_MULTIMEDIA_EXPORT QPlatformMediaRecorder
 {
 public:
+    // Counters describing how well the backend keeps up with its sources
+    struct EncodingStatistics
+    {
+        qint64 droppedVideoFrames = 0;
+        qint64 lateVideoFrames = 0;
+        qint64 droppedCaptureFrames = 0;
+        qint64 lateCaptureFrames = 0;
+        // maximum time in microseconds from capturing until the camera dequeued
+        // a frame, and from then until all consumers took it
+        qint64 maxCaptureDequeueLatency = 0;
+        qint64 maxCaptureDeliveryLatency = 0;
+        qint64 droppedAudioBuffers = 0;
+        qreal encodeFrameRate = 0;
+    };
+
+    // Additional destination of the encoded media, either a location or a device
+    struct AdditionalOutput
+    {
+        QUrl location;
+        QIODevice *device = nullptr;
+        QMediaFormat::FileFormat format = QMediaFormat::UnspecifiedFormat;
+    };
+
     virtual ~QPlatformMediaRecorder() {}
 
     virtual bool isLocationWritable(const QUrl &location) const = 0;
@@ -145,12 +193,15 @@ public:
     virtual void pause();
     virtual void resume();
     virtual void stop() = 0;
+    virtual void triggerPreEventRecording() {}
 
     virtual qint64 duration() const { return m_duration; }
 
     virtual void setMetaData(const QMediaMetaData &) {}
     virtual QMediaMetaData metaData() const { return {}; }
 
+    virtual EncodingStatistics encodingStatistics() const { return {}; }
+
     QMediaRecorder::Error error() const { return m_error;}
     QString errorString() const { return m_errorString; }
 
@@ -158,6 +209,9 @@ public:
     virtual void setOutputLocation(const QUrl &location) { m_outputLocation = location; }
     QUrl actualLocation() const { return m_actualLocation; }
     void clearActualLocation() { m_actualLocation.clear(); }
+    QList<AdditionalOutput> additionalOutputs() const { return m_additionalOutputs; }
+    void addAdditionalOutput(const AdditionalOutput &output) { m_additionalOutputs.append(output); }
+    void clearAdditionalOutputs() { m_additionalOutputs.clear(); }
     void clearError() { error(QMediaRecorder::NoError, QString()); }
 
 protected:
@@ -166,6 +220,7 @@ protected:
     void stateChanged(QMediaRecorder::RecorderState state);
     void durationChanged(qint64 position);
     void actualLocationChanged(const QUrl &location);
+    void segmentFinished(const QUrl &location);
     void error(QMediaRecorder::Error error, const QString &errorString);
     void metaDataChanged();
 
@@ -177,6 +232,7 @@ private:
     QString m_errorString;
     QUrl m_actualLocation;
     QUrl m_outputLocation;
+    QList<AdditionalOutput> m_additionalOutputs;
     qint64 m_duration = 0;
 
     QMediaRecorder::RecorderState m_state = QMediaRecorder::StoppedState;
@@ -145,6 +145,18 @@ void QMediaPlayerPrivate::setStatus(QMediaPlayer::MediaStatus s)
     Q_Q(QMediaPlayer);
 
     emit q->mediaStatusChanged(s);
+
+    // The back end didn't continue with the next source on its own, switch to
+    // it the same way the application would.
+    if (s == QMediaPlayer::EndOfMedia && !nextSource.isEmpty()) {
+        QMetaObject::invokeMethod(q, [this, next = nextSource]() {
+            Q_Q(QMediaPlayer);
+            if (nextSource != next)
+                return;
+            q->setSource(next);
+            q->play();
+        }, Qt::QueuedConnection);
+    }
 }
 
 void QMediaPlayerPrivate::setError(int error, const QString &errorString)
@@ -243,6 +255,39 @@ void QMediaPlayerPrivate::setMedia(const QUrl &media, QIODevice *stream)
     }
 
     qrcFile.swap(file); // Cleans up any previous file
+
+    setNextMedia();
+}
+
+void QMediaPlayerPrivate::setNextMedia()
+{
+    if (!control)
+        return;
+
+    // Resources and looping media are handled by switching sources at the end
+    // of the current media instead.
+    QUrl url = nextSource;
+    if (control->loops() != 1 || url.scheme() == QLatin1String("qrc")
+        || url.scheme() == QLatin1String("content")) {
+        url = QUrl();
+    } else if (!url.isEmpty() && (url.scheme().isEmpty() || url.scheme() == QLatin1String("file"))) {
+        url = QUrl::fromUserInput(url.path(), QDir::currentPath(), QUrl::AssumeLocalFile);
+    }
+    control->setNextMedia(url);
+}
+
+void QMediaPlayerPrivate::nextMediaStarted()
+{
+    Q_Q(QMediaPlayer);
+
+    source = nextSource;
+    stream = nullptr;
+    qrcMedia = QUrl();
+    qrcFile.reset();
+    nextSource = QUrl();
+
+    emit q->sourceChanged(source);
+    emit q->nextSourceChanged(nextSource);
 }
 
 QList<QMediaMetaData> QMediaPlayerPrivate::trackMetaData(QPlatformMediaPlayer::TrackType s) const
@@ -390,6 +435,35 @@ float QMediaPlayer::bufferProgress() const
     return 0.;
 }
 
+/*!
+    Returns the time in microseconds the last seek took, from setting the
+    position until the first frame at the new position was rendered. Returns 0
+    before the first seek, or if the backend doesn't measure it.
+
+    \since 6.5
+    \sa maxSeekLatency(), setPosition()
+*/
+qint64 QMediaPlayer::lastSeekLatency() const
+{
+    Q_D(const QMediaPlayer);
+    return d->control ? d->control->seekStatistics().lastLatency : 0;
+}
+
+/*!
+    Returns the time in microseconds the slowest seek in the current media
+    took, from setting the position until the first frame at the new position
+    was rendered. Returns 0 before the first seek, or if the backend doesn't
+    measure it.
+
+    \since 6.5
+    \sa lastSeekLatency(), setPosition()
+*/
+qint64 QMediaPlayer::maxSeekLatency() const
+{
+    Q_D(const QMediaPlayer);
+    return d->control ? d->control->seekStatistics().maxLatency : 0;
+}
+
 /*!
     Returns a QMediaTimeRange describing the currently buffered data.
 
@@ -521,6 +595,7 @@ void QMediaPlayer::setLoops(int loops)
         return;
     if (d->control)
         d->control->setLoops(loops);
+    d->setNextMedia();
 }
 
 /*!
@@ -669,11 +744,56 @@ void QMediaPlayer::setSource(const QUrl &source)
 
     d->source = source;
     d->stream = nullptr;
+    if (!d->nextSource.isEmpty() && d->nextSource == source) {
+        d->nextSource = QUrl();
+        emit nextSourceChanged(d->nextSource);
+    }
 
     d->setMedia(source, nullptr);
     emit sourceChanged(d->source);
 }
 
+/*!
+    \qmlproperty url QtMultimedia::MediaPlayer::nextSource
+
+    This property holds the URL of the media played after the current source.
+
+    When the current media ends, the player continues with the next source,
+    without a gap if the back end supports it. The \l source property then
+    changes to it and \c nextSource is reset.
+
+    \sa QMediaPlayer::setNextSource()
+*/
+
+/*!
+    Returns the media source played after the current one.
+
+    \sa setNextSource()
+*/
+QUrl QMediaPlayer::nextSource() const
+{
+    Q_D(const QMediaPlayer);
+
+    return d->nextSource;
+}
+
+/*!
+    Sets the \a source played once the current media ended.
+
+    \sa nextSource
+*/
+void QMediaPlayer::setNextSource(const QUrl &source)
+{
+    Q_D(QMediaPlayer);
+
+    if (d->nextSource == source)
+        return;
+
+    d->nextSource = source;
+    d->setNextMedia();
+    emit nextSourceChanged(d->nextSource);
+}
+
 /*!
     Sets the current source \a device.
 
@@ -1229,6 +1349,24 @@ QMediaMetaData QMediaPlayer::metaData() const
     \sa QUrl
 */
 
+/*!
+    \property QMediaPlayer::nextSource
+    \brief the media source played after the current one.
+
+    When the current media ends, the player continues with the next source and
+    the \l source property changes to it. If the back end supports it, the next
+    source is opened and buffered ahead of time, so the playback continues
+    without a gap. Otherwise the player switches sources once the current media
+    reached its end.
+
+    The property is reset to a null QUrl once the player switched to the next
+    source. The next source is ignored while the current media is looped.
+
+    By default this property has a null QUrl.
+
+    \sa source, loops
+*/
+
 /*!
     \property QMediaPlayer::mediaStatus
     \brief the status of the current media stream.
@@ -59,6 +59,7 @@ class Q_MULTIMEDIA_EXPORT QMediaPlayer : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QUrl source READ source WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(QUrl nextSource READ nextSource WRITE setNextSource NOTIFY nextSourceChanged)
     Q_PROPERTY(qint64 duration READ duration NOTIFY durationChanged)
     Q_PROPERTY(qint64 position READ position WRITE setPosition NOTIFY positionChanged)
     Q_PROPERTY(float bufferProgress READ bufferProgress NOTIFY bufferProgressChanged)
@@ -155,6 +156,7 @@ public:
 
     QUrl source() const;
     const QIODevice *sourceDevice() const;
+    QUrl nextSource() const;
 
     PlaybackState playbackState() const;
     MediaStatus mediaStatus() const;
@@ -169,6 +171,8 @@ public:
     QMediaTimeRange bufferedTimeRange() const;
 
     bool isSeekable() const;
+    qint64 lastSeekLatency() const;
+    qint64 maxSeekLatency() const;
     qreal playbackRate() const;
 
     int loops() const;
@@ -191,9 +195,11 @@ public Q_SLOTS:
 
     void setSource(const QUrl &source);
     void setSourceDevice(QIODevice *device, const QUrl &sourceUrl = QUrl());
+    void setNextSource(const QUrl &source);
 
 Q_SIGNALS:
     void sourceChanged(const QUrl &media);
+    void nextSourceChanged(const QUrl &media);
     void playbackStateChanged(QMediaPlayer::PlaybackState newState);
     void mediaStatusChanged(QMediaPlayer::MediaStatus status);
 
@@ -86,11 +86,14 @@ public:
     std::unique_ptr<QFile> qrcFile;
     QUrl source;
     QIODevice *stream = nullptr;
+    QUrl nextSource;
 
     QMediaPlayer::PlaybackState state = QMediaPlayer::StoppedState;
     QMediaPlayer::Error error = QMediaPlayer::NoError;
 
     void setMedia(const QUrl &media, QIODevice *stream = nullptr);
+    void setNextMedia();
+    void nextMediaStarted();
 
     QList<QMediaMetaData> trackMetaData(QPlatformMediaPlayer::TrackType s) const;
 
@@ -49,6 +49,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <climits>
+
 Q_DECLARE_LOGGING_CATEGORY(qLcPulseAudio)
 
 QT_BEGIN_NAMESPACE
@@ -60,10 +62,11 @@ const int PeriodTimeMs = 20;
 static void  outputStreamWriteCallback(pa_stream *stream, size_t length, void *userdata)
 {
     Q_UNUSED(stream);
-    Q_UNUSED(userdata);
     qCDebug(qLcPulseAudioOut) << "Write callback:" << length;
     QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
     pa_threaded_mainloop_signal(pulseEngine->mainloop(), 0);
+    if (userdata)
+        static_cast<QPulseAudioSink *>(userdata)->streamWriteCallback();
 }
 
 static void outputStreamStateCallback(pa_stream *stream, void *userdata)
@@ -187,8 +190,17 @@ QAudio::State QPulseAudioSink::state() const
     return m_deviceState;
 }
 
+void QPulseAudioSink::streamWriteCallback()
+{
+    if (m_ioThread)
+        m_ioThread->wake();
+}
+
 void QPulseAudioSink::streamUnderflowCallback()
 {
+    if (m_ioThread)
+        m_ioThread->underrun();
+
     if (m_audioSource && m_audioSource->atEnd()) {
         qCDebug(qLcPulseAudioOut) << "Draining stream at end of buffer";
         pa_operation *o = pa_stream_drain(m_stream, outputStreamDrainComplete, this);
@@ -207,6 +219,16 @@ void QPulseAudioSink::streamDrainedCallback()
 }
 
 void QPulseAudioSink::start(QIODevice *device)
+{
+    startPull(device, nullptr);
+}
+
+void QPulseAudioSink::startWithAdapter(std::unique_ptr<QAudioRenderAdapter> adapter)
+{
+    startPull(nullptr, std::move(adapter));
+}
+
+void QPulseAudioSink::startPull(QIODevice *device, std::unique_ptr<QAudioRenderAdapter> adapter)
 {
     setState(QAudio::StoppedState);
     setError(QAudio::NoError);
@@ -220,9 +242,11 @@ void QPulseAudioSink::start(QIODevice *device)
 
     m_pullMode = true;
     m_audioSource = device;
+    m_renderAdapter = std::move(adapter);
 
     if (!open()) {
         m_audioSource = nullptr;
+        m_renderAdapter.reset();
         return;
     }
 
@@ -230,12 +254,19 @@ void QPulseAudioSink::start(QIODevice *device)
     gettimeofday(&lastTimingInfo, nullptr);
     lastProcessedUSecs = 0;
 
-    connect(m_audioSource, &QIODevice::readyRead, this, &QPulseAudioSink::startReading);
+    if (m_audioSource)
+        connect(m_audioSource, &QIODevice::readyRead, this, &QPulseAudioSink::startReading);
     setState(QAudio::ActiveState);
 }
 
 void QPulseAudioSink::startReading()
 {
+    if (useIOThread()) {
+        if (!m_ioThread || !m_ioThread->isRunning())
+            startIO();
+        return;
+    }
+
     if (!m_tickTimer.isActive())
         m_tickTimer.start(m_periodTime, this);
 }
@@ -253,6 +284,7 @@ QIODevice *QPulseAudioSink::start()
     close();
 
     m_pullMode = false;
+    m_renderAdapter.reset();
 
     if (!open())
         return nullptr;
@@ -418,6 +450,7 @@ void QPulseAudioSink::close()
         return;
 
     m_tickTimer.stop();
+    stopIO();
 
     QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
 
@@ -456,6 +489,7 @@ void QPulseAudioSink::close()
         delete[] m_audioBuffer;
         m_audioBuffer = nullptr;
     }
+    m_ringBuffer.reset();
 }
 
 void QPulseAudioSink::timerEvent(QTimerEvent *event)
@@ -574,6 +608,9 @@ qsizetype QPulseAudioSink::bytesFree() const
     if (m_deviceState != QAudio::ActiveState && m_deviceState != QAudio::IdleState)
         return 0;
 
+    if (m_ringBuffer)
+        return m_ringBuffer->free();
+
     QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
     pulseEngine->lock();
     int writableSize = pa_stream_writable_size(m_stream);
@@ -676,7 +713,10 @@ void QPulseAudioSink::resume()
 
         pulseEngine->unlock();
 
-        m_tickTimer.start(m_periodTime, this);
+        if (useIOThread())
+            startIO();
+        else
+            m_tickTimer.start(m_periodTime, this);
 
         setState(QAudio::ActiveState);
         setError(QAudio::NoError);
@@ -700,6 +740,7 @@ void QPulseAudioSink::suspend()
         setState(QAudio::SuspendedState);
 
         m_tickTimer.stop();
+        stopIO();
 
         QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
         pa_operation *operation;
@@ -738,6 +779,12 @@ qint64 PulseOutputPrivate::writeData(const char *data, qint64 len)
 
     if ((m_audioDevice->m_deviceState == QAudio::ActiveState
          || m_audioDevice->m_deviceState == QAudio::IdleState)) {
+        if (m_audioDevice->m_ringBuffer) {
+            // The audio thread passes the data on, don't block the writer on it
+            written = m_audioDevice->m_ringBuffer->write(data, int(qMin<qint64>(len, INT_MAX)));
+            m_audioDevice->m_ioThread->wake();
+            return written;
+        }
          while(written < len) {
             int chunk = m_audioDevice->write(data+written, (len-written));
             if (chunk <= 0)
@@ -762,6 +809,151 @@ qreal QPulseAudioSink::volume() const
     return m_volume;
 }
 
+QAudioIOThread::Metrics QPulseAudioSink::ioMetrics() const
+{
+    return m_ioThread ? m_ioThread->metrics() : QAudioIOThread::Metrics{};
+}
+
+void QPulseAudioSink::startIO()
+{
+    if (!m_ioThread) {
+        m_ioThread = std::make_unique<QAudioIOThread>(QStringLiteral("PulseAudio output"),
+                                                      [this] { return processIO(); });
+    }
+    // Data written in push mode is passed to the audio thread through a ring
+    if (!m_pullMode && !m_ringBuffer)
+        m_ringBuffer = std::make_unique<QAudioRingBuffer>(m_maxBufferSize);
+
+    m_ioState = m_deviceState;
+    m_ioError = QAudio::NoError;
+    m_ioThread->start(m_periodTime * 1000);
+}
+
+void QPulseAudioSink::stopIO()
+{
+    if (m_ioThread)
+        m_ioThread->stop();
+}
+
+// Runs on the audio thread: waits for the stream to ask for data, or for a
+// period to pass, and fills as much of the stream as there is data for.
+bool QPulseAudioSink::processIO()
+{
+    m_ioThread->waitForWake(m_periodTime * 1000);
+    if (m_ioThread->isStopRequested())
+        return false;
+
+    m_ioThread->callbackStarted();
+
+    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+    pulseEngine->lock();
+    const size_t writableSize = pa_stream_writable_size(m_stream);
+    pulseEngine->unlock();
+
+    if (writableSize == size_t(-1) || writableSize == 0)
+        return true;
+
+    const int bytesPerFrame = m_format.bytesPerFrame();
+    qint64 writable = qMin(qint64(writableSize), qint64(m_maxBufferSize));
+    writable -= writable % bytesPerFrame;
+
+    qint64 len = 0;
+    qreal volume = m_volume;
+    if (m_renderAdapter) {
+        // the volume is applied while converting from float
+        len = m_renderAdapter->render(m_audioBuffer, writable, float(volume));
+        volume = 1.;
+    } else if (m_pullMode) {
+        len = m_audioSource->read(m_audioBuffer, writable);
+    } else {
+        const int whole = m_ringBuffer->used() / bytesPerFrame * bytesPerFrame;
+        len = m_ringBuffer->read(m_audioBuffer, int(qMin<qint64>(whole, writable)));
+    }
+
+    if (len < 0) {
+        postIOState(QAudio::StoppedState, QAudio::IOError);
+        return false;
+    }
+
+    if (len == 0) {
+        // The underflow callback reports starving in push mode
+        if (m_pullMode)
+            postIOState(QAudio::IdleState, m_audioSource->atEnd() ? QAudio::NoError : QAudio::UnderrunError);
+        return true;
+    }
+
+    for (qint64 written = 0; written < len;) {
+        const qint64 chunk = writeIO(m_audioBuffer + written, len - written, volume);
+        if (chunk < 0) {
+            postIOState(QAudio::StoppedState, QAudio::IOError);
+            return false;
+        }
+        if (chunk == 0)
+            break;
+        written += chunk;
+    }
+
+    postIOState(QAudio::ActiveState, QAudio::NoError);
+    return true;
+}
+
+// Like write(), but leaves reporting errors to the caller
+qint64 QPulseAudioSink::writeIO(const char *data, qint64 len, qreal volume)
+{
+    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+    pulseEngine->lock();
+
+    size_t nbytes = len;
+    void *dest = nullptr;
+
+    if (pa_stream_begin_write(m_stream, &dest, &nbytes) < 0) {
+        qCWarning(qLcPulseAudioOut) << "pa_stream_begin_write error:"
+                                    << pa_strerror(pa_context_errno(pulseEngine->context()));
+        pulseEngine->unlock();
+        return -1;
+    }
+
+    len = qMin(len, qint64(nbytes));
+
+    if (volume < 1.0f)
+        QAudioHelperInternal::qMultiplySamples(volume, m_format, data, dest, len);
+    else
+        memcpy(dest, data, len);
+
+    if (pa_stream_write(m_stream, dest, len, nullptr, 0, PA_SEEK_RELATIVE) < 0) {
+        qCWarning(qLcPulseAudioOut) << "pa_stream_write error:"
+                                    << pa_strerror(pa_context_errno(pulseEngine->context()));
+        pulseEngine->unlock();
+        return -1;
+    }
+
+    pulseEngine->unlock();
+    return len;
+}
+
+// Hands state changes detected on the audio thread to the thread owning the sink
+void QPulseAudioSink::postIOState(QAudio::State state, QAudio::Error error)
+{
+    if (m_ioState == state && m_ioError == error)
+        return;
+    m_ioState = state;
+    m_ioError = error;
+    QMetaObject::invokeMethod(this, [this, state, error] { ioStateChanged(state, error); },
+                              Qt::QueuedConnection);
+}
+
+void QPulseAudioSink::ioStateChanged(QAudio::State state, QAudio::Error error)
+{
+    if (m_deviceState == QAudio::StoppedState || m_deviceState == QAudio::SuspendedState)
+        return;
+
+    if (state == QAudio::StoppedState)
+        close();
+
+    setError(error);
+    setState(state);
+}
+
 void QPulseAudioSink::onPulseContextFailed()
 {
     close();
@@ -61,9 +61,13 @@
 #include "qaudio.h"
 #include "qaudiodevice.h"
 #include <private/qaudiosystem_p.h>
+#include <private/qaudioiothread_p.h>
+#include <private/qaudiocallback_p.h>
 
 #include <pulse/pulseaudio.h>
 
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 
 class QPulseAudioSink : public QPlatformAudioSink
@@ -77,6 +81,7 @@ public:
 
     void start(QIODevice *device) override;
     QIODevice *start() override;
+    void startWithAdapter(std::unique_ptr<QAudioRenderAdapter> adapter) override;
     void stop() override;
     void reset() override;
     void suspend() override;
@@ -93,9 +98,12 @@ public:
     void setVolume(qreal volume) override;
     qreal volume() const override;
 
+    void streamWriteCallback();
     void streamUnderflowCallback();
     void streamDrainedCallback();
 
+    QAudioIOThread::Metrics ioMetrics() const override;
+
 protected:
     void timerEvent(QTimerEvent *event) override;
 
@@ -108,6 +116,15 @@ private:
     void close();
     qint64 write(const char *data, qint64 len);
 
+    void startPull(QIODevice *device, std::unique_ptr<QAudioRenderAdapter> adapter);
+    bool useIOThread() const { return m_renderAdapter || QAudioIOThread::isRequested(); }
+    void startIO();
+    void stopIO();
+    bool processIO();
+    qint64 writeIO(const char *data, qint64 len, qreal volume);
+    void postIOState(QAudio::State state, QAudio::Error error);
+    void ioStateChanged(QAudio::State state, QAudio::Error error);
+
 private Q_SLOTS:
     void userFeed();
     void onPulseContextFailed();
@@ -143,6 +160,14 @@ private:
     bool m_pullMode = true;
     bool m_opened = false;
     bool m_resuming = false;
+
+    // Only used when the stream is fed from its own thread
+    std::unique_ptr<QAudioIOThread> m_ioThread;
+    std::unique_ptr<QAudioRingBuffer> m_ringBuffer;
+    QAudio::State m_ioState = QAudio::StoppedState;
+    QAudio::Error m_ioError = QAudio::NoError;
+    // Set when started with a render callback, which always uses the audio thread
+    std::unique_ptr<QAudioRenderAdapter> m_renderAdapter;
 };
 
 class PulseOutputPrivate : public QIODevice
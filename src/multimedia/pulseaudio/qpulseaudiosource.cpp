@@ -55,11 +55,12 @@ const int PeriodTimeMs = 50;
 
 static void inputStreamReadCallback(pa_stream *stream, size_t length, void *userdata)
 {
-    Q_UNUSED(userdata);
     Q_UNUSED(length);
     Q_UNUSED(stream);
     QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
     pa_threaded_mainloop_signal(pulseEngine->mainloop(), 0);
+    if (userdata)
+        static_cast<QPulseAudioSource *>(userdata)->streamReadCallback();
 }
 
 static void inputStreamStateCallback(pa_stream *stream, void *userdata)
@@ -108,8 +109,9 @@ static void inputStreamUnderflowCallback(pa_stream *stream, void *userdata)
 static void inputStreamOverflowCallback(pa_stream *stream, void *userdata)
 {
     Q_UNUSED(stream);
-    Q_UNUSED(userdata);
     qWarning() << "Got a buffer overflow!";
+    if (userdata)
+        static_cast<QPulseAudioSource *>(userdata)->streamOverflowCallback();
 }
 
 static void inputStreamSuccessCallback(pa_stream *stream, int success, void *userdata)
@@ -202,6 +204,7 @@ void QPulseAudioSource::start(QIODevice *device)
     }
 
     close();
+    m_captureAdapter.reset();
 
     if (!open())
         return;
@@ -223,6 +226,7 @@ QIODevice *QPulseAudioSource::start()
     }
 
     close();
+    m_captureAdapter.reset();
 
     if (!open())
         return nullptr;
@@ -236,6 +240,37 @@ QIODevice *QPulseAudioSource::start()
     return m_audioSource;
 }
 
+void QPulseAudioSource::startWithCallback(const QAudioSource::CaptureCallback &callback,
+                                          int blockFrames)
+{
+    setState(QAudio::StoppedState);
+    setError(QAudio::NoError);
+
+    if (!m_pullMode && m_audioSource) {
+        delete m_audioSource;
+        m_audioSource = nullptr;
+    }
+
+    close();
+
+    m_captureAdapter = std::make_unique<QAudioCaptureAdapter>(callback, m_format, blockFrames);
+    // created before the stream exists, as its callbacks wake the thread
+    if (!m_ioThread) {
+        m_ioThread = std::make_unique<QAudioIOThread>(QStringLiteral("PulseAudio input"),
+                                                      [this] { return processIO(); });
+    }
+
+    if (!open()) {
+        m_captureAdapter.reset();
+        return;
+    }
+
+    m_pullMode = true;
+    m_audioSource = nullptr;
+
+    setState(QAudio::ActiveState);
+}
+
 void QPulseAudioSource::stop()
 {
     if (m_deviceState == QAudio::StoppedState)
@@ -343,7 +378,12 @@ bool QPulseAudioSource::open()
     connect(pulseEngine, &QPulseAudioEngine::contextFailed, this, &QPulseAudioSource::onPulseContextFailed);
 
     m_opened = true;
-    m_timer->start(m_periodTime);
+    if (m_captureAdapter) {
+        m_ioState = QAudio::ActiveState;
+        startIO();
+    } else {
+        m_timer->start(m_periodTime);
+    }
 
     m_elapsedTimeOffset = 0;
     m_totalTimeValue = 0;
@@ -357,6 +397,7 @@ void QPulseAudioSource::close()
         return;
 
     m_timer->stop();
+    stopIO();
 
     QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
 
@@ -522,7 +563,10 @@ void QPulseAudioSource::resume()
 
         pulseEngine->unlock();
 
-        m_timer->start(m_periodTime);
+        if (m_captureAdapter)
+            startIO();
+        else
+            m_timer->start(m_periodTime);
 
         setState(QAudio::ActiveState);
         setError(QAudio::NoError);
@@ -572,6 +616,7 @@ void QPulseAudioSource::suspend()
         setState(QAudio::SuspendedState);
 
         m_timer->stop();
+        stopIO();
 
         QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
         pa_operation *operation;
@@ -623,6 +668,101 @@ void QPulseAudioSource::reset()
     m_bytesAvailable = 0;
 }
 
+QAudioIOThread::Metrics QPulseAudioSource::ioMetrics() const
+{
+    return m_ioThread ? m_ioThread->metrics() : QAudioIOThread::Metrics{};
+}
+
+void QPulseAudioSource::streamReadCallback()
+{
+    if (m_ioThread)
+        m_ioThread->wake();
+}
+
+void QPulseAudioSource::streamOverflowCallback()
+{
+    if (m_ioThread)
+        m_ioThread->underrun();
+}
+
+void QPulseAudioSource::startIO()
+{
+    m_ioBuffer.resize(qMax(m_periodSize, m_bufferSize));
+    m_ioError = QAudio::NoError;
+    m_ioThread->start(m_periodTime * 1000);
+}
+
+void QPulseAudioSource::stopIO()
+{
+    if (m_ioThread)
+        m_ioThread->stop();
+}
+
+// Runs on the audio thread: waits for the stream to have data, or for a
+// period to pass, and hands everything captured to the capture callback.
+// The data is copied out so the callback doesn't run under the mainloop lock.
+bool QPulseAudioSource::processIO()
+{
+    m_ioThread->waitForWake(m_periodTime * 1000);
+    if (m_ioThread->isStopRequested())
+        return false;
+
+    m_ioThread->callbackStarted();
+
+    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+    while (!m_ioThread->isStopRequested()) {
+        pulseEngine->lock();
+        const void *data = nullptr;
+        size_t length = 0;
+        if (pa_stream_peek(m_stream, &data, &length) < 0) {
+            pulseEngine->unlock();
+            postIOState(QAudio::StoppedState, QAudio::IOError);
+            return false;
+        }
+        if (length == 0) {
+            pulseEngine->unlock();
+            break;
+        }
+        // only grows if the server hands out more than a buffer at once
+        if (m_ioBuffer.size() < qsizetype(length))
+            m_ioBuffer.resize(length);
+        if (data)
+            memcpy(m_ioBuffer.data(), data, length);
+        else
+            memset(m_ioBuffer.data(), 0, length); // a hole in the stream
+        pa_stream_drop(m_stream);
+        pulseEngine->unlock();
+
+        m_captureAdapter->capture(m_ioBuffer.constData(), qint64(length), float(m_volume));
+    }
+
+    postIOState(QAudio::ActiveState, QAudio::NoError);
+    return true;
+}
+
+// Hands state changes detected on the audio thread to the thread owning the source
+void QPulseAudioSource::postIOState(QAudio::State state, QAudio::Error error)
+{
+    if (m_ioState == state && m_ioError == error)
+        return;
+    m_ioState = state;
+    m_ioError = error;
+    QMetaObject::invokeMethod(this, [this, state, error] { ioStateChanged(state, error); },
+                              Qt::QueuedConnection);
+}
+
+void QPulseAudioSource::ioStateChanged(QAudio::State state, QAudio::Error error)
+{
+    if (m_deviceState == QAudio::StoppedState || m_deviceState == QAudio::SuspendedState)
+        return;
+
+    if (state == QAudio::StoppedState)
+        close();
+
+    setError(error);
+    setState(state);
+}
+
 void QPulseAudioSource::onPulseContextFailed()
 {
     close();
@@ -61,9 +61,13 @@
 #include "qaudio.h"
 #include "qaudiodevice.h"
 #include <private/qaudiosystem_p.h>
+#include <private/qaudioiothread_p.h>
+#include <private/qaudiocallback_p.h>
 
 #include <pulse/pulseaudio.h>
 
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 
 class PulseInputPrivate;
@@ -96,6 +100,12 @@ public:
     void setVolume(qreal volume) override;
     qreal volume() const override;
 
+    void startWithCallback(const QAudioSource::CaptureCallback &callback, int blockFrames) override;
+    QAudioIOThread::Metrics ioMetrics() const override;
+
+    void streamReadCallback();
+    void streamOverflowCallback();
+
     qint64 m_totalTimeValue;
     QIODevice *m_audioSource;
     QAudioFormat m_format;
@@ -118,6 +128,12 @@ private:
     bool open();
     void close();
 
+    void startIO();
+    void stopIO();
+    bool processIO();
+    void postIOState(QAudio::State state, QAudio::Error error);
+    void ioStateChanged(QAudio::State state, QAudio::Error error);
+
     bool m_pullMode;
     bool m_opened;
     int m_bytesAvailable;
@@ -131,6 +147,14 @@ private:
     QByteArray m_device;
     QByteArray m_tempBuffer;
     pa_sample_spec m_spec;
+
+    // Only used when started with a capture callback, which reads the stream
+    // from its own thread
+    std::unique_ptr<QAudioCaptureAdapter> m_captureAdapter;
+    std::unique_ptr<QAudioIOThread> m_ioThread;
+    QByteArray m_ioBuffer;
+    QAudio::State m_ioState = QAudio::StoppedState;
+    QAudio::Error m_ioError = QAudio::NoError;
 };
 
 class PulseInputPrivate : public QIODevice
@@ -216,6 +216,68 @@ void QMediaRecorder::setCaptureSession(QMediaCaptureSession *session)
     and reset when new location is set or new recording starts.
 */
 
+/*!
+    Adds \a location as an additional output of the next recording.
+
+    Additional outputs receive the same encoded media as the main output
+    location, without encoding it a second time. Besides local files, the
+    location can be a network URL supported by the backend, for example
+    \c{udp://127.0.0.1:1234}. The container is given by \a format, or guessed
+    from the location if it is QMediaFormat::UnspecifiedFormat. Network
+    outputs default to MPEG transport streams.
+
+    Every output is written from its own queue, so a slow output drops media
+    rather than holding up the other ones. An output that can't be opened or
+    written to is reported through errorOccurred(), while the recording to the
+    other outputs continues.
+
+    Additional outputs are kept for following recordings until
+    clearAdditionalOutputs() is called. They are not supported by all
+    backends.
+
+    \since 6.5
+*/
+void QMediaRecorder::addAdditionalOutput(const QUrl &location, QMediaFormat::FileFormat format)
+{
+    Q_D(QMediaRecorder);
+    if (d->control)
+        d->control->addAdditionalOutput({ location, nullptr, format });
+}
+
+/*!
+    \overload
+
+    Adds \a device as an additional output of the next recording, writing
+    the container given by \a format.
+
+    The device has to be open for writing, and must stay valid until the
+    recording is finished. It is written to from an internal thread, so it
+    must not be used otherwise while recording. Containers like MP4 that
+    normally seek back to complete their header are written as fragments to
+    sequential devices.
+
+    \since 6.5
+*/
+void QMediaRecorder::addAdditionalOutput(QIODevice *device, QMediaFormat::FileFormat format)
+{
+    Q_D(QMediaRecorder);
+    if (d->control && device)
+        d->control->addAdditionalOutput({ QUrl(), device, format });
+}
+
+/*!
+    Removes all outputs added with addAdditionalOutput(). The recording in
+    progress is not affected.
+
+    \since 6.5
+*/
+void QMediaRecorder::clearAdditionalOutputs()
+{
+    Q_D(QMediaRecorder);
+    if (d->control)
+        d->control->clearAdditionalOutputs();
+}
+
 /*!
     \qmlproperty bool QtMultimedia::MediaRecorder::isAvailable
     \brief This property holds whether the recorder service is ready to use.
@@ -311,6 +373,113 @@ qint64 QMediaRecorder::duration() const
 {
     return d_func()->control ? d_func()->control->duration() : 0;
 }
+
+/*!
+    Returns the number of video frames the encoder dropped because it could
+    not keep up with the camera or screen capture.
+
+    The encoding statistics describe the current recording, or the last one
+    while the recorder is stopped. They are updated as the recording
+    progresses, so they can be polled, for example whenever durationChanged()
+    is emitted. Backends that don't collect statistics report 0.
+
+    \since 6.5
+    \sa lateVideoFrames(), droppedCaptureFrames(), lateCaptureFrames(), encodeFrameRate()
+*/
+qint64 QMediaRecorder::droppedVideoFrames() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().droppedVideoFrames : 0;
+}
+
+/*!
+    Returns the number of video frames that waited for the encoder for
+    longer than two frame intervals. A growing count is an early sign of the
+    encoder falling behind, before it starts to drop frames.
+
+    \since 6.5
+    \sa droppedVideoFrames()
+*/
+qint64 QMediaRecorder::lateVideoFrames() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().lateVideoFrames : 0;
+}
+
+/*!
+    Returns the number of frames the camera dropped before they could be
+    passed to the encoder, for example because all of the driver's buffers
+    were in use.
+
+    \since 6.5
+    \sa droppedVideoFrames()
+*/
+qint64 QMediaRecorder::droppedCaptureFrames() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().droppedCaptureFrames : 0;
+}
+
+/*!
+    Returns the number of frames the camera delivered more than a frame
+    interval after capturing them. A growing count means the capture
+    pipeline is falling behind, before the camera starts dropping frames.
+
+    \since 6.5
+    \sa droppedCaptureFrames()
+*/
+qint64 QMediaRecorder::lateCaptureFrames() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().lateCaptureFrames : 0;
+}
+
+/*!
+    Returns the longest time in microseconds a frame took from being
+    captured until the camera backend picked it up from the driver, since
+    the camera started capturing.
+
+    \since 6.5
+    \sa maxCaptureDeliveryLatency(), lateCaptureFrames()
+*/
+qint64 QMediaRecorder::maxCaptureDequeueLatency() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().maxCaptureDequeueLatency : 0;
+}
+
+/*!
+    Returns the longest time in microseconds the camera backend took to hand
+    a frame to all of its consumers, like the encoder and the preview, since
+    the camera started capturing.
+
+    \since 6.5
+    \sa maxCaptureDequeueLatency(), lateCaptureFrames()
+*/
+qint64 QMediaRecorder::maxCaptureDeliveryLatency() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().maxCaptureDeliveryLatency : 0;
+}
+
+/*!
+    Returns the number of audio buffers the encoder dropped because it could
+    not keep up with the audio input.
+
+    \since 6.5
+    \sa droppedVideoFrames()
+*/
+qint64 QMediaRecorder::droppedAudioBuffers() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().droppedAudioBuffers : 0;
+}
+
+/*!
+    Returns the rate in frames per second at which video frames are currently
+    being encoded. If the encoder stops making progress, the rate drops towards
+    0 instead of keeping the last measured value.
+
+    \since 6.5
+    \sa droppedVideoFrames()
+*/
+qreal QMediaRecorder::encodeFrameRate() const
+{
+    return d_func()->control ? d_func()->control->encodingStatistics().encodeFrameRate : 0;
+}
 /*!
     \qmlmethod QtMultimedia::MediaRecorder::record()
     \brief Starts recording.
@@ -417,6 +586,37 @@ void QMediaRecorder::stop()
     if (d->control && d->captureSession)
         d->control->stop();
 }
+
+/*!
+    \qmlmethod QtMultimedia::MediaRecorder::triggerPreEventRecording()
+    \brief Starts writing a pre-event recording to disk.
+
+    \since 6.5
+*/
+/*!
+    Starts writing a pre-event recording to disk.
+
+    If preEventDuration is set, record() only keeps that much of the most
+    recent encoded media in memory instead of writing it to the output
+    location. This is useful to capture what happened right before an event,
+    for example in surveillance or sports-replay applications.
+
+    Calling this function writes the buffered media to actualLocation() right
+    away, starting at a key frame, and continues recording live from there on
+    until stop() is called. If no event got triggered, stop() discards the buffered
+    media and no file is written.
+
+    Does nothing if the recorder is not recording or not in pre-event mode.
+
+    \since 6.5
+    \sa preEventDuration
+*/
+void QMediaRecorder::triggerPreEventRecording()
+{
+    Q_D(QMediaRecorder);
+    if (d->control && d->captureSession)
+        d->control->triggerPreEventRecording();
+}
 /*!
     \qmlproperty enumeration QtMultimedia::MediaRecorder::recorderState
     \brief This property holds the current media recorder state.
@@ -498,6 +698,31 @@ void QMediaRecorder::stop()
     Signals that the actual \a location of the recorded media has changed.
     This signal is usually emitted when recording starts.
 */
+/*!
+    \qmlsignal QtMultimedia::MediaRecorder::segmentFinished(const QUrl &location)
+    \brief Signals that the segment of the recording at \a location has been
+    completely written.
+
+    This signal is only emitted when the backend splits the recording into
+    several files.
+    \since 6.5
+*/
+/*!
+    \fn QMediaRecorder::segmentFinished(const QUrl &location)
+
+    Signals that the segment of the recording at \a location has been
+    completely written and can be moved or played back.
+
+    This signal is only emitted when the recording is split into several
+    files, see segmentDuration and segmentSize. The first segment is written to actualLocation(), following segments get
+    a running number appended to the file name.
+
+    Segments start at a video key frame. Audio recorded just before that key
+    frame still goes to the previous segment, so a segment can finish shortly
+    after the next one started. The last segment is finished when recording
+    stops.
+    \since 6.5
+*/
 /*!
     \qmlsignal QtMultimedia::MediaRecorder::errorOccurred(Error error, const QString &errorString)
     \brief Signals that an \a error has occurred.
@@ -828,6 +1053,151 @@ void QMediaRecorder::setAudioSampleRate(int sampleRate)
     emit audioSampleRateChanged();
 }
 
+/*!
+    \qmlproperty qint64 QtMultimedia::MediaRecorder::segmentDuration
+    \brief The duration in milliseconds after which the recording continues in a
+    new file.
+
+    \since 6.5
+*/
+/*!
+    \property QMediaRecorder::segmentDuration
+    \brief The duration in milliseconds after which the recording continues in
+    a new file.
+
+    A new segment is started at the first video key frame after the duration
+    passed, and segmentFinished() is emitted once the previous one is complete.
+    The default of 0 doesn't split the recording by duration. Takes effect with
+    the next call to record().
+
+    Not all backends support splitting the recording.
+
+    \since 6.5
+    \sa segmentSize, segmentFinished()
+*/
+qint64 QMediaRecorder::segmentDuration() const
+{
+    Q_D(const QMediaRecorder);
+    return d->encoderSettings.segmentDuration();
+}
+
+void QMediaRecorder::setSegmentDuration(qint64 duration)
+{
+    Q_D(QMediaRecorder);
+    duration = qMax<qint64>(0, duration);
+    if (d->encoderSettings.segmentDuration() == duration)
+        return;
+    d->encoderSettings.setSegmentDuration(duration);
+    emit segmentDurationChanged();
+}
+
+/*!
+    \qmlproperty qint64 QtMultimedia::MediaRecorder::segmentSize
+    \brief The size in bytes after which the recording continues in a new file.
+
+    \since 6.5
+*/
+/*!
+    \property QMediaRecorder::segmentSize
+    \brief The size in bytes after which the recording continues in a new file.
+
+    Like with segmentDuration, the new segment starts at the next video key
+    frame, so segments grow somewhat beyond this size. The default of 0
+    doesn't split the recording by size. If both limits are set, whichever is
+    reached first starts a new segment.
+
+    \since 6.5
+    \sa segmentDuration, segmentFinished()
+*/
+qint64 QMediaRecorder::segmentSize() const
+{
+    Q_D(const QMediaRecorder);
+    return d->encoderSettings.segmentSize();
+}
+
+void QMediaRecorder::setSegmentSize(qint64 size)
+{
+    Q_D(QMediaRecorder);
+    size = qMax<qint64>(0, size);
+    if (d->encoderSettings.segmentSize() == size)
+        return;
+    d->encoderSettings.setSegmentSize(size);
+    emit segmentSizeChanged();
+}
+
+/*!
+    \qmlproperty bool QtMultimedia::MediaRecorder::fragmented
+    \brief Whether the recording is written as a series of self-contained
+    fragments.
+
+    \since 6.5
+*/
+/*!
+    \property QMediaRecorder::fragmented
+    \brief Whether the recording is written as a series of self-contained
+    fragments.
+
+    Fragmented files can be played back while they are still being written,
+    and stay readable up to the last fragment if the recording gets
+    interrupted. This is supported for MP4, QuickTime, Matroska and WebM files.
+    The default is \c false.
+
+    \since 6.5
+*/
+bool QMediaRecorder::isFragmented() const
+{
+    Q_D(const QMediaRecorder);
+    return d->encoderSettings.isFragmented();
+}
+
+void QMediaRecorder::setFragmented(bool fragmented)
+{
+    Q_D(QMediaRecorder);
+    if (d->encoderSettings.isFragmented() == fragmented)
+        return;
+    d->encoderSettings.setFragmented(fragmented);
+    emit fragmentedChanged();
+}
+
+/*!
+    \qmlproperty qint64 QtMultimedia::MediaRecorder::preEventDuration
+    \brief The duration in milliseconds of media kept in memory until
+    triggerPreEventRecording() is called.
+
+    \since 6.5
+*/
+/*!
+    \property QMediaRecorder::preEventDuration
+    \brief The duration in milliseconds of media kept in memory until
+    triggerPreEventRecording() is called.
+
+    With a duration greater than 0, record() starts encoding but doesn't write
+    anything to the output location yet. The buffered media always starts at a
+    video key frame, so somewhat more than the duration can be kept, depending
+    on the key frame interval of the encoder. The default of 0 writes the
+    recording right away. Takes effect with the next call to record().
+
+    Not all backends support pre-event recording.
+
+    \since 6.5
+    \sa triggerPreEventRecording()
+*/
+qint64 QMediaRecorder::preEventDuration() const
+{
+    Q_D(const QMediaRecorder);
+    return d->encoderSettings.preEventDuration();
+}
+
+void QMediaRecorder::setPreEventDuration(qint64 duration)
+{
+    Q_D(QMediaRecorder);
+    duration = qMax<qint64>(0, duration);
+    if (d->encoderSettings.preEventDuration() == duration)
+        return;
+    d->encoderSettings.setPreEventDuration(duration);
+    emit preEventDurationChanged();
+}
+
 QT_END_NAMESPACE
 
 #include "moc_qmediarecorder.cpp"
@@ -45,17 +45,18 @@
 #include <QtMultimedia/qtmultimediaglobal.h>
 #include <QtMultimedia/qmediaenumdebug.h>
 #include <QtMultimedia/qmediametadata.h>
+#include <QtMultimedia/qmediaformat.h>
 
 #include <QtCore/qpair.h>
 
 QT_BEGIN_NAMESPACE
 
 class QUrl;
+class QIODevice;
 class QSize;
 class QAudioFormat;
 class QCamera;
 class QCameraDevice;
-class QMediaFormat;
 class QAudioDevice;
 class QMediaCaptureSession;
 class QPlatformMediaRecorder;
@@ -73,6 +74,10 @@ class Q_MULTIMEDIA_EXPORT QMediaRecorder : public QObject
     Q_PROPERTY(QString errorString READ errorString NOTIFY errorChanged)
     Q_PROPERTY(QMediaFormat mediaFormat READ mediaFormat WRITE setMediaFormat NOTIFY mediaFormatChanged)
     Q_PROPERTY(Quality quality READ quality WRITE setQuality)
+    Q_PROPERTY(qint64 segmentDuration READ segmentDuration WRITE setSegmentDuration NOTIFY segmentDurationChanged)
+    Q_PROPERTY(qint64 segmentSize READ segmentSize WRITE setSegmentSize NOTIFY segmentSizeChanged)
+    Q_PROPERTY(bool fragmented READ isFragmented WRITE setFragmented NOTIFY fragmentedChanged)
+    Q_PROPERTY(qint64 preEventDuration READ preEventDuration WRITE setPreEventDuration NOTIFY preEventDurationChanged)
 public:
     enum Quality
     {
@@ -121,6 +126,11 @@ public:
 
     QUrl actualLocation() const;
 
+    void addAdditionalOutput(const QUrl &location,
+                             QMediaFormat::FileFormat format = QMediaFormat::UnspecifiedFormat);
+    void addAdditionalOutput(QIODevice *device, QMediaFormat::FileFormat format);
+    void clearAdditionalOutputs();
+
     RecorderState recorderState() const;
 
     Error error() const;
@@ -128,6 +138,15 @@ public:
 
     qint64 duration() const;
 
+    qint64 droppedVideoFrames() const;
+    qint64 lateVideoFrames() const;
+    qint64 droppedCaptureFrames() const;
+    qint64 lateCaptureFrames() const;
+    qint64 maxCaptureDequeueLatency() const;
+    qint64 maxCaptureDeliveryLatency() const;
+    qint64 droppedAudioBuffers() const;
+    qreal encodeFrameRate() const;
+
     QMediaFormat mediaFormat() const;
     void setMediaFormat(const QMediaFormat &format);
 
@@ -156,6 +175,18 @@ public:
     int audioSampleRate() const;
     void setAudioSampleRate(int sampleRate);
 
+    qint64 segmentDuration() const;
+    void setSegmentDuration(qint64 duration);
+
+    qint64 segmentSize() const;
+    void setSegmentSize(qint64 size);
+
+    bool isFragmented() const;
+    void setFragmented(bool fragmented);
+
+    qint64 preEventDuration() const;
+    void setPreEventDuration(qint64 duration);
+
     QMediaMetaData metaData() const;
     void setMetaData(const QMediaMetaData &metaData);
     void addMetaData(const QMediaMetaData &metaData);
@@ -167,11 +198,13 @@ public Q_SLOTS:
     void record();
     void pause();
     void stop();
+    void triggerPreEventRecording();
 
 Q_SIGNALS:
     void recorderStateChanged(RecorderState state);
     void durationChanged(qint64 duration);
     void actualLocationChanged(const QUrl &location);
+    void segmentFinished(const QUrl &location);
     void encoderSettingsChanged();
 
     void errorOccurred(Error error, const QString &errorString);
@@ -188,6 +221,10 @@ Q_SIGNALS:
     void audioBitRateChanged();
     void audioChannelCountChanged();
     void audioSampleRateChanged();
+    void segmentDurationChanged();
+    void segmentSizeChanged();
+    void fragmentedChanged();
+    void preEventDurationChanged();
 
 private:
     QMediaRecorderPrivate *d_ptr;
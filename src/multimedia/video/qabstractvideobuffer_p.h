@@ -92,6 +92,10 @@ public:
     virtual quint64 textureHandle(int /*plane*/) const { return 0; }
     virtual std::unique_ptr<QRhiTexture> texture(int /*plane*/) const;
 
+    // File descriptor of a DMA buffer backing the plane, or -1. Consumers that can
+    // import DMA buffers use it to access the frame data without mapping it.
+    virtual int dmaBufFileDescriptor(int /*plane*/) const { return -1; }
+
     virtual QMatrix4x4 externalTextureMatrix() const { return {}; }
 protected:
     QVideoFrame::HandleType m_type;
@@ -59,7 +59,7 @@ QT_BEGIN_NAMESPACE
 // Converts to RGB32 or ARGB32_Premultiplied
 typedef void (QT_FASTCALL *VideoFrameConvertFunc)(const QVideoFrame &frame, uchar *output);
 
-VideoFrameConvertFunc qConverterForFormat(QVideoFrameFormat::PixelFormat format);
+Q_MULTIMEDIA_EXPORT VideoFrameConvertFunc qConverterForFormat(QVideoFrameFormat::PixelFormat format);
 
 template<int a, int r, int g, int b>
 struct ArgbPixel
@@ -56,10 +56,13 @@
 #include <QtGui/private/qrhimetal_p.h>
 #endif
 
+#include <QtCore/qabstracteventdispatcher.h>
 #include <QtCore/qcoreapplication.h>
 #include <QtCore/qsize.h>
 #include <QtCore/qhash.h>
 #include <QtCore/qfile.h>
+#include <QtCore/qpromise.h>
+#include <QtCore/qthread.h>
 #include <QtCore/qthreadstorage.h>
 #include <QtGui/qimage.h>
 #include <qpa/qplatformintegration.h>
@@ -68,6 +71,9 @@
 #include <private/qguiapplication_p.h>
 #include <private/qrhi_p.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
@@ -75,6 +81,42 @@ Q_LOGGING_CATEGORY(qLcVideoFrameConverter, "qt.multimedia.video.frameconverter")
 
 namespace {
 
+constexpr int maxPlanes = QVideoTextureHelper::TextureDescription::maxPlanes;
+
+// How many sets of conversion resources a thread keeps around between
+// conversions. Batches converting more frames than this create the extra
+// sets on demand and drop them again afterwards.
+constexpr size_t maxCachedResources = 8;
+
+// The resources needed to convert frames of one pixel format and size into
+// an image of a given (rotated) size.
+struct ConversionResources
+{
+    QVideoFrameFormat::PixelFormat pixelFormat = QVideoFrameFormat::Format_Invalid;
+    QString vertexShader;
+    QString fragmentShader;
+    QSize frameSize;
+    QSize targetSize;
+
+    std::unique_ptr<QRhiBuffer> uniformBuffer;
+    std::unique_ptr<QRhiTexture> targetTexture;
+    std::unique_ptr<QRhiTextureRenderTarget> renderTarget;
+    std::unique_ptr<QRhiRenderPassDescriptor> renderPass;
+    std::unique_ptr<QRhiShaderResourceBindings> shaderResourceBindings;
+    std::unique_ptr<QRhiGraphicsPipeline> graphicsPipeline;
+    std::unique_ptr<QRhiTexture> frameTextures[maxPlanes];
+    QRhiTexture *boundTextures[maxPlanes] = {};
+
+    quint64 lastUsed = 0;
+    bool inUse = false;
+};
+
+struct PendingConversion
+{
+    QVideoFrame frame;
+    QPromise<QImage> promise;
+};
+
 struct State
 {
     QRhi *rhi = nullptr;
@@ -82,7 +124,22 @@ struct State
     QOffscreenSurface *fallbackSurface = nullptr;
 #endif
     bool cpuOnly = false;
+
+    // Resources reused by all conversions done with the rhi above
+    std::unique_ptr<QRhiBuffer> vertexBuffer;
+    bool vertexBufferUploaded = false;
+    std::unique_ptr<QRhiSampler> textureSampler;
+    std::vector<std::unique_ptr<ConversionResources>> resources;
+    quint64 useCounter = 0;
+
+    // Frames queued by qImageFromVideoFrameAsync() for the next batch
+    std::vector<PendingConversion> pendingConversions;
+    bool flushScheduled = false;
+
     ~State() {
+        resources.clear();
+        textureSampler.reset();
+        vertexBuffer.reset();
         delete rhi;
 #if QT_CONFIG(opengl)
         delete fallbackSurface;
@@ -90,9 +147,28 @@ struct State
     }
 };
 
+struct Conversion
+{
+    Conversion(const QVideoFrame &frame, QVideoFrame::RotationAngle rotation, bool mirrorX, bool mirrorY)
+        : frame(frame), rotation(rotation), mirrorX(mirrorX), mirrorY(mirrorY)
+    {}
+
+    QVideoFrame frame;
+    QVideoFrame::RotationAngle rotation;
+    bool mirrorX;
+    bool mirrorY;
+
+    QImage image;
+    bool done = false;
+
+    QRhi *rhi = nullptr;
+    QRhiReadbackResult readResult;
+    bool readCompleted = false;
+};
+
 }
 
-static QThreadStorage<State> g_state;
+static QThreadStorage<State *> g_state;
 static QHash<QString, QShader> g_shaderCache;
 
 static const float g_quad[] = {
@@ -118,6 +194,13 @@ static const float g_quad[] = {
    -1.f,  1.f,  1.f, 0.f,
 };
 
+static State &threadState()
+{
+    if (!g_state.hasLocalData())
+        g_state.setLocalData(new State);
+    return *g_state.localData();
+}
+
 static bool pixelFormatHasAlpha(QVideoFrameFormat::PixelFormat format)
 {
     switch (format) {
@@ -173,87 +256,195 @@ static void imageCleanupHandler(void *info)
 
 static QRhi *initializeRHI(QRhi::Implementation backend)
 {
-    if (g_state.localData().rhi || g_state.localData().cpuOnly)
-        return g_state.localData().rhi;
+    State &state = threadState();
+    if (state.rhi || state.cpuOnly)
+        return state.rhi;
 
     if (QGuiApplicationPrivate::platformIntegration()->hasCapability(QPlatformIntegration::RhiBasedRendering)) {
 
 #if defined(Q_OS_MACOS) || defined(Q_OS_IOS)
         if (backend == QRhi::Metal || backend == QRhi::Null) {
             QRhiMetalInitParams params;
-            g_state.localData().rhi = QRhi::create(QRhi::Metal, &params);
+            state.rhi = QRhi::create(QRhi::Metal, &params);
         }
 #endif
 
 #if defined(Q_OS_WIN)
         if (backend == QRhi::D3D11 || backend == QRhi::Null) {
             QRhiD3D11InitParams params;
-            g_state.localData().rhi = QRhi::create(QRhi::D3D11, &params);
+            state.rhi = QRhi::create(QRhi::D3D11, &params);
         }
 #endif
 
 #if QT_CONFIG(opengl)
-        if (!g_state.localData().rhi && (backend == QRhi::OpenGLES2 || backend == QRhi::Null)) {
+        if (!state.rhi && (backend == QRhi::OpenGLES2 || backend == QRhi::Null)) {
             if (QGuiApplicationPrivate::platformIntegration()->hasCapability(QPlatformIntegration::OpenGL)
                     && QGuiApplicationPrivate::platformIntegration()->hasCapability(QPlatformIntegration::RasterGLSurface)
                     && !QCoreApplication::testAttribute(Qt::AA_ForceRasterWidgets)) {
 
-                g_state.localData().fallbackSurface = QRhiGles2InitParams::newFallbackSurface();
+                state.fallbackSurface = QRhiGles2InitParams::newFallbackSurface();
                 QRhiGles2InitParams params;
-                params.fallbackSurface = g_state.localData().fallbackSurface;
-                g_state.localData().rhi = QRhi::create(QRhi::OpenGLES2, &params);
+                params.fallbackSurface = state.fallbackSurface;
+                state.rhi = QRhi::create(QRhi::OpenGLES2, &params);
             }
         }
 #endif
     }
 
-    if (!g_state.localData().rhi) {
-        g_state.localData().cpuOnly = true;
+    if (!state.rhi) {
+        state.cpuOnly = true;
         qWarning() << Q_FUNC_INFO << ": No RHI backend. Using CPU conversion.";
     }
 
-    return g_state.localData().rhi;
+    return state.rhi;
+}
+
+static QRhi *rhiForFrame(const QVideoFrame &frame)
+{
+    QRhi *rhi = nullptr;
+    QRhi::Implementation backend = QRhi::Null;
+
+    if (frame.videoBuffer()) {
+        rhi = frame.videoBuffer()->rhi();
+        if (rhi)
+            backend = rhi->backend();
+    }
+
+    if (!rhi || rhi->thread() != QThread::currentThread())
+        rhi = initializeRHI(backend);
+
+    return rhi;
+}
+
+static QSize targetSize(const Conversion &conversion)
+{
+    QSize size = conversion.frame.size();
+    if ((conversion.rotation / 90) % 2)
+        size.transpose();
+    return size;
+}
+
+static ConversionResources *acquireResources(State &state, const QVideoFrame &frame, const QSize &targetSize)
+{
+    const auto format = frame.surfaceFormat();
+    const QString vertexShader = QVideoTextureHelper::vertexShaderFileName(format);
+    const QString fragmentShader = QVideoTextureHelper::fragmentShaderFileName(format);
+
+    ConversionResources *resources = nullptr;
+    for (const auto &r : state.resources) {
+        if (!r->inUse && r->pixelFormat == format.pixelFormat() && r->frameSize == frame.size()
+            && r->targetSize == targetSize && r->vertexShader == vertexShader
+            && r->fragmentShader == fragmentShader) {
+            resources = r.get();
+            break;
+        }
+    }
+
+    if (!resources) {
+        auto r = std::make_unique<ConversionResources>();
+        r->pixelFormat = format.pixelFormat();
+        r->vertexShader = vertexShader;
+        r->fragmentShader = fragmentShader;
+        r->frameSize = frame.size();
+        r->targetSize = targetSize;
+        resources = r.get();
+        state.resources.push_back(std::move(r));
+    }
+
+    resources->inUse = true;
+    resources->lastUsed = ++state.useCounter;
+    return resources;
+}
+
+static void releaseResources(State &state)
+{
+    for (const auto &r : state.resources)
+        r->inUse = false;
+
+    // Drop the least recently used sets beyond the cache limit
+    while (state.resources.size() > maxCachedResources) {
+        auto oldest = std::min_element(state.resources.begin(), state.resources.end(),
+                                       [](const auto &a, const auto &b) {
+                                           return a->lastUsed < b->lastUsed;
+                                       });
+        state.resources.erase(oldest);
+    }
+}
+
+static bool createTarget(QRhi *rhi, ConversionResources &resources)
+{
+    if (resources.renderTarget)
+        return true;
+
+    resources.uniformBuffer.reset(rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, 64 + 64 + 4 + 4 + 4 + 4));
+    resources.uniformBuffer->create();
+
+    resources.shaderResourceBindings.reset(rhi->newShaderResourceBindings());
+
+    resources.targetTexture.reset(rhi->newTexture(QRhiTexture::RGBA8, resources.targetSize, 1, QRhiTexture::RenderTarget));
+    if (!resources.targetTexture->create()) {
+        resources.targetTexture.reset();
+        return false;
+    }
+
+    std::unique_ptr<QRhiTextureRenderTarget> renderTarget(rhi->newTextureRenderTarget({ { resources.targetTexture.get() } }));
+    resources.renderPass.reset(renderTarget->newCompatibleRenderPassDescriptor());
+    renderTarget->setRenderPassDescriptor(resources.renderPass.get());
+    renderTarget->create();
+    resources.renderTarget = std::move(renderTarget);
+
+    return true;
 }
 
 static bool updateTextures(QRhi *rhi,
                            QRhiResourceUpdateBatch *rub,
-                           std::unique_ptr<QRhiBuffer> &uniformBuffer,
-                           std::unique_ptr<QRhiSampler> &textureSampler,
-                           std::unique_ptr<QRhiShaderResourceBindings> &shaderResourceBindings,
-                           std::unique_ptr<QRhiGraphicsPipeline> &graphicsPipeline,
-                           std::unique_ptr<QRhiRenderPassDescriptor> &renderPass,
-                           const QVideoFrame &frame,
-                           std::unique_ptr<QRhiTexture> (&textures)[QVideoTextureHelper::TextureDescription::maxPlanes])
+                           QRhiSampler *textureSampler,
+                           ConversionResources &resources,
+                           const QVideoFrame &frame)
 {
     auto format = frame.surfaceFormat();
     auto pixelFormat = format.pixelFormat();
 
     auto textureDesc = QVideoTextureHelper::textureDescription(pixelFormat);
 
-    for (int i = 0; i < QVideoTextureHelper::TextureDescription::maxPlanes; ++i)
-        QVideoTextureHelper::updateRhiTexture(frame, rhi, rub, i, textures[i]);
+    for (int i = 0; i < maxPlanes; ++i)
+        QVideoTextureHelper::updateRhiTexture(frame, rhi, rub, i, resources.frameTextures[i]);
 
-    QRhiShaderResourceBinding bindings[4];
-    auto *b = bindings;
-    *b++ = QRhiShaderResourceBinding::uniformBuffer(0, QRhiShaderResourceBinding::VertexStage | QRhiShaderResourceBinding::FragmentStage,
-                                                    uniformBuffer.get());
+    // The bindings only need rebuilding when a plane ended up in a different
+    // texture object, e.g. for frames that come with their own textures.
+    bool bindingsChanged = !resources.graphicsPipeline;
     for (int i = 0; i < textureDesc->nplanes; ++i)
-        *b++ = QRhiShaderResourceBinding::sampledTexture(i + 1, QRhiShaderResourceBinding::FragmentStage,
-                                                         textures[i].get(), textureSampler.get());
-    shaderResourceBindings->setBindings(bindings, b);
-    shaderResourceBindings->create();
+        bindingsChanged |= resources.boundTextures[i] != resources.frameTextures[i].get();
+
+    if (bindingsChanged) {
+        QRhiShaderResourceBinding bindings[4];
+        auto *b = bindings;
+        *b++ = QRhiShaderResourceBinding::uniformBuffer(0, QRhiShaderResourceBinding::VertexStage | QRhiShaderResourceBinding::FragmentStage,
+                                                        resources.uniformBuffer.get());
+        for (int i = 0; i < textureDesc->nplanes; ++i)
+            *b++ = QRhiShaderResourceBinding::sampledTexture(i + 1, QRhiShaderResourceBinding::FragmentStage,
+                                                             resources.frameTextures[i].get(), textureSampler);
+        resources.shaderResourceBindings->setBindings(bindings, b);
+        resources.shaderResourceBindings->create();
+
+        for (int i = 0; i < maxPlanes; ++i)
+            resources.boundTextures[i] = i < textureDesc->nplanes ? resources.frameTextures[i].get() : nullptr;
+    }
 
-    graphicsPipeline.reset(rhi->newGraphicsPipeline());
-    graphicsPipeline->setTopology(QRhiGraphicsPipeline::TriangleStrip);
+    if (resources.graphicsPipeline)
+        return true;
 
-    QShader vs = getShader(QVideoTextureHelper::vertexShaderFileName(format));
+    QShader vs = getShader(resources.vertexShader);
     if (!vs.isValid())
         return false;
 
-    QShader fs = getShader(QVideoTextureHelper::fragmentShaderFileName(format));
+    QShader fs = getShader(resources.fragmentShader);
     if (!fs.isValid())
         return false;
 
+    std::unique_ptr<QRhiGraphicsPipeline> graphicsPipeline(rhi->newGraphicsPipeline());
+    graphicsPipeline->setTopology(QRhiGraphicsPipeline::TriangleStrip);
+
     graphicsPipeline->setShaderStages({
         { QRhiShaderStage::Vertex, vs },
         { QRhiShaderStage::Fragment, fs }
@@ -269,10 +460,12 @@ static bool updateTextures(QRhi *rhi,
     });
 
     graphicsPipeline->setVertexInputLayout(inputLayout);
-    graphicsPipeline->setShaderResourceBindings(shaderResourceBindings.get());
-    graphicsPipeline->setRenderPassDescriptor(renderPass.get());
-    graphicsPipeline->create();
+    graphicsPipeline->setShaderResourceBindings(resources.shaderResourceBindings.get());
+    graphicsPipeline->setRenderPassDescriptor(resources.renderPass.get());
+    if (!graphicsPipeline->create())
+        return false;
 
+    resources.graphicsPipeline = std::move(graphicsPipeline);
     return true;
 }
 
@@ -311,150 +504,281 @@ static QImage convertCPU(const QVideoFrame &frame, QVideoFrame::RotationAngle ro
     }
 }
 
-QImage qImageFromVideoFrame(const QVideoFrame &frame, QVideoFrame::RotationAngle rotation, bool mirrorX, bool mirrorY)
+static QImage imageFromReadback(const QVideoFrame &frame, const QRhiReadbackResult &readResult)
 {
-#ifdef Q_OS_DARWIN
-    QMacAutoReleasePool releasePool;
-#endif
+    if (!qConverterForFormat(frame.pixelFormat())) {
+        qCDebug(qLcVideoFrameConverter) << "Unsupported pixel format" << frame.pixelFormat();
+        return {};
+    }
 
-    if (!g_state.hasLocalData())
-        g_state.setLocalData({});
+    QImage::Format format = pixelFormatHasAlpha(frame.pixelFormat()) ?
+                QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
 
-    std::unique_ptr<QRhiRenderPassDescriptor> renderPass;
-    std::unique_ptr<QRhiBuffer> vertexBuffer;
-    std::unique_ptr<QRhiBuffer> uniformBuffer;
-    std::unique_ptr<QRhiTexture> targetTexture;
-    std::unique_ptr<QRhiTextureRenderTarget> renderTarget;
-    std::unique_ptr<QRhiSampler> textureSampler;
-    std::unique_ptr<QRhiShaderResourceBindings> shaderResourceBindings;
-    std::unique_ptr<QRhiGraphicsPipeline> graphicsPipeline;
-    std::unique_ptr<QRhiTexture> frameTextures[QVideoTextureHelper::TextureDescription::maxPlanes];
+    QByteArray *imageData = new QByteArray(readResult.data);
 
-    if (frame.size().isEmpty() || frame.pixelFormat() == QVideoFrameFormat::Format_Invalid)
-        return {};
+    return QImage(reinterpret_cast<const uchar *>(imageData->constData()),
+                  readResult.pixelSize.width(), readResult.pixelSize.height(),
+                  format, imageCleanupHandler, imageData);
+}
 
-    if (frame.pixelFormat() == QVideoFrameFormat::Format_Jpeg)
-        return convertJPEG(frame, rotation, mirrorX, mirrorY);
+// Renders all conversions using the given rhi in a single offscreen frame, so
+// that the GPU is waited for once per batch rather than once per frame.
+// Conversions that fail are left for the caller to do on the CPU.
+static void convertOnRhi(QRhi *rhi, const std::vector<Conversion *> &conversions)
+{
+    State &state = threadState();
 
-    QRhi *rhi = nullptr;
-    QRhi::Implementation backend = QRhi::Null;
+    // The thread's own rhi keeps its resources between calls; frames converted
+    // with the rhi of their video buffer get temporary ones.
+    const bool cached = rhi == state.rhi;
+    std::unique_ptr<QRhiBuffer> ownVertexBuffer;
+    std::unique_ptr<QRhiSampler> ownSampler;
+    std::vector<std::unique_ptr<ConversionResources>> ownResources;
 
-    if (frame.videoBuffer()) {
-        rhi = frame.videoBuffer()->rhi();
-        if (rhi)
-            backend = rhi->backend();
+    std::unique_ptr<QRhiBuffer> &vertexBuffer = cached ? state.vertexBuffer : ownVertexBuffer;
+    std::unique_ptr<QRhiSampler> &textureSampler = cached ? state.textureSampler : ownSampler;
+
+    if (!vertexBuffer) {
+        vertexBuffer.reset(rhi->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, sizeof(g_quad)));
+        vertexBuffer->create();
     }
 
-    if (!rhi || rhi->thread() != QThread::currentThread())
-        rhi = initializeRHI(backend);
+    if (!textureSampler) {
+        textureSampler.reset(rhi->newSampler(QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::None,
+                                             QRhiSampler::ClampToEdge, QRhiSampler::ClampToEdge));
+        textureSampler->create();
+    }
 
-    if (!rhi || rhi->isRecordingFrame())
-        return convertCPU(frame, rotation, mirrorX, mirrorY);
+    QRhiCommandBuffer *cb = nullptr;
+    QRhi::FrameOpResult r = rhi->beginOffscreenFrame(&cb);
+    if (r != QRhi::FrameOpSuccess) {
+        qCDebug(qLcVideoFrameConverter) << "Failed to set up offscreen frame. Using CPU conversion.";
+        return;
+    }
 
-    // Do conversion using shaders
+    bool uploadVertices = !cached || !state.vertexBufferUploaded;
+    QRhiResourceUpdateBatch *rub = nullptr;
+
+    for (Conversion *conversion : conversions) {
+        const QVideoFrame &frame = conversion->frame;
+        const QSize frameSize = targetSize(*conversion);
+
+        ConversionResources *resources = nullptr;
+        if (cached) {
+            resources = acquireResources(state, frame, frameSize);
+        } else {
+            ownResources.push_back(std::make_unique<ConversionResources>());
+            resources = ownResources.back().get();
+            resources->frameSize = frame.size();
+            resources->targetSize = frameSize;
+            resources->vertexShader = QVideoTextureHelper::vertexShaderFileName(frame.surfaceFormat());
+            resources->fragmentShader = QVideoTextureHelper::fragmentShaderFileName(frame.surfaceFormat());
+        }
 
-    const int rotationIndex = (rotation / 90) % 4;
+        if (!createTarget(rhi, *resources)) {
+            qCDebug(qLcVideoFrameConverter) << "Failed to create target texture. Using CPU conversion.";
+            continue;
+        }
 
-    QSize frameSize = frame.size();
-    if (rotationIndex % 2)
-        frameSize.transpose();
+        if (!rub) {
+            rub = rhi->nextResourceUpdateBatch();
+            if (uploadVertices)
+                rub->uploadStaticBuffer(vertexBuffer.get(), g_quad);
+        }
+
+        if (!updateTextures(rhi, rub, textureSampler.get(), *resources, frame)) {
+            qCDebug(qLcVideoFrameConverter) << "Failed to update textures. Using CPU conversion.";
+            continue;
+        }
+
+        float xScale = conversion->mirrorX ? -1.0 : 1.0;
+        float yScale = conversion->mirrorY ? -1.0 : 1.0;
+
+        if (rhi->isYUpInFramebuffer())
+            yScale = -yScale;
+
+        QMatrix4x4 transform;
+        transform.scale(xScale, yScale);
 
-    vertexBuffer.reset(rhi->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, sizeof(g_quad)));
-    vertexBuffer->create();
+        QByteArray uniformData(64 + 64 + 4 + 4, Qt::Uninitialized);
+        QVideoTextureHelper::updateUniformData(&uniformData, frame.surfaceFormat(), frame, transform, 1.f);
+        rub->updateDynamicBuffer(resources->uniformBuffer.get(), 0, uniformData.size(), uniformData.constData());
 
-    uniformBuffer.reset(rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, 64 + 64 + 4 + 4 + 4 + 4));
-    uniformBuffer->create();
+        cb->beginPass(resources->renderTarget.get(), Qt::black, { 1.0f, 0 }, rub);
+        rub = nullptr;
+        uploadVertices = false;
 
-    textureSampler.reset(rhi->newSampler(QRhiSampler::Linear, QRhiSampler::Linear, QRhiSampler::None,
-                                         QRhiSampler::ClampToEdge, QRhiSampler::ClampToEdge));
-    textureSampler->create();
+        cb->setGraphicsPipeline(resources->graphicsPipeline.get());
 
-    shaderResourceBindings.reset(rhi->newShaderResourceBindings());
+        cb->setViewport({ 0, 0, float(frameSize.width()), float(frameSize.height()) });
+        cb->setShaderResources(resources->shaderResourceBindings.get());
 
-    targetTexture.reset(rhi->newTexture(QRhiTexture::RGBA8, frameSize, 1, QRhiTexture::RenderTarget));
-    if (!targetTexture->create()) {
-        qCDebug(qLcVideoFrameConverter) << "Failed to create target texture. Using CPU conversion.";
-        return convertCPU(frame, rotation, mirrorX, mirrorY);
+        const int rotationIndex = (conversion->rotation / 90) % 4;
+        quint32 vertexOffset = quint32(sizeof(float)) * 16 * rotationIndex;
+        const QRhiCommandBuffer::VertexInput vbufBinding(vertexBuffer.get(), vertexOffset);
+        cb->setVertexInput(0, 1, &vbufBinding);
+        cb->draw(4);
+
+        QRhiReadbackDescription readDesc(resources->targetTexture.get());
+        bool *readCompleted = &conversion->readCompleted;
+        conversion->readResult.completed = [readCompleted] { *readCompleted = true; };
+
+        QRhiResourceUpdateBatch *readBatch = rhi->nextResourceUpdateBatch();
+        readBatch->readBackTexture(readDesc, &conversion->readResult);
+
+        cb->endPass(readBatch);
     }
 
-    renderTarget.reset(rhi->newTextureRenderTarget({ { targetTexture.get() } }));
-    renderPass.reset(renderTarget->newCompatibleRenderPassDescriptor());
-    renderTarget->setRenderPassDescriptor(renderPass.get());
-    renderTarget->create();
+    if (rub)
+        rub->release();
 
-    QRhiCommandBuffer *cb = nullptr;
-    QRhi::FrameOpResult r = rhi->beginOffscreenFrame(&cb);
-    if (r != QRhi::FrameOpSuccess) {
-        qCDebug(qLcVideoFrameConverter) << "Failed to set up offscreen frame. Using CPU conversion.";
-        return convertCPU(frame, rotation, mirrorX, mirrorY);
+    rhi->endOffscreenFrame();
+
+    if (cached) {
+        state.vertexBufferUploaded |= !uploadVertices;
+        releaseResources(state);
     }
 
-    QRhiResourceUpdateBatch *rub = rhi->nextResourceUpdateBatch();
+    for (Conversion *conversion : conversions) {
+        if (!conversion->readCompleted) {
+            qCDebug(qLcVideoFrameConverter) << "Failed to read back texture. Using CPU conversion.";
+            continue;
+        }
+        conversion->image = imageFromReadback(conversion->frame, conversion->readResult);
+        conversion->done = true;
+    }
+}
 
-    rub->uploadStaticBuffer(vertexBuffer.get(), g_quad);
+static void convertFrames(std::vector<Conversion> &conversions)
+{
+#ifdef Q_OS_DARWIN
+    QMacAutoReleasePool releasePool;
+#endif
 
-    if (!updateTextures(rhi, rub, uniformBuffer, textureSampler, shaderResourceBindings,
-                        graphicsPipeline, renderPass, frame, frameTextures)) {
-        qCDebug(qLcVideoFrameConverter) << "Failed to update textures. Using CPU conversion.";
-        return convertCPU(frame, rotation, mirrorX, mirrorY);
+    for (Conversion &conversion : conversions) {
+        const QVideoFrame &frame = conversion.frame;
+        if (frame.size().isEmpty() || frame.pixelFormat() == QVideoFrameFormat::Format_Invalid) {
+            conversion.done = true;
+        } else if (frame.pixelFormat() == QVideoFrameFormat::Format_Jpeg) {
+            conversion.image = convertJPEG(frame, conversion.rotation, conversion.mirrorX, conversion.mirrorY);
+            conversion.done = true;
+        } else {
+            conversion.rhi = rhiForFrame(frame);
+            if (conversion.rhi && conversion.rhi->isRecordingFrame())
+                conversion.rhi = nullptr;
+        }
     }
 
-    float xScale = mirrorX ? -1.0 : 1.0;
-    float yScale = mirrorY ? -1.0 : 1.0;
+    // Do conversion using shaders, one offscreen frame per rhi involved
 
-    if (rhi->isYUpInFramebuffer())
-        yScale = -yScale;
+    std::vector<Conversion *> batch;
+    for (Conversion &conversion : conversions) {
+        if (conversion.done || !conversion.rhi)
+            continue;
 
-    QMatrix4x4 transform;
-    transform.scale(xScale, yScale);
+        QRhi *rhi = conversion.rhi;
+        batch.clear();
+        for (Conversion &c : conversions) {
+            if (!c.done && c.rhi == rhi) {
+                batch.push_back(&c);
+                c.rhi = nullptr;
+            }
+        }
+        convertOnRhi(rhi, batch);
+    }
 
-    QByteArray uniformData(64 + 64 + 4 + 4, Qt::Uninitialized);
-    QVideoTextureHelper::updateUniformData(&uniformData, frame.surfaceFormat(), frame, transform, 1.f);
-    rub->updateDynamicBuffer(uniformBuffer.get(), 0, uniformData.size(), uniformData.constData());
+    for (Conversion &conversion : conversions) {
+        if (!conversion.done)
+            conversion.image = convertCPU(conversion.frame, conversion.rotation, conversion.mirrorX, conversion.mirrorY);
+    }
+}
 
-    cb->beginPass(renderTarget.get(), Qt::black, { 1.0f, 0 }, rub);
-    cb->setGraphicsPipeline(graphicsPipeline.get());
+static Conversion conversionForFrame(const QVideoFrame &frame)
+{
+    return Conversion(frame, frame.rotationAngle(), frame.mirrored(),
+                      frame.surfaceFormat().scanLineDirection() != QVideoFrameFormat::TopToBottom);
+}
 
-    cb->setViewport({ 0, 0, float(frameSize.width()), float(frameSize.height()) });
-    cb->setShaderResources(shaderResourceBindings.get());
+static void flushPendingConversions()
+{
+    State &state = threadState();
+    std::vector<PendingConversion> pending = std::exchange(state.pendingConversions, {});
+    state.flushScheduled = false;
 
-    quint32 vertexOffset = quint32(sizeof(float)) * 16 * rotationIndex;
-    const QRhiCommandBuffer::VertexInput vbufBinding(vertexBuffer.get(), vertexOffset);
-    cb->setVertexInput(0, 1, &vbufBinding);
-    cb->draw(4);
+    std::vector<Conversion> conversions;
+    conversions.reserve(pending.size());
+    for (const PendingConversion &p : pending)
+        conversions.push_back(conversionForFrame(p.frame));
 
-    QRhiReadbackDescription readDesc(targetTexture.get());
-    QRhiReadbackResult readResult;
-    bool readCompleted = false;
+    convertFrames(conversions);
 
-    readResult.completed = [&readCompleted] { readCompleted = true; };
+    for (size_t i = 0; i < pending.size(); ++i) {
+        pending[i].promise.addResult(std::move(conversions[i].image));
+        pending[i].promise.finish();
+    }
+}
 
-    rub = rhi->nextResourceUpdateBatch();
-    rub->readBackTexture(readDesc, &readResult);
+QImage qImageFromVideoFrame(const QVideoFrame &frame, QVideoFrame::RotationAngle rotation, bool mirrorX, bool mirrorY)
+{
+    std::vector<Conversion> conversions;
+    conversions.emplace_back(frame, rotation, mirrorX, mirrorY);
+    convertFrames(conversions);
+    return conversions.front().image;
+}
 
-    cb->endPass(rub);
+/*
+    Converts all \a frames to images, taking the rotation and mirroring of
+    each frame into account the same way QVideoFrame::toImage() does.
 
-    rhi->endOffscreenFrame();
+    Frames that are converted using the same QRhi are rendered within a single
+    offscreen frame, so the GPU is only waited for once for the whole list.
+*/
+QList<QImage> qImagesFromVideoFrames(const QList<QVideoFrame> &frames)
+{
+    std::vector<Conversion> conversions;
+    conversions.reserve(frames.size());
+    for (const QVideoFrame &frame : frames)
+        conversions.push_back(conversionForFrame(frame));
+
+    convertFrames(conversions);
+
+    QList<QImage> images;
+    images.reserve(frames.size());
+    for (Conversion &conversion : conversions)
+        images.append(std::move(conversion.image));
+    return images;
+}
 
-    if (!readCompleted) {
-        qCDebug(qLcVideoFrameConverter) << "Failed to read back texture. Using CPU conversion.";
-        return convertCPU(frame, rotation, mirrorX, mirrorY);
-    }
+/*
+    Queues \a frame for conversion to an image and returns a future for the
+    result.
 
-    if (!qConverterForFormat(frame.pixelFormat())) {
-        qCDebug(qLcVideoFrameConverter) << "Unsupported pixel format" << frame.pixelFormat();
-        return {};
+    All frames queued from one thread before it returns to its event loop are
+    converted together, as with qImagesFromVideoFrames(), and the futures are
+    fulfilled in the calling thread. Without an event loop, the frame is
+    converted right away.
+*/
+QFuture<QImage> qImageFromVideoFrameAsync(const QVideoFrame &frame)
+{
+    QPromise<QImage> promise;
+    QFuture<QImage> future = promise.future();
+    promise.start();
+
+    QAbstractEventDispatcher *dispatcher = QThread::currentThread()->eventDispatcher();
+    if (!dispatcher) {
+        promise.addResult(qImagesFromVideoFrames({ frame }).constFirst());
+        promise.finish();
+        return future;
     }
 
-    QImage::Format format = pixelFormatHasAlpha(frame.pixelFormat()) ?
-                QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
-
-    QByteArray *imageData = new QByteArray(readResult.data);
+    State &state = threadState();
+    state.pendingConversions.push_back({ frame, std::move(promise) });
+    if (!state.flushScheduled) {
+        state.flushScheduled = true;
+        QMetaObject::invokeMethod(dispatcher, [] { flushPendingConversions(); }, Qt::QueuedConnection);
+    }
 
-    return QImage(reinterpret_cast<const uchar *>(imageData->constData()),
-                  readResult.pixelSize.width(), readResult.pixelSize.height(),
-                  format, imageCleanupHandler, imageData);
+    return future;
 }
 
 QT_END_NAMESPACE
-
@@ -52,10 +52,14 @@
 //
 
 #include <qvideoframe.h>
+#include <QtCore/qfuture.h>
+#include <QtCore/qlist.h>
 
 QT_BEGIN_NAMESPACE
 
 Q_MULTIMEDIA_EXPORT QImage qImageFromVideoFrame(const QVideoFrame &frame, QVideoFrame::RotationAngle rotation = QVideoFrame::Rotation0, bool mirrorX = false, bool mirrorY = false);
+Q_MULTIMEDIA_EXPORT QList<QImage> qImagesFromVideoFrames(const QList<QVideoFrame> &frames);
+Q_MULTIMEDIA_EXPORT QFuture<QImage> qImageFromVideoFrameAsync(const QVideoFrame &frame);
 
 QT_END_NAMESPACE
 
@@ -56,6 +56,8 @@
 
 #include <qloggingcategory.h>
 
+#include <chrono>
+
 extern "C" {
 #include <libavutil/hwcontext.h>
 }
@@ -69,6 +71,13 @@ Q_LOGGING_CATEGORY(qLcDecoder, "qt.multimedia.ffmpeg.decoder")
 Q_LOGGING_CATEGORY(qLcVideoRenderer, "qt.multimedia.ffmpeg.videoRenderer")
 Q_LOGGING_CATEGORY(qLcAudioRenderer, "qt.multimedia.ffmpeg.audioRenderer")
 
+// monotonic time in microseconds
+static qint64 seekTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 Codec::Data::Data(AVCodecContext *context, AVStream *stream, const HWAccel &hwAccel)
     : context(context)
     , stream(stream)
@@ -84,7 +93,7 @@ Codec::Data::~Data()
     avcodec_free_context(&context);
 }
 
-Codec::Codec(AVFormatContext *format, int streamIndex)
+Codec::Codec(AVFormatContext *format, int streamIndex, const HWAccel &sharedHWAccel)
 {
     qCDebug(qLcDecoder) << "Codec::Codec" << streamIndex;
     Q_ASSERT(streamIndex >= 0 && streamIndex < (int)format->nb_streams);
@@ -100,7 +109,10 @@ Codec::Codec(AVFormatContext *format, int streamIndex)
 
     QFFmpeg::HWAccel hwAccel;
     if (decoder->type == AVMEDIA_TYPE_VIDEO) {
-        hwAccel = QFFmpeg::HWAccel(decoder);
+        // creating a device context is expensive, reuse the one of the previous media
+        hwAccel = sharedHWAccel.withSameDevice(decoder);
+        if (hwAccel.isNull())
+            hwAccel = QFFmpeg::HWAccel(decoder);
     }
 
     auto *context = avcodec_alloc_context3(decoder);
@@ -137,20 +149,34 @@ Codec::Codec(AVFormatContext *format, int streamIndex)
 }
 
 
-Demuxer::Demuxer(Decoder *decoder, AVFormatContext *context)
+Demuxer::Demuxer(Decoder *decoder, AVFormatContext *context, qint64 timeOffset)
     : Thread()
     , decoder(decoder)
     , context(context)
+    , timeOffset(timeOffset)
 {
     QString objectName = QLatin1String("Demuxer");
     setObjectName(objectName);
 
     streamDecoders.resize(context->nb_streams);
+
+    for (unsigned int i = 0; i < context->nb_streams; ++i) {
+        const auto *stream = context->streams[i];
+        if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO
+            && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            seekIndexStream = i;
+            break;
+        }
+    }
+    if (seekIndexStream >= 0)
+        seekIndex.load(context);
 }
 
 Demuxer::~Demuxer()
 {
     if (context) {
+        // the thread never ran, and we might be on the GUI thread here
+        seekIndex.saveInBackground(context);
         if (context->pb) {
             av_free(context->pb);
             context->pb = nullptr;
@@ -159,12 +185,12 @@ Demuxer::~Demuxer()
     }
 }
 
-StreamDecoder *Demuxer::addStream(int streamIndex)
+StreamDecoder *Demuxer::addStream(int streamIndex, const HWAccel &hwAccel)
 {
     if (streamIndex < 0)
         return nullptr;
     QMutexLocker locker(&mutex);
-    Codec codec(context, streamIndex);
+    Codec codec(context, streamIndex, hwAccel);
     if (!codec.isValid()) {
         decoder->error(QMediaPlayer::FormatError, "Invalid media file");
         return nullptr;
@@ -173,7 +199,7 @@ StreamDecoder *Demuxer::addStream(int streamIndex)
     Q_ASSERT(codec.context()->codec_type == AVMEDIA_TYPE_AUDIO ||
              codec.context()->codec_type == AVMEDIA_TYPE_VIDEO ||
              codec.context()->codec_type == AVMEDIA_TYPE_SUBTITLE);
-    auto *stream = new StreamDecoder(this, codec);
+    auto *stream = new StreamDecoder(this, codec, timeOffset);
     Q_ASSERT(!streamDecoders.at(streamIndex));
     streamDecoders[streamIndex] = stream;
     stream->start();
@@ -198,27 +224,54 @@ void Demuxer::stopDecoding()
     QMutexLocker locker(&mutex);
     sendFinalPacketToStreams();
 }
-int Demuxer::seek(qint64 pos)
+qint64 Demuxer::seek(qint64 pos, SeekMode mode)
 {
     QMutexLocker locker(&mutex);
+
+    // With the GOP containing pos known, we can jump straight to its keyframe,
+    // instead of relying on the container index, which may point further back.
+    std::optional<SeekIndex::Entry> keyframe;
+    if (mode == SeekMode::NearestKeyframe)
+        keyframe = seekIndex.nearestKeyframe(pos);
+    else
+        keyframe = seekIndex.gopContaining(pos);
+    if (mode == SeekMode::NearestKeyframe && keyframe)
+        pos = keyframe->pts;
+
     for (StreamDecoder *d : qAsConst(streamDecoders)) {
         if (d)
             d->mutex.lock();
     }
     for (StreamDecoder *d : qAsConst(streamDecoders)) {
-        if (d)
+        if (d) {
             d->flush();
+            d->setSkipTarget(pos);
+        }
     }
     for (StreamDecoder *d : qAsConst(streamDecoders)) {
         if (d)
             d->mutex.unlock();
     }
-    qint64 seekPos = pos*AV_TIME_BASE/1000000; // usecs to AV_TIME_BASE
-    av_seek_frame(context, -1, seekPos, AVSEEK_FLAG_BACKWARD);
+
+    bool seeked = false;
+    if (keyframe) {
+        auto *stream = context->streams[seekIndexStream];
+        // round up, so that we don't end up in the GOP before
+        int64_t ts = av_rescale_q_rnd(keyframe->pts, AVRational{ 1, 1000000 }, stream->time_base,
+                                      AV_ROUND_UP);
+        seeked = av_seek_frame(context, seekIndexStream, ts, AVSEEK_FLAG_BACKWARD) >= 0;
+        if (!seeked && keyframe->pos >= 0 && !(context->iformat->flags & AVFMT_NO_BYTE_SEEK))
+            seeked = av_seek_frame(context, seekIndexStream, keyframe->pos, AVSEEK_FLAG_BYTE) >= 0;
+    }
+    if (!seeked) {
+        qint64 seekPos = pos*AV_TIME_BASE/1000000; // usecs to AV_TIME_BASE
+        av_seek_frame(context, -1, seekPos, AVSEEK_FLAG_BACKWARD);
+    }
+    seekIndex.setDiscontinuity();
     last_pts = -1;
     loop();
-    qCDebug(qLcDemuxer) << "Demuxer::seek" << pos << last_pts;
-    return last_pts;
+    qCDebug(qLcDemuxer) << "Demuxer::seek" << pos << last_pts << "using index:" << seeked;
+    return pos;
 }
 
 void Demuxer::updateEnabledStreams()
@@ -259,6 +312,7 @@ void Demuxer::cleanup()
         Q_ASSERT(!streamDecoder);
     }
 #endif
+    seekIndex.save(context);
     avformat_close_input(&context);
     Thread::cleanup();
 }
@@ -274,6 +328,8 @@ bool Demuxer::shouldWait() const
     for (auto *d : streamDecoders) {
         if (!d)
             continue;
+        if (d->isPacketQueueFull())
+            return true;
         if (d->queuedDuration() < 200)
             buffersFull = false;
         queueSize += d->queuedPacketSize();
@@ -300,6 +356,12 @@ void Demuxer::loop()
         last_pts = timeStamp(packet->pts, stream->time_base);
     }
 
+    if (packet->stream_index == seekIndexStream && (packet->flags & AV_PKT_FLAG_KEY)
+        && packet->pts != AV_NOPTS_VALUE) {
+        auto *stream = context->streams[packet->stream_index];
+        seekIndex.addKeyframe(timeStampUs(packet->pts, stream->time_base), packet->pos);
+    }
+
     auto *streamDecoder = streamDecoders.at(packet->stream_index);
     if (!streamDecoder) {
         av_packet_free(&packet);
@@ -309,9 +371,10 @@ void Demuxer::loop()
 }
 
 
-StreamDecoder::StreamDecoder(Demuxer *demuxer, const Codec &codec)
+StreamDecoder::StreamDecoder(Demuxer *demuxer, const Codec &codec, qint64 timeOffset)
     : Thread()
     , demuxer(demuxer)
+    , timeOffset(timeOffset)
     , codec(codec)
 {
     Q_ASSERT(codec.context()->codec_type == AVMEDIA_TYPE_AUDIO ||
@@ -339,19 +402,27 @@ StreamDecoder::StreamDecoder(Demuxer *demuxer, const Codec &codec)
 
 void StreamDecoder::addPacket(AVPacket *packet)
 {
-    {
-        QMutexLocker locker(&packetQueue.mutex);
-//        qCDebug(qLcDecoder) << "enqueuing packet of type" << type()
-//                            << "size" << packet->size
-//                            << "stream index" << packet->stream_index
-//                            << "pts" << codec.toMs(packet->pts)
-//                            << "duration" << codec.toMs(packet->duration);
-        packetQueue.queue.enqueue(Packet(packet));
-        if (packet) {
-            packetQueue.size += packet->size;
-            packetQueue.duration += codec.toMs(packet->duration);
-        }
-        eos.storeRelease(false);
+//    qCDebug(qLcDecoder) << "enqueuing packet of type" << type()
+//                        << "size" << packet->size
+//                        << "stream index" << packet->stream_index
+//                        << "pts" << codec.toMs(packet->pts)
+//                        << "duration" << codec.toMs(packet->duration);
+    // account for the packet before it becomes visible to the decoder thread,
+    // so the counters can never go negative
+    const qint64 size = packet ? packet->size : 0;
+    const qint64 duration = packet ? codec.toMs(packet->duration) : 0;
+    packetQueue.size.fetchAndAddRelaxed(size);
+    packetQueue.duration.fetchAndAddRelaxed(duration);
+    // clear eos before the packet becomes visible, so it can't overwrite the
+    // decoder reaching the end of this very packet
+    eos.storeRelease(false);
+    Packet p(packet);
+    if (!packetQueue.queue.push(std::move(p))) {
+        // can only happen if the demuxer ignored isPacketQueueFull(), p frees the packet
+        qCWarning(qLcDecoder) << "packet queue overflow, dropping packet";
+        packetQueue.size.fetchAndSubRelaxed(size);
+        packetQueue.duration.fetchAndSubRelaxed(duration);
+        return;
     }
     wake();
 }
@@ -359,20 +430,24 @@ void StreamDecoder::addPacket(AVPacket *packet)
 void StreamDecoder::flush()
 {
     qCDebug(qLcDecoder) << ">>>> flushing stream decoder" << type();
+    // Called with both the demuxer and this thread locked, so we can take over the
+    // consumer side of the packet queue here. The renderer might still be reading
+    // from the frame queue, it drops the discarded frames on its next access.
     avcodec_flush_buffers(codec.context());
-    {
-        QMutexLocker locker(&packetQueue.mutex);
-        packetQueue.queue.clear();
-        packetQueue.size = 0;
-        packetQueue.duration = 0;
-    }
-    {
-        QMutexLocker locker(&frameQueue.mutex);
-        frameQueue.queue.clear();
-    }
+    while (takePacket().isValid())
+        ;
+    frameQueue.queue.discardQueued();
     qCDebug(qLcDecoder) << ">>>> done flushing stream decoder" << type();
 }
 
+void StreamDecoder::setSkipTarget(qint64 time)
+{
+    // Audio frames are trimmed by the renderer, subtitles have to stay as they
+    // can be displayed for a long time.
+    if (codec.context()->codec_type == AVMEDIA_TYPE_VIDEO)
+        skipUntil = time;
+}
+
 void StreamDecoder::setRenderer(Renderer *r)
 {
     QMutexLocker locker(&mutex);
@@ -389,31 +464,23 @@ void StreamDecoder::killHelper()
 
 Packet StreamDecoder::peekPacket()
 {
-    QMutexLocker locker(&packetQueue.mutex);
-    if (packetQueue.queue.isEmpty()) {
-        if (demuxer)
-            demuxer->wake();
-        return {};
-    }
-    auto packet = packetQueue.queue.first();
-
+    const Packet *packet = packetQueue.queue.peek();
     if (demuxer)
         demuxer->wake();
-    return packet;
+    return packet ? *packet : Packet();
 }
 
 Packet StreamDecoder::takePacket()
 {
-    QMutexLocker locker(&packetQueue.mutex);
-    if (packetQueue.queue.isEmpty()) {
+    Packet packet;
+    if (!packetQueue.queue.pop(packet)) {
         if (demuxer)
             demuxer->wake();
         return {};
     }
-    auto packet = packetQueue.queue.dequeue();
     if (packet.avPacket()) {
-        packetQueue.size -= packet.avPacket()->size;
-        packetQueue.duration -= codec.toMs(packet.avPacket()->duration);
+        packetQueue.size.fetchAndSubRelaxed(packet.avPacket()->size);
+        packetQueue.duration.fetchAndSubRelaxed(codec.toMs(packet.avPacket()->duration));
     }
 //    qCDebug(qLcDecoder) << "<<<< dequeuing packet of type" << type()
 //                        << "size" << packet.avPacket()->size
@@ -429,21 +496,20 @@ Packet StreamDecoder::takePacket()
 void StreamDecoder::addFrame(const Frame &f)
 {
     Q_ASSERT(f.isValid());
-    QMutexLocker locker(&frameQueue.mutex);
-    frameQueue.queue.append(std::move(f));
+    // shouldWait() doesn't let us decode more than maxSize frames, which is
+    // always less than the capacity of the queue
+    const bool queued = frameQueue.queue.push(f);
+    Q_ASSERT(queued);
+    Q_UNUSED(queued);
     if (m_renderer)
         m_renderer->wake();
 }
 
 Frame StreamDecoder::takeFrame()
 {
-    QMutexLocker locker(&frameQueue.mutex);
+    Frame f;
+    frameQueue.queue.pop(f);
     // wake up the decoder so it delivers more frames
-    if (frameQueue.queue.isEmpty()) {
-        wake();
-        return {};
-    }
-    auto f = frameQueue.queue.dequeue();
     wake();
     return f;
 }
@@ -483,7 +549,13 @@ void StreamDecoder::decode()
             pts = codec.toUs(frame->pts);
         else
             pts = codec.toUs(frame->best_effort_timestamp);
-        addFrame(Frame{frame, codec, pts});
+        if (skipUntil >= 0 && pts < skipUntil) {
+            // decoded only as a reference for the frames we seeked to
+            av_frame_free(&frame);
+        } else {
+            skipUntil = -1;
+            addFrame(Frame{frame, codec, pts + timeOffset});
+        }
     } else if (res == AVERROR(EOF) || res == AVERROR_EOF) {
         eos.storeRelease(true);
         av_frame_free(&frame);
@@ -507,6 +579,15 @@ void StreamDecoder::decode()
         return;
     }
 
+    // Frames no other frame refers to don't need to be decoded on the way
+    // to the seek target
+    const AVPacket *avPacket = packet.avPacket();
+    if (skipUntil >= 0 && avPacket && (avPacket->flags & AV_PKT_FLAG_DISPOSABLE)
+        && avPacket->pts != AV_NOPTS_VALUE && codec.toUs(avPacket->pts) < skipUntil) {
+        takePacket();
+        return;
+    }
+
     res = avcodec_send_packet(codec.context(), packet.avPacket());
     if (res != AVERROR(EAGAIN)) {
         takePacket();
@@ -567,7 +648,7 @@ void StreamDecoder::decodeSubtitle()
             text.chop(1);
 
 //        qCDebug(qLcDecoder) << "    >>> subtitle adding" << text << start << end;
-        Frame sub{text, start, end - start};
+        Frame sub{text, start + timeOffset, end - start};
         addFrame(sub);
     }
 }
@@ -612,8 +693,67 @@ void Renderer::setStream(StreamDecoder *stream)
     wake();
 }
 
+void Renderer::setNextStream(StreamDecoder *stream, StreamDecoder *subtitleStream)
+{
+    QMutexLocker locker(&mutex);
+    Q_ASSERT(!nextStreamDecoder && !nextSubtitleStreamDecoder);
+    nextStreamDecoder = stream;
+    nextSubtitleStreamDecoder = subtitleStream;
+}
+
+bool Renderer::clearNextStreams(Renderer *audioRenderer, Renderer *videoRenderer)
+{
+    // Lock both renderers, so that none of them can switch while we check
+    // the other one. Always audio before video.
+    Renderer *renderers[] = { audioRenderer, videoRenderer };
+    for (auto *r : renderers)
+        if (r)
+            r->mutex.lock();
+    bool canClear = true;
+    for (auto *r : renderers)
+        if (r && !r->nextStreamDecoder)
+            canClear = false;
+    if (canClear) {
+        for (auto *r : renderers) {
+            if (!r)
+                continue;
+            r->nextStreamDecoder->kill();
+            r->nextStreamDecoder = nullptr;
+            if (r->nextSubtitleStreamDecoder)
+                r->nextSubtitleStreamDecoder->kill();
+            r->nextSubtitleStreamDecoder = nullptr;
+        }
+    }
+    for (auto *r : renderers)
+        if (r)
+            r->mutex.unlock();
+    return canClear;
+}
+
+bool Renderer::switchToNextStream()
+{
+    if (!nextStreamDecoder)
+        return false;
+    qCDebug(qLcDecoder) << "switching to the next stream" << type;
+    streamDecoder->kill();
+    streamDecoder = nextStreamDecoder;
+    nextStreamDecoder = nullptr;
+    streamDecoder->setRenderer(this);
+    nextStreamStarted();
+    mutex.unlock();
+    emit switchedToNextStream();
+    mutex.lock();
+    return true;
+}
+
 void Renderer::killHelper()
 {
+    if (nextSubtitleStreamDecoder)
+        nextSubtitleStreamDecoder->kill();
+    nextSubtitleStreamDecoder = nullptr;
+    if (nextStreamDecoder)
+        nextStreamDecoder->kill();
+    nextStreamDecoder = nullptr;
     if (streamDecoder)
         streamDecoder->kill();
     streamDecoder = nullptr;
@@ -644,6 +784,12 @@ VideoRenderer::VideoRenderer(Decoder *decoder, QVideoSink *sink)
 
 void VideoRenderer::killHelper()
 {
+    if (nextSubtitleStreamDecoder)
+        nextSubtitleStreamDecoder->kill();
+    nextSubtitleStreamDecoder = nullptr;
+    if (nextStreamDecoder)
+        nextStreamDecoder->kill();
+    nextStreamDecoder = nullptr;
     if (subtitleStreamDecoder)
         subtitleStreamDecoder->kill();
     subtitleStreamDecoder = nullptr;
@@ -667,6 +813,18 @@ void VideoRenderer::setSubtitleStream(StreamDecoder *stream)
     wake();
 }
 
+void VideoRenderer::nextStreamStarted()
+{
+    // mutex is already locked
+    if (subtitleStreamDecoder)
+        subtitleStreamDecoder->kill();
+    subtitleStreamDecoder = nextSubtitleStreamDecoder;
+    nextSubtitleStreamDecoder = nullptr;
+    if (subtitleStreamDecoder)
+        subtitleStreamDecoder->setRenderer(this);
+    sink->setSubtitleText({});
+}
+
 void VideoRenderer::init()
 {
     qCDebug(qLcVideoRenderer) << "starting video renderer";
@@ -683,6 +841,8 @@ void VideoRenderer::loop()
     Frame frame = streamDecoder->takeFrame();
     if (!frame.isValid()) {
         if (streamDecoder->isAtEnd()) {
+            if (switchToNextStream())
+                return;
             timeOut = -1;
             eos.storeRelease(true);
             mutex.unlock();
@@ -735,7 +895,7 @@ void VideoRenderer::loop()
         // add in subtitles
         const Frame *currentSubtitle = nullptr;
         if (subtitleStreamDecoder)
-            currentSubtitle = subtitleStreamDecoder->lockAndPeekFrame();
+            currentSubtitle = subtitleStreamDecoder->peekFrame();
 
         if (currentSubtitle && currentSubtitle->isValid()) {
 //            qCDebug(qLcVideoRenderer) << "frame: subtitle" << currentSubtitle->text() << currentSubtitle->pts() << currentSubtitle->duration();
@@ -752,20 +912,18 @@ void VideoRenderer::loop()
         } else {
             sink->setSubtitleText({});
         }
-        if (subtitleStreamDecoder)
-            subtitleStreamDecoder->unlockAndReleaseFrame();
 
 //        qCDebug(qLcVideoRenderer) << "    sending a video frame" << startTime << duration << decoder->baseTimer.elapsed();
         sink->setVideoFrame(videoFrame);
+        decoder->frameRendered();
         doneStep();
     }
-    const Frame *nextFrame = streamDecoder->lockAndPeekFrame();
+    const Frame *nextFrame = streamDecoder->peekFrame();
     qint64 nextFrameTime = 0;
     if (nextFrame)
         nextFrameTime = nextFrame->pts();
     else
         nextFrameTime = startTime + duration;
-    streamDecoder->unlockAndReleaseFrame();
     qint64 mtime = timeUpdated(startTime);
     timeOut = usecsTo(mtime, nextFrameTime)/1000;
 //    qCDebug(qLcVideoRenderer) << "    next video frame in" << startTime << nextFrameTime << currentTime() << timeOut;
@@ -875,6 +1033,8 @@ void AudioRenderer::loop()
         Frame frame = streamDecoder->takeFrame();
         if (!frame.isValid()) {
             if (streamDecoder->isAtEnd()) {
+                if (switchToNextStream())
+                    return;
                 if (audioSink)
                     processedUSecs = audioSink->processedUSecs();
                 timeOut = -1;
@@ -889,6 +1049,14 @@ void AudioRenderer::loop()
         }
         eos.storeRelease(false);
 
+        if (nextStreamPending) {
+            nextStreamPending = false;
+            // continue writing to the same sink to avoid a gap, the resampler
+            // converts the next stream to its format
+            if (audioSink)
+                resampler.reset(new Resampler(frame.codec(), format));
+        }
+
         if (!audioSink)
             updateOutput(frame.codec());
 
@@ -910,6 +1078,7 @@ void AudioRenderer::loop()
             }
 
             processedUSecs = audioSink->processedUSecs();
+            decoder->frameRendered();
         }
     }
 
@@ -935,6 +1104,12 @@ void AudioRenderer::streamChanged()
     deviceChanged = true;
 }
 
+void AudioRenderer::nextStreamStarted()
+{
+    // mutex is already locked
+    nextStreamPending = true;
+}
+
 void AudioRenderer::updateAudio()
 {
     QMutexLocker locker(&mutex);
@@ -954,6 +1129,8 @@ Decoder::~Decoder()
         audioRenderer->kill();
     if (demuxer)
         demuxer->kill();
+    if (nextDemuxer)
+        nextDemuxer->kill();
 }
 
 static int read(void *opaque, uint8_t *buf, int buf_size)
@@ -986,56 +1163,149 @@ static int64_t seek(void *opaque, int64_t offset, int whence)
     return offset;
 }
 
-void Decoder::setMedia(const QUrl &media, QIODevice *stream)
+MediaOpenOptions MediaOpenOptions::fromEnvironment()
+{
+    MediaOpenOptions options;
+    bool ok = false;
+    qint64 value = qgetenv("QT_FFMPEG_PROBE_SIZE").toLongLong(&ok);
+    if (ok && value > 0)
+        options.probeSize = value;
+    value = qgetenv("QT_FFMPEG_ANALYZE_DURATION").toLongLong(&ok);
+    if (ok && value >= 0)
+        options.analyzeDuration = value;
+    return options;
+}
+
+MediaOpener::MediaOpener(const QUrl &media, QIODevice *stream, const MediaOpenOptions &options)
+    : media(media)
+    , stream(stream)
+    , options(options)
+{
+    setObjectName(QLatin1String("MediaOpener"));
+}
+
+MediaOpener::~MediaOpener()
+{
+    if (context)
+        avformat_close_input(&context);
+}
+
+AVFormatContext *MediaOpener::takeContext()
+{
+    auto *c = context;
+    context = nullptr;
+    return c;
+}
+
+int MediaOpener::interruptCallback(void *opaque)
+{
+    return static_cast<MediaOpener *>(opaque)->isCancelled();
+}
+
+void MediaOpener::run()
+{
+    context = open();
+}
+
+// Returns true if the container header describes all streams well enough to
+// decode them without scanning the start of the media.
+static bool hasCompleteStreamInfo(AVFormatContext *context)
+{
+    if (!context->nb_streams)
+        return false;
+    for (unsigned int i = 0; i < context->nb_streams; ++i) {
+        auto *codecPar = context->streams[i]->codecpar;
+        if (codecPar->codec_id == AV_CODEC_ID_NONE)
+            return false;
+        if (codecPar->codec_type == AVMEDIA_TYPE_VIDEO && (!codecPar->width || !codecPar->height))
+            return false;
+        if (codecPar->codec_type == AVMEDIA_TYPE_AUDIO && !codecPar->sample_rate)
+            return false;
+    }
+    return true;
+}
+
+AVFormatContext *MediaOpener::open()
 {
     QByteArray url = media.toEncoded(QUrl::PreferLocalFile);
 
-    AVFormatContext *context = nullptr;
+    AVFormatContext *formatContext = avformat_alloc_context();
+    formatContext->interrupt_callback = { &MediaOpener::interruptCallback, this };
 
     if (stream) {
-        if (!stream->isOpen()) {
-            if (!stream->open(QIODevice::ReadOnly)) {
-                emitError(QMediaPlayer::ResourceError, QLatin1String("Could not open source device."));
-                return;
-            }
-        }
         if (!stream->isSequential())
             stream->seek(0);
-        context = avformat_alloc_context();
         constexpr int bufferSize = 32768;
         unsigned char *buffer = (unsigned char *)av_malloc(bufferSize);
-        context->pb = avio_alloc_context(buffer, bufferSize, false, stream, ::read, nullptr, ::seek);
+        formatContext->pb = avio_alloc_context(buffer, bufferSize, false, stream, ::read, nullptr, ::seek);
     }
 
-    int ret = avformat_open_input(&context, url.constData(), nullptr, nullptr);
+    AVDictionary *dict = nullptr;
+    if (options.probeSize > 0)
+        av_dict_set_int(&dict, "probesize", options.probeSize, 0);
+    if (options.analyzeDuration > 0)
+        av_dict_set_int(&dict, "analyzeduration", options.analyzeDuration, 0);
+
+    // on failure avformat_open_input() frees the formatContext
+    int ret = avformat_open_input(&formatContext, url.constData(), nullptr, &dict);
+    av_dict_free(&dict);
     if (ret < 0) {
-        auto code = QMediaPlayer::ResourceError;
+        m_errorCode = QMediaPlayer::ResourceError;
         if (ret == AVERROR(EACCES))
-            code = QMediaPlayer::AccessDeniedError;
+            m_errorCode = QMediaPlayer::AccessDeniedError;
         else if (ret == AVERROR(EINVAL))
-            code = QMediaPlayer::FormatError;
+            m_errorCode = QMediaPlayer::FormatError;
+        m_errorString = QMediaPlayer::tr("Could not open file");
+        return nullptr;
+    }
 
-        emitError(code, QMediaPlayer::tr("Could not open file"));
-        return;
+    if (options.analyzeDuration == 0 && hasCompleteStreamInfo(formatContext)) {
+        qCDebug(qLcDecoder) << "skipping the stream info scan";
+    } else {
+        ret = avformat_find_stream_info(formatContext, nullptr);
+        if (ret < 0) {
+            avformat_close_input(&formatContext);
+            m_errorCode = QMediaPlayer::FormatError;
+            m_errorString = QMediaPlayer::tr("Could not find stream information for media file");
+            return nullptr;
+        }
     }
 
-    ret = avformat_find_stream_info(context, nullptr);
-    if (ret < 0) {
-        emitError(QMediaPlayer::FormatError, QMediaPlayer::tr("Could not find stream information for media file"));
-        return;
+    if (isCancelled()) {
+        avformat_close_input(&formatContext);
+        return nullptr;
     }
 
 #ifndef QT_NO_DEBUG
-    av_dump_format(context, 0, url.constData(), 0);
+    av_dump_format(formatContext, 0, url.constData(), 0);
 #endif
 
-    m_metaData = QFFmpegMetaData::fromAVMetaData(context->metadata);
-    m_metaData.insert(QMediaMetaData::FileFormat,
-                      QVariant::fromValue(QFFmpegMediaFormatInfo::fileFormatForAVInputFormat(context->iformat)));
+    // the context outlives the opener
+    formatContext->interrupt_callback = { nullptr, nullptr };
+    return formatContext;
+}
 
-    checkStreams(context);
+void Decoder::setMedia(const QUrl &media, QIODevice *stream)
+{
+    if (stream && !stream->isOpen()) {
+        if (!stream->open(QIODevice::ReadOnly)) {
+            emitError(QMediaPlayer::ResourceError, QLatin1String("Could not open source device."));
+            return;
+        }
+    }
 
-    m_isSeekable = !(context->ctx_flags & AVFMTCTX_UNSEEKABLE);
+    MediaOpener opener(media, stream, MediaOpenOptions::fromEnvironment());
+    AVFormatContext *context = opener.open();
+    if (!context) {
+        emitError(opener.errorCode(), opener.errorString());
+        return;
+    }
+    setMediaContext(context);
+}
+
+void Decoder::setMediaContext(AVFormatContext *context)
+{
+    setMediaInfo(mediaInfo(context));
 
     demuxer = new Demuxer(this, context);
     demuxer->start();
@@ -1044,6 +1314,118 @@ void Decoder::setMedia(const QUrl &media, QIODevice *stream)
     clockController.setNotify(this, metaObject()->method(metaObject()->indexOfSlot("updateCurrentTime(qint64)")));
 }
 
+bool Decoder::prepareNext(AVFormatContext *context)
+{
+    if (!clearNext()) {
+        avformat_close_input(&context);
+        return false;
+    }
+
+    MediaInfo info = mediaInfo(context);
+
+    // The renderers continue with the streams of the next media, so it has to
+    // provide a stream for each of them.
+    bool canSwitch = audioRenderer || videoRenderer;
+    if (audioRenderer && (audioRenderer->isAtEnd()
+                          || info.currentAVStreamIndex[QPlatformMediaPlayer::AudioStream] < 0))
+        canSwitch = false;
+    if (videoRenderer && (videoRenderer->isAtEnd()
+                          || info.currentAVStreamIndex[QPlatformMediaPlayer::VideoStream] < 0))
+        canSwitch = false;
+    if (!canSwitch) {
+        qCDebug(qLcDecoder) << "can't continue with the next media without a gap";
+        avformat_close_input(&context);
+        return false;
+    }
+
+    auto *next = new Demuxer(this, context, m_timeOffset + m_duration);
+    next->start();
+
+    StreamDecoder *audioStream = nullptr;
+    StreamDecoder *videoStream = nullptr;
+    StreamDecoder *subtitleStream = nullptr;
+    if (audioRenderer)
+        audioStream = next->addStream(info.currentAVStreamIndex[QPlatformMediaPlayer::AudioStream]);
+    if (videoRenderer) {
+        videoStream = next->addStream(info.currentAVStreamIndex[QPlatformMediaPlayer::VideoStream],
+                                      m_videoHWAccel);
+        subtitleStream = next->addStream(info.currentAVStreamIndex[QPlatformMediaPlayer::SubtitleStream]);
+    }
+    if ((audioRenderer && !audioStream) || (videoRenderer && !videoStream)) {
+        for (auto *stream : { audioStream, videoStream, subtitleStream })
+            if (stream)
+                stream->kill();
+        next->kill();
+        return false;
+    }
+
+    // The stream decoders pre-roll while the current media is still playing
+    nextDemuxer = next;
+    nextInfo = info;
+    nextDemuxer->startDecoding();
+    if (audioRenderer) {
+        audioRenderer->setNextStream(audioStream);
+        ++pendingSwitches;
+    }
+    if (videoRenderer) {
+        videoRenderer->setNextStream(videoStream, subtitleStream);
+        ++pendingSwitches;
+    }
+    return true;
+}
+
+bool Decoder::clearNext()
+{
+    if (!nextDemuxer)
+        return true;
+
+    // once a renderer started playing the next media, it can't be undone
+    if (!Renderer::clearNextStreams(audioRenderer, videoRenderer))
+        return false;
+
+    nextDemuxer->kill();
+    nextDemuxer = nullptr;
+    nextInfo = {};
+    pendingSwitches = 0;
+    return true;
+}
+
+void Decoder::finishSwitch()
+{
+    Renderer *renderers[] = { audioRenderer, videoRenderer };
+    for (auto *r : renderers)
+        if (r)
+            r->switchToNextStreamNow();
+    rendererSwitched();
+}
+
+void Decoder::rendererSwitched()
+{
+    if (!nextDemuxer)
+        return;
+    // Count the renderers that didn't switch yet instead of the notifications,
+    // finishSwitch() makes the ones still queued stale.
+    pendingSwitches = 0;
+    Renderer *renderers[] = { audioRenderer, videoRenderer };
+    for (auto *r : renderers)
+        if (r && r->hasNextStream())
+            ++pendingSwitches;
+    if (pendingSwitches > 0)
+        return;
+
+    qCDebug(qLcDecoder) << "switched to the next media";
+    // all streams of the previous media are gone with the renderers' switch
+    demuxer->kill();
+    demuxer = nextDemuxer;
+    nextDemuxer = nullptr;
+    m_timeOffset += m_duration;
+    setMediaInfo(nextInfo);
+    nextInfo = {};
+
+    if (player)
+        player->nextMediaSwitched();
+}
+
 static void insertVideoData(QMediaMetaData &metaData, AVStream *stream)
 {
     Q_ASSERT(stream);
@@ -1064,8 +1446,14 @@ static void insertAudioData(QMediaMetaData &metaData, AVStream *stream)
                     QVariant::fromValue(QFFmpegMediaFormatInfo::audioCodecForAVCodecId(codecPar->codec_id)));
 };
 
-void Decoder::checkStreams(AVFormatContext *context)
+Decoder::MediaInfo Decoder::mediaInfo(AVFormatContext *context)
 {
+    MediaInfo info;
+    info.metaData = QFFmpegMetaData::fromAVMetaData(context->metadata);
+    info.metaData.insert(QMediaMetaData::FileFormat,
+                         QVariant::fromValue(QFFmpegMediaFormatInfo::fileFormatForAVInputFormat(context->iformat)));
+    info.isSeekable = !(context->ctx_flags & AVFMTCTX_UNSEEKABLE);
+
     qint64 duration = 0;
     AVStream *firstAudioStream = nullptr;
     AVStream *defaultAudioStream = nullptr;
@@ -1106,41 +1494,54 @@ void Decoder::checkStreams(AVFormatContext *context)
             type = QPlatformMediaPlayer::SubtitleStream;
             break;
         }
-        if (isDefault && m_requestedStreams[type] < 0)
-            m_requestedStreams[type] = m_streamMap[type].size();
+        if (isDefault && info.requestedStreams[type] < 0)
+            info.requestedStreams[type] = info.streamMap[type].size();
 
-        m_streamMap[type].append({ (int)i, isDefault, metaData });
+        info.streamMap[type].append({ (int)i, isDefault, metaData });
         duration = qMax(duration, 1000000*stream->duration*stream->time_base.num/stream->time_base.den);
     }
 
-    if (m_requestedStreams[QPlatformMediaPlayer::VideoStream] < 0 && m_streamMap[QPlatformMediaPlayer::VideoStream].size()) {
-        m_requestedStreams[QPlatformMediaPlayer::VideoStream] = 0;
+    if (info.requestedStreams[QPlatformMediaPlayer::VideoStream] < 0 && info.streamMap[QPlatformMediaPlayer::VideoStream].size()) {
+        info.requestedStreams[QPlatformMediaPlayer::VideoStream] = 0;
         defaultVideoStream = firstVideoStream;
     }
-    if (m_requestedStreams[QPlatformMediaPlayer::AudioStream] < 0 && m_streamMap[QPlatformMediaPlayer::AudioStream].size()) {
-        m_requestedStreams[QPlatformMediaPlayer::AudioStream] = 0;
+    if (info.requestedStreams[QPlatformMediaPlayer::AudioStream] < 0 && info.streamMap[QPlatformMediaPlayer::AudioStream].size()) {
+        info.requestedStreams[QPlatformMediaPlayer::AudioStream] = 0;
         defaultAudioStream = firstAudioStream;
     }
     if (defaultVideoStream) {
-        insertVideoData(m_metaData, defaultVideoStream);
-        m_currentAVStreamIndex[QPlatformMediaPlayer::VideoStream] = defaultVideoStream->index;
+        insertVideoData(info.metaData, defaultVideoStream);
+        info.currentAVStreamIndex[QPlatformMediaPlayer::VideoStream] = defaultVideoStream->index;
     }
     if (defaultAudioStream) {
-        insertAudioData(m_metaData, defaultAudioStream);
-        m_currentAVStreamIndex[QPlatformMediaPlayer::AudioStream] = defaultAudioStream->index;
+        insertAudioData(info.metaData, defaultAudioStream);
+        info.currentAVStreamIndex[QPlatformMediaPlayer::AudioStream] = defaultAudioStream->index;
+    }
+    info.requestedStreams[QPlatformMediaPlayer::SubtitleStream] = -1;
+    info.currentAVStreamIndex[QPlatformMediaPlayer::SubtitleStream] = -1;
+    info.duration = duration;
+    return info;
+}
+
+void Decoder::setMediaInfo(const MediaInfo &info)
+{
+    m_metaData = info.metaData;
+    m_isSeekable = info.isSeekable;
+    for (int i = 0; i < QPlatformMediaPlayer::NTrackTypes; ++i) {
+        m_streamMap[i] = info.streamMap[i];
+        m_requestedStreams[i] = info.requestedStreams[i];
+        m_currentAVStreamIndex[i] = info.currentAVStreamIndex[i];
     }
-    m_requestedStreams[QPlatformMediaPlayer::SubtitleStream] = -1;
-    m_currentAVStreamIndex[QPlatformMediaPlayer::SubtitleStream] = -1;
 
     if (player)
         player->tracksChanged();
 
-    if (m_duration != duration) {
-        m_duration = duration;
+    if (m_duration != info.duration) {
+        m_duration = info.duration;
         if (player)
-            player->durationChanged(duration/1000);
+            player->durationChanged(m_duration/1000);
         else if (audioDecoder)
-            audioDecoder->durationChanged(duration/1000);
+            audioDecoder->durationChanged(m_duration/1000);
     }
 }
 
@@ -1249,6 +1650,8 @@ void Decoder::setVideoSink(QVideoSink *sink)
     if (sink == videoSink)
         return;
     videoSink = sink;
+    // the next media would otherwise keep streams for renderers that are gone
+    clearNext();
     if (!videoSink || m_currentAVStreamIndex[QPlatformMediaPlayer::VideoStream] < 0) {
         if (videoRenderer) {
             videoRenderer->kill();
@@ -1256,9 +1659,12 @@ void Decoder::setVideoSink(QVideoSink *sink)
         }
     } else if (!videoRenderer) {
         videoRenderer = new VideoRenderer(this, sink);
-        connect(audioRenderer, &Renderer::atEnd, this, &Decoder::streamAtEnd);
+        connect(videoRenderer, &Renderer::atEnd, this, &Decoder::streamAtEnd);
+        connect(videoRenderer, &Renderer::switchedToNextStream, this, &Decoder::rendererSwitched);
         videoRenderer->start();
         StreamDecoder *stream = demuxer->addStream(m_currentAVStreamIndex[QPlatformMediaPlayer::VideoStream]);
+        if (stream)
+            m_videoHWAccel = stream->codec.hwAccel();
         videoRenderer->setStream(stream);
         stream = demuxer->addStream(m_currentAVStreamIndex[QPlatformMediaPlayer::SubtitleStream]);
         videoRenderer->setSubtitleStream(stream);
@@ -1272,6 +1678,7 @@ void Decoder::setAudioSink(QPlatformAudioOutput *output)
 
     qCDebug(qLcDecoder) << "setAudioSink" << audioOutput;
     audioOutput = output;
+    clearNext();
     if (!output || m_currentAVStreamIndex[QPlatformMediaPlayer::AudioStream] < 0) {
         if (audioRenderer) {
             audioRenderer->kill();
@@ -1280,6 +1687,7 @@ void Decoder::setAudioSink(QPlatformAudioOutput *output)
     } else if (!audioRenderer) {
         audioRenderer = new AudioRenderer(this, output->q);
         connect(audioRenderer, &Renderer::atEnd, this, &Decoder::streamAtEnd);
+        connect(audioRenderer, &Renderer::switchedToNextStream, this, &Decoder::rendererSwitched);
         audioRenderer->start();
         auto *stream = demuxer->addStream(m_currentAVStreamIndex[QPlatformMediaPlayer::AudioStream]);
         audioRenderer->setStream(stream);
@@ -1310,7 +1718,7 @@ void Decoder::changeAVTrack(QPlatformMediaPlayer::TrackType type, int streamInde
     default:
         Q_UNREACHABLE();
     }
-    demuxer->seek(clockController.currentTime());
+    demuxer->seek(clockController.currentTime() - m_timeOffset);
     if (m_state == QMediaPlayer::PlayingState)
         setPaused(false);
     else
@@ -1336,9 +1744,16 @@ void Decoder::seek(qint64 pos)
 {
     if (!demuxer)
         return;
+    // The seek only applies to the current demuxer, so the next media is
+    // prepared again afterwards. If a renderer already plays the next media,
+    // the current one can't be restored, so the others follow it and the seek
+    // applies to the next media.
+    if (!clearNext())
+        finishSwitch();
     pos = qBound(0, pos, m_duration);
-    demuxer->seek(pos);
-    clockController.syncTo(pos);
+    m_seekStart.storeRelaxed(seekTimestamp());
+    pos = demuxer->seek(pos, m_seekMode);
+    clockController.syncTo(pos + m_timeOffset);
     if (player)
         player->positionChanged(pos/1000);
     demuxer->wake();
@@ -1346,6 +1761,26 @@ void Decoder::seek(qint64 pos)
         triggerStep();
 }
 
+SeekMode Decoder::defaultSeekMode()
+{
+    static const SeekMode mode = qEnvironmentVariable("QT_FFMPEG_SEEK_MODE") == QLatin1String("keyframe")
+            ? SeekMode::NearestKeyframe : SeekMode::Exact;
+    return mode;
+}
+
+void Decoder::seekFinished()
+{
+    // the audio and video renderers race for the first frame
+    qint64 start = m_seekStart.loadRelaxed();
+    if (start < 0 || !m_seekStart.testAndSetRelaxed(start, -1))
+        return;
+    const qint64 latency = seekTimestamp() - start;
+    m_seekLatency.storeRelaxed(latency);
+    if (latency > m_maxSeekLatency.loadRelaxed())
+        m_maxSeekLatency.storeRelaxed(latency);
+    qCDebug(qLcDecoder) << "seek took" << latency << "us";
+}
+
 void Decoder::setPlaybackRate(float rate)
 {
     if (m_state == QMediaPlayer::PlayingState)
@@ -1358,11 +1793,14 @@ void Decoder::setPlaybackRate(float rate)
 void Decoder::updateCurrentTime(qint64 time)
 {
     if (player)
-        player->positionChanged(time/1000);
+        player->positionChanged(qMax(0, time - m_timeOffset)/1000);
 }
 
 void Decoder::streamAtEnd()
 {
+    // a renderer that reached the end of its stream will continue with the next media
+    if (pendingSwitches > 0)
+        return;
     if (audioRenderer && !audioRenderer->isAtEnd())
         return;
     if (videoRenderer && !videoRenderer->isAtEnd())
@@ -57,10 +57,11 @@
 #include "qffmpegclock_p.h"
 #include "qaudiobuffer.h"
 #include "qffmpegresampler_p.h"
+#include "qffmpegspscqueue_p.h"
+#include "qffmpegseekindex_p.h"
 
 #include <qshareddata.h>
 #include <qtimer.h>
-#include <qqueue.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -76,6 +77,8 @@ class Resampler;
 // queue up max 16M of encoded data, that should always be enough
 // (it's around 2 secs of 4K HDR video, longer for almost all other formats)
 enum { MaxQueueSize = 16*1024*1024 };
+// upper limit for the number of packets queued per stream
+enum { MaxPacketQueueLength = 4096 };
 
 struct Packet
 {
@@ -114,7 +117,8 @@ struct Codec
     };
 
     Codec() = default;
-    Codec(AVFormatContext *format, int streamIndex);
+    // A valid hwAccel is shared if the decoder supports its device type.
+    Codec(AVFormatContext *format, int streamIndex, const HWAccel &hwAccel = {});
     bool isValid() const { return !!d; }
 
     AVCodecContext *context() const { return d->context; }
@@ -181,6 +185,54 @@ class Renderer;
 class AudioRenderer;
 class VideoRenderer;
 
+struct MediaOpenOptions
+{
+    // Limits for probing the streams of the media, in bytes and microseconds.
+    // -1 uses the FFmpeg defaults. An analyze duration of 0 skips the stream info
+    // scan if the container header already describes all streams.
+    qint64 probeSize = -1;
+    qint64 analyzeDuration = -1;
+
+    static MediaOpenOptions fromEnvironment();
+};
+
+// Opens a media source and probes its streams on a worker thread, so slow
+// storage doesn't block the thread setting the source.
+class MediaOpener : public QThread
+{
+public:
+    MediaOpener(const QUrl &media, QIODevice *stream, const MediaOpenOptions &options);
+    ~MediaOpener();
+
+    // threadsafe, aborts the I/O of a pending open as soon as possible
+    void cancel() { cancelled.storeRelaxed(true); }
+    bool isCancelled() const { return cancelled.loadRelaxed(); }
+
+    bool usesStream() const { return stream; }
+
+    // valid once the thread finished
+    AVFormatContext *takeContext();
+    int errorCode() const { return m_errorCode; }
+    QString errorString() const { return m_errorString; }
+
+    // opens the media on the calling thread, returns nullptr on failure
+    AVFormatContext *open();
+
+protected:
+    void run() override;
+
+private:
+    static int interruptCallback(void *opaque);
+
+    QUrl media;
+    QIODevice *stream = nullptr;
+    MediaOpenOptions options;
+    QAtomicInteger<bool> cancelled = false;
+    AVFormatContext *context = nullptr;
+    int m_errorCode = 0;
+    QString m_errorString;
+};
+
 class Decoder : public QObject
 {
     Q_OBJECT
@@ -197,6 +249,19 @@ public:
     ~Decoder();
 
     void setMedia(const QUrl &media, QIODevice *stream);
+    // takes ownership of a context opened by MediaOpener
+    void setMediaContext(AVFormatContext *context);
+
+    // Gapless playback: starts demuxing and decoding the next media, so the
+    // renderers can continue with it once the current media ends. Takes ownership
+    // of the context. Returns false if the renderers can't switch to it without
+    // being recreated, e.g. because it lacks a video stream the current media has.
+    bool prepareNext(AVFormatContext *context);
+    // Returns false if the renderers already started switching to the next media.
+    bool clearNext();
+    bool hasNext() const { return nextDemuxer; }
+    // Lets the renderers that still play the current media switch right away
+    void finishSwitch();
 
     void init();
     void setState(QMediaPlayer::PlaybackState state);
@@ -220,7 +285,19 @@ public:
     void seek(qint64 pos);
     void setPlaybackRate(float rate);
 
-    void checkStreams(AVFormatContext *context);
+    // QT_FFMPEG_SEEK_MODE=keyframe selects NearestKeyframe
+    static SeekMode defaultSeekMode();
+    QPlatformMediaPlayer::SeekStatistics seekStatistics() const
+    {
+        return { m_seekLatency.loadRelaxed(), m_maxSeekLatency.loadRelaxed() };
+    }
+
+    // threadsafe, called by the renderers for each rendered frame
+    void frameRendered()
+    {
+        if (m_seekStart.loadRelaxed() >= 0)
+            seekFinished();
+    }
 
     int activeTrack(QPlatformMediaPlayer::TrackType type);
     void setActiveTrack(QPlatformMediaPlayer::TrackType type, int streamNumber);
@@ -237,6 +314,7 @@ public Q_SLOTS:
     void emitError(int error, const QString &errorString);
     void updateCurrentTime(qint64 time);
     void streamAtEnd();
+    void rendererSwitched();
 
 public:
 
@@ -276,16 +354,42 @@ protected:
     int m_requestedStreams[3] = { -1, -1, -1 };
     qint64 m_duration = 0;
     QMediaMetaData m_metaData;
+
+    struct MediaInfo {
+        QList<StreamInfo> streamMap[QPlatformMediaPlayer::NTrackTypes];
+        int requestedStreams[3] = { -1, -1, -1 };
+        int currentAVStreamIndex[QPlatformMediaPlayer::NTrackTypes] = { -1, -1, -1 };
+        qint64 duration = 0;
+        QMediaMetaData metaData;
+        bool isSeekable = false;
+    };
+    static MediaInfo mediaInfo(AVFormatContext *context);
+    void setMediaInfo(const MediaInfo &info);
+
+    // The clock keeps running across media played back to back, the timestamps
+    // of the current media are shifted by this offset.
+    qint64 m_timeOffset = 0;
+    HWAccel m_videoHWAccel;
+
+    Demuxer *nextDemuxer = nullptr;
+    MediaInfo nextInfo;
+    int pendingSwitches = 0;
+
+    const SeekMode m_seekMode = defaultSeekMode();
+    void seekFinished();
+    QAtomicInteger<qint64> m_seekStart = -1;
+    QAtomicInteger<qint64> m_seekLatency = 0;
+    QAtomicInteger<qint64> m_maxSeekLatency = 0;
 };
 
 class Demuxer : public Thread
 {
     Q_OBJECT
 public:
-    Demuxer(Decoder *decoder, AVFormatContext *context);
+    Demuxer(Decoder *decoder, AVFormatContext *context, qint64 timeOffset = 0);
     ~Demuxer();
 
-    StreamDecoder *addStream(int streamIndex);
+    StreamDecoder *addStream(int streamIndex, const HWAccel &hwAccel = {});
     void removeStream(int streamIndex);
 
     bool isStopped() const
@@ -300,7 +404,9 @@ public:
     }
     void stopDecoding();
 
-    int seek(qint64 pos);
+    // Returns the position playback continues at, which differs from pos
+    // when seeking to a keyframe.
+    qint64 seek(qint64 pos, SeekMode mode = SeekMode::Exact);
 
 private:
     void updateEnabledStreams();
@@ -317,6 +423,11 @@ private:
 
     QAtomicInteger<bool> m_isStopped = true;
     qint64 last_pts = -1;
+    qint64 timeOffset = 0;
+
+    // built from the packets of the first video stream
+    SeekIndex seekIndex;
+    int seekIndexStream = -1;
 };
 
 
@@ -327,54 +438,57 @@ protected:
     Demuxer *demuxer = nullptr;
     Renderer *m_renderer = nullptr;
 
+    // Demuxer -> StreamDecoder. The demuxer stops reading before the queue is full,
+    // keeping one slot free for the final (null) packet.
     struct PacketQueue {
-        mutable QMutex mutex;
-        QQueue<Packet> queue;
-        qint64 size = 0;
-        qint64 duration = 0;
+        SpscQueue<Packet> queue{ MaxPacketQueueLength };
+        QAtomicInteger<qint64> size = 0;
+        QAtomicInteger<qint64> duration = 0;
     };
     PacketQueue packetQueue;
 
+    // StreamDecoder -> Renderer
     struct FrameQueue {
-        mutable QMutex mutex;
-        QQueue<Frame> queue;
+        SpscQueue<Frame> queue{ 16 };
         int maxSize = 3;
     };
     FrameQueue frameQueue;
     QAtomicInteger<bool> eos = false;
     bool decoderHasNoFrames = false;
+    // added to the timestamps of all frames
+    qint64 timeOffset = 0;
+    // after a seek, video frames before this time are dropped without being
+    // handed to the renderer
+    qint64 skipUntil = -1;
 
 public:
-    StreamDecoder(Demuxer *demuxer, const Codec &codec);
+    StreamDecoder(Demuxer *demuxer, const Codec &codec, qint64 timeOffset = 0);
 
+    // called from the demuxer
     void addPacket(AVPacket *packet);
 
-    qint64 queuedPacketSize() const {
-        QMutexLocker locker(&packetQueue.mutex);
-        return packetQueue.size;
-    }
-    qint64 queuedDuration() const {
-        QMutexLocker locker(&packetQueue.mutex);
-        return packetQueue.duration;
-    }
-
-    const Frame *lockAndPeekFrame()
+    qint64 queuedPacketSize() const { return packetQueue.size.loadAcquire(); }
+    qint64 queuedDuration() const { return packetQueue.duration.loadAcquire(); }
+    bool isPacketQueueFull() const
     {
-        frameQueue.mutex.lock();
-        return frameQueue.queue.isEmpty() ? nullptr : &frameQueue.queue.first();
+        return packetQueue.queue.size() >= packetQueue.queue.capacity() - 1;
     }
+
+    // called from the renderer. The pointer returned by peekFrame() stays valid
+    // until removePeekedFrame() or takeFrame() is called.
+    const Frame *peekFrame() { return frameQueue.queue.peek(); }
     void removePeekedFrame()
     {
-        frameQueue.queue.takeFirst();
-        wake();
-    }
-    void unlockAndReleaseFrame()
-    {
-        frameQueue.mutex.unlock();
+        // the peeked frame might have been discarded by a flush in between,
+        // don't drop a newer one in its place
+        if (frameQueue.queue.popPeeked())
+            wake();
     }
     Frame takeFrame();
 
     void flush();
+    // called with the mutex locked, like flush()
+    void setSkipTarget(qint64 time);
 
     Codec codec;
 
@@ -393,12 +507,10 @@ private:
 
     bool hasEnoughFrames() const
     {
-        QMutexLocker locker(&frameQueue.mutex);
-        return frameQueue.queue.size() >= frameQueue.maxSize;
+        return frameQueue.queue.size() >= quintptr(frameQueue.maxSize);
     }
     bool hasNoPackets() const
     {
-        QMutexLocker locker(&packetQueue.mutex);
         return packetQueue.queue.isEmpty();
     }
 
@@ -421,8 +533,15 @@ protected:
     bool step = false;
     bool paused = true;
     StreamDecoder *streamDecoder = nullptr;
+    // continue where the current streams end, for gapless playback
+    StreamDecoder *nextStreamDecoder = nullptr;
+    StreamDecoder *nextSubtitleStreamDecoder = nullptr;
     QAtomicInteger<bool> eos = false;
 
+    // called with the mutex locked when streamDecoder is at its end
+    bool switchToNextStream();
+    virtual void nextStreamStarted() {}
+
 public:
     Renderer(QPlatformMediaPlayer::TrackType type);
 
@@ -447,12 +566,29 @@ public:
     void setStream(StreamDecoder *stream);
     virtual void setSubtitleStream(StreamDecoder *) {}
 
+    void setNextStream(StreamDecoder *stream, StreamDecoder *subtitleStream = nullptr);
+    // Returns false, and leaves the streams untouched, if one of the renderers
+    // already switched to its next stream.
+    static bool clearNextStreams(Renderer *audioRenderer, Renderer *videoRenderer);
+    bool hasNextStream() const
+    {
+        QMutexLocker locker(&mutex);
+        return nextStreamDecoder;
+    }
+    // Continues with the next stream without waiting for the end of the current one
+    void switchToNextStreamNow()
+    {
+        QMutexLocker locker(&mutex);
+        switchToNextStream();
+    }
+
     void killHelper() override;
 
     virtual void streamChanged() {}
 
 Q_SIGNALS:
     void atEnd();
+    void switchedToNextStream();
 
 protected:
     bool shouldWait() const override;
@@ -466,12 +602,16 @@ public:
     ClockedRenderer(Decoder *decoder, QPlatformMediaPlayer::TrackType type)
         : Renderer(type)
         , Clock(&decoder->clockController)
+        , decoder(decoder)
     {
     }
     ~ClockedRenderer()
     {
     }
     void setPaused(bool paused) override;
+
+protected:
+    Decoder *decoder;
 };
 
 class VideoRenderer : public ClockedRenderer
@@ -486,6 +626,7 @@ public:
 
     void setSubtitleStream(StreamDecoder *stream) override;
 private:
+    void nextStreamStarted() override;
 
     void init() override;
     void loop() override;
@@ -515,6 +656,7 @@ private:
     void cleanup() override;
     void loop() override;
     void streamChanged() override;
+    void nextStreamStarted() override;
     Type type() const override { return AudioClock; }
 
     int outputSamples(int inputSamples) {
@@ -527,6 +669,8 @@ private:
     qint64 processedUSecs = 0;
 
     bool deviceChanged = false;
+    // set when switching to the next stream, which keeps the audio sink
+    bool nextStreamPending = false;
     QAudioOutput *output = nullptr;
     bool audioMuted = false;
     qint64 writtenUSecs = 0;
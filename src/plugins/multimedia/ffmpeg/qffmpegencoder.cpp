@@ -42,6 +42,8 @@
 #include "private/qmultimediautils_p.h"
 
 #include <qdebug.h>
+#include <qdir.h>
+#include <qfileinfo.h>
 #include <qiodevice.h>
 #include <qaudiosource.h>
 #include <qaudiobuffer.h>
@@ -50,12 +52,16 @@
 #include "qffmpegvideobuffer_p.h"
 #include "qffmpegmediametadata_p.h"
 #include "qffmpegencoderoptions_p.h"
+#if QT_CONFIG(linux_v4l)
+#include "qv4l2camera_p.h"
+#endif
 
 #include <qloggingcategory.h>
 
 extern "C" {
 #include <libavutil/pixdesc.h>
 #include <libavutil/common.h>
+#include <libavutil/opt.h>
 }
 
 QT_BEGIN_NAMESPACE
@@ -65,8 +71,61 @@ Q_LOGGING_CATEGORY(qLcFFmpegEncoder, "qt.multimedia.ffmpeg.encoder")
 namespace QFFmpeg
 {
 
+static bool hasMuxerOption(const AVFormatContext *context, const char *name)
+{
+    const AVClass *priv = context->oformat->priv_class;
+    return priv && av_opt_find(&priv, name, nullptr, 0, AV_OPT_SEARCH_FAKE_OBJ);
+}
+
+static AVDictionary *containerOptions(AVFormatContext *context, bool fragmented)
+{
+    AVDictionary *opts = nullptr;
+    if (!fragmented)
+        return opts;
+
+    // Write self-contained fragments for MP4/QuickTime and short clusters for Matroska/WebM,
+    // and push them to disk right away, so that everything written so far stays playable
+    // even if the process dies before writing the trailer
+    if (hasMuxerOption(context, "movflags"))
+        av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    else if (hasMuxerOption(context, "cluster_time_limit"))
+        av_dict_set(&opts, "cluster_time_limit", "1000", 0);
+    else
+        qCWarning(qLcFFmpegEncoder) << "fragmented recording not supported by" << context->oformat->name;
+    context->flush_packets = 1;
+    return opts;
+}
+
+static qint64 packetTime(const AVPacket *packet, const AVStream *stream)
+{
+    qint64 ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    if (ts == AV_NOPTS_VALUE)
+        return AV_NOPTS_VALUE;
+    return av_rescale_q(ts, stream->time_base, AV_TIME_BASE_Q);
+}
+
+static QUrl segmentLocation(const QUrl &url, int index)
+{
+    if (!index)
+        return url;
+    QFileInfo info(url.toLocalFile());
+    QString name = QStringLiteral("%1_%2").arg(info.completeBaseName()).arg(index, 4, 10, QLatin1Char('0'));
+    if (!info.suffix().isEmpty())
+        name += QLatin1Char('.') + info.suffix();
+    return QUrl::fromLocalFile(info.dir().filePath(name));
+}
+
+static void closeOutput(AVFormatContext *context)
+{
+    int res = av_write_trailer(context);
+    if (res < 0)
+        qWarning() << "could not write trailer" << res;
+    avio_closep(&context->pb);
+}
+
 Encoder::Encoder(const QMediaEncoderSettings &settings, const QUrl &url)
     : settings(settings)
+    , segmentUrl(url)
 {
     const AVOutputFormat *avFormat = QFFmpegMediaFormatInfo::outputFormatForFileFormat(settings.fileFormat());
 
@@ -77,8 +136,23 @@ Encoder::Encoder(const QMediaEncoderSettings &settings, const QUrl &url)
     formatContext->url = (char *)av_malloc(encoded.size() + 1);
     memcpy(formatContext->url, encoded.constData(), encoded.size() + 1);
     formatContext->pb = nullptr;
-    avio_open2(&formatContext->pb, formatContext->url, AVIO_FLAG_WRITE, nullptr, nullptr);
-    qCDebug(qLcFFmpegEncoder) << "opened" << formatContext->url;
+
+    // The environment variables only apply where the recorder doesn't set anything
+    fragmented = settings.isFragmented() || qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_FRAGMENTED");
+    segmentDuration = settings.segmentDuration() > 0
+            ? settings.segmentDuration()*AV_TIME_BASE/1000
+            : qint64(qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_SEGMENT_SECONDS"))*AV_TIME_BASE;
+    segmentSize = settings.segmentSize() > 0
+            ? settings.segmentSize()
+            : qint64(qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_SEGMENT_MB"))*1024*1024;
+    preEventBuffer.setDuration(settings.preEventDuration() > 0
+            ? settings.preEventDuration()*AV_TIME_BASE/1000
+            : qint64(qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_PRE_EVENT_SECONDS"))*AV_TIME_BASE);
+
+    if (!preEventBuffer.isEnabled()) {
+        avio_open2(&formatContext->pb, formatContext->url, AVIO_FLAG_WRITE, nullptr, nullptr);
+        qCDebug(qLcFFmpegEncoder) << "opened" << formatContext->url;
+    }
 
     muxer = new Muxer(this);
 }
@@ -97,7 +171,13 @@ void Encoder::addAudioInput(QFFmpegAudioInput *input)
 void Encoder::addVideoSource(QPlatformCamera *source)
 {
     videoEncode = new VideoEncoder(this, source, settings);
-    connect(source, &QPlatformCamera::newVideoFrame, this, &Encoder::newVideoFrame);
+    videoFrameConnection = connect(source, &QPlatformCamera::newVideoFrame, this,
+                                   &Encoder::newVideoFrame, Qt::DirectConnection);
+}
+
+void Encoder::addOutput(const QPlatformMediaRecorder::AdditionalOutput &output)
+{
+    additionalOutputs.append(output);
 }
 
 void Encoder::start()
@@ -106,30 +186,64 @@ void Encoder::start()
 
     formatContext->metadata = QFFmpegMetaData::toAVMetaData(metaData);
 
-    int res = avformat_write_header(formatContext, nullptr);
-    if (res < 0)
-        qWarning() << "could not write header" << res;
+    // with pre-event recording the output gets opened by the muxer once triggered
+    if (!preEventBuffer.isEnabled()) {
+        AVDictionary *opts = containerOptions(formatContext, fragmented);
+        int res = avformat_write_header(formatContext, &opts);
+        av_dict_free(&opts);
+        if (res < 0)
+            qWarning() << "could not write header" << res;
+    }
+
+    // the streams have been set up by the audio and video encoders at this point
+    for (const auto &output : qAsConst(additionalOutputs)) {
+        auto *tee = new TeeOutput(this, output);
+        if (tee->isValid()) {
+            teeOutputs.append(tee);
+        } else {
+            emit outputError(QMediaRecorder::LocationNotWritable,
+                             QStringLiteral("Could not open additional output %1").arg(tee->outputName()));
+            delete tee;
+        }
+    }
 
     muxer->start();
+    for (auto *tee : qAsConst(teeOutputs))
+        tee->start();
     if (audioEncode)
         audioEncode->start();
     if (videoEncode)
         videoEncode->start();
+    QMutexLocker locker(&videoFrameMutex);
     isRecording = true;
 }
 
 void EncodingFinalizer::run()
 {
+    {
+        // a frame delivery might still wait for room in the video queue
+        QMutexLocker locker(&encoder->videoFrameMutex);
+        while (encoder->pendingVideoFrames)
+            encoder->videoFramesDelivered.wait(&encoder->videoFrameMutex);
+    }
     if (encoder->audioEncode)
         encoder->audioEncode->kill();
     if (encoder->videoEncode)
         encoder->videoEncode->kill();
     encoder->muxer->kill();
+    for (auto *tee : qAsConst(encoder->teeOutputs))
+        tee->kill();
+
+    encoder->closePreviousSegment();
+    // nothing got written if a pre-event recording never got triggered
+    if (encoder->currentOutput()->pb) {
+        closeOutput(encoder->currentOutput());
+        if (encoder->isSegmenting())
+            emit encoder->segmentFinished(segmentLocation(encoder->segmentUrl, encoder->segmentIndex));
+    }
+    encoder->preEventBuffer.clear();
 
-    int res = av_write_trailer(encoder->formatContext);
-    if (res < 0)
-        qWarning() << "could not write trailer" << res;
-
+    avformat_free_context(encoder->segmentContext);
     avformat_free_context(encoder->formatContext);
     qCDebug(qLcFFmpegEncoder) << "    done finalizing.";
     emit encoder->finalizationDone();
@@ -141,7 +255,13 @@ void Encoder::finalize()
 {
     qCDebug(qLcFFmpegEncoder) << ">>>>>>>>>>>>>>> finalize";
 
-    isRecording = false;
+    {
+        QMutexLocker locker(&videoFrameMutex);
+        disconnect(videoFrameConnection);
+        isRecording = false;
+    }
+    if (videoEncode)
+        videoEncode->releaseSource();
     auto *finalizer = new EncodingFinalizer(this);
     finalizer->start();
 }
@@ -165,10 +285,207 @@ void Encoder::newAudioBuffer(const QAudioBuffer &buffer)
         audioEncode->addBuffer(buffer);
 }
 
+QPlatformMediaRecorder::EncodingStatistics Encoder::statistics() const
+{
+    QPlatformMediaRecorder::EncodingStatistics stats;
+    if (videoEncode) {
+        stats.droppedVideoFrames = videoEncode->droppedFrames();
+        stats.lateVideoFrames = videoEncode->lateFrames();
+        videoEncode->addCaptureStatistics(stats);
+        stats.encodeFrameRate = videoEncode->encodeFrameRate();
+    }
+    if (audioEncode)
+        stats.droppedAudioBuffers = audioEncode->droppedBuffers();
+    return stats;
+}
+
+bool Encoder::isKeyPacket(const AVPacket *packet) const
+{
+    if (!(packet->flags & AV_PKT_FLAG_KEY))
+        return false;
+    // with video, only cut at key frames of the main video stream, all audio packets are key frames
+    return !videoEncode || packet->stream_index == videoEncode->streamIndex();
+}
+
+bool Encoder::isSegmentBoundary(const AVPacket *packet) const
+{
+    if (!isSegmenting() || !isKeyPacket(packet))
+        return false;
+
+    const AVStream *stream = formatContext->streams[packet->stream_index];
+    qint64 time = packetTime(packet, stream);
+    if (segmentDuration && time != AV_NOPTS_VALUE && time - segmentStart >= segmentDuration)
+        return true;
+    AVIOContext *pb = currentOutput()->pb;
+    return segmentSize && pb && avio_tell(pb) >= segmentSize;
+}
+
+bool Encoder::startSegment(const AVPacket *packet)
+{
+    // the first segment of a pre-event recording doesn't replace anything
+    const bool hasOutput = currentOutput()->pb;
+    QUrl url = segmentLocation(segmentUrl, hasOutput ? segmentIndex + 1 : segmentIndex);
+    QByteArray encoded = url.toEncoded();
+
+    AVFormatContext *next = avformat_alloc_context();
+    next->oformat = formatContext->oformat;
+    next->url = (char *)av_malloc(encoded.size() + 1);
+    memcpy(next->url, encoded.constData(), encoded.size() + 1);
+    av_dict_copy(&next->metadata, formatContext->metadata, 0);
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+        const AVStream *source = formatContext->streams[i];
+        AVStream *stream = avformat_new_stream(next, nullptr);
+        avcodec_parameters_copy(stream->codecpar, source->codecpar);
+        stream->id = source->id;
+        stream->time_base = source->time_base;
+    }
+
+    int res = avio_open2(&next->pb, next->url, AVIO_FLAG_WRITE, nullptr, nullptr);
+    if (res >= 0) {
+        AVDictionary *opts = containerOptions(next, fragmented);
+        res = avformat_write_header(next, &opts);
+        av_dict_free(&opts);
+    }
+    if (res < 0) {
+        // keep on writing to the current segment rather than losing data
+        qWarning() << "could not start new segment" << url << err2str(res);
+        avio_closep(&next->pb);
+        avformat_free_context(next);
+        return false;
+    }
+    qCDebug(qLcFFmpegEncoder) << "started segment" << url;
+
+    if (hasOutput) {
+        closePreviousSegment();
+        previousSegment = currentOutput();
+        previousSegmentIndex = segmentIndex;
+        previousSegmentStart = segmentStart;
+        for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+            if (int(i) != packet->stream_index)
+                streamsBehindCut.insert(int(i));
+        }
+        ++segmentIndex;
+    }
+
+    segmentContext = next;
+    segmentStart = packetTime(packet, formatContext->streams[packet->stream_index]);
+    if (streamsBehindCut.isEmpty())
+        closePreviousSegment();
+    return true;
+}
+
+void Encoder::closePreviousSegment()
+{
+    if (!previousSegment)
+        return;
+    closeOutput(previousSegment);
+    emit segmentFinished(segmentLocation(segmentUrl, previousSegmentIndex));
+    // the template context keeps the streams the encoders refer to alive, so it's
+    // only freed in the finalizer
+    if (previousSegment != formatContext)
+        avformat_free_context(previousSegment);
+    previousSegment = nullptr;
+    streamsBehindCut.clear();
+}
+
+void Encoder::triggerPreEvent()
+{
+    if (!preEventBuffer.isEnabled())
+        return;
+    preEventTriggered.storeRelease(true);
+    muxer->wake();
+}
+
+// Keeps packets in the pre-event buffer until triggered. Returns false once the
+// packet should be written to the output directly.
+bool Encoder::bufferPreEvent(AVPacket *packet)
+{
+    if (!preEventBuffer.isEnabled() || currentOutput()->pb)
+        return false;
+
+    const qint64 time = packetTime(packet, formatContext->streams[packet->stream_index]);
+    preEventBuffer.add(packet, isKeyPacket(packet), time);
+    if (hasPendingPreEvent())
+        flushPreEvent();
+    return true;
+}
+
+bool Encoder::hasPendingPreEvent() const
+{
+    return preEventTriggered.loadAcquire() && !preEventBuffer.isEmpty();
+}
+
+// Opens the output and writes the buffered packets to it, after which
+// packets go to the output directly
+bool Encoder::flushPreEvent()
+{
+    if (!startSegment(preEventBuffer.first())) {
+        emit error(QMediaRecorder::LocationNotWritable, QStringLiteral("Could not open output file"));
+        preEventTriggered.storeRelease(false);
+        return false;
+    }
+    while (!preEventBuffer.isEmpty()) {
+        AVPacket *p = preEventBuffer.take();
+        writePacket(p);
+        av_packet_free(&p);
+    }
+    return true;
+}
+
+void Encoder::writePacket(AVPacket *packet)
+{
+    AVFormatContext *output = currentOutput();
+    qint64 start = segmentStart;
+    if (segmentContext) {
+        // audio encoded before the video key frame a segment started at would get a
+        // negative timestamp in it, so it still goes to the previous segment
+        const qint64 time = packetTime(packet, formatContext->streams[packet->stream_index]);
+        if (time != AV_NOPTS_VALUE && time < segmentStart) {
+            // a pre-event recording has nothing before its first key frame
+            if (!previousSegment)
+                return;
+            output = previousSegment;
+            start = previousSegmentStart;
+        } else if (previousSegment) {
+            streamsBehindCut.remove(packet->stream_index);
+            if (streamsBehindCut.isEmpty())
+                closePreviousSegment();
+        }
+    }
+
+    if (output != formatContext) {
+        // the encoders produce packets in the time base of the template streams,
+        // every segment starts at zero
+        AVRational from = formatContext->streams[packet->stream_index]->time_base;
+        AVRational to = output->streams[packet->stream_index]->time_base;
+        qint64 offset = av_rescale_q(start, AV_TIME_BASE_Q, from);
+        if (packet->pts != AV_NOPTS_VALUE)
+            packet->pts = av_rescale_q(packet->pts - offset, from, to);
+        if (packet->dts != AV_NOPTS_VALUE)
+            packet->dts = av_rescale_q(packet->dts - offset, from, to);
+        packet->duration = av_rescale_q(packet->duration, from, to);
+    }
+    av_interleaved_write_frame(output, packet);
+}
+
 void Encoder::newVideoFrame(const QVideoFrame &frame)
 {
-    if (videoEncode && isRecording)
+    QMutexLocker locker(&videoFrameMutex);
+    if (!videoEncode || !isRecording)
+        return;
+
+    // Waiting for room in the queue must not block finalize(), the finalizer
+    // waits for the delivery to complete instead
+    ++pendingVideoFrames;
+    locker.unlock();
+    videoEncode->waitForQueueSpace();
+    locker.relock();
+
+    if (isRecording)
         videoEncode->addFrame(frame);
+    if (!--pendingVideoFrames)
+        videoFramesDelivered.wakeAll();
 }
 
 void Encoder::newTimeStamp(qint64 time)
@@ -189,6 +506,9 @@ Muxer::Muxer(Encoder *encoder)
 void Muxer::addPacket(AVPacket *packet)
 {
 //    qCDebug(qLcFFmpegEncoder) << "Muxer::addPacket" << packet->pts << packet->stream_index;
+    for (auto *tee : qAsConst(encoder->teeOutputs))
+        tee->addPacket(packet);
+
     QMutexLocker locker(&queueMutex);
     packetQueue.enqueue(packet);
     wake();
@@ -209,21 +529,195 @@ void Muxer::init()
 
 void Muxer::cleanup()
 {
+    while (!packetQueue.isEmpty())
+        loop();
 }
 
 bool QFFmpeg::Muxer::shouldWait() const
 {
-    QMutexLocker locker(&queueMutex);
-    return packetQueue.isEmpty();
+    {
+        QMutexLocker locker(&queueMutex);
+        if (!packetQueue.isEmpty())
+            return false;
+    }
+    // a triggered pre-event recording is written right away, not with the next packet
+    return !encoder->hasPendingPreEvent();
 }
 
 void Muxer::loop()
 {
     auto *packet = takePacket();
+    if (!packet) {
+        if (encoder->hasPendingPreEvent())
+            encoder->flushPreEvent();
+        return;
+    }
 //    qCDebug(qLcFFmpegEncoder) << "writing packet to file" << packet->pts << packet->duration << packet->stream_index;
-    av_interleaved_write_frame(encoder->formatContext, packet);
+    if (encoder->bufferPreEvent(packet))
+        return;
+    if (encoder->isSegmentBoundary(packet))
+        encoder->startSegment(packet);
+    encoder->writePacket(packet);
+    av_packet_free(&packet);
 }
 
+static int writeToDevice(void *opaque, uint8_t *buf, int size)
+{
+    auto *device = static_cast<QIODevice *>(opaque);
+    qint64 written = device->write(reinterpret_cast<const char *>(buf), size);
+    return written < 0 ? AVERROR(EIO) : int(written);
+}
+
+static const AVOutputFormat *teeOutputFormat(const QPlatformMediaRecorder::AdditionalOutput &output)
+{
+    if (output.format != QMediaFormat::UnspecifiedFormat)
+        return QFFmpegMediaFormatInfo::outputFormatForFileFormat(output.format);
+
+    // network outputs default to a transport stream, as that's what receivers can join at any time
+    const QString scheme = output.location.scheme();
+    if (scheme == QLatin1String("udp") || scheme == QLatin1String("srt"))
+        return av_guess_format("mpegts", nullptr, nullptr);
+    if (scheme == QLatin1String("rtp"))
+        return av_guess_format("rtp_mpegts", nullptr, nullptr);
+    return av_guess_format(nullptr, output.location.path().toUtf8().constData(), nullptr);
+}
+
+TeeOutput::TeeOutput(Encoder *encoder, const QPlatformMediaRecorder::AdditionalOutput &output)
+    : encoder(encoder)
+    , device(output.device)
+{
+    setObjectName(QLatin1String("TeeOutput"));
+    name = device ? QStringLiteral("device") : output.location.toString();
+
+    const AVOutputFormat *avFormat = teeOutputFormat(output);
+    if (!avFormat) {
+        qWarning() << "could not find a container format for additional output" << name;
+        return;
+    }
+
+    AVFormatContext *context = avformat_alloc_context();
+    context->oformat = const_cast<AVOutputFormat *>(avFormat); // constness varies
+    av_dict_copy(&context->metadata, encoder->formatContext->metadata, 0);
+
+    for (unsigned int i = 0; i < encoder->formatContext->nb_streams; ++i) {
+        const AVStream *source = encoder->formatContext->streams[i];
+        AVStream *stream = avformat_new_stream(context, nullptr);
+        avcodec_parameters_copy(stream->codecpar, source->codecpar);
+        stream->id = source->id;
+        stream->time_base = source->time_base;
+    }
+
+    int res = 0;
+    if (device) {
+        constexpr int bufferSize = 64*1024;
+        auto *buffer = static_cast<unsigned char *>(av_malloc(bufferSize));
+        context->pb = avio_alloc_context(buffer, bufferSize, 1, device, nullptr, writeToDevice, nullptr);
+        context->flags |= AVFMT_FLAG_CUSTOM_IO;
+    } else {
+        QByteArray encoded = output.location.toEncoded();
+        context->url = (char *)av_malloc(encoded.size() + 1);
+        memcpy(context->url, encoded.constData(), encoded.size() + 1);
+        res = avio_open2(&context->pb, context->url, AVIO_FLAG_WRITE, nullptr, nullptr);
+    }
+    if (res < 0 || !context->pb) {
+        qWarning() << "could not open additional output" << name << err2str(res);
+        avformat_free_context(context);
+        return;
+    }
+    formatContext = context;
+
+    maxQueueSize = qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_TEE_QUEUE");
+    if (maxQueueSize <= 0)
+        maxQueueSize = 256;
+}
+
+TeeOutput::~TeeOutput()
+{
+    if (!formatContext)
+        return;
+    if (device) {
+        av_freep(&formatContext->pb->buffer);
+        avio_context_free(&formatContext->pb);
+    } else {
+        avio_closep(&formatContext->pb);
+    }
+    avformat_free_context(formatContext);
+}
+
+void TeeOutput::addPacket(const AVPacket *packet)
+{
+    QMutexLocker locker(&queueMutex);
+    if (packetQueue.size() >= maxQueueSize)
+        waitForKeyPacket = true;
+    // once packets got dropped, the output can only continue decoding at the next key frame
+    if (waitForKeyPacket) {
+        if (packetQueue.size() >= maxQueueSize || !encoder->isKeyPacket(packet)) {
+            if (dropped++ == 0)
+                qCWarning(qLcFFmpegEncoder) << "additional output" << name << "can't keep up, dropping packets";
+            return;
+        }
+        waitForKeyPacket = false;
+    }
+    packetQueue.enqueue(av_packet_clone(packet));
+    wake();
+}
+
+AVPacket *TeeOutput::takePacket()
+{
+    QMutexLocker locker(&queueMutex);
+    if (packetQueue.isEmpty())
+        return nullptr;
+    return packetQueue.dequeue();
+}
+
+void TeeOutput::init()
+{
+    // containers that seek back to finish their header, like MP4, can only be
+    // written to sequential devices in fragments
+    const bool sequential = device && device->isSequential();
+    AVDictionary *opts = containerOptions(formatContext, sequential || encoder->fragmented);
+    int res = avformat_write_header(formatContext, &opts);
+    av_dict_free(&opts);
+    if (res < 0) {
+        qWarning() << "could not write header to additional output" << name << err2str(res);
+        emit encoder->outputError(QMediaRecorder::FormatError,
+                                  QStringLiteral("Could not write to additional output %1: %2")
+                                          .arg(name, err2str(res)));
+    } else {
+        headerWritten = true;
+    }
+}
+
+void TeeOutput::cleanup()
+{
+    while (!packetQueue.isEmpty())
+        loop();
+    if (headerWritten) {
+        int res = av_write_trailer(formatContext);
+        if (res < 0)
+            qWarning() << "could not write trailer to additional output" << name << res;
+    }
+}
+
+bool TeeOutput::shouldWait() const
+{
+    QMutexLocker locker(&queueMutex);
+    return packetQueue.isEmpty();
+}
+
+void TeeOutput::loop()
+{
+    auto *packet = takePacket();
+    if (!packet)
+        return;
+    if (headerWritten) {
+        // the muxer might have picked a different time base for the stream
+        const AVStream *source = encoder->formatContext->streams[packet->stream_index];
+        av_packet_rescale_ts(packet, source->time_base, formatContext->streams[packet->stream_index]->time_base);
+        av_interleaved_write_frame(formatContext, packet);
+    }
+    av_packet_free(&packet);
+}
 
 static AVSampleFormat bestMatchingSampleFormat(AVSampleFormat requested, const AVSampleFormat *available)
 {
@@ -284,6 +778,11 @@ AudioEncoder::AudioEncoder(Encoder *encoder, QFFmpegAudioInput *input, const QMe
     stream->codecpar->frame_size = 1024;
     stream->codecpar->format = bestSampleFormat;
     stream->time_base = AVRational{ 1, format.sampleRate() };
+
+    int maxQueuedMs = qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_AUDIO_QUEUE_MS");
+    if (maxQueuedMs <= 0)
+        maxQueuedMs = 10000;
+    maxQueuedDuration = qint64(maxQueuedMs)*1000;
 }
 
 void AudioEncoder::open()
@@ -317,10 +816,17 @@ void AudioEncoder::open()
 void AudioEncoder::addBuffer(const QAudioBuffer &buffer)
 {
     QMutexLocker locker(&queueMutex);
-    if (!paused.loadRelaxed()) {
-        audioBufferQueue.enqueue(buffer);
-        wake();
+    if (paused.loadRelaxed())
+        return;
+
+    if (queuedDuration > maxQueuedDuration) {
+        if (dropped.fetchAndAddRelaxed(1) == 0)
+            qCWarning(qLcFFmpegEncoder) << "Audio encoder can't keep up, dropping audio";
+        return;
     }
+    queuedDuration += buffer.duration();
+    audioBufferQueue.enqueue(buffer);
+    wake();
 }
 
 QAudioBuffer AudioEncoder::takeBuffer()
@@ -328,7 +834,9 @@ QAudioBuffer AudioEncoder::takeBuffer()
     QMutexLocker locker(&queueMutex);
     if (audioBufferQueue.isEmpty())
         return QAudioBuffer();
-    return audioBufferQueue.dequeue();
+    QAudioBuffer buffer = audioBufferQueue.dequeue();
+    queuedDuration -= buffer.duration();
+    return buffer;
 }
 
 void AudioEncoder::init()
@@ -433,19 +941,172 @@ VideoEncoder::VideoEncoder(Encoder *encoder, QPlatformCamera *camera, const QMed
     AVPixelFormat pixelFormat = hwAccel ? hwAccel->hwFormat() : swFormat;
     frameEncoder = new VideoFrameEncoder(settings, format.resolution(), format.maxFrameRate(), pixelFormat, swFormat);
     frameEncoder->initWithFormatContext(encoder->formatContext);
+
+    maxQueueSize = qEnvironmentVariableIntValue("QT_FFMPEG_ENCODER_VIDEO_QUEUE");
+    if (maxQueueSize <= 0)
+        maxQueueSize = 8;
+
+    QByteArray policyName = qgetenv("QT_FFMPEG_ENCODER_OVERLOAD_POLICY");
+    if (policyName == "drop")
+        policy = DropFrames;
+    else if (policyName == "block")
+        policy = BlockSource;
+    else
+        policy = ReduceFrameRate;
+
+    qreal frameRate = format.maxFrameRate() > 0 ? format.maxFrameRate() : 30.;
+    nominalFrameInterval = qint64(1000000./frameRate);
+    clock.start();
+
+    // QT_FFMPEG_ENCODER_RENDITIONS="1280x720,640x360" adds further video streams encoded from the
+    // same frames, e.g. as the lower steps of an adaptive bitrate ladder
+    const QByteArray renditionSizes = qgetenv("QT_FFMPEG_ENCODER_RENDITIONS");
+    if (!renditionSizes.isEmpty()) {
+        // planar 4:2:0 is what encoders take natively, keep the camera format if it already is one
+        renditionFormat = (swFormat == AV_PIX_FMT_NV12 || swFormat == AV_PIX_FMT_YUV420P)
+                ? swFormat : AV_PIX_FMT_YUV420P;
+        QSize mainResolution = settings.videoResolution().isValid() ? settings.videoResolution() : format.resolution();
+        keyFrameInterval = qMax(1, qRound(frameRate*2));
+
+        for (const QByteArray &size : renditionSizes.split(',')) {
+            const QList<QByteArray> dimensions = size.trimmed().split('x');
+            QSize resolution;
+            if (dimensions.size() == 2)
+                resolution = QSize(dimensions.at(0).toInt() & ~1, dimensions.at(1).toInt() & ~1);
+            if (resolution.isEmpty()) {
+                qWarning() << "ignoring invalid rendition size" << size;
+                continue;
+            }
+
+            QMediaEncoderSettings renditionSettings = settings;
+            renditionSettings.setVideoResolution(resolution);
+            if (settings.videoBitRate() > 0 && !mainResolution.isEmpty())
+                renditionSettings.setVideoBitRate(int(qint64(settings.videoBitRate())*resolution.width()*resolution.height()
+                                                      /(mainResolution.width()*mainResolution.height())));
+
+            auto *rendition = new VideoRenditionEncoder(encoder, renditionSettings, format.resolution(),
+                                                        format.maxFrameRate(), renditionFormat, keyFrameInterval);
+            if (rendition->isValid())
+                renditions.append(rendition);
+            else
+                delete rendition;
+        }
+        if (!renditions.isEmpty())
+            frameEncoder->setKeyFrameInterval(keyFrameInterval);
+    }
 }
 
 VideoEncoder::~VideoEncoder()
 {
+    qDeleteAll(renditions);
+    sws_freeContext(renditionConverter);
     delete frameEncoder;
 }
 
+void VideoEncoder::addCaptureStatistics(QPlatformMediaRecorder::EncodingStatistics &stats) const
+{
+#if QT_CONFIG(linux_v4l)
+    if (auto *v4l2Camera = qobject_cast<QV4L2Camera *>(m_camera)) {
+        stats.droppedCaptureFrames = qint64(v4l2Camera->droppedFrames());
+        stats.lateCaptureFrames = qint64(v4l2Camera->lateFrames());
+        stats.maxCaptureDequeueLatency = v4l2Camera->maxDequeueLatency();
+        stats.maxCaptureDeliveryLatency = v4l2Camera->maxDeliveryLatency();
+    }
+#else
+    Q_UNUSED(stats);
+#endif
+}
+
+int VideoEncoder::streamIndex() const
+{
+    return frameEncoder->streamIndex();
+}
+
 void VideoEncoder::addFrame(const QVideoFrame &frame)
 {
     QMutexLocker locker(&queueMutex);
-    if (!paused.loadRelaxed()) {
-        videoFrameQueue.enqueue(frame);
-        wake();
+    if (paused.loadRelaxed())
+        return;
+
+    if (!acceptFrame(frame))
+        return;
+
+    videoFrameQueue.enqueue({ frame, clock.nsecsElapsed()/1000 });
+    wake();
+}
+
+// With the BlockSource policy, holds up the camera until there is room in the queue
+void VideoEncoder::waitForQueueSpace()
+{
+    if (policy != BlockSource)
+        return;
+
+    QMutexLocker locker(&queueMutex);
+    // don't hold up the camera forever if the encoder got stuck
+    QDeadlineTimer deadline(500);
+    while (videoFrameQueue.size() >= maxQueueSize && !sourceReleased && !exit.loadAcquire()) {
+        if (!queueNotFull.wait(&queueMutex, deadline))
+            break;
+    }
+}
+
+// Stops holding up the camera, recording is about to end
+void VideoEncoder::releaseSource()
+{
+    QMutexLocker locker(&queueMutex);
+    sourceReleased = true;
+    queueNotFull.wakeAll();
+}
+
+// Called with queueMutex locked
+bool VideoEncoder::acceptFrame(const QVideoFrame &frame)
+{
+    const int queueSize = videoFrameQueue.size();
+    if (queueSize >= maxQueueSize) {
+        if (dropped.fetchAndAddRelaxed(1) == 0)
+            qCWarning(qLcFFmpegEncoder) << "Video encoder can't keep up, dropping frames";
+        return false;
+    }
+
+    if (policy != ReduceFrameRate)
+        return true;
+
+    adjustFrameRate(queueSize);
+
+    qint64 time = frame.startTime();
+    if (minFrameInterval > 0 && lastAcceptedFrameTime >= 0 && time >= lastAcceptedFrameTime
+        && time - lastAcceptedFrameTime < minFrameInterval) {
+        dropped.fetchAndAddRelaxed(1);
+        return false;
+    }
+    lastAcceptedFrameTime = time;
+    return true;
+}
+
+// Lowers the rate at which frames get accepted while the queue fills up, and
+// slowly raises it again once the encoder has caught up
+void VideoEncoder::adjustFrameRate(int queueSize)
+{
+    const qint64 now = clock.nsecsElapsed()/1000;
+    if (now - lastRateAdjustment < 500000)
+        return;
+
+    if (queueSize*4 >= maxQueueSize*3) {
+        const qint64 maxInterval = nominalFrameInterval*8;
+        qint64 interval = minFrameInterval > 0 ? minFrameInterval*5/4 : nominalFrameInterval*5/4;
+        interval = qMin(interval, maxInterval);
+        if (interval != minFrameInterval) {
+            qCDebug(qLcFFmpegEncoder) << "reducing encoded frame rate to" << 1000000./interval;
+            minFrameInterval = interval;
+        }
+        lastRateAdjustment = now;
+    } else if (minFrameInterval > 0 && queueSize*4 <= maxQueueSize) {
+        minFrameInterval = minFrameInterval*9/10;
+        if (minFrameInterval <= nominalFrameInterval) {
+            qCDebug(qLcFFmpegEncoder) << "restored full frame rate";
+            minFrameInterval = 0;
+        }
+        lastRateAdjustment = now;
     }
 }
 
@@ -454,7 +1115,41 @@ QVideoFrame VideoEncoder::takeFrame()
     QMutexLocker locker(&queueMutex);
     if (videoFrameQueue.isEmpty())
         return QVideoFrame();
-    return videoFrameQueue.dequeue();
+    QueuedFrame queued = videoFrameQueue.dequeue();
+    queueNotFull.wakeOne();
+
+    // frames that waited longer than two frame intervals will show up late in a live preview
+    // of the encoded stream, and are an early sign of the encoder not keeping up
+    if (clock.nsecsElapsed()/1000 - queued.queuedAt > 2*nominalFrameInterval)
+        late.fetchAndAddRelaxed(1);
+    return queued.frame;
+}
+
+qreal VideoEncoder::encodeFrameRate() const
+{
+    const qreal rate = encodedFramesPerHundredSeconds.loadRelaxed()/100.;
+    // The rate is only updated when frames get encoded. Once nothing was encoded
+    // for longer than a rate window, at most one frame made it through in the
+    // time since, so decay the rate accordingly instead of reporting the old one.
+    const qint64 idle = clock.nsecsElapsed()/1000 - lastEncodedAt.loadRelaxed();
+    if (idle <= 1000000)
+        return rate;
+    return qMin(rate, 1000000./idle);
+}
+
+void VideoEncoder::updateEncodeRate()
+{
+    const qint64 now = clock.nsecsElapsed()/1000;
+    lastEncodedAt.storeRelaxed(now);
+    if (!framesInRateWindow)
+        rateWindowStart = now;
+    ++framesInRateWindow;
+
+    const qint64 elapsed = now - rateWindowStart;
+    if (elapsed >= 1000000) {
+        encodedFramesPerHundredSeconds.storeRelaxed((framesInRateWindow - 1)*100000000ll/elapsed);
+        framesInRateWindow = 0;
+    }
 }
 
 void VideoEncoder::retrievePackets()
@@ -471,6 +1166,8 @@ void VideoEncoder::init()
     bool ok = frameEncoder->open();
     if (!ok)
         encoder->error(QMediaRecorder::ResourceError, "Could not initialize encoder");
+    for (auto *rendition : qAsConst(renditions))
+        rendition->start();
 }
 
 void VideoEncoder::cleanup()
@@ -482,6 +1179,16 @@ void VideoEncoder::cleanup()
             retrievePackets();
         retrievePackets();
     }
+    // drains and flushes the rendition encoders
+    for (auto *rendition : qAsConst(renditions))
+        rendition->kill();
+    renditions.clear();
+}
+
+void VideoEncoder::killHelper()
+{
+    QMutexLocker locker(&queueMutex);
+    queueNotFull.wakeAll();
 }
 
 bool VideoEncoder::shouldWait() const
@@ -565,12 +1272,156 @@ void VideoEncoder::loop()
 
     encoder->newTimeStamp(time/1000);
 
+    // has to happen before sending, the encoder takes ownership of avFrame
+    AVFrame *renditionFrame = nullptr;
+    bool key = false;
+    if (!renditions.isEmpty()) {
+        renditionFrame = renditionSourceFrame(avFrame);
+        key = framesEncoded % keyFrameInterval == 0;
+        if (key)
+            avFrame->pict_type = AV_PICTURE_TYPE_I;
+    }
+    ++framesEncoded;
+
 //    qCDebug(qLcFFmpegEncoder) << ">>> sending frame" << avFrame->pts << time;
     int ret = frameEncoder->sendFrame(avFrame);
     if (ret < 0) {
         qCDebug(qLcFFmpegEncoder) << "error sending frame" << ret << err2str(ret);
         encoder->error(QMediaRecorder::ResourceError, err2str(ret));
     }
+
+    if (renditionFrame) {
+        for (auto *rendition : qAsConst(renditions))
+            rendition->addFrame(renditionFrame, time, key);
+        av_frame_free(&renditionFrame);
+    }
+    updateEncodeRate();
+}
+
+// Returns a new reference to the frame in renditionFormat, downloading it from the GPU and
+// converting it as needed. This is done once, the renditions only scale the result.
+AVFrame *VideoEncoder::renditionSourceFrame(const AVFrame *frame)
+{
+    AVFrame *swFrame = nullptr;
+    if (frame->hw_frames_ctx) {
+        swFrame = av_frame_alloc();
+        int err = av_hwframe_transfer_data(swFrame, frame, 0);
+        if (err < 0) {
+            qCDebug(qLcFFmpegEncoder) << "Error transferring frame data for renditions" << err2str(err);
+            av_frame_free(&swFrame);
+            return nullptr;
+        }
+    } else {
+        swFrame = av_frame_clone(frame);
+    }
+    if (!swFrame || swFrame->format == renditionFormat)
+        return swFrame;
+
+    renditionConverter = sws_getCachedContext(renditionConverter, swFrame->width, swFrame->height,
+                                              AVPixelFormat(swFrame->format), swFrame->width, swFrame->height,
+                                              renditionFormat, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    AVFrame *converted = av_frame_alloc();
+    converted->format = renditionFormat;
+    converted->width = swFrame->width;
+    converted->height = swFrame->height;
+    av_frame_get_buffer(converted, 0);
+    sws_scale(renditionConverter, swFrame->data, swFrame->linesize, 0, swFrame->height,
+              converted->data, converted->linesize);
+    av_frame_free(&swFrame);
+    return converted;
+}
+
+VideoRenditionEncoder::VideoRenditionEncoder(Encoder *encoder, const QMediaEncoderSettings &settings,
+                                             const QSize &sourceSize, float frameRate, AVPixelFormat sourceFormat,
+                                             int keyFrameInterval)
+    : resolution(settings.videoResolution())
+{
+    this->encoder = encoder;
+
+    setObjectName(QLatin1String("VideoRenditionEncoder"));
+    qCDebug(qLcFFmpegEncoder) << "VideoRenditionEncoder" << settings.videoCodec() << resolution;
+
+    frameEncoder = new VideoFrameEncoder(settings, sourceSize, frameRate, sourceFormat, sourceFormat);
+    frameEncoder->setKeyFrameInterval(keyFrameInterval);
+    if (!frameEncoder->isNull())
+        frameEncoder->initWithFormatContext(encoder->formatContext);
+}
+
+VideoRenditionEncoder::~VideoRenditionEncoder()
+{
+    for (auto &queued : frameQueue)
+        av_frame_free(&queued.frame);
+    delete frameEncoder;
+}
+
+bool VideoRenditionEncoder::isValid() const
+{
+    return !frameEncoder->isNull();
+}
+
+void VideoRenditionEncoder::addFrame(const AVFrame *frame, qint64 time, bool key)
+{
+    QMutexLocker locker(&queueMutex);
+    // a rendition that can't keep up only drops its own frames, without holding up the others
+    if (frameQueue.size() >= 4) {
+        if (dropped++ == 0)
+            qCWarning(qLcFFmpegEncoder) << "rendition" << resolution << "can't keep up, dropping frames";
+        keyPending |= key;
+        return;
+    }
+    frameQueue.enqueue({ av_frame_clone(frame), time, key || keyPending });
+    keyPending = false;
+    wake();
+}
+
+VideoRenditionEncoder::QueuedFrame VideoRenditionEncoder::takeFrame()
+{
+    QMutexLocker locker(&queueMutex);
+    if (frameQueue.isEmpty())
+        return {};
+    return frameQueue.dequeue();
+}
+
+void VideoRenditionEncoder::retrievePackets()
+{
+    while (AVPacket *packet = frameEncoder->retrievePacket())
+        encoder->muxer->addPacket(packet);
+}
+
+void VideoRenditionEncoder::init()
+{
+    if (!frameEncoder->open())
+        encoder->error(QMediaRecorder::ResourceError, "Could not initialize encoder");
+}
+
+void VideoRenditionEncoder::cleanup()
+{
+    while (!frameQueue.isEmpty())
+        loop();
+    while (frameEncoder->sendFrame(nullptr) == AVERROR(EAGAIN))
+        retrievePackets();
+    retrievePackets();
+}
+
+bool VideoRenditionEncoder::shouldWait() const
+{
+    QMutexLocker locker(&queueMutex);
+    return frameQueue.isEmpty();
+}
+
+void VideoRenditionEncoder::loop()
+{
+    retrievePackets();
+
+    QueuedFrame queued = takeFrame();
+    if (!queued.frame)
+        return;
+
+    queued.frame->pts = frameEncoder->getPts(queued.time);
+    queued.frame->pict_type = queued.key ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    int ret = frameEncoder->sendFrame(queued.frame);
+    if (ret < 0)
+        qCDebug(qLcFFmpegEncoder) << "error sending frame to rendition" << resolution << err2str(ret);
 }
 
 }
@@ -53,12 +53,15 @@
 #include "qffmpegthread_p.h"
 #include "qffmpeg_p.h"
 #include "qffmpeghwaccel_p.h"
+#include "qffmpegpreeventbuffer_p.h"
 
 #include <private/qplatformmediarecorder_p.h>
 #include <qaudioformat.h>
 #include <qaudiobuffer.h>
 
 #include <qqueue.h>
+#include <qset.h>
+#include <qelapsedtimer.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -71,8 +74,10 @@ namespace QFFmpeg
 
 class Encoder;
 class Muxer;
+class TeeOutput;
 class AudioEncoder;
 class VideoEncoder;
+class VideoRenditionEncoder;
 class VideoFrameEncoder;
 
 class EncodingFinalizer : public QThread
@@ -102,6 +107,22 @@ public:
     void setPaused(bool p);
 
     void setMetaData(const QMediaMetaData &metaData);
+    void addOutput(const QPlatformMediaRecorder::AdditionalOutput &output);
+
+    QPlatformMediaRecorder::EncodingStatistics statistics() const;
+
+    bool isSegmenting() const { return segmentDuration > 0 || segmentSize > 0; }
+    AVFormatContext *currentOutput() const { return segmentContext ? segmentContext : formatContext; }
+    bool isKeyPacket(const AVPacket *packet) const;
+    bool isSegmentBoundary(const AVPacket *packet) const;
+    bool startSegment(const AVPacket *packet);
+    void closePreviousSegment();
+    void writePacket(AVPacket *packet);
+
+    void triggerPreEvent();
+    bool bufferPreEvent(AVPacket *packet);
+    bool hasPendingPreEvent() const;
+    bool flushPreEvent();
 
 public Q_SLOTS:
     void newAudioBuffer(const QAudioBuffer &buffer);
@@ -111,7 +132,10 @@ public Q_SLOTS:
 Q_SIGNALS:
     void durationChanged(qint64 duration);
     void error(QMediaRecorder::Error code, const QString &description);
+    // an additional output failed, the recording itself continues
+    void outputError(QMediaRecorder::Error code, const QString &description);
     void finalizationDone();
+    void segmentFinished(const QUrl &location);
 
 public:
 
@@ -119,13 +143,46 @@ public:
     QMediaMetaData metaData;
     AVFormatContext *formatContext = nullptr;
     Muxer *muxer = nullptr;
+
+    // Fragmented output can be played back even if the trailer never got written
+    bool fragmented = false;
+    // Rolling over to a new file at the first key frame after segmentDuration (in AV_TIME_BASE
+    // units) or segmentSize bytes. Only touched by the muxer thread once recording started.
+    qint64 segmentDuration = 0;
+    qint64 segmentSize = 0;
+    AVFormatContext *segmentContext = nullptr;
+    QUrl segmentUrl;
+    int segmentIndex = 0;
+    qint64 segmentStart = 0;
+    // Segments are cut at video key frames, packets of the other streams that are still
+    // behind the cut complete the previous segment, which stays open until they caught up
+    AVFormatContext *previousSegment = nullptr;
+    int previousSegmentIndex = 0;
+    qint64 previousSegmentStart = 0;
+    QSet<int> streamsBehindCut;
+
+    // Pre-event recording keeps the last few seconds of encoded packets in memory
+    // and only opens the output once triggered
+    PreEventBuffer preEventBuffer;
+    QAtomicInteger<bool> preEventTriggered = false;
     bool isRecording = false;
 
     AudioEncoder *audioEncode = nullptr;
     VideoEncoder *videoEncode = nullptr;
 
+    // every additional output muxes a copy of all packets in its own thread
+    QList<QPlatformMediaRecorder::AdditionalOutput> additionalOutputs;
+    QList<TeeOutput *> teeOutputs;
+
     QMutex timeMutex;
     qint64 timeRecorded = 0;
+
+    // video frames are delivered directly on the camera's capture thread
+    QMutex videoFrameMutex;
+    QMetaObject::Connection videoFrameConnection;
+    // deliveries that wait for room in the video queue without holding the mutex
+    int pendingVideoFrames = 0;
+    QWaitCondition videoFramesDelivered;
 };
 
 
@@ -149,6 +206,38 @@ private:
     Encoder *encoder;
 };
 
+class TeeOutput : public Thread
+{
+    mutable QMutex queueMutex;
+    QQueue<AVPacket *> packetQueue;
+public:
+    TeeOutput(Encoder *encoder, const QPlatformMediaRecorder::AdditionalOutput &output);
+    ~TeeOutput();
+
+    bool isValid() const { return formatContext != nullptr; }
+    QString outputName() const { return name; }
+    void addPacket(const AVPacket *packet);
+
+private:
+    AVPacket *takePacket();
+
+    void init() override;
+    void cleanup() override;
+    bool shouldWait() const override;
+    void loop() override;
+
+    Encoder *encoder;
+    QString name;
+    AVFormatContext *formatContext = nullptr;
+    QIODevice *device = nullptr;
+    bool headerWritten = false;
+
+    // guarded by queueMutex
+    int maxQueueSize = 0;
+    bool waitForKeyPacket = false;
+    qint64 dropped = 0;
+};
+
 class EncoderThread : public Thread
 {
 public:
@@ -166,6 +255,10 @@ class AudioEncoder : public EncoderThread
 {
     mutable QMutex queueMutex;
     QQueue<QAudioBuffer> audioBufferQueue;
+    // Audio is cheap to encode and small, so it's only ever dropped when the
+    // encoder falls this far behind
+    qint64 queuedDuration = 0;
+    qint64 maxQueuedDuration = 0;
 public:
     AudioEncoder(Encoder *encoder, QFFmpegAudioInput *input, const QMediaEncoderSettings &settings);
 
@@ -174,6 +267,8 @@ public:
 
     QFFmpegAudioInput *audioInput() const { return input; }
 
+    qint64 droppedBuffers() const { return dropped.loadRelaxed(); }
+
 private:
     QAudioBuffer takeBuffer();
     void retrievePackets();
@@ -192,18 +287,48 @@ private:
     qint64 samplesWritten = 0;
     const AVCodec *avCodec = nullptr;
     QMediaEncoderSettings settings;
+    QAtomicInteger<qint64> dropped = 0;
 };
 
 
 class VideoEncoder : public EncoderThread
 {
+public:
+    // What to do when frames come in faster than they can be encoded
+    enum OverloadPolicy {
+        DropFrames,      // drop frames once the queue is full
+        ReduceFrameRate, // skip frames to lower the frame rate while the queue fills up, drop when full
+        BlockSource      // make the camera thread wait for space in the queue
+    };
+
+private:
+    struct QueuedFrame
+    {
+        QVideoFrame frame;
+        qint64 queuedAt = 0;
+    };
+
     mutable QMutex queueMutex;
-    QQueue<QVideoFrame> videoFrameQueue;
+    QWaitCondition queueNotFull;
+    QQueue<QueuedFrame> videoFrameQueue;
+    int maxQueueSize = 0;
+    OverloadPolicy policy = ReduceFrameRate;
+    bool sourceReleased = false;
+
 public:
     VideoEncoder(Encoder *encoder, QPlatformCamera *camera, const QMediaEncoderSettings &settings);
     ~VideoEncoder();
 
+    void waitForQueueSpace();
     void addFrame(const QVideoFrame &frame);
+    void releaseSource();
+
+    qint64 droppedFrames() const { return dropped.loadRelaxed(); }
+    qint64 lateFrames() const { return late.loadRelaxed(); }
+    qreal encodeFrameRate() const;
+    // adds what the camera measured before the frames reached the encoder
+    void addCaptureStatistics(QPlatformMediaRecorder::EncodingStatistics &stats) const;
+    int streamIndex() const;
 
     void setPaused(bool b) override
     {
@@ -215,7 +340,12 @@ public:
 private:
     QVideoFrame takeFrame();
     void retrievePackets();
+    bool acceptFrame(const QVideoFrame &frame);
+    void adjustFrameRate(int queueSize);
+    void updateEncodeRate();
+    AVFrame *renditionSourceFrame(const AVFrame *frame);
 
+    void killHelper() override;
     void init() override;
     void cleanup() override;
     bool shouldWait() const override;
@@ -227,6 +357,69 @@ private:
 
     QAtomicInteger<qint64> baseTime = -1;
     qint64 lastFrameTime = 0;
+
+    // all of the below in microseconds, guarded by queueMutex
+    QElapsedTimer clock;
+    qint64 nominalFrameInterval = 0;
+    qint64 minFrameInterval = 0;
+    qint64 lastAcceptedFrameTime = -1;
+    qint64 lastRateAdjustment = 0;
+
+    // only touched by the encoder thread
+    qint64 rateWindowStart = 0;
+    int framesInRateWindow = 0;
+
+    QAtomicInteger<qint64> dropped = 0;
+    QAtomicInteger<qint64> late = 0;
+    QAtomicInteger<qint64> encodedFramesPerHundredSeconds = 0;
+    // on the clock, so a stalled encoder can be noticed when asking for the rate
+    QAtomicInteger<qint64> lastEncodedAt = 0;
+
+    // Additional resolutions encoded from the same frames. Their input gets converted once
+    // into renditionFormat at the source resolution, each rendition then only scales it.
+    // Key frames are forced every keyFrameInterval frames to keep the GOPs aligned, the
+    // encoders don't insert any of their own.
+    QList<VideoRenditionEncoder *> renditions;
+    AVPixelFormat renditionFormat = AV_PIX_FMT_NONE;
+    SwsContext *renditionConverter = nullptr;
+    int keyFrameInterval = 0;
+    qint64 framesEncoded = 0;
+};
+
+class VideoRenditionEncoder : public EncoderThread
+{
+    struct QueuedFrame
+    {
+        AVFrame *frame = nullptr;
+        qint64 time = 0;
+        bool key = false;
+    };
+
+    mutable QMutex queueMutex;
+    QQueue<QueuedFrame> frameQueue;
+public:
+    VideoRenditionEncoder(Encoder *encoder, const QMediaEncoderSettings &settings, const QSize &sourceSize,
+                          float frameRate, AVPixelFormat sourceFormat, int keyFrameInterval);
+    ~VideoRenditionEncoder();
+
+    bool isValid() const;
+    void addFrame(const AVFrame *frame, qint64 time, bool key);
+
+private:
+    QueuedFrame takeFrame();
+    void retrievePackets();
+
+    void init() override;
+    void cleanup() override;
+    bool shouldWait() const override;
+    void loop() override;
+
+    VideoFrameEncoder *frameEncoder = nullptr;
+    QSize resolution;
+
+    // guarded by queueMutex
+    bool keyPending = false;
+    qint64 dropped = 0;
 };
 
 }
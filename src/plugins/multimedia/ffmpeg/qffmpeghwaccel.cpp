@@ -211,6 +211,21 @@ HWAccel::HWAccel(AVHWDeviceType deviceType)
 
 HWAccel::~HWAccel() = default;
 
+HWAccel HWAccel::withSameDevice(const AVCodec *codec) const
+{
+    if (isNull() || codec->type != AVMEDIA_TYPE_VIDEO)
+        return {};
+    for (int i = 0; const AVCodecHWConfig *config = avcodec_get_hw_config(codec, i); ++i) {
+        if (config->device_type != deviceType())
+            continue;
+        HWAccel accel;
+        accel.d = new Data;
+        accel.d->hwDeviceContext = av_buffer_ref(d->hwDeviceContext);
+        return accel;
+    }
+    return {};
+}
+
 AVPixelFormat HWAccel::format(AVFrame *frame)
 {
     if (!frame->hw_frames_ctx)
@@ -131,6 +131,10 @@ public:
     explicit HWAccel(const AVCodec *codec);
     ~HWAccel();
 
+    // Returns an accelerator sharing the device context, or a null one if
+    // codec can't use the device.
+    HWAccel withSameDevice(const AVCodec *codec) const;
+
     bool isNull() const { return !d || !d->hwDeviceContext; }
 
     AVHWDeviceType deviceType() const;
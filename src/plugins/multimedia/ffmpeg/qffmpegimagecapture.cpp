@@ -43,10 +43,14 @@
 #include <private/qplatformimagecapture_p.h>
 #include <qvideoframeformat.h>
 #include <private/qmediastoragelocation_p.h>
+#include <private/qmemoryvideobuffer_p.h>
+#include <private/qvideoframeconverter_p.h>
 #include <qimagewriter.h>
 
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QThread>
 #include <qstandardpaths.h>
 
 #include <qloggingcategory.h>
@@ -58,10 +62,24 @@ Q_LOGGING_CATEGORY(qLcImageCapture, "qt.multimedia.imageCapture")
 QFFmpegImageCapture::QFFmpegImageCapture(QImageCapture *parent)
   : QPlatformImageCapture(parent)
 {
+    // Encoding runs on a small pool of its own, so that writing an image
+    // doesn't hold up the delivery of camera frames. Frames are converted to
+    // images before, on our own thread, as the converter sets up GPU
+    // resources for every thread it runs on.
+    int threads = qEnvironmentVariableIntValue("QT_FFMPEG_IMAGE_CAPTURE_THREADS");
+    if (threads <= 0)
+        threads = qBound(1, QThread::idealThreadCount() / 2, 4);
+    m_encoderPool.setMaxThreadCount(threads);
+
+    m_maxEncodesInFlight = qEnvironmentVariableIntValue("QT_FFMPEG_IMAGE_CAPTURE_QUEUE");
+    if (m_maxEncodesInFlight <= 0)
+        m_maxEncodesInFlight = 2 * threads;
 }
 
 QFFmpegImageCapture::~QFFmpegImageCapture()
 {
+    m_encoderPool.clear();
+    m_encoderPool.waitForDone();
 }
 
 bool QFFmpegImageCapture::isReadyForCapture() const
@@ -90,6 +108,44 @@ static const char *extensionForFormat(QImageCapture::FileFormat format)
     return fmt;
 }
 
+static const char *writerFormat(QImageCapture::FileFormat format)
+{
+    const char *fmt = nullptr;
+    switch (format) {
+    case QImageCapture::UnspecifiedFormat:
+    case QImageCapture::JPEG:
+        fmt = "jpeg";
+        break;
+    case QImageCapture::PNG:
+        fmt = "png";
+        break;
+    case QImageCapture::WebP:
+        fmt = "webp";
+        break;
+    case QImageCapture::Tiff:
+        fmt = "tiff";
+        break;
+    }
+    return fmt;
+}
+
+static int writerQuality(QImageCapture::Quality quality)
+{
+    switch (quality) {
+    case QImageCapture::VeryLowQuality:
+        return 25;
+    case QImageCapture::LowQuality:
+        return 50;
+    case QImageCapture::NormalQuality:
+        break;
+    case QImageCapture::HighQuality:
+        return 75;
+    case QImageCapture::VeryHighQuality:
+        return 99;
+    }
+    return -1;
+}
+
 int QFFmpegImageCapture::capture(const QString &fileName)
 {
     QString path = QMediaStorageLocation::generateFileName(fileName, QStandardPaths::PicturesLocation, QLatin1String(extensionForFormat(m_settings.format())));
@@ -101,7 +157,13 @@ int QFFmpegImageCapture::captureToBuffer()
     return doCapture(QString());
 }
 
-int QFFmpegImageCapture::doCapture(const QString &fileName)
+int QFFmpegImageCapture::captureBurst(const QString &fileName, int count)
+{
+    QString path = QMediaStorageLocation::generateFileName(fileName, QStandardPaths::PicturesLocation, QLatin1String(extensionForFormat(m_settings.format())));
+    return doCapture(path, qMax(count, 1));
+}
+
+int QFFmpegImageCapture::doCapture(const QString &fileName, int count)
 {
     qCDebug(qLcImageCapture) << "do capture";
     if (!m_session) {
@@ -126,7 +188,18 @@ int QFFmpegImageCapture::doCapture(const QString &fileName)
         qCDebug(qLcImageCapture) << "error 2";
         return -1;
     }
-    if (passImage) {
+    if (count > m_maxEncodesInFlight) {
+        // a burst is only encoded once all of its frames are in, so it has to
+        // fit into the encode queue as a whole
+        QMetaObject::invokeMethod(this, "error", Qt::QueuedConnection,
+                                  Q_ARG(int, -1),
+                                  Q_ARG(int, QImageCapture::NotSupportedFeatureError),
+                                  Q_ARG(QString, tr("Bursts are limited to %1 images.").arg(m_maxEncodesInFlight)));
+
+        qCDebug(qLcImageCapture) << "burst of" << count << "exceeds" << m_maxEncodesInFlight;
+        return -1;
+    }
+    if (framesToCapture || m_encodesInFlight + count > m_maxEncodesInFlight) {
         //emit error in the next event loop,
         //so application can associate it with returned request id.
         QMetaObject::invokeMethod(this, "error", Qt::QueuedConnection,
@@ -137,14 +210,35 @@ int QFFmpegImageCapture::doCapture(const QString &fileName)
         qCDebug(qLcImageCapture) << "error 3";
         return -1;
     }
-    m_lastId++;
 
-    pendingImages.enqueue({m_lastId, fileName, QMediaMetaData{}});
-    // let one image pass the pipeline
-    passImage = true;
+    const int firstId = m_lastId + 1;
+    for (int i = 0; i < count; ++i) {
+        m_lastId++;
+        const QString name = fileName.isEmpty() ? QString() : reserveFileName(fileName);
+        pendingImages.enqueue({m_lastId, name, QMediaMetaData{}});
+    }
+    // let the requested number of images pass the pipeline
+    framesToCapture = count;
+    connectToFrames();
 
     updateReadyForCapture();
-    return m_lastId;
+    return firstId;
+}
+
+// Names generated from the files on disk can't account for images that are
+// still being encoded, so those names are kept unique here.
+QString QFFmpegImageCapture::reserveFileName(const QString &fileName)
+{
+    QString name = fileName;
+    const QFileInfo info(fileName);
+    for (int n = 1; m_reservedFileNames.contains(name); ++n) {
+        name = info.dir().filePath(QStringLiteral("%1_%2.%3")
+                                           .arg(info.completeBaseName())
+                                           .arg(n)
+                                           .arg(info.suffix()));
+    }
+    m_reservedFileNames.insert(name);
+    return name;
 }
 
 void QFFmpegImageCapture::setCaptureSession(QPlatformMediaCaptureSession *session)
@@ -157,7 +251,9 @@ void QFFmpegImageCapture::setCaptureSession(QPlatformMediaCaptureSession *sessio
         disconnect(m_session, nullptr, this, nullptr);
         m_lastId = 0;
         pendingImages.clear();
-        passImage = false;
+        burstFrames.clear();
+        framesToCapture = 0;
+        disconnectFromFrames();
         cameraActive = false;
     }
 
@@ -169,9 +265,26 @@ void QFFmpegImageCapture::setCaptureSession(QPlatformMediaCaptureSession *sessio
     updateReadyForCapture();
 }
 
+// The camera delivers frames on its capture thread. Listening only while images are
+// requested keeps it from queuing every frame to our thread, which would also hold
+// on to its buffers.
+void QFFmpegImageCapture::connectToFrames()
+{
+    if (m_camera && !m_frameConnection)
+        m_frameConnection = connect(m_camera, &QPlatformCamera::newVideoFrame, this, &QFFmpegImageCapture::newVideoFrame);
+}
+
+void QFFmpegImageCapture::disconnectFromFrames()
+{
+    if (m_frameConnection)
+        disconnect(m_frameConnection);
+    m_frameConnection = {};
+}
+
 void QFFmpegImageCapture::updateReadyForCapture()
 {
-    bool ready = m_session && !passImage && cameraActive;
+    bool ready = m_session && !framesToCapture && cameraActive
+            && m_encodesInFlight < m_maxEncodesInFlight;
     if (ready == m_isReadyForCapture)
         return;
     m_isReadyForCapture = ready;
@@ -188,12 +301,47 @@ void QFFmpegImageCapture::cameraActiveChanged(bool active)
     updateReadyForCapture();
 }
 
+// Copies a frame into memory of its own, so that a burst doesn't hold on to
+// the camera's buffers while it is being captured.
+static QVideoFrame copyToMemory(const QVideoFrame &frame)
+{
+    if (frame.handleType() != QVideoFrame::NoHandle || frame.pixelFormat() == QVideoFrameFormat::Format_Jpeg)
+        return frame;
+
+    QVideoFrame source = frame;
+    if (!source.map(QVideoFrame::ReadOnly))
+        return frame;
+
+    // planes not laid out one after another can't be described by a single buffer
+    qsizetype size = source.mappedBytes(0);
+    for (int i = 1; i < source.planeCount(); ++i) {
+        if (source.bits(i) != source.bits(0) + size) {
+            source.unmap();
+            return frame;
+        }
+        size += source.mappedBytes(i);
+    }
+
+    QByteArray data(reinterpret_cast<const char *>(source.bits(0)), size);
+    const int bytesPerLine = source.bytesPerLine(0);
+    source.unmap();
+
+    QVideoFrame copy(new QMemoryVideoBuffer(data, bytesPerLine), frame.surfaceFormat());
+    copy.setStartTime(frame.startTime());
+    copy.setEndTime(frame.endTime());
+    copy.setRotationAngle(frame.rotationAngle());
+    copy.setMirrored(frame.mirrored());
+    return copy;
+}
+
 void QFFmpegImageCapture::newVideoFrame(const QVideoFrame &frame)
 {
-    if (!passImage)
+    // frames queued before we disconnected can still arrive
+    if (!framesToCapture)
         return;
 
-    passImage = false;
+    if (!--framesToCapture)
+        disconnectFromFrames();
     Q_ASSERT(!pendingImages.isEmpty());
     auto pending = pendingImages.dequeue();
 
@@ -201,57 +349,97 @@ void QFFmpegImageCapture::newVideoFrame(const QVideoFrame &frame)
     // ### Add metadata from the AVFrame
     emit imageMetadataAvailable(pending.id, pending.metaData);
     emit imageAvailable(pending.id, frame);
-    QImage image = frame.toImage();
-    if (m_settings.resolution().isValid() && m_settings.resolution() != image.size())
-        image = image.scaled(m_settings.resolution());
 
-    emit imageCaptured(pending.id, image);
-    if (!pending.filename.isEmpty()) {
-        const char *fmt = nullptr;
-        switch (m_settings.format()) {
-        case QImageCapture::UnspecifiedFormat:
-        case QImageCapture::JPEG:
-            fmt = "jpeg";
-            break;
-        case QImageCapture::PNG:
-            fmt = "png";
-            break;
-        case QImageCapture::WebP:
-            fmt = "webp";
-            break;
-        case QImageCapture::Tiff:
-            fmt = "tiff";
-            break;
-        }
-        int quality = -1;
-        switch (m_settings.quality()) {
-        case QImageCapture::VeryLowQuality:
-            quality = 25;
-            break;
-        case QImageCapture::LowQuality:
-            quality = 50;
-            break;
-        case QImageCapture::NormalQuality:
-            break;
-        case QImageCapture::HighQuality:
-            quality = 75;
-            break;
-        case QImageCapture::VeryHighQuality:
-            quality = 99;
-            break;
+    if (framesToCapture || !burstFrames.isEmpty()) {
+        // Bursts are captured at the camera's frame rate first, and only
+        // encoded once all of their frames are in.
+        burstFrames.append({ pending, copyToMemory(frame) });
+        if (framesToCapture)
+            return;
+
+        const auto frames = std::exchange(burstFrames, {});
+        QList<QVideoFrame> videoFrames;
+        videoFrames.reserve(frames.size());
+        for (const auto &f : frames)
+            videoFrames.append(f.second);
+        // waits for the GPU only once for the whole burst
+        const QList<QImage> images = qImagesFromVideoFrames(videoFrames);
+        for (int i = 0; i < frames.size(); ++i)
+            encode(frames.at(i).first, frames.at(i).second, images.at(i));
+    } else {
+        encode(pending, frame, frame.toImage());
+    }
+
+    updateReadyForCapture();
+}
+
+static QImageCapture::Error writeError(QImageWriter::ImageWriterError error)
+{
+    return error == QImageWriter::UnsupportedFormatError ? QImageCapture::FormatError
+                                                         : QImageCapture::ResourceError;
+}
+
+void QFFmpegImageCapture::encode(const PendingImage &pending, const QVideoFrame &frame,
+                                 const QImage &image)
+{
+    ++m_encodesInFlight;
+
+    const QImageEncoderSettings settings = m_settings;
+    m_encoderPool.start([this, pending, frame, image, settings]() {
+        EncodedImage encoded;
+        encoded.image = image;
+
+        // JPEG data from the camera is written out as it is, rather than
+        // decoded and encoded again
+        const QSize resolution = settings.resolution();
+        const bool passThrough = frame.pixelFormat() == QVideoFrameFormat::Format_Jpeg
+                && qstrcmp(writerFormat(settings.format()), "jpeg") == 0
+                && frame.rotationAngle() == QVideoFrame::Rotation0 && !frame.mirrored()
+                && (!resolution.isValid() || resolution == frame.size());
+
+        if (!passThrough && resolution.isValid() && resolution != encoded.image.size())
+            encoded.image = encoded.image.scaled(resolution);
+
+        if (passThrough && !pending.filename.isEmpty()) {
+            QVideoFrame source = frame;
+            QFile file(pending.filename);
+            if (!source.map(QVideoFrame::ReadOnly)) {
+                encoded.error = QImageCapture::ResourceError;
+                encoded.errorString = QImageCapture::tr("Could not map the captured frame.");
+            } else if (!file.open(QIODevice::WriteOnly)
+                       || file.write(reinterpret_cast<const char *>(source.bits(0)), source.mappedBytes(0))
+                               != source.mappedBytes(0)) {
+                encoded.error = QImageCapture::ResourceError;
+                encoded.errorString = file.errorString();
+            }
+            source.unmap();
+        } else if (!pending.filename.isEmpty()) {
+            QImageWriter writer(pending.filename, writerFormat(settings.format()));
+            writer.setQuality(writerQuality(settings.quality()));
+
+            if (!writer.write(encoded.image)) {
+                encoded.error = writeError(writer.error());
+                encoded.errorString = writer.errorString();
+            }
         }
 
-        QImageWriter writer(pending.filename, fmt);
-        writer.setQuality(quality);
+        QMetaObject::invokeMethod(this, [this, pending, encoded]() {
+            encodeFinished(pending, encoded);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void QFFmpegImageCapture::encodeFinished(const PendingImage &pending, const EncodedImage &encoded)
+{
+    --m_encodesInFlight;
+    m_reservedFileNames.remove(pending.filename);
 
-        if (writer.write(image)) {
+    emit imageCaptured(pending.id, encoded.image);
+    if (!pending.filename.isEmpty()) {
+        if (encoded.error == QImageCapture::NoError)
             emit imageSaved(pending.id, pending.filename);
-        } else {
-            QImageCapture::Error err = QImageCapture::ResourceError;
-            if (writer.error() == QImageWriter::UnsupportedFormatError)
-                err = QImageCapture::FormatError;
-            emit error(pending.id, err, writer.errorString());
-        }
+        else
+            emit error(pending.id, encoded.error, encoded.errorString);
     }
     updateReadyForCapture();
 }
@@ -264,13 +452,15 @@ void QFFmpegImageCapture::onCameraChanged()
 
     if (m_camera)
         disconnect(m_camera);
+    m_frameConnection = {};
 
     m_camera = camera;
 
     if (camera) {
         cameraActiveChanged(camera->isActive());
         connect(camera, &QPlatformCamera::activeChanged, this, &QFFmpegImageCapture::cameraActiveChanged);
-        connect(camera, &QPlatformCamera::newVideoFrame, this, &QFFmpegImageCapture::newVideoFrame);
+        if (framesToCapture)
+            connectToFrames();
     } else {
         cameraActiveChanged(false);
     }
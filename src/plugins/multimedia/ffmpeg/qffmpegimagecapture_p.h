@@ -55,7 +55,10 @@
 #include <private/qplatformimagecapture_p.h>
 #include "qffmpegmediacapturesession_p.h"
 
+#include <qimage.h>
 #include <qqueue.h>
+#include <qset.h>
+#include <qthreadpool.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -70,6 +73,7 @@ public:
     bool isReadyForCapture() const override;
     int capture(const QString &fileName) override;
     int captureToBuffer() override;
+    int captureBurst(const QString &fileName, int count) override;
 
     QImageEncoderSettings imageSettings() const override;
     void setImageSettings(const QImageEncoderSettings &settings) override;
@@ -84,23 +88,43 @@ public Q_SLOTS:
     void onCameraChanged();
 
 private:
-    int doCapture(const QString &fileName);
-
-    QFFmpegMediaCaptureSession *m_session = nullptr;
-    int m_lastId = 0;
-    QImageEncoderSettings m_settings;
-    QPlatformCamera *m_camera = nullptr;
-
     struct PendingImage {
         int id;
         QString filename;
         QMediaMetaData metaData;
     };
 
+    struct EncodedImage {
+        QImage image;
+        int error = QImageCapture::NoError;
+        QString errorString;
+    };
+
+    int doCapture(const QString &fileName, int count = 1);
+    QString reserveFileName(const QString &fileName);
+    void connectToFrames();
+    void disconnectFromFrames();
+    void encode(const PendingImage &pending, const QVideoFrame &frame, const QImage &image);
+    void encodeFinished(const PendingImage &pending, const EncodedImage &encoded);
+
+    QFFmpegMediaCaptureSession *m_session = nullptr;
+    int m_lastId = 0;
+    QImageEncoderSettings m_settings;
+    QPlatformCamera *m_camera = nullptr;
+    QMetaObject::Connection m_frameConnection;
+
     QQueue<PendingImage> pendingImages;
-    bool passImage = false;
+    // frames of the current request still to be taken from the camera
+    int framesToCapture = 0;
+    // frames of a burst kept in memory until the whole burst is captured
+    QList<QPair<PendingImage, QVideoFrame>> burstFrames;
     bool cameraActive = false;
     bool m_isReadyForCapture = false;
+
+    QThreadPool m_encoderPool;
+    int m_encodesInFlight = 0;
+    int m_maxEncodesInFlight = 0;
+    QSet<QString> m_reservedFileNames;
 };
 
 QT_END_NAMESPACE
@@ -79,7 +79,8 @@ void QFFmpegMediaCaptureSession::setCamera(QPlatformCamera *camera)
     m_camera = camera;
 
     if (m_camera) {
-        connect(m_camera, &QPlatformCamera::newVideoFrame, this, &QFFmpegMediaCaptureSession::newVideoFrame);
+        connect(m_camera, &QPlatformCamera::newVideoFrame, this,
+                &QFFmpegMediaCaptureSession::newVideoFrame, Qt::DirectConnection);
         m_camera->setCaptureSession(this);
     }
 
@@ -137,6 +138,7 @@ void QFFmpegMediaCaptureSession::setAudioInput(QPlatformAudioInput *input)
 
 void QFFmpegMediaCaptureSession::setVideoPreview(QVideoSink *sink)
 {
+    QMutexLocker locker(&m_videoSinkMutex);
     if (m_videoSink == sink)
         return;
 
@@ -153,6 +155,7 @@ void QFFmpegMediaCaptureSession::setAudioOutput(QPlatformAudioOutput *output)
 
 void QFFmpegMediaCaptureSession::newVideoFrame(const QVideoFrame &frame)
 {
+    QMutexLocker locker(&m_videoSinkMutex);
     if (m_videoSink)
         m_videoSink->setVideoFrame(frame);
 }
@@ -54,6 +54,8 @@
 #include <private/qplatformmediacapture_p.h>
 #include <private/qplatformmediaintegration_p.h>
 
+#include <qmutex.h>
+
 QT_BEGIN_NAMESPACE
 
 class QFFmpegMediaRecorder;
@@ -92,6 +94,8 @@ private:
     QFFmpegImageCapture *m_imageCapture = nullptr;
     QFFmpegMediaRecorder *m_mediaRecorder = nullptr;
     QPlatformAudioOutput *m_audioOutput = nullptr;
+    // frames can arrive on the camera's capture thread
+    QMutex m_videoSinkMutex;
     QVideoSink *m_videoSink = nullptr;
 };
 
@@ -70,6 +70,13 @@ QFFmpegMediaPlayer::QFFmpegMediaPlayer(QMediaPlayer *player)
 
 QFFmpegMediaPlayer::~QFFmpegMediaPlayer()
 {
+    for (auto *o : { opener, nextOpener }) {
+        if (o) {
+            o->cancel();
+            o->wait();
+            delete o;
+        }
+    }
     delete decoder;
 }
 
@@ -80,12 +87,26 @@ qint64 QFFmpegMediaPlayer::duration() const
 
 void QFFmpegMediaPlayer::setPosition(qint64 position)
 {
-    if (decoder)
+    if (opener) {
+        pendingPosition = position;
+        positionChanged(position);
+        return;
+    }
+    if (decoder) {
         decoder->seek(position*1000);
+        // seeking dropped the next media that was prepared
+        if (!decoder->hasNext())
+            prepareNextMedia();
+    }
     if (state() == QMediaPlayer::StoppedState)
         mediaStatusChanged(QMediaPlayer::LoadedMedia);
 }
 
+QPlatformMediaPlayer::SeekStatistics QFFmpegMediaPlayer::seekStatistics() const
+{
+    return decoder ? decoder->seekStatistics() : SeekStatistics{};
+}
+
 float QFFmpegMediaPlayer::bufferProgress() const
 {
     return 1.;
@@ -120,13 +141,34 @@ const QIODevice *QFFmpegMediaPlayer::mediaStream() const
     return m_device;
 }
 
+void QFFmpegMediaPlayer::cancelOpening(MediaOpener *&opener)
+{
+    if (!opener)
+        return;
+    opener->cancel();
+    opener->disconnect();
+    // The application may delete the device once the source changed. Otherwise
+    // the opener can finish in the background, it only owns what it opened.
+    if (opener->usesStream())
+        opener->wait();
+    connect(opener, &QThread::finished, opener, &QObject::deleteLater);
+    if (opener->isFinished())
+        opener->deleteLater();
+    opener = nullptr;
+}
+
 void QFFmpegMediaPlayer::setMedia(const QUrl &media, QIODevice *stream)
 {
     m_url = media;
     m_device = stream;
+    m_nextUrl.clear();
+    cancelOpening(opener);
+    cancelOpening(nextOpener);
     if (decoder)
         delete decoder;
     decoder = nullptr;
+    pendingState = QMediaPlayer::StoppedState;
+    pendingPosition = -1;
 
     positionChanged(0);
 
@@ -140,10 +182,46 @@ void QFFmpegMediaPlayer::setMedia(const QUrl &media, QIODevice *stream)
     }
 
     mediaStatusChanged(QMediaPlayer::LoadingMedia);
+
+    if (stream && !stream->isOpen() && !stream->open(QIODevice::ReadOnly)) {
+        error(QMediaPlayer::ResourceError, QLatin1String("Could not open source device."));
+        mediaStatusChanged(QMediaPlayer::InvalidMedia);
+        return;
+    }
+
+    // Opening and probing the media can block for a long time on slow storage,
+    // so it happens on a worker thread and LoadedMedia is reported once it's done.
+    opener = new MediaOpener(media, stream, MediaOpenOptions::fromEnvironment());
+    connect(opener, &QThread::finished, this, [this, o = opener]() { mediaOpened(o); });
+    opener->start();
+}
+
+void QFFmpegMediaPlayer::mediaOpened(MediaOpener *o)
+{
+    // the media may have changed before the notification arrived
+    if (o != opener || !o->isFinished())
+        return;
+    opener = nullptr;
+    o->wait();
+    AVFormatContext *context = o->takeContext();
+    const int errorCode = o->errorCode();
+    const QString errorString = o->errorString();
+    delete o;
+
+    if (!context) {
+        error(errorCode, errorString);
+        mediaStatusChanged(QMediaPlayer::InvalidMedia);
+        if (pendingState != QMediaPlayer::StoppedState)
+            stateChanged(QMediaPlayer::StoppedState);
+        return;
+    }
+
     decoder = new Decoder(this);
-    decoder->setMedia(media, stream);
+    decoder->setMediaContext(context);
     decoder->setAudioSink(m_audioOutput);
     decoder->setVideoSink(m_videoSink);
+    if (m_playbackRate != 1.)
+        decoder->setPlaybackRate(m_playbackRate);
 
     metaDataChanged();
     seekableChanged(decoder->isSeekable());
@@ -151,11 +229,86 @@ void QFFmpegMediaPlayer::setMedia(const QUrl &media, QIODevice *stream)
     audioAvailableChanged(!decoder->m_streamMap[QPlatformMediaPlayer::AudioStream].isEmpty());
     videoAvailableChanged(!decoder->m_streamMap[QPlatformMediaPlayer::VideoStream].isEmpty());
 
-    QMetaObject::invokeMethod(this, "delayedLoadedStatus", Qt::QueuedConnection);
+    if (pendingPosition > 0)
+        decoder->seek(pendingPosition*1000);
+    prepareNextMedia();
+
+    switch (pendingState) {
+    case QMediaPlayer::StoppedState:
+        mediaStatusChanged(QMediaPlayer::LoadedMedia);
+        break;
+    case QMediaPlayer::PausedState:
+        pause();
+        break;
+    case QMediaPlayer::PlayingState:
+        play();
+        break;
+    }
+}
+
+void QFFmpegMediaPlayer::setNextMedia(const QUrl &media)
+{
+    if (m_nextUrl == media)
+        return;
+    m_nextUrl = media;
+    prepareNextMedia();
+}
+
+void QFFmpegMediaPlayer::prepareNextMedia()
+{
+    cancelOpening(nextOpener);
+    if (decoder && !decoder->clearNext())
+        return; // too late, the next media is already playing
+    if (m_nextUrl.isEmpty() || !decoder)
+        return;
+
+    nextOpener = new MediaOpener(m_nextUrl, nullptr, MediaOpenOptions::fromEnvironment());
+    connect(nextOpener, &QThread::finished, this, [this, o = nextOpener]() { nextMediaOpened(o); });
+    nextOpener->start();
+}
+
+void QFFmpegMediaPlayer::nextMediaOpened(MediaOpener *o)
+{
+    if (o != nextOpener || !o->isFinished())
+        return;
+    nextOpener = nullptr;
+    o->wait();
+    AVFormatContext *context = o->takeContext();
+    delete o;
+
+    // If the next media can't be chained, QMediaPlayer switches to it once
+    // the current one ended, with a short gap.
+    if (!context)
+        return;
+    if (!decoder) {
+        avformat_close_input(&context);
+        return;
+    }
+    decoder->prepareNext(context);
+}
+
+void QFFmpegMediaPlayer::nextMediaSwitched()
+{
+    m_url = m_nextUrl;
+    m_nextUrl.clear();
+    m_device = nullptr;
+
+    metaDataChanged();
+    seekableChanged(decoder->isSeekable());
+    audioAvailableChanged(!decoder->m_streamMap[QPlatformMediaPlayer::AudioStream].isEmpty());
+    videoAvailableChanged(!decoder->m_streamMap[QPlatformMediaPlayer::VideoStream].isEmpty());
+    positionChanged(0);
+
+    nextMediaStarted();
 }
 
 void QFFmpegMediaPlayer::play()
 {
+    if (opener) {
+        pendingState = QMediaPlayer::PlayingState;
+        stateChanged(QMediaPlayer::PlayingState);
+        return;
+    }
     if (!decoder)
         return;
 
@@ -168,6 +321,11 @@ void QFFmpegMediaPlayer::play()
 
 void QFFmpegMediaPlayer::pause()
 {
+    if (opener) {
+        pendingState = QMediaPlayer::PausedState;
+        stateChanged(QMediaPlayer::PausedState);
+        return;
+    }
     if (!decoder)
         return;
     if (mediaStatus() == QMediaPlayer::EndOfMedia && state() == QMediaPlayer::StoppedState)
@@ -179,6 +337,12 @@ void QFFmpegMediaPlayer::pause()
 
 void QFFmpegMediaPlayer::stop()
 {
+    if (opener) {
+        pendingState = QMediaPlayer::StoppedState;
+        pendingPosition = -1;
+        stateChanged(QMediaPlayer::StoppedState);
+        return;
+    }
     if (!decoder)
         return;
     decoder->stop();
@@ -192,8 +356,11 @@ void QFFmpegMediaPlayer::setAudioOutput(QPlatformAudioOutput *output)
         return;
 
     m_audioOutput = output;
-    if (decoder)
+    if (decoder) {
         decoder->setAudioSink(output);
+        if (!decoder->hasNext())
+            prepareNextMedia();
+    }
 }
 
 QMediaMetaData QFFmpegMediaPlayer::metaData() const
@@ -207,8 +374,11 @@ void QFFmpegMediaPlayer::setVideoSink(QVideoSink *sink)
         return;
 
     m_videoSink = sink;
-    if (decoder)
+    if (decoder) {
         decoder->setVideoSink(sink);
+        if (!decoder->hasNext())
+            prepareNextMedia();
+    }
 }
 
 QVideoSink *QFFmpegMediaPlayer::videoSink() const
@@ -54,11 +54,13 @@
 #include <private/qplatformmediaplayer_p.h>
 #include <qmediametadata.h>
 #include "qffmpeg_p.h"
+#include "qffmpegseekindex_p.h"
 
 QT_BEGIN_NAMESPACE
 
 namespace QFFmpeg {
 class Decoder;
+class MediaOpener;
 }
 class QPlatformAudioOutput;
 
@@ -75,6 +77,8 @@ public:
 
     float bufferProgress() const override;
 
+    SeekStatistics seekStatistics() const override;
+
     QMediaTimeRange availablePlaybackRanges() const override;
 
     qreal playbackRate() const override;
@@ -83,6 +87,7 @@ public:
     QUrl media() const override;
     const QIODevice *mediaStream() const override;
     void setMedia(const QUrl &media, QIODevice *stream) override;
+    void setNextMedia(const QUrl &media) override;
 
     void play() override;
     void pause() override;
@@ -102,12 +107,23 @@ public:
     int activeTrack(TrackType) override;
     void setActiveTrack(TrackType, int streamNumber) override;
 
-    Q_INVOKABLE void delayedLoadedStatus() { mediaStatusChanged(QMediaPlayer::LoadedMedia); }
-
 private:
     friend class QFFmpeg::Decoder;
 
+    static void cancelOpening(QFFmpeg::MediaOpener *&opener);
+    void mediaOpened(QFFmpeg::MediaOpener *opener);
+    void prepareNextMedia();
+    void nextMediaOpened(QFFmpeg::MediaOpener *opener);
+    void nextMediaSwitched();
+
     QFFmpeg::Decoder *decoder = nullptr;
+    // opens the current media, while in LoadingMedia
+    QFFmpeg::MediaOpener *opener = nullptr;
+    // requests made while the media is still being opened
+    QMediaPlayer::PlaybackState pendingState = QMediaPlayer::StoppedState;
+    qint64 pendingPosition = -1;
+    // opens the media played after the current one, once the decoder exists
+    QFFmpeg::MediaOpener *nextOpener = nullptr;
     void checkStreams();
 
     QPlatformAudioOutput *m_audioOutput = nullptr;
@@ -115,6 +131,7 @@ private:
 
     QUrl m_url;
     QIODevice *m_device = nullptr;
+    QUrl m_nextUrl;
     float m_playbackRate = 1.;
 };
 
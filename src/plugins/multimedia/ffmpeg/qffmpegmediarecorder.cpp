@@ -77,6 +77,12 @@ void QFFmpegMediaRecorder::handleSessionError(QMediaRecorder::Error code, const
     stop();
 }
 
+// Additional outputs failing doesn't stop the recording
+void QFFmpegMediaRecorder::handleOutputError(QMediaRecorder::Error code, const QString &description)
+{
+    error(code, description);
+}
+
 void QFFmpegMediaRecorder::record(QMediaEncoderSettings &settings)
 {
     if (!m_session || state() != QMediaRecorder::StoppedState)
@@ -102,11 +108,14 @@ void QFFmpegMediaRecorder::record(QMediaEncoderSettings &settings)
 
     Q_ASSERT(!actualSink.isEmpty());
 
+    m_lastStatistics = {};
     encoder = new QFFmpeg::Encoder(settings, actualSink);
     encoder->setMetaData(m_metaData);
     connect(encoder, &QFFmpeg::Encoder::durationChanged, this, &QFFmpegMediaRecorder::newDuration);
     connect(encoder, &QFFmpeg::Encoder::finalizationDone, this, &QFFmpegMediaRecorder::finalizationDone);
     connect(encoder, &QFFmpeg::Encoder::error, this, &QFFmpegMediaRecorder::handleSessionError);
+    connect(encoder, &QFFmpeg::Encoder::outputError, this, &QFFmpegMediaRecorder::handleOutputError);
+    connect(encoder, &QFFmpeg::Encoder::segmentFinished, this, &QFFmpegMediaRecorder::newSegment);
 
     auto *audioInput = m_session->audioInput();
     if (audioInput)
@@ -116,6 +125,12 @@ void QFFmpegMediaRecorder::record(QMediaEncoderSettings &settings)
     if (camera)
         encoder->addVideoSource(camera);
 
+    for (auto output : additionalOutputs()) {
+        if (!output.device && output.location.scheme().isEmpty())
+            output.location = QUrl::fromLocalFile(QDir::current().absoluteFilePath(output.location.path()));
+        encoder->addOutput(output);
+    }
+
     durationChanged(0);
     stateChanged(QMediaRecorder::RecordingState);
     actualLocationChanged(QUrl::fromLocalFile(location));
@@ -156,11 +171,18 @@ void QFFmpegMediaRecorder::stop()
     // ### all of the below should be done asynchronous. finalize() should do it's work in a thread
     // to avoid blocking the UI in case of slow codecs
     if (encoder) {
+        m_lastStatistics = encoder->statistics();
         encoder->finalize();
         encoder = nullptr;
     }
 }
 
+void QFFmpegMediaRecorder::triggerPreEventRecording()
+{
+    if (encoder && state() != QMediaRecorder::StoppedState)
+        encoder->triggerPreEvent();
+}
+
 void QFFmpegMediaRecorder::finalizationDone()
 {
     stateChanged(QMediaRecorder::StoppedState);
@@ -178,6 +200,11 @@ QMediaMetaData QFFmpegMediaRecorder::metaData() const
     return m_metaData;
 }
 
+QPlatformMediaRecorder::EncodingStatistics QFFmpegMediaRecorder::encodingStatistics() const
+{
+    return encoder ? encoder->statistics() : m_lastStatistics;
+}
+
 void QFFmpegMediaRecorder::setCaptureSession(QPlatformMediaCaptureSession *session)
 {
     auto *captureSession = static_cast<QFFmpegMediaCaptureSession *>(session);
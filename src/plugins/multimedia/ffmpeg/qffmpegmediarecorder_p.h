@@ -81,22 +81,28 @@ public:
     void pause() override;
     void resume() override;
     void stop() override;
+    void triggerPreEventRecording() override;
 
     void setMetaData(const QMediaMetaData &) override;
     QMediaMetaData metaData() const override;
 
+    EncodingStatistics encodingStatistics() const override;
+
     void setCaptureSession(QPlatformMediaCaptureSession *session);
 
 private Q_SLOTS:
     void newDuration(qint64 d) { durationChanged(d); }
+    void newSegment(const QUrl &location) { segmentFinished(location); }
     void finalizationDone();
     void handleSessionError(QMediaRecorder::Error code, const QString &description);
+    void handleOutputError(QMediaRecorder::Error code, const QString &description);
 
 private:
     QFFmpegMediaCaptureSession *m_session = nullptr;
     QMediaMetaData m_metaData;
 
     QFFmpeg::Encoder *encoder = nullptr;
+    EncodingStatistics m_lastStatistics;
 };
 
 QT_END_NAMESPACE
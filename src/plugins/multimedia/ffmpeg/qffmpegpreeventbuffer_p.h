@@ -0,0 +1,143 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QFFMPEGPREEVENTBUFFER_P_H
+#define QFFMPEGPREEVENTBUFFER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qqueue.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+}
+
+QT_BEGIN_NAMESPACE
+
+namespace QFFmpeg
+{
+
+// The encoded packets of a pre-event recording, kept in memory until the event
+// gets triggered. The buffer always starts at a key frame, and whole GOPs get
+// dropped from its front for as long as the rest still covers duration().
+// Only used by the muxer thread.
+class PreEventBuffer
+{
+public:
+    PreEventBuffer() = default;
+    ~PreEventBuffer() { clear(); }
+
+    // in AV_TIME_BASE units, 0 disables pre-event recording
+    qint64 duration() const { return m_duration; }
+    void setDuration(qint64 duration) { m_duration = qMax<qint64>(0, duration); }
+    bool isEnabled() const { return m_duration > 0; }
+
+    bool isEmpty() const { return m_packets.isEmpty(); }
+    qsizetype size() const { return m_packets.size(); }
+    const AVPacket *first() const { return m_packets.first().packet; }
+
+    // Takes ownership of packet. key tells whether the buffer may start at the
+    // packet, time is its time in AV_TIME_BASE units or AV_NOPTS_VALUE.
+    void add(AVPacket *packet, bool key, qint64 time)
+    {
+        if (m_packets.isEmpty() && !key) {
+            av_packet_free(&packet);
+            return;
+        }
+        m_packets.enqueue({ packet, key, time });
+        trim(time);
+    }
+
+    // Hands the oldest packet over to the caller
+    AVPacket *take() { return m_packets.dequeue().packet; }
+
+    void clear()
+    {
+        for (auto &entry : m_packets)
+            av_packet_free(&entry.packet);
+        m_packets.clear();
+    }
+
+private:
+    void trim(qint64 newest)
+    {
+        while (newest != AV_NOPTS_VALUE) {
+            qsizetype next = 1;
+            while (next < m_packets.size() && !m_packets.at(next).key)
+                ++next;
+            if (next == m_packets.size())
+                return;
+            // the GOP starting at next would no longer cover the full duration
+            const qint64 time = m_packets.at(next).time;
+            if (time == AV_NOPTS_VALUE || newest - time < m_duration)
+                return;
+            for (qsizetype i = 0; i < next; ++i) {
+                AVPacket *packet = m_packets.dequeue().packet;
+                av_packet_free(&packet);
+            }
+        }
+    }
+
+    struct Entry
+    {
+        AVPacket *packet = nullptr;
+        bool key = false;
+        qint64 time = AV_NOPTS_VALUE;
+    };
+    QQueue<Entry> m_packets;
+    qint64 m_duration = 0;
+
+    Q_DISABLE_COPY(PreEventBuffer)
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,238 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qffmpegscaler_p.h"
+#include <qloggingcategory.h>
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+}
+
+Q_LOGGING_CATEGORY(qLcScaler, "qt.multimedia.ffmpeg.scaler")
+
+QT_BEGIN_NAMESPACE
+
+namespace QFFmpeg
+{
+
+// conversions with cached contexts and buffer pools
+static constexpr int MaxEntries = 8;
+// idle contexts kept per conversion, enough for the renderer and a few
+// threads mapping frames concurrently
+static constexpr int MaxIdleContexts = 4;
+// alignment of the lines of converted frames, enough for AVX-512
+static constexpr int LineAlignment = 64;
+
+Scaler::~Scaler()
+{
+    for (auto &e : entries)
+        freeEntry(e);
+}
+
+Scaler *Scaler::instance()
+{
+    static Scaler scaler;
+    return &scaler;
+}
+
+void Scaler::setThreadCount(int count)
+{
+    QMutexLocker locker(&mutex);
+    threads = qMax(count, 0);
+}
+
+int Scaler::threadCount() const
+{
+    QMutexLocker locker(&mutex);
+    if (threads < 0) {
+        bool ok = false;
+        const int count = qEnvironmentVariableIntValue("QT_FFMPEG_SWS_THREADS", &ok);
+        threads = ok ? qMax(count, 0) : 0;
+    }
+    return threads;
+}
+
+void Scaler::freeEntry(Entry &entry)
+{
+    for (auto *c : qAsConst(entry.idleContexts))
+        sws_freeContext(c);
+    entry.idleContexts.clear();
+    // the pool is freed once the last converted frame using it is gone
+    av_buffer_pool_uninit(&entry.pool);
+}
+
+Scaler::Entry *Scaler::entry(const Key &key)
+{
+    // called with the mutex locked
+    ++useCounter;
+    for (auto &e : entries) {
+        if (e.key == key) {
+            e.lastUsed = useCounter;
+            return &e;
+        }
+    }
+
+    const int bufferSize = av_image_get_buffer_size(key.dstFormat, key.size.width(),
+                                                    key.size.height(), LineAlignment);
+    if (bufferSize < 0)
+        return nullptr;
+
+    if (entries.size() >= MaxEntries) {
+        auto lru = std::min_element(entries.begin(), entries.end(),
+                                    [](const Entry &a, const Entry &b) { return a.lastUsed < b.lastUsed; });
+        freeEntry(*lru);
+        entries.erase(lru);
+    }
+
+    Entry e;
+    e.key = key;
+    e.bufferSize = bufferSize;
+    e.pool = av_buffer_pool_init(bufferSize, nullptr);
+    e.lastUsed = useCounter;
+    entries.append(e);
+    return &entries.last();
+}
+
+SwsContext *Scaler::createContext(const Key &key) const
+{
+    const int width = key.size.width();
+    const int height = key.size.height();
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+    int count = threadCount();
+    // small frames convert faster than the threads can be synchronized
+    if (count == 0 && width*height < 1920*1080)
+        count = 1;
+
+    SwsContext *context = sws_alloc_context();
+    if (!context)
+        return nullptr;
+    av_opt_set_int(context, "srcw", width, 0);
+    av_opt_set_int(context, "srch", height, 0);
+    av_opt_set_int(context, "src_format", key.srcFormat, 0);
+    av_opt_set_int(context, "dstw", width, 0);
+    av_opt_set_int(context, "dsth", height, 0);
+    av_opt_set_int(context, "dst_format", key.dstFormat, 0);
+    av_opt_set_int(context, "sws_flags", key.flags, 0);
+    av_opt_set_int(context, "threads", count, 0);
+    if (sws_init_context(context, nullptr, nullptr) < 0) {
+        sws_freeContext(context);
+        return nullptr;
+    }
+    return context;
+#else
+    return sws_getContext(width, height, key.srcFormat, width, height, key.dstFormat,
+                          key.flags, nullptr, nullptr, nullptr);
+#endif
+}
+
+void Scaler::releaseContext(const Key &key, SwsContext *context)
+{
+    {
+        QMutexLocker locker(&mutex);
+        for (auto &e : entries) {
+            if (e.key == key && e.idleContexts.size() < MaxIdleContexts) {
+                e.idleContexts.append(context);
+                return;
+            }
+        }
+    }
+    // evicted in the meantime, or enough contexts kept already
+    sws_freeContext(context);
+}
+
+AVFrame *Scaler::convert(const AVFrame *frame, AVPixelFormat format, int flags)
+{
+    const Key key{ AVPixelFormat(frame->format), format, { frame->width, frame->height }, flags };
+
+    SwsContext *context = nullptr;
+    AVBufferRef *buffer = nullptr;
+    {
+        QMutexLocker locker(&mutex);
+        Entry *e = entry(key);
+        if (!e)
+            return nullptr;
+        if (!e->idleContexts.isEmpty())
+            context = e->idleContexts.takeLast();
+        // av_buffer_pool_get() is threadsafe, but the entry could be evicted
+        // once we unlock
+        buffer = av_buffer_pool_get(e->pool);
+    }
+    if (!buffer)
+        return nullptr;
+    if (!context) {
+        qCDebug(qLcScaler) << "creating scaler context" << key.size
+                           << av_get_pix_fmt_name(key.srcFormat) << "->" << av_get_pix_fmt_name(format);
+        context = createContext(key);
+        if (!context) {
+            av_buffer_unref(&buffer);
+            return nullptr;
+        }
+    }
+
+    AVFrame *converted = av_frame_alloc();
+    converted->width = frame->width;
+    converted->height = frame->height;
+    converted->format = format;
+    converted->buf[0] = buffer;
+    av_image_fill_arrays(converted->data, converted->linesize, buffer->data, format,
+                         frame->width, frame->height, LineAlignment);
+
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+    // splits the conversion into slices when the context has threads
+    const int res = sws_scale_frame(context, converted, frame);
+#else
+    const int res = sws_scale(context, frame->data, frame->linesize, 0, frame->height,
+                              converted->data, converted->linesize);
+#endif
+    releaseContext(key, context);
+
+    if (res < 0) {
+        qCWarning(qLcScaler) << "converting the frame failed:" << err2str(res);
+        av_frame_free(&converted);
+        return nullptr;
+    }
+    av_frame_copy_props(converted, frame);
+    return converted;
+}
+
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QFFMPEGSCALER_P_H
+#define QFFMPEGSCALER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qffmpeg_p.h"
+#include <qlist.h>
+#include <qmutex.h>
+#include <qsize.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QFFmpeg
+{
+
+// Converts software frames to another pixel format.
+//
+// Setting up a SwsContext and allocating the converted frame are expensive
+// compared to the conversion itself, so both are reused for frames of the
+// same geometry: idle contexts are kept per conversion, and the buffers of the
+// converted frames come from an AVBufferPool. Converting large frames can be
+// split into slices processed on multiple threads (FFmpeg 5.0 and later).
+//
+// Threadsafe, a context is only used by one conversion at a time.
+class Scaler
+{
+public:
+    struct Key {
+        AVPixelFormat srcFormat = AV_PIX_FMT_NONE;
+        AVPixelFormat dstFormat = AV_PIX_FMT_NONE;
+        QSize size;
+        int flags = 0;
+
+        bool operator==(const Key &other) const
+        {
+            return srcFormat == other.srcFormat && dstFormat == other.dstFormat
+                    && size == other.size && flags == other.flags;
+        }
+    };
+
+    Scaler() = default;
+    ~Scaler();
+
+    static Scaler *instance();
+
+    // Returns a new frame, or nullptr if the conversion isn't supported.
+    AVFrame *convert(const AVFrame *frame, AVPixelFormat format, int flags = SWS_BICUBIC);
+
+    // Threads a single conversion is split over, 0 picks them depending on the
+    // frame size. Defaults to QT_FFMPEG_SWS_THREADS. Only affects new contexts.
+    void setThreadCount(int count);
+    int threadCount() const;
+
+private:
+    struct Entry {
+        Key key;
+        QList<SwsContext *> idleContexts;
+        AVBufferPool *pool = nullptr;
+        int bufferSize = 0;
+        quint64 lastUsed = 0;
+    };
+
+    Entry *entry(const Key &key);
+    SwsContext *createContext(const Key &key) const;
+    void releaseContext(const Key &key, SwsContext *context);
+    static void freeEntry(Entry &entry);
+
+    mutable QMutex mutex;
+    QList<Entry> entries;
+    quint64 useCounter = 0;
+    mutable int threads = -1;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif // QFFMPEGSCALER_P_H
@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qffmpegseekindex_p.h"
+#include <qcryptographichash.h>
+#include <qdatastream.h>
+#include <qdatetime.h>
+#include <qdir.h>
+#include <qfileinfo.h>
+#include <qsavefile.h>
+#include <qthreadpool.h>
+#include <qurl.h>
+#include <qloggingcategory.h>
+
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(qLcSeekIndex, "qt.multimedia.ffmpeg.seekindex")
+
+QT_BEGIN_NAMESPACE
+
+namespace QFFmpeg
+{
+
+static constexpr quint32 CacheMagic = 0x51534b49; // "QSKI"
+static constexpr quint32 CacheVersion = 1;
+
+static bool lessThanPts(const SeekIndex::Entry &e, qint64 pts)
+{
+    return e.pts < pts;
+}
+
+void SeekIndex::addKeyframe(qint64 pts, qint64 pos)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), pts, lessThanPts);
+    if (it == entries.end() || it->pts != pts) {
+        it = entries.insert(it, { pts, pos, -1 });
+        modified = true;
+    } else if (it->pos < 0 && pos >= 0) {
+        it->pos = pos;
+        modified = true;
+    }
+
+    if (lastPts >= 0 && lastPts < pts && it != entries.begin()) {
+        auto previous = it - 1;
+        if (previous->pts == lastPts && previous->duration != pts - lastPts) {
+            previous->duration = pts - lastPts;
+            modified = true;
+        }
+    }
+    lastPts = pts;
+}
+
+std::optional<SeekIndex::Entry> SeekIndex::gopContaining(qint64 time) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), time + 1, lessThanPts);
+    if (it == entries.begin())
+        return {};
+    --it;
+    if (!it->contains(time))
+        return {};
+    return *it;
+}
+
+std::optional<SeekIndex::Entry> SeekIndex::nearestKeyframe(qint64 time) const
+{
+    if (entries.isEmpty())
+        return {};
+    auto it = std::lower_bound(entries.begin(), entries.end(), time, lessThanPts);
+    if (it == entries.end())
+        return entries.last();
+    if (it == entries.begin())
+        return *it;
+    auto previous = it - 1;
+    return (time - previous->pts <= it->pts - time) ? *previous : *it;
+}
+
+static QString cacheFileName(const char *url, QFileInfo *info)
+{
+    static const QString cacheDir = qEnvironmentVariable("QT_FFMPEG_SEEK_INDEX_CACHE");
+    if (cacheDir.isEmpty() || !url)
+        return {};
+
+    QString path = QString::fromUtf8(url);
+    if (path.startsWith(QLatin1String("file:")))
+        path = QUrl(path).toLocalFile();
+    *info = QFileInfo(path);
+    if (!info->isFile())
+        return {};
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info->absoluteFilePath().toUtf8());
+    return QDir(cacheDir).filePath(QString::fromLatin1(hash.result().toHex()) + QLatin1String(".seekindex"));
+}
+
+void SeekIndex::load(const AVFormatContext *context)
+{
+    QFileInfo info;
+    const QString fileName = cacheFileName(context->url, &info);
+    if (fileName.isEmpty())
+        return;
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return;
+    QDataStream stream(&file);
+    quint32 magic = 0, version = 0;
+    qint64 size = 0, lastModified = 0;
+    stream >> magic >> version >> size >> lastModified;
+    // the file changed since the index was written
+    if (magic != CacheMagic || version != CacheVersion || size != info.size()
+        || lastModified != info.lastModified().toMSecsSinceEpoch())
+        return;
+
+    quint32 count = 0;
+    stream >> count;
+    // don't trust the count further than the file can hold entries
+    constexpr qint64 entrySize = 3*sizeof(qint64);
+    if (stream.status() != QDataStream::Ok || count > quint64(file.bytesAvailable()/entrySize))
+        return;
+    QList<Entry> cached;
+    cached.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Entry e;
+        stream >> e.pts >> e.pos >> e.duration;
+        cached.append(e);
+    }
+    // lookups rely on the entries being sorted by time, without duplicates
+    const auto notAscending = [](const Entry &a, const Entry &b) { return a.pts >= b.pts; };
+    if (stream.status() != QDataStream::Ok
+        || std::adjacent_find(cached.cbegin(), cached.cend(), notAscending) != cached.cend())
+        return;
+
+    entries = std::move(cached);
+    modified = false;
+    qCDebug(qLcSeekIndex) << "loaded" << entries.size() << "keyframes from" << fileName;
+}
+
+static void writeCache(const char *url, const QList<SeekIndex::Entry> &entries)
+{
+    QFileInfo info;
+    const QString fileName = cacheFileName(url, &info);
+    if (fileName.isEmpty())
+        return;
+
+    QDir().mkpath(QFileInfo(fileName).path());
+    QSaveFile file(fileName);
+    if (!file.open(QFile::WriteOnly))
+        return;
+    QDataStream stream(&file);
+    stream << CacheMagic << CacheVersion << qint64(info.size())
+           << qint64(info.lastModified().toMSecsSinceEpoch()) << quint32(entries.size());
+    for (const auto &e : entries)
+        stream << e.pts << e.pos << e.duration;
+    if (file.commit())
+        qCDebug(qLcSeekIndex) << "saved" << entries.size() << "keyframes to" << fileName;
+}
+
+void SeekIndex::save(const AVFormatContext *context) const
+{
+    if (modified && !entries.isEmpty())
+        writeCache(context->url, entries);
+}
+
+void SeekIndex::saveInBackground(const AVFormatContext *context) const
+{
+    if (!modified || entries.isEmpty() || !context->url)
+        return;
+    QThreadPool::globalInstance()->start([url = QByteArray(context->url), entries = entries]() {
+        writeCache(url.constData(), entries);
+    });
+}
+
+}
+
+QT_END_NAMESPACE
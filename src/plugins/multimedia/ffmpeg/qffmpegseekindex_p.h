@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QFFMPEGSEEKINDEX_P_H
+#define QFFMPEGSEEKINDEX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qffmpeg_p.h"
+#include <qlist.h>
+#include <qstring.h>
+
+#include <optional>
+
+QT_BEGIN_NAMESPACE
+
+namespace QFFmpeg
+{
+
+enum class SeekMode {
+    // decode from the preceding keyframe up to the requested position
+    Exact,
+    // continue at the keyframe closest to the requested position, for scrubbing
+    NearestKeyframe
+};
+
+// Keyframes of one stream, collected while demuxing. Unlike the index of the
+// container, it also knows how long each GOP is, so a seek can tell whether
+// the keyframe before the target is the right one to start decoding from.
+//
+// Not thread safe, the demuxer only accesses it with its mutex locked.
+class SeekIndex
+{
+public:
+    struct Entry {
+        // in microseconds
+        qint64 pts = 0;
+        // byte offset in the file, -1 if unknown
+        qint64 pos = -1;
+        // time until the next keyframe, -1 if it hasn't been demuxed yet
+        qint64 duration = -1;
+
+        bool contains(qint64 time) const
+        {
+            return time >= pts && duration >= 0 && time < pts + duration;
+        }
+    };
+
+    void addKeyframe(qint64 pts, qint64 pos);
+    // the next keyframe doesn't follow the previous one, e.g. after a seek
+    void setDiscontinuity() { lastPts = -1; }
+
+    // the keyframe of the GOP containing time, if the whole GOP is known
+    std::optional<Entry> gopContaining(qint64 time) const;
+    // the keyframe closest to time, if any is known
+    std::optional<Entry> nearestKeyframe(qint64 time) const;
+
+    qsizetype size() const { return entries.size(); }
+
+    // Persists the index in the directory given by QT_FFMPEG_SEEK_INDEX_CACHE,
+    // for local files only.
+    void load(const AVFormatContext *context);
+    void save(const AVFormatContext *context) const;
+    // writes a copy of the index from a thread pool thread
+    void saveInBackground(const AVFormatContext *context) const;
+
+private:
+    QList<Entry> entries;
+    qint64 lastPts = -1;
+    bool modified = false;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif // QFFMPEGSEEKINDEX_P_H
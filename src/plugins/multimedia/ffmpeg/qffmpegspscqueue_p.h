@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#ifndef QFFMPEGSPSCQUEUE_P_H
+#define QFFMPEGSPSCQUEUE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API. It exists purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qatomic.h>
+
+#include <memory>
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+
+namespace QFFmpeg
+{
+
+// Bounded single producer/single consumer ring buffer.
+//
+// push() may only be called from one thread at a time (the producer), peek() and
+// pop() only from one other thread (the consumer). None of the operations
+// block or allocate, so the threads on both sides never contend on a lock.
+// Handing over the producer or consumer role to another thread is fine as long as
+// it happens through some other synchronization (e.g. a mutex both threads take).
+template<typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(quintptr minimumCapacity)
+    {
+        quintptr capacity = 2;
+        while (capacity < minimumCapacity)
+            capacity <<= 1;
+        m_mask = capacity - 1;
+        m_slots.reset(new T[capacity]);
+    }
+    Q_DISABLE_COPY(SpscQueue)
+
+    quintptr capacity() const { return m_mask + 1; }
+
+    // Can be called from any thread, the result is exact only on the producer
+    // or consumer side. Elements marked by discardQueued() are still counted
+    // until the consumer has dropped them.
+    quintptr size() const
+    {
+        // load the tail first, the head can only have moved further since
+        const quintptr tail = m_tail.loadAcquire();
+        return m_head.loadAcquire() - tail;
+    }
+    bool isEmpty() const { return size() == 0; }
+    bool isFull() const { return size() > m_mask; }
+
+    // producer side
+    bool push(T &&value)
+    {
+        const quintptr head = m_head.loadRelaxed();
+        if (head - m_tail.loadAcquire() > m_mask)
+            return false;
+        m_slots[head & m_mask] = std::move(value);
+        m_head.storeRelease(head + 1);
+        return true;
+    }
+    bool push(const T &value)
+    {
+        T copy = value;
+        return push(std::move(copy));
+    }
+
+    // consumer side. The returned pointer stays valid until the next pop().
+    T *peek()
+    {
+        dropDiscarded();
+        const quintptr tail = m_tail.loadRelaxed();
+        if (tail == m_head.loadAcquire())
+            return nullptr;
+        m_peekedTail = tail;
+        return &m_slots[tail & m_mask];
+    }
+
+    // consumer side. Pops the element returned by the last peek(), unless it
+    // has been discarded in the meantime. Returns false in that case, so an
+    // element queued after the discard is never dropped unseen.
+    bool popPeeked()
+    {
+        dropDiscarded();
+        if (m_tail.loadRelaxed() != m_peekedTail)
+            return false;
+        return pop();
+    }
+
+    // consumer side
+    bool pop(T &value)
+    {
+        dropDiscarded();
+        const quintptr tail = m_tail.loadRelaxed();
+        if (tail == m_head.loadAcquire())
+            return false;
+        T &slot = m_slots[tail & m_mask];
+        value = std::move(slot);
+        slot = T();
+        m_tail.storeRelease(tail + 1);
+        m_peekedTail = NoPeek;
+        return true;
+    }
+    bool pop()
+    {
+        T value;
+        return pop(value);
+    }
+
+    // Marks everything that is currently queued as discarded. The elements are
+    // released by the consumer on its next call to peek() or pop(), so this
+    // can be called while the consumer is running. The producer must not run
+    // concurrently though, as it would race with reading the head.
+    void discardQueued()
+    {
+        m_discardMark.storeRelease(m_head.loadAcquire());
+    }
+
+private:
+    void dropDiscarded()
+    {
+        const quintptr mark = m_discardMark.loadAcquire();
+        quintptr tail = m_tail.loadRelaxed();
+        if (qintptr(mark - tail) <= 0)
+            return;
+        while (tail != mark) {
+            m_slots[tail & m_mask] = T();
+            ++tail;
+        }
+        m_tail.storeRelease(tail);
+    }
+
+    // keep the producer and consumer indices on different cache lines
+    alignas(64) QAtomicInteger<quintptr> m_head = 0;
+    alignas(64) QAtomicInteger<quintptr> m_tail = 0;
+    alignas(64) QAtomicInteger<quintptr> m_discardMark = 0;
+    quintptr m_mask = 0;
+    std::unique_ptr<T[]> m_slots;
+    // consumer side only
+    static constexpr quintptr NoPeek = ~quintptr(0);
+    quintptr m_peekedTail = NoPeek;
+};
+
+}
+
+QT_END_NAMESPACE
+
+#endif
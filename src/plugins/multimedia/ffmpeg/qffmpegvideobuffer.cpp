@@ -40,6 +40,7 @@
 #include "qffmpegvideobuffer_p.h"
 #include "private/qvideotexturehelper_p.h"
 #include "qffmpeghwaccel_p.h"
+#include "qffmpegscaler_p.h"
 
 extern "C" {
 #include <libavutil/pixdesc.h>
@@ -82,20 +83,13 @@ void QFFmpegVideoBuffer::convertSWFrame()
     if (pixelFormat != m_pixelFormat) {
         AVPixelFormat newFormat = toAVPixelFormat(m_pixelFormat);
         // convert the format into something we can handle
-        SwsContext *c = sws_getContext(swFrame->width, swFrame->height, AVPixelFormat(swFrame->format),
-                                       swFrame->width, swFrame->height, newFormat,
-                                       SWS_BICUBIC, nullptr, nullptr, nullptr);
-
-        AVFrame *newFrame = av_frame_alloc();
-        newFrame->width = swFrame->width;
-        newFrame->height = swFrame->height;
-        newFrame->format = newFormat;
-        av_frame_get_buffer(newFrame, 0);
-
-        sws_scale(c, swFrame->data, swFrame->linesize, 0, swFrame->height, newFrame->data, newFrame->linesize);
+        AVFrame *newFrame = QFFmpeg::Scaler::instance()->convert(swFrame, newFormat);
+        if (!newFrame)
+            return;
+        if (frame == swFrame)
+            frame = newFrame;
         av_frame_free(&swFrame);
         swFrame = newFrame;
-        sws_freeContext(c);
     }
 }
 
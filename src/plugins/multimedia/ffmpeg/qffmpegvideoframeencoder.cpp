@@ -304,7 +304,18 @@ bool VideoFrameEncoder::open()
 {
     AVDictionary *opts = nullptr;
     applyVideoEncoderOptions(d->settings, d->codec->name, d->codecContext, &opts);
+    if (d->keyFrameInterval > 0) {
+        // key frames only where the caller forces them, so that streams encoded from the same
+        // frames can be switched between at the same points
+        d->codecContext->gop_size = d->keyFrameInterval;
+        d->codecContext->keyint_min = d->keyFrameInterval;
+        av_dict_set(&opts, "sc_threshold", "0", 0);
+        av_dict_set(&opts, "forced-idr", "1", 0);
+        if (qstrcmp(d->codec->name, "libx265") == 0)
+            av_dict_set(&opts, "x265-params", "scenecut=0", 0);
+    }
     int res = avcodec_open2(d->codecContext, d->codec, &opts);
+    av_dict_free(&opts);
     if (res < 0) {
         avcodec_free_context(&d->codecContext);
         qWarning() << "Couldn't open codec for writing" << err2str(res);
@@ -327,6 +338,7 @@ int VideoFrameEncoder::sendFrame(AVFrame *frame)
     if (!frame)
         return avcodec_send_frame(d->codecContext, frame);
     auto pts = frame->pts;
+    auto pictType = frame->pict_type;
 
     if (d->downloadFromHW) {
         auto *f = av_frame_alloc();
@@ -379,6 +391,7 @@ int VideoFrameEncoder::sendFrame(AVFrame *frame)
 
     qCDebug(qLcVideoFrameEncoder) << "sending frame" << pts;
     frame->pts = pts;
+    frame->pict_type = pictType;
     int ret = avcodec_send_frame(d->codecContext, frame);
     av_frame_free(&frame);
     return ret;
@@ -78,6 +78,7 @@ class VideoFrameEncoder
         AVPixelFormat sourceSWFormat = AV_PIX_FMT_NONE;
         AVPixelFormat targetFormat = AV_PIX_FMT_NONE;
         AVPixelFormat targetSWFormat = AV_PIX_FMT_NONE;
+        int keyFrameInterval = 0;
         bool sourceFormatIsHWFormat = false;
         bool targetFormatIsHWFormat = false;
         bool downloadFromHW = false;
@@ -95,8 +96,12 @@ public:
 
     bool isNull() const { return !d; }
 
+    // Fixed GOP length without scene cut key frames, has to be set before open()
+    void setKeyFrameInterval(int frames) { if (d) d->keyFrameInterval = frames; }
+
     AVPixelFormat sourceFormat() const { return d ? d->sourceFormat : AV_PIX_FMT_NONE; }
     AVPixelFormat targetFormat() const { return d ? d->targetFormat : AV_PIX_FMT_NONE; }
+    int streamIndex() const { return d && d->stream ? d->stream->id : -1; }
 
     qint64 getPts(qint64 ms);
 
@@ -42,8 +42,11 @@
 #include <qdir.h>
 #include <qmutex.h>
 #include <qendian.h>
+#include <qvarlengtharray.h>
+#include <qthread.h>
 #include <private/qcameradevice_p.h>
 #include <private/qabstractvideobuffer_p.h>
+#include <private/qmemoryvideobuffer_p.h>
 #include <private/qvideotexturehelper_p.h>
 #include <private/qmultimediautils_p.h>
 #include <private/qplatformmediadevices_p.h>
@@ -55,6 +58,9 @@
 #include <fcntl.h>
 #include <private/qcore_unix_p.h>
 #include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <time.h>
 
 #include <linux/videodev2.h>
 
@@ -64,6 +70,13 @@ QT_BEGIN_NAMESPACE
 
 Q_LOGGING_CATEGORY(qLV4L2Camera, "qt.multimedia.ffmpeg.v4l2camera");
 
+static qint64 monotonicTimeUs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
 QV4L2CameraDevices::QV4L2CameraDevices(QPlatformMediaIntegration *integration)
     : QPlatformVideoDevices(integration)
 {
@@ -263,6 +276,11 @@ public:
     void unmap() override {
         m_mode = QVideoFrame::NotMapped;
     }
+    int dmaBufFileDescriptor(int plane) const override {
+        if (plane != 0 || d->v4l2FileDescriptor < 0 || index >= d->mappedBuffers.size())
+            return -1;
+        return d->mappedBuffers.at(index).dmaBufFd;
+    }
 
     QVideoFrame::MapMode m_mode = QVideoFrame::NotMapped;
     MapData data;
@@ -270,6 +288,61 @@ public:
     QExplicitlySharedDataPointer<QV4L2CameraBuffers> d;
 };
 
+// Waits for frames on the device and hands them to the consumers, so that
+// capturing isn't delayed by the event loop of the thread owning the camera.
+class QV4L2CaptureThread : public QThread
+{
+public:
+    QV4L2CaptureThread(QV4L2Camera *camera)
+        : camera(camera)
+    {
+        setObjectName(QLatin1String("V4L2Capture"));
+    }
+
+    void stop()
+    {
+        stopRequested.storeRelease(true);
+        quint64 value = 1;
+        qt_safe_write(camera->d->wakeupFd, &value, sizeof(value));
+        wait();
+    }
+
+protected:
+    void run() override
+    {
+        auto *d = camera->d.get();
+        while (!stopRequested.loadAcquire()) {
+            bool hasQueuedBuffers;
+            {
+                QMutexLocker locker(&d->mutex);
+                hasQueuedBuffers = d->queuedBuffers > 0;
+            }
+            // The driver reports an error on the device when no buffer is queued,
+            // so only wait on it if it can actually produce a frame.
+            pollfd fds[2] = {
+                { hasQueuedBuffers ? d->v4l2FileDescriptor : -1, POLLIN, 0 },
+                { d->wakeupFd, POLLIN, 0 }
+            };
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                qWarning() << "error polling the camera" << strerror(errno);
+                break;
+            }
+            if (fds[1].revents & POLLIN) {
+                quint64 value;
+                qt_safe_read(d->wakeupFd, &value, sizeof(value));
+            }
+            if ((fds[0].revents & (POLLIN | POLLERR)) && !camera->readFrame())
+                break;
+        }
+    }
+
+private:
+    QV4L2Camera *camera;
+    QAtomicInteger<bool> stopRequested = false;
+};
+
 QV4L2CameraBuffers::~QV4L2CameraBuffers()
 {
     QMutexLocker locker(&mutex);
@@ -277,14 +350,8 @@ QV4L2CameraBuffers::~QV4L2CameraBuffers()
     unmapBuffers();
 }
 
-
-
-void QV4L2CameraBuffers::release(int index)
+bool QV4L2CameraBuffers::queueBuffer(int index)
 {
-    QMutexLocker locker(&mutex);
-    if (v4l2FileDescriptor < 0 || index >= mappedBuffers.size())
-        return;
-
     struct v4l2_buffer buf = {};
 
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -292,19 +359,43 @@ void QV4L2CameraBuffers::release(int index)
     buf.index = index;
 
     if (ioctl(v4l2FileDescriptor, VIDIOC_QBUF, &buf) < 0)
+        return false;
+    if (++queuedBuffers == 1 && wakeupFd >= 0) {
+        quint64 value = 1;
+        qt_safe_write(wakeupFd, &value, sizeof(value));
+    }
+    return true;
+}
+
+void QV4L2CameraBuffers::release(int index)
+{
+    QMutexLocker locker(&mutex);
+    if (v4l2FileDescriptor < 0 || index >= mappedBuffers.size())
+        return;
+
+    if (!queueBuffer(index))
         qWarning() << "Couldn't release V4L2 buffer" << errno << strerror(errno) << index;
 }
 
 void QV4L2CameraBuffers::unmapBuffers()
 {
-    for (const auto &b : qAsConst(mappedBuffers))
+    for (const auto &b : qAsConst(mappedBuffers)) {
         munmap(b.data, b.size);
+        if (b.dmaBufFd >= 0)
+            qt_safe_close(b.dmaBufFd);
+    }
     mappedBuffers.clear();
+    queuedBuffers = 0;
 }
 
 QV4L2Camera::QV4L2Camera(QCamera *camera)
     : QPlatformCamera(camera)
 {
+    if (qEnvironmentVariableIsSet("QT_V4L2_BUFFER_COUNT"))
+        setBufferCount(qEnvironmentVariableIntValue("QT_V4L2_BUFFER_COUNT"));
+    if (qgetenv("QT_V4L2_FRAME_DROP_POLICY") == "drop-oldest")
+        m_frameDropPolicy = DropOldest;
+    m_dmaBufExport = qEnvironmentVariableIntValue("QT_V4L2_DMABUF") != 0;
 }
 
 QV4L2Camera::~QV4L2Camera()
@@ -319,6 +410,12 @@ bool QV4L2Camera::isActive() const
     return m_active;
 }
 
+void QV4L2Camera::setBufferCount(int count)
+{
+    // V4L2 needs at least two buffers to capture continuously
+    m_bufferCount = qMax(count, 2);
+}
+
 void QV4L2Camera::setActive(bool active)
 {
     if (m_active == active)
@@ -602,38 +699,101 @@ void QV4L2Camera::setColorTemperature(int temperature)
         colorTemperatureChanged(t);
 }
 
-void QV4L2Camera::readFrame()
+bool QV4L2Camera::readFrame()
 {
-    if (!d)
-        return;
+    // Dequeue all frames the driver has filled since the last notification, so
+    // the drop policy knows how far the consumers are behind.
+    QVarLengthArray<v4l2_buffer, 8> ready;
+    forever {
+        v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
 
-    v4l2_buffer buf = {};
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+        if (ioctl(d->v4l2FileDescriptor, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno == ENODEV) {
+                // camera got removed while being active
+                QMetaObject::invokeMethod(this, [this]() {
+                    stopCapturing();
+                    closeV4L2Fd();
+                }, Qt::QueuedConnection);
+                return false;
+            }
+            if (errno != EAGAIN)
+                qWarning() << "error calling VIDIOC_DQBUF" << errno << strerror(errno);
+            break;
+        }
 
-    if (ioctl(d->v4l2FileDescriptor, VIDIOC_DQBUF, &buf) < 0) {
-        if (errno == ENODEV) {
-            // camera got removed while being active
-            stopCapturing();
-            closeV4L2Fd();
-            return;
+        Q_ASSERT(buf.index < d->mappedBuffers.size());
+        {
+            QMutexLocker locker(&d->mutex);
+            --d->queuedBuffers;
+        }
+
+        // gaps in the sequence are frames the driver skipped for lack of a queued buffer
+        if (lastSequence >= 0 && buf.sequence > lastSequence + 1)
+            m_droppedFrames.fetchAndAddRelaxed(buf.sequence - lastSequence - 1);
+        lastSequence = buf.sequence;
+
+        ready.append(buf);
+    }
+
+    if (ready.isEmpty())
+        return true;
+
+    if (m_frameDropPolicy == DropOldest && ready.size() > 1) {
+        QMutexLocker locker(&d->mutex);
+        for (qsizetype i = 0; i < ready.size() - 1; ++i) {
+            if (!d->queueBuffer(ready.at(i).index))
+                qWarning() << "Couldn't requeue V4L2 buffer" << errno << strerror(errno);
         }
-        if (errno != EAGAIN)
-            qWarning() << "error calling VIDIOC_DQBUF" << errno << strerror(errno);
+        m_droppedFrames.fetchAndAddRelaxed(ready.size() - 1);
+        ready.remove(0, ready.size() - 1);
     }
 
-    Q_ASSERT(buf.index < d->mappedBuffers.size());
+    for (const auto &buf : qAsConst(ready))
+        processBuffer(buf);
+    return true;
+}
+
+void QV4L2Camera::processBuffer(const v4l2_buffer &buf)
+{
     int i = buf.index;
 
-//    auto textureDesc = QVideoTextureHelper::textureDescription(m_format.pixelFormat());
+    const qint64 dequeueTime = monotonicTimeUs();
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        qint64 age = dequeueTime - (qint64(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec);
+        if (age > m_maxDequeueLatency.loadRelaxed())
+            m_maxDequeueLatency.storeRelaxed(age);
+        if (frameDuration > 0 && age > frameDuration)
+            m_lateFrames.fetchAndAddRelaxed(1);
+    }
 
-    QV4L2VideoBuffer *buffer = new QV4L2VideoBuffer(d.get(), i);
-    buffer->data.nPlanes = 1;
-    buffer->data.bytesPerLine[0] = bytesPerLine;
-    buffer->data.data[0] = (uchar *)d->mappedBuffers.at(i).data;
-    buffer->data.size[0] = d->mappedBuffers.at(i).size;
     QVideoFrameFormat fmt(m_cameraFormat.resolution(), m_cameraFormat.pixelFormat());
     fmt.setColorSpace(colorSpace);
+
+    bool copy = false;
+    if (m_frameDropPolicy == DropOldest) {
+        // Don't hand out the driver's last buffer, or capturing stalls until the
+        // consumers release a frame.
+        QMutexLocker locker(&d->mutex);
+        copy = d->queuedBuffers == 0;
+    }
+
+    QAbstractVideoBuffer *buffer = nullptr;
+    if (copy) {
+        const auto &mapped = d->mappedBuffers.at(i);
+        QByteArray data(static_cast<const char *>(mapped.data),
+                        buf.bytesused ? qsizetype(buf.bytesused) : mapped.size);
+        buffer = new QMemoryVideoBuffer(data, bytesPerLine);
+        d->release(i);
+    } else {
+        auto *v4l2Buffer = new QV4L2VideoBuffer(d.get(), i);
+        v4l2Buffer->data.nPlanes = 1;
+        v4l2Buffer->data.bytesPerLine[0] = bytesPerLine;
+        v4l2Buffer->data.data[0] = (uchar *)d->mappedBuffers.at(i).data;
+        v4l2Buffer->data.size[0] = d->mappedBuffers.at(i).size;
+        buffer = v4l2Buffer;
+    }
 //    qCDebug(qLV4L2Camera) << "got a frame" << d->mappedBuffers.at(i).data << d->mappedBuffers.at(i).size << fmt << i;
     QVideoFrame frame(buffer, fmt);
 
@@ -645,6 +805,10 @@ void QV4L2Camera::readFrame()
     frame.setEndTime(frame.startTime() + frameDuration);
 
     emit newVideoFrame(frame);
+
+    qint64 delivery = monotonicTimeUs() - dequeueTime;
+    if (delivery > m_maxDeliveryLatency.loadRelaxed())
+        m_maxDeliveryLatency.storeRelaxed(delivery);
 }
 
 void QV4L2Camera::setCameraBusy()
@@ -671,7 +835,7 @@ void QV4L2Camera::initV4L2Controls()
 
     d = new QV4L2CameraBuffers;
 
-    d->v4l2FileDescriptor = qt_safe_open(deviceName.constData(), O_RDWR);
+    d->v4l2FileDescriptor = qt_safe_open(deviceName.constData(), O_RDWR | O_NONBLOCK);
     if (d->v4l2FileDescriptor == -1) {
         qWarning() << "Unable to open the camera" << deviceName
                    << "for read to query the parameter info:" << qt_error_string(errno);
@@ -885,7 +1049,7 @@ void QV4L2Camera::initMMap()
         return;
 
     v4l2_requestbuffers req = {};
-    req.count = 4;
+    req.count = m_bufferCount;
     req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
 
@@ -922,9 +1086,21 @@ void QV4L2Camera::initMMap()
             return;
         }
 
+        if (m_dmaBufExport) {
+            v4l2_exportbuffer expbuf = {};
+            expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            expbuf.index = n;
+            expbuf.flags = O_RDONLY | O_CLOEXEC;
+            if (ioctl(d->v4l2FileDescriptor, VIDIOC_EXPBUF, &expbuf) == 0)
+                buffer.dmaBufFd = expbuf.fd;
+            else
+                qCDebug(qLV4L2Camera) << "exporting buffer" << n << "as DMA buffer failed" << strerror(errno);
+        }
+
         d->mappedBuffers.append(buffer);
     }
 
+    qCDebug(qLV4L2Camera) << "mapped" << d->mappedBuffers.size() << "buffers, requested" << m_bufferCount;
 }
 
 void QV4L2Camera::stopCapturing()
@@ -932,8 +1108,24 @@ void QV4L2Camera::stopCapturing()
     if (!d)
         return;
 
-    delete notifier;
-    notifier = nullptr;
+    if (captureThread) {
+        captureThread->stop();
+        delete captureThread;
+        captureThread = nullptr;
+    }
+    {
+        QMutexLocker locker(&d->mutex);
+        if (d->wakeupFd >= 0) {
+            qt_safe_close(d->wakeupFd);
+            d->wakeupFd = -1;
+        }
+    }
+
+    if (lastSequence >= 0) {
+        qCDebug(qLV4L2Camera) << "stopped capturing," << droppedFrames() << "frames dropped,"
+                              << lateFrames() << "late, max. latency" << maxDequeueLatency()
+                              << "us dequeuing," << maxDeliveryLatency() << "us delivering";
+    }
 
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
@@ -941,6 +1133,11 @@ void QV4L2Camera::stopCapturing()
         if (errno != ENODEV)
             qWarning() << "failed to stop capture";
     }
+    {
+        // STREAMOFF dequeues all buffers, startCapturing() queues them again
+        QMutexLocker locker(&d->mutex);
+        d->queuedBuffers = 0;
+    }
     cameraBusy = false;
 }
 
@@ -950,27 +1147,33 @@ void QV4L2Camera::startCapturing()
         return;
 
     // #### better to use the user data method instead of mmap???
-    unsigned int i;
-
-    for (i = 0; i < d->mappedBuffers.size(); ++i) {
-        v4l2_buffer buf = {};
-        buf.index = i;
-        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-        buf.memory = V4L2_MEMORY_MMAP;
-
-        if (ioctl(d->v4l2FileDescriptor, VIDIOC_QBUF, &buf) < 0) {
-            qWarning() << "failed to setup mapped buffer";
-            return;
+    {
+        QMutexLocker locker(&d->mutex);
+        for (int i = 0; i < d->mappedBuffers.size(); ++i) {
+            if (!d->queueBuffer(i)) {
+                qWarning() << "failed to setup mapped buffer";
+                return;
+            }
         }
     }
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (ioctl(d->v4l2FileDescriptor, VIDIOC_STREAMON, &type) < 0)
         qWarning() << "failed to start capture";
 
-    notifier = new QSocketNotifier(d->v4l2FileDescriptor, QSocketNotifier::Read);
-    connect(notifier, &QSocketNotifier::activated, this, &QV4L2Camera::readFrame);
-
     firstFrameTime = { -1, -1 };
+    lastSequence = -1;
+    m_droppedFrames.storeRelaxed(0);
+    m_lateFrames.storeRelaxed(0);
+    m_maxDequeueLatency.storeRelaxed(0);
+    m_maxDeliveryLatency.storeRelaxed(0);
+
+    d->wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (d->wakeupFd < 0) {
+        qWarning() << "failed to create the capture wakeup fd" << strerror(errno);
+        return;
+    }
+    captureThread = new QV4L2CaptureThread(this);
+    captureThread->start(QThread::TimeCriticalPriority);
 }
 
 QT_END_NAMESPACE
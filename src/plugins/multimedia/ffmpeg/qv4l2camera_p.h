@@ -56,9 +56,10 @@
 #include <private/qplatformmediaintegration_p.h>
 
 #include <qfilesystemwatcher.h>
-#include <qsocketnotifier.h>
 #include <qmutex.h>
 
+struct v4l2_buffer;
+
 QT_BEGIN_NAMESPACE
 
 class QV4L2CameraDevices : public QObject,
@@ -85,6 +86,7 @@ struct QV4L2CameraBuffers
 public:
     ~QV4L2CameraBuffers();
 
+    bool queueBuffer(int index);
     void release(int index);
     void unmapBuffers();
 
@@ -93,11 +95,19 @@ public:
     struct MappedBuffer {
         void *data;
         qsizetype size;
+        int dmaBufFd = -1;
     };
     QList<MappedBuffer> mappedBuffers;
     int v4l2FileDescriptor = -1;
+    // number of buffers currently queued to the driver, protected by mutex
+    int queuedBuffers = 0;
+    // eventfd waking up the capture thread, signalled when the driver gets a
+    // buffer back after running dry
+    int wakeupFd = -1;
 };
 
+class QV4L2CaptureThread;
+
 class Q_MULTIMEDIA_EXPORT QV4L2Camera : public QPlatformCamera
 {
     Q_OBJECT
@@ -141,11 +151,44 @@ public:
 
     void releaseBuffer(int index);
 
-private Q_SLOTS:
-    void readFrame();
+    enum FrameDropPolicy {
+        // Deliver every captured frame. If consumers hold on to all buffers,
+        // capturing stalls until one of them is released.
+        BlockWhenFull,
+        // Always deliver the newest frame. Frames that queued up are dropped, and
+        // the last free buffer is copied instead of handed out, so capturing
+        // never stalls.
+        DropOldest
+    };
+
+    // The settings take effect the next time the device is opened. Defaults can be
+    // set with the QT_V4L2_BUFFER_COUNT, QT_V4L2_FRAME_DROP_POLICY (block or
+    // drop-oldest) and QT_V4L2_DMABUF environment variables.
+    void setBufferCount(int count);
+    int bufferCount() const { return m_bufferCount; }
+    void setFrameDropPolicy(FrameDropPolicy policy) { m_frameDropPolicy = policy; }
+    FrameDropPolicy frameDropPolicy() const { return m_frameDropPolicy; }
+    void setDmaBufExportEnabled(bool enabled) { m_dmaBufExport = enabled; }
+    bool isDmaBufExportEnabled() const { return m_dmaBufExport; }
+
+    // Frames lost since capturing started, either dropped by the policy or
+    // skipped by the driver because no buffer was queued.
+    quint64 droppedFrames() const { return m_droppedFrames.loadRelaxed(); }
+    // Frames that waited longer than a frame period before being delivered.
+    quint64 lateFrames() const { return m_lateFrames.loadRelaxed(); }
+    // Maximum latencies since capturing started in microseconds: from the kernel
+    // timestamp until the frame got dequeued, and from dequeuing until all
+    // consumers took the frame.
+    qint64 maxDequeueLatency() const { return m_maxDequeueLatency.loadRelaxed(); }
+    qint64 maxDeliveryLatency() const { return m_maxDeliveryLatency.loadRelaxed(); }
 
 private:
+    friend class QV4L2CaptureThread;
+
+    // called on the capture thread, returns false if capturing has to stop
+    bool readFrame();
     void setCameraBusy();
+    void processBuffer(const v4l2_buffer &buf);
 
     bool m_active = false;
 
@@ -162,9 +205,18 @@ private:
     void startCapturing();
     void stopCapturing();
 
-    QSocketNotifier *notifier = nullptr;
+    QV4L2CaptureThread *captureThread = nullptr;
     QExplicitlySharedDataPointer<QV4L2CameraBuffers> d;
 
+    int m_bufferCount = 4;
+    FrameDropPolicy m_frameDropPolicy = BlockWhenFull;
+    bool m_dmaBufExport = false;
+    QAtomicInteger<quint64> m_droppedFrames = 0;
+    QAtomicInteger<quint64> m_lateFrames = 0;
+    QAtomicInteger<qint64> m_maxDequeueLatency = 0;
+    QAtomicInteger<qint64> m_maxDeliveryLatency = 0;
+    qint64 lastSequence = -1;
+
     bool v4l2AutoWhiteBalanceSupported = false;
     bool v4l2ColorTemperatureSupported = false;
     bool v4l2AutoExposureSupported = false;
@@ -73,4 +73,17 @@ int ResonanceAudio::getAmbisonicOutput(const float *buffers[], const float *reve
     return buffer->num_frames();
 }
 
+float ResonanceAudio::sourceAudibility(int sourceId) const
+{
+    const SourceParameters *parameters = impl->GetSourceParameters(sourceId);
+    if (!parameters)
+        return 0.f;
+    return parameters->attenuations[AttenuationType::kDirect] + parameters->attenuations[AttenuationType::kReflections];
+}
+
+void ResonanceAudio::setParallelExecutor(ParallelExecutor *executor)
+{
+    impl->SetParallelExecutor(executor);
+}
+
 }
@@ -44,6 +44,7 @@ namespace vraudio
 
 class ResonanceAudioExtensions;
 class ResonanceAudioApiImpl;
+class ParallelExecutor;
 
 class EXPORT_API ResonanceAudio
 {
@@ -55,6 +56,14 @@ public:
     // decoder will then add it to the generated surround signal.
     int getAmbisonicOutput(const float *buffers[], const float *reverb[], int nChannels);
 
+    // Distributes the processing of the sound sources over the threads of executor.
+    // Must not be called while audio is being processed.
+    void setParallelExecutor(ParallelExecutor *executor);
+
+    // The gain with which the direct sound and reflections of a sound object reach
+    // the listener, as of the last processed buffer. Only call from the audio thread.
+    float sourceAudibility(int sourceId) const;
+
     ResonanceAudioApi *api = nullptr;
     ResonanceAudioApiImpl *impl = nullptr;
     bool roomEffectsEnabled = true;
@@ -131,7 +131,8 @@ int QAmbientSound::loops() const
 
 void QAmbientSound::setLoops(int loops)
 {
-    int oldLoops = d->m_loops.fetchAndStoreRelaxed(loops);
+    int oldLoops = d->m_loops.loadRelaxed();
+    d->setLoops(loops);
     if (oldLoops != loops)
         emit loopsChanged();
 }
@@ -156,6 +157,37 @@ void QAmbientSound::setAutoPlay(bool autoPlay)
         emit autoPlayChanged();
 }
 
+/*!
+   \property QAmbientSound::streaming
+
+    Determines whether the sound file is decoded while playing instead of
+    being decoded completely up front.
+
+    In streaming mode, only a small amount of decoded audio is kept in memory,
+    independent of the length of the file. Looping restarts decoding from the
+    beginning of the file. This is well suited for long sounds such as background
+    music. Short sounds that are played by many sources should not be streamed,
+    as their decoded data is shared between all sources playing the same file.
+
+    Changing this property reloads the source.
+
+    The default value is \c false.
+ */
+bool QAmbientSound::streaming() const
+{
+    return d->streaming;
+}
+
+void QAmbientSound::setStreaming(bool streaming)
+{
+    if (d->streaming == streaming)
+        return;
+    d->streaming = streaming;
+    if (!d->url.isEmpty())
+        d->load();
+    emit streamingChanged();
+}
+
 /*!
     Starts playing back the sound. Does nothing if the sound is already playing.
  */
@@ -188,11 +220,14 @@ void QAmbientSound::setEngine(QAudioEngine *engine)
 {
     if (d->engine == engine)
         return;
-    auto *ep = QAudioEnginePrivate::get(engine);
+    auto *ep = QAudioEnginePrivate::get(d->engine);
 
     if (ep)
         ep->removeStereoSound(this);
     d->engine = engine;
+    // decoded data is cached per engine, so we need to fetch it again
+    if (!d->url.isEmpty())
+        d->load();
 
     ep = QAudioEnginePrivate::get(engine);
     if (ep) {
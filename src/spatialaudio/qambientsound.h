@@ -54,6 +54,7 @@ class Q_SPATIALAUDIO_EXPORT QAmbientSound : public QObject
     Q_PROPERTY(float volume READ volume WRITE setVolume NOTIFY volumeChanged)
     Q_PROPERTY(int loops READ loops WRITE setLoops NOTIFY loopsChanged)
     Q_PROPERTY(bool autoPlay READ autoPlay WRITE setAutoPlay NOTIFY autoPlayChanged)
+    Q_PROPERTY(bool streaming READ streaming WRITE setStreaming NOTIFY streamingChanged)
 
 public:
     explicit QAmbientSound(QAudioEngine *engine);
@@ -75,6 +76,9 @@ public:
     bool autoPlay() const;
     void setAutoPlay(bool autoPlay);
 
+    bool streaming() const;
+    void setStreaming(bool streaming);
+
     void setVolume(float volume);
     float volume() const;
 
@@ -84,6 +88,7 @@ Q_SIGNALS:
     void sourceChanged();
     void loopsChanged();
     void autoPlayChanged();
+    void streamingChanged();
     void volumeChanged();
 
 public Q_SLOTS:
@@ -109,78 +109,160 @@ static const QAmbisonicDecoderData decoderMap[] =
     }
 };
 
-// Implements a split second order IIR filter
-// The audio data is split into a phase synced low and high frequency part
-// This allows us to apply different factors to both parts for better sound
-// localization when converting from ambisonic formats
-//
-// Details are described in https://ambisonics.dreamhosters.com/BLaH3.pdf, Appendix A.2.
-class QAmbisonicDecoderFilter
+void QAmbisonicDecoderFilter::configure(float sampleRate, float cutoffFrequency)
+{
+    double k = tan(M_PI*cutoffFrequency/sampleRate);
+    a1 = float(2.*(k*k - 1.)/(k*k + 2*k + 1.));
+    a2 = float((k*k - 2*k + 1.)/(k*k + 2*k + 1.));
+
+    b0_lf = float(k*k/(k*k + 2*k + 1));
+    b1_lf = 2.f*b0_lf;
+
+    b0_hf = float(1./(k*k + 2*k + 1));
+    b1_hf = -2.f*b0_hf;
+}
+
+namespace QAmbisonicDecoderKernels
+{
+
+static void QT_FASTCALL filter_generic(QAmbisonicDecoderFilter &f, const float *input, float *lf, float *hf,
+                                       int channelStride, int nSamples)
 {
-public:
-    QAmbisonicDecoderFilter() = default;
-    void configure(float sampleRate, float cutoffFrequency = 380)
-    {
-        double k = tan(M_PI*cutoffFrequency/sampleRate);
-        a1 = float(2.*(k*k - 1.)/(k*k + 2*k + 1.));
-        a2 = float((k*k - 2*k + 1.)/(k*k + 2*k + 1.));
-
-        b0_lf = float(k*k/(k*k + 2*k + 1));
-        b1_lf = 2.f*b0_lf;
-
-        b0_hf = float(1./(k*k + 2*k + 1));
-        b1_hf = -2.f*b0_hf;
+    for (int i = 0; i < nSamples; ++i) {
+        for (int j = 0; j < channelStride; ++j) {
+            const float x = input[j];
+            float r_lf = x*f.b0_lf +
+                      f.prevX[0][j]*f.b1_lf +
+                      f.prevX[1][j]*f.b0_lf -
+                      f.prevR_lf[0][j]*f.a1 -
+                      f.prevR_lf[1][j]*f.a2;
+            float r_hf = x*f.b0_hf +
+                      f.prevX[0][j]*f.b1_hf +
+                      f.prevX[1][j]*f.b0_hf -
+                      f.prevR_hf[0][j]*f.a1 -
+                      f.prevR_hf[1][j]*f.a2;
+            f.prevX[1][j] = f.prevX[0][j];
+            f.prevX[0][j] = x;
+            f.prevR_lf[1][j] = f.prevR_lf[0][j];
+            f.prevR_lf[0][j] = r_lf;
+            f.prevR_hf[1][j] = f.prevR_hf[0][j];
+            f.prevR_hf[0][j] = r_hf;
+            lf[j] = r_lf;
+            hf[j] = r_hf;
+        }
+        input += channelStride;
+        lf += channelStride;
+        hf += channelStride;
     }
+}
 
-    struct Output
-    {
-        float lf;
-        float hf;
-    };
-
-    Output next(float x)
-    {
-        float r_lf = x*b0_lf +
-                  prevX[0]*b1_lf +
-                  prevX[1]*b0_lf -
-                  prevR_lf[0]*a1 -
-                  prevR_lf[1]*a2;
-        float r_hf = x*b0_hf +
-                  prevX[0]*b1_hf +
-                  prevX[1]*b0_hf -
-                  prevR_hf[0]*a1 -
-                  prevR_hf[1]*a2;
-        prevX[1] = prevX[0];
-        prevX[0] = x;
-        prevR_lf[1] = prevR_lf[0];
-        prevR_lf[0] = r_lf;
-        prevR_hf[1] = prevR_hf[0];
-        prevR_hf[0] = r_hf;
-        return { r_lf, r_hf };
+static void QT_FASTCALL decode_generic(const float *lf, const float *hf, int channelStride, int nInputChannels,
+                                       const float *matrixLf, const float *matrixHf,
+                                       const float *reverb0, const float *reverb1, const float *reverbFactors,
+                                       float *output, int nSamples)
+{
+    for (int i = 0; i < nSamples; ++i) {
+        float o[maxOutputChannels] = {};
+        for (int j = 0; j < nInputChannels; ++j) {
+            for (int k = 0; k < maxOutputChannels; ++k)
+                o[k] += matrixLf[j*maxOutputChannels + k]*lf[j];
+        }
+        if (matrixHf) {
+            for (int j = 0; j < nInputChannels; ++j) {
+                for (int k = 0; k < maxOutputChannels; ++k)
+                    o[k] += matrixHf[j*maxOutputChannels + k]*hf[j];
+            }
+        }
+        if (reverb0) {
+            for (int k = 0; k < maxOutputChannels; ++k)
+                o[k] += reverb0[i]*reverbFactors[k] + reverb1[i]*reverbFactors[maxOutputChannels + k];
+        }
+        memcpy(output, o, sizeof(o));
+        lf += channelStride;
+        hf += channelStride;
+        output += maxOutputChannels;
     }
+}
 
-private:
-    float a1 = 0.;
-    float a2 = 0.;
+static void QT_FASTCALL convertToInt16_generic(const float *input, short *output, int nOutputChannels, int nSamples)
+{
+    for (int i = 0; i < nSamples; ++i) {
+        for (int k = 0; k < nOutputChannels; ++k)
+            output[k] = static_cast<short>(qBound(-32768.f, input[k]*32768.f, 32767.f));
+        input += maxOutputChannels;
+        output += nOutputChannels;
+    }
+}
 
-    float b0_hf = 0.;
-    float b1_hf = 0.;
+const Kernels &genericKernels()
+{
+    static const Kernels k = { filter_generic, decode_generic, convertToInt16_generic };
+    return k;
+}
 
-    float b0_lf = 0.;
-    float b1_lf = 0.;
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+extern const Kernels &sse2Kernels();
+#endif
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+extern const Kernels &avx2Kernels();
+#endif
+#if defined(__ARM_NEON__)
+extern const Kernels &neonKernels();
+#endif
+
+static const Kernels &selectKernels()
+{
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+    if (qCpuHasFeature(AVX2) && qCpuHasFeature(FMA))
+        return avx2Kernels();
+#endif
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+    if (qCpuHasFeature(SSE2))
+        return sse2Kernels();
+#endif
+#if defined(__ARM_NEON__)
+    if (qCpuHasFeature(NEON))
+        return neonKernels();
+#endif
+    return genericKernels();
+}
 
-    float prevX[2] = {};
-    float prevR_lf[2] = {};
-    float prevR_hf[2] = {};
-};
+const Kernels &kernels()
+{
+    static const Kernels &k = selectKernels();
+    return k;
+}
 
+QList<NamedKernels> simdKernels()
+{
+    QList<NamedKernels> result;
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+    if (qCpuHasFeature(AVX2) && qCpuHasFeature(FMA))
+        result.append({ "avx2", &avx2Kernels() });
+#endif
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+    if (qCpuHasFeature(SSE2))
+        result.append({ "sse2", &sse2Kernels() });
+#endif
+#if defined(__ARM_NEON__)
+    if (qCpuHasFeature(NEON))
+        result.append({ "neon", &neonKernels() });
+#endif
+    return result;
+}
+
+}
 
 QAmbisonicDecoder::QAmbisonicDecoder(AmbisonicLevel ambisonicLevel, const QAudioFormat &format)
     : level(ambisonicLevel)
+    , kernels(&QAmbisonicDecoderKernels::kernels())
 {
+    using QAmbisonicDecoderKernels::maxOutputChannels;
+
     Q_ASSERT(level > 0 && level <= 3);
     inputChannels = (level+1)*(level+1);
     outputChannels = format.channelCount();
+    channelStride = (inputChannels + 3) & ~3;
 
     channelConfig = format.channelConfig();
     if (channelConfig == QAudioFormat::ChannelConfigUnknown)
@@ -200,95 +282,101 @@ QAmbisonicDecoder::QAmbisonicDecoder(AmbisonicLevel ambisonicLevel, const QAudio
         // Left and right channels get 50% W and 50% X
         // Center gets 50% W and 50% Y
         // LFE gets 50% W
-        simpleDecoderFactors = new float[4*outputChannels];
-        float *r = new float[2*outputChannels]; // reverb output is in stereo
-        float *f = simpleDecoderFactors;
-        reverbFactors = r;
-        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::FrontLeft)) {
-            f[0] = 0.5f; f[1] = 0.5f; f[2] = 0.; f[3] = 0.f;
-            f += 4;
-            r[0] = 1.; r[1] = 0.;
-            r += 2;
-        }
-        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::FrontRight)) {
-            f[0] = 0.5f; f[1] = -0.5f; f[2] = 0.; f[3] = 0.f;
-            f += 4;
-            r[0] = 0.; r[1] = 1.;
-            r += 2;
-        }
-        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::FrontCenter)) {
-            f[0] = 0.5f; f[1] = -0.f; f[2] = 0.; f[3] = 0.5f;
-            f += 4;
-            r[0] = .5; r[1] = .5;
-            r += 2;
-        }
-        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::LFE)) {
-            f[0] = 0.5f; f[1] = -0.f; f[2] = 0.; f[3] = 0.0f;
-            f += 4;
-            r[0] = 0.; r[1] = 0.;
-            r += 2;
-        }
-        Q_UNUSED(f);
-        Q_UNUSED(r);
-        Q_ASSERT((f - simpleDecoderFactors) == 4*outputChannels);
-        Q_ASSERT((r - reverbFactors) == 2*outputChannels);
-
+        simpleDecoder = true;
+        channelStride = 4;
+        int k = 0;
+        auto setFactors = [&](float w, float x, float y, float z, float reverbLeft, float reverbRight) {
+            matrixLf[0*maxOutputChannels + k] = w;
+            matrixLf[1*maxOutputChannels + k] = x;
+            matrixLf[2*maxOutputChannels + k] = y;
+            matrixLf[3*maxOutputChannels + k] = z;
+            reverbFactors[k] = reverbLeft; // reverb output is in stereo
+            reverbFactors[maxOutputChannels + k] = reverbRight;
+            ++k;
+        };
+        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::FrontLeft))
+            setFactors(0.5f, 0.5f, 0.f, 0.f, 1.f, 0.f);
+        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::FrontRight))
+            setFactors(0.5f, -0.5f, 0.f, 0.f, 0.f, 1.f);
+        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::FrontCenter))
+            setFactors(0.5f, -0.f, 0.f, 0.5f, .5f, .5f);
+        if (channelConfig & QAudioFormat::channelConfig(QAudioFormat::LFE))
+            setFactors(0.5f, -0.f, 0.f, 0.f, 0.f, 0.f);
+        Q_ASSERT(k == outputChannels);
         return;
     }
 
+    const QAmbisonicDecoderData *decoderData = nullptr;
     for (const auto &d : decoderMap) {
         if (d.config == channelConfig) {
             decoderData = &d;
-            reverbFactors = decoderData->reverb;
             break;
         }
     }
-    if (!decoderData) {
+    if (!decoderData || outputChannels > maxOutputChannels) {
         // can't handle this,
         outputChannels = 0;
         return;
     }
 
-    filters = new QAmbisonicDecoderFilter[inputChannels];
-    for (int i = 0; i < inputChannels; ++i)
-        filters[i].configure(format.sampleRate());
+    const float *matrix_hi = decoderData->hf[level - 1];
+    const float *matrix_lo = decoderData->lf[level - 1];
+    for (int k = 0; k < outputChannels; ++k) {
+        for (int j = 0; j < inputChannels; ++j) {
+            matrixLf[j*maxOutputChannels + k] = matrix_lo[k*inputChannels + j];
+            matrixHf[j*maxOutputChannels + k] = matrix_hi[k*inputChannels + j];
+        }
+        reverbFactors[k] = decoderData->reverb[2*k];
+        reverbFactors[maxOutputChannels + k] = decoderData->reverb[2*k + 1];
+    }
+
+    filter.configure(format.sampleRate());
 }
 
-QAmbisonicDecoder::~QAmbisonicDecoder()
+QAmbisonicDecoder::~QAmbisonicDecoder() = default;
+
+// Decodes nSamples <= blockSize samples starting at offset into outputBlock
+void QAmbisonicDecoder::decodeBlock(const float *input[], const float *reverb[2], int offset, int nSamples)
 {
-    if (simpleDecoderFactors) {
-        delete simpleDecoderFactors;
-        delete reverbFactors;
+    Q_ASSERT(nSamples <= blockSize);
+    const int channels = simpleDecoder ? 4 : inputChannels;
+
+    // convert to sample major order, the padding channels stay zero
+    for (int j = 0; j < channels; ++j) {
+        const float *in = input[j] + offset;
+        float *out = inputBlock + j;
+        for (int i = 0; i < nSamples; ++i)
+            out[i*channelStride] = in[i];
+    }
+
+    const float *reverb0 = reverb[0] ? reverb[0] + offset : nullptr;
+    const float *reverb1 = reverb[0] ? reverb[1] + offset : nullptr;
+    if (simpleDecoder) {
+        kernels->decode(inputBlock, nullptr, channelStride, channels, matrixLf, nullptr,
+                        reverb0, reverb1, reverbFactors, outputBlock, nSamples);
+    } else {
+        kernels->filter(filter, inputBlock, lfBlock, hfBlock, channelStride, nSamples);
+        kernels->decode(lfBlock, hfBlock, channelStride, channels, matrixLf, matrixHf,
+                        reverb0, reverb1, reverbFactors, outputBlock, nSamples);
     }
 }
 
 void QAmbisonicDecoder::processBuffer(const float *input[], float *output, int nSamples)
 {
-    float *o = output;
-    memset(o, 0, nSamples*outputChannels*sizeof(float));
-
-    if (simpleDecoderFactors) {
-        for (int i = 0; i < nSamples; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                for (int k = 0; k < outputChannels; ++k)
-                    o[k] += simpleDecoderFactors[k*4 + j]*input[j][i];
-            }
-            o += outputChannels;
-        }
-        return;
-    }
+    const float *reverb[] = { nullptr, nullptr };
+    return processBufferWithReverb(input, reverb, output, nSamples);
+}
 
-    const float *matrix_hi = decoderData->hf[level - 1];
-    const float *matrix_lo = decoderData->lf[level - 1];
-    for (int i = 0; i < nSamples; ++i) {
-        QAmbisonicDecoderFilter::Output buf[maxAmbisonicChannels];
-        for (int j = 0; j < inputChannels; ++j)
-            buf[j] = filters[j].next(input[j][i]);
-        for (int j = 0; j < inputChannels; ++j) {
-            for (int k = 0; k < outputChannels; ++k)
-                o[k] += matrix_lo[k*inputChannels + j]*buf[j].lf + matrix_hi[k*inputChannels + j]*buf[j].hf;
+void QAmbisonicDecoder::processBufferWithReverb(const float *input[], const float *reverb[], float *output, int nSamples)
+{
+    using QAmbisonicDecoderKernels::maxOutputChannels;
+    for (int offset = 0; offset < nSamples; offset += blockSize) {
+        const int n = qMin(blockSize, nSamples - offset);
+        decodeBlock(input, reverb, offset, n);
+        for (int i = 0; i < n; ++i) {
+            memcpy(output, outputBlock + i*maxOutputChannels, outputChannels*sizeof(float));
+            output += outputChannels;
         }
-        o += outputChannels;
     }
 }
 
@@ -300,49 +388,12 @@ void QAmbisonicDecoder::processBuffer(const float *input[], short *output, int n
 
 void QAmbisonicDecoder::processBufferWithReverb(const float *input[], const float *reverb[], short *output, int nSamples)
 {
-    if (simpleDecoderFactors) {
-        for (int i = 0; i < nSamples; ++i) {
-            float o[4] = {};
-            for (int k = 0; k < outputChannels; ++k) {
-                for (int j = 0; j < 4; ++j)
-                    o[k] += simpleDecoderFactors[k*4 + j]*input[j][i];
-            }
-            if (reverb[0]) {
-                for (int k = 0; k < outputChannels; ++k) {
-                    o[k] += reverb[0][i]*reverbFactors[2*k] + reverb[1][i]*reverbFactors[2*k+1];
-                }
-            }
-
-            for (int k = 0; k < outputChannels; ++k)
-                output[k] = static_cast<short>(o[k]*32768.);
-            output += outputChannels;
-        }
-        return;
+    for (int offset = 0; offset < nSamples; offset += blockSize) {
+        const int n = qMin(blockSize, nSamples - offset);
+        decodeBlock(input, reverb, offset, n);
+        kernels->convertToInt16(outputBlock, output, outputChannels, n);
+        output += n*outputChannels;
     }
-
-    //    qDebug() << "XXX" << inputChannels << outputChannels;
-    const float *matrix_hi = decoderData->hf[level - 1];
-    const float *matrix_lo = decoderData->lf[level - 1];
-    for (int i = 0; i < nSamples; ++i) {
-        QAmbisonicDecoderFilter::Output buf[maxAmbisonicChannels];
-        for (int j = 0; j < inputChannels; ++j)
-            buf[j] = filters[j].next(input[j][i]);
-        float o[32] = {}; // we can't support more than 32 channels from our API
-        for (int j = 0; j < inputChannels; ++j) {
-            for (int k = 0; k < outputChannels; ++k)
-                o[k] += matrix_lo[k*inputChannels + j]*buf[j].lf + matrix_hi[k*inputChannels + j]*buf[j].hf;
-        }
-        if (reverb[0]) {
-            for (int k = 0; k < outputChannels; ++k) {
-                o[k] += reverb[0][i]*reverbFactors[2*k] + reverb[1][i]*reverbFactors[2*k+1];
-            }
-        }
-        for (int k = 0; k < outputChannels; ++k)
-            output[k] = static_cast<short>(o[k]*32768.);
-        output += outputChannels;
-    }
-
 }
 
 QT_END_NAMESPACE
-
@@ -0,0 +1,184 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qambisonicdecoder_p.h"
+
+#ifdef QT_COMPILER_SUPPORTS_AVX2
+
+QT_BEGIN_NAMESPACE
+
+namespace QAmbisonicDecoderKernels
+{
+
+template<typename Vector, typename Ops>
+static void filterChannels(QAmbisonicDecoderFilter &f, const float *input, float *lf, float *hf,
+                           int channelStride, int j, int nSamples)
+{
+    const Vector a1 = Ops::set1(f.a1);
+    const Vector a2 = Ops::set1(f.a2);
+    const Vector b0_lf = Ops::set1(f.b0_lf);
+    const Vector b1_lf = Ops::set1(f.b1_lf);
+    const Vector b0_hf = Ops::set1(f.b0_hf);
+    const Vector b1_hf = Ops::set1(f.b1_hf);
+
+    Vector x1 = Ops::load(f.prevX[0] + j);
+    Vector x2 = Ops::load(f.prevX[1] + j);
+    Vector lf1 = Ops::load(f.prevR_lf[0] + j);
+    Vector lf2 = Ops::load(f.prevR_lf[1] + j);
+    Vector hf1 = Ops::load(f.prevR_hf[0] + j);
+    Vector hf2 = Ops::load(f.prevR_hf[1] + j);
+
+    for (int i = 0; i < nSamples; ++i) {
+        const int index = i*channelStride + j;
+        const Vector x = Ops::load(input + index);
+        const Vector xx2 = Ops::add(x, x2);
+        // r = (x + x2)*b0 + x1*b1 - lf1*a1 - lf2*a2
+        Vector r_lf = Ops::fmadd(x1, b1_lf, Ops::mul(xx2, b0_lf));
+        r_lf = Ops::fnmadd(lf1, a1, Ops::fnmadd(lf2, a2, r_lf));
+        Vector r_hf = Ops::fmadd(x1, b1_hf, Ops::mul(xx2, b0_hf));
+        r_hf = Ops::fnmadd(hf1, a1, Ops::fnmadd(hf2, a2, r_hf));
+        Ops::store(lf + index, r_lf);
+        Ops::store(hf + index, r_hf);
+        x2 = x1;
+        x1 = x;
+        lf2 = lf1;
+        lf1 = r_lf;
+        hf2 = hf1;
+        hf1 = r_hf;
+    }
+
+    Ops::store(f.prevX[0] + j, x1);
+    Ops::store(f.prevX[1] + j, x2);
+    Ops::store(f.prevR_lf[0] + j, lf1);
+    Ops::store(f.prevR_lf[1] + j, lf2);
+    Ops::store(f.prevR_hf[0] + j, hf1);
+    Ops::store(f.prevR_hf[1] + j, hf2);
+}
+
+struct Ops256
+{
+    static __m256 set1(float f) { return _mm256_set1_ps(f); }
+    // rows of the sample major blocks are only 16 byte aligned
+    static __m256 load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+    static __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+    static __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    static __m256 fmadd(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    static __m256 fnmadd(__m256 a, __m256 b, __m256 c) { return _mm256_fnmadd_ps(a, b, c); }
+};
+
+struct Ops128
+{
+    static __m128 set1(float f) { return _mm_set1_ps(f); }
+    static __m128 load(const float *p) { return _mm_load_ps(p); }
+    static void store(float *p, __m128 v) { _mm_store_ps(p, v); }
+    static __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+    static __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+    static __m128 fmadd(__m128 a, __m128 b, __m128 c) { return _mm_fmadd_ps(a, b, c); }
+    static __m128 fnmadd(__m128 a, __m128 b, __m128 c) { return _mm_fnmadd_ps(a, b, c); }
+};
+
+// Filters 8 channels at a time, and the remaining 4 for second order ambisonics
+static void QT_FASTCALL filter_avx2(QAmbisonicDecoderFilter &f, const float *input, float *lf, float *hf,
+                                    int channelStride, int nSamples)
+{
+    int j = 0;
+    for (; j + 8 <= channelStride; j += 8)
+        filterChannels<__m256, Ops256>(f, input, lf, hf, channelStride, j, nSamples);
+    if (j < channelStride)
+        filterChannels<__m128, Ops128>(f, input, lf, hf, channelStride, j, nSamples);
+}
+
+static void QT_FASTCALL decode_avx2(const float *lf, const float *hf, int channelStride, int nInputChannels,
+                                    const float *matrixLf, const float *matrixHf,
+                                    const float *reverb0, const float *reverb1, const float *reverbFactors,
+                                    float *output, int nSamples)
+{
+    static_assert(maxOutputChannels == 8, "one output sample has to fit into a __m256");
+    for (int i = 0; i < nSamples; ++i) {
+        __m256 o = _mm256_setzero_ps();
+        for (int j = 0; j < nInputChannels; ++j)
+            o = _mm256_fmadd_ps(_mm256_set1_ps(lf[j]), _mm256_load_ps(matrixLf + j*maxOutputChannels), o);
+        if (matrixHf) {
+            for (int j = 0; j < nInputChannels; ++j)
+                o = _mm256_fmadd_ps(_mm256_set1_ps(hf[j]), _mm256_load_ps(matrixHf + j*maxOutputChannels), o);
+        }
+        if (reverb0) {
+            o = _mm256_fmadd_ps(_mm256_set1_ps(reverb0[i]), _mm256_load_ps(reverbFactors), o);
+            o = _mm256_fmadd_ps(_mm256_set1_ps(reverb1[i]), _mm256_load_ps(reverbFactors + maxOutputChannels), o);
+        }
+        _mm256_store_ps(output, o);
+        lf += channelStride;
+        hf += channelStride;
+        output += maxOutputChannels;
+    }
+}
+
+static void QT_FASTCALL convertToInt16_avx2(const float *input, short *output, int nOutputChannels, int nSamples)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    for (int i = 0; i < nSamples; ++i) {
+        __m256 o = _mm256_mul_ps(_mm256_load_ps(input), scale);
+        o = _mm256_min_ps(_mm256_max_ps(o, min), max);
+        const __m256i v = _mm256_cvttps_epi32(o);
+        const __m128i s = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        if (nOutputChannels == maxOutputChannels) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output), s);
+        } else {
+            alignas(16) short tmp[maxOutputChannels];
+            _mm_store_si128(reinterpret_cast<__m128i *>(tmp), s);
+            memcpy(output, tmp, nOutputChannels*sizeof(short));
+        }
+        input += maxOutputChannels;
+        output += nOutputChannels;
+    }
+}
+
+const Kernels &avx2Kernels()
+{
+    static const Kernels k = { filter_avx2, decode_avx2, convertToInt16_avx2 };
+    return k;
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,151 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qambisonicdecoder_p.h"
+
+#if defined(__ARM_NEON__)
+
+QT_BEGIN_NAMESPACE
+
+namespace QAmbisonicDecoderKernels
+{
+
+// Filters 4 channels at a time, keeping their state in registers for the whole block
+static void QT_FASTCALL filter_neon(QAmbisonicDecoderFilter &f, const float *input, float *lf, float *hf,
+                                    int channelStride, int nSamples)
+{
+    for (int j = 0; j < channelStride; j += 4) {
+        float32x4_t x1 = vld1q_f32(f.prevX[0] + j);
+        float32x4_t x2 = vld1q_f32(f.prevX[1] + j);
+        float32x4_t lf1 = vld1q_f32(f.prevR_lf[0] + j);
+        float32x4_t lf2 = vld1q_f32(f.prevR_lf[1] + j);
+        float32x4_t hf1 = vld1q_f32(f.prevR_hf[0] + j);
+        float32x4_t hf2 = vld1q_f32(f.prevR_hf[1] + j);
+
+        for (int i = 0; i < nSamples; ++i) {
+            const int index = i*channelStride + j;
+            const float32x4_t x = vld1q_f32(input + index);
+            const float32x4_t xx2 = vaddq_f32(x, x2);
+            float32x4_t r_lf = vmlaq_n_f32(vmulq_n_f32(xx2, f.b0_lf), x1, f.b1_lf);
+            r_lf = vmlsq_n_f32(vmlsq_n_f32(r_lf, lf1, f.a1), lf2, f.a2);
+            float32x4_t r_hf = vmlaq_n_f32(vmulq_n_f32(xx2, f.b0_hf), x1, f.b1_hf);
+            r_hf = vmlsq_n_f32(vmlsq_n_f32(r_hf, hf1, f.a1), hf2, f.a2);
+            vst1q_f32(lf + index, r_lf);
+            vst1q_f32(hf + index, r_hf);
+            x2 = x1;
+            x1 = x;
+            lf2 = lf1;
+            lf1 = r_lf;
+            hf2 = hf1;
+            hf1 = r_hf;
+        }
+
+        vst1q_f32(f.prevX[0] + j, x1);
+        vst1q_f32(f.prevX[1] + j, x2);
+        vst1q_f32(f.prevR_lf[0] + j, lf1);
+        vst1q_f32(f.prevR_lf[1] + j, lf2);
+        vst1q_f32(f.prevR_hf[0] + j, hf1);
+        vst1q_f32(f.prevR_hf[1] + j, hf2);
+    }
+}
+
+static void QT_FASTCALL decode_neon(const float *lf, const float *hf, int channelStride, int nInputChannels,
+                                    const float *matrixLf, const float *matrixHf,
+                                    const float *reverb0, const float *reverb1, const float *reverbFactors,
+                                    float *output, int nSamples)
+{
+    for (int i = 0; i < nSamples; ++i) {
+        float32x4_t o0 = vdupq_n_f32(0.f);
+        float32x4_t o1 = vdupq_n_f32(0.f);
+        for (int j = 0; j < nInputChannels; ++j) {
+            o0 = vmlaq_n_f32(o0, vld1q_f32(matrixLf + j*maxOutputChannels), lf[j]);
+            o1 = vmlaq_n_f32(o1, vld1q_f32(matrixLf + j*maxOutputChannels + 4), lf[j]);
+        }
+        if (matrixHf) {
+            for (int j = 0; j < nInputChannels; ++j) {
+                o0 = vmlaq_n_f32(o0, vld1q_f32(matrixHf + j*maxOutputChannels), hf[j]);
+                o1 = vmlaq_n_f32(o1, vld1q_f32(matrixHf + j*maxOutputChannels + 4), hf[j]);
+            }
+        }
+        if (reverb0) {
+            o0 = vmlaq_n_f32(o0, vld1q_f32(reverbFactors), reverb0[i]);
+            o1 = vmlaq_n_f32(o1, vld1q_f32(reverbFactors + 4), reverb0[i]);
+            o0 = vmlaq_n_f32(o0, vld1q_f32(reverbFactors + maxOutputChannels), reverb1[i]);
+            o1 = vmlaq_n_f32(o1, vld1q_f32(reverbFactors + maxOutputChannels + 4), reverb1[i]);
+        }
+        vst1q_f32(output, o0);
+        vst1q_f32(output + 4, o1);
+        lf += channelStride;
+        hf += channelStride;
+        output += maxOutputChannels;
+    }
+}
+
+static void QT_FASTCALL convertToInt16_neon(const float *input, short *output, int nOutputChannels, int nSamples)
+{
+    const float32x4_t min = vdupq_n_f32(-32768.f);
+    const float32x4_t max = vdupq_n_f32(32767.f);
+    for (int i = 0; i < nSamples; ++i) {
+        float32x4_t o0 = vmulq_n_f32(vld1q_f32(input), 32768.f);
+        float32x4_t o1 = vmulq_n_f32(vld1q_f32(input + 4), 32768.f);
+        o0 = vminq_f32(vmaxq_f32(o0, min), max);
+        o1 = vminq_f32(vmaxq_f32(o1, min), max);
+        const int16x8_t s = vcombine_s16(vqmovn_s32(vcvtq_s32_f32(o0)), vqmovn_s32(vcvtq_s32_f32(o1)));
+        if (nOutputChannels == maxOutputChannels) {
+            vst1q_s16(output, s);
+        } else {
+            short tmp[maxOutputChannels];
+            vst1q_s16(tmp, s);
+            memcpy(output, tmp, nOutputChannels*sizeof(short));
+        }
+        input += maxOutputChannels;
+        output += nOutputChannels;
+    }
+}
+
+const Kernels &neonKernels()
+{
+    static const Kernels k = { filter_neon, decode_neon, convertToInt16_neon };
+    return k;
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif
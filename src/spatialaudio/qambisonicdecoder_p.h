@@ -50,13 +50,84 @@
 
 #include <qtspatialaudioglobal_p.h>
 #include <qaudioformat.h>
+#include <qlist.h>
+#include <private/qsimd_p.h>
 
 QT_BEGIN_NAMESPACE
 
 struct QAmbisonicDecoderData;
-class QAmbisonicDecoderFilter;
 
-class QAmbisonicDecoder
+// Implements a split second order IIR filter for all ambisonic channels
+// The audio data is split into a phase synced low and high frequency part
+// This allows us to apply different factors to both parts for better sound
+// localization when converting from ambisonic formats
+//
+// All channels share the same coefficients. The state is stored per channel in
+// separate arrays, so that the SIMD kernels can filter several channels at once.
+//
+// Details are described in https://ambisonics.dreamhosters.com/BLaH3.pdf, Appendix A.2.
+struct Q_SPATIALAUDIO_EXPORT QAmbisonicDecoderFilter
+{
+    static constexpr int maxChannels = 16;
+
+    void configure(float sampleRate, float cutoffFrequency = 380);
+
+    float a1 = 0.;
+    float a2 = 0.;
+
+    float b0_hf = 0.;
+    float b1_hf = 0.;
+
+    float b0_lf = 0.;
+    float b1_lf = 0.;
+
+    // index 0 holds the previous, index 1 the one before that
+    alignas(32) float prevX[2][maxChannels] = {};
+    alignas(32) float prevR_lf[2][maxChannels] = {};
+    alignas(32) float prevR_hf[2][maxChannels] = {};
+};
+
+// The decoder works on blocks of samples in sample major order, with the channels
+// of one sample stored next to each other:
+//
+// - filter() splits channelStride channels into a low and high frequency part
+// - decode() applies the decoder matrices (transposed, with maxOutputChannels
+//   columns) and the reverb, writing maxOutputChannels floats per sample
+// - convertToInt16() converts that to interleaved 16 bit output
+namespace QAmbisonicDecoderKernels
+{
+constexpr int maxOutputChannels = 8;
+
+using FilterFunction = void (QT_FASTCALL *)(QAmbisonicDecoderFilter &filter, const float *input,
+                                            float *lf, float *hf, int channelStride, int nSamples);
+using DecodeFunction = void (QT_FASTCALL *)(const float *lf, const float *hf, int channelStride, int nInputChannels,
+                                            const float *matrixLf, const float *matrixHf,
+                                            const float *reverb0, const float *reverb1, const float *reverbFactors,
+                                            float *output, int nSamples);
+using ConvertFunction = void (QT_FASTCALL *)(const float *input, short *output, int nOutputChannels, int nSamples);
+
+struct Kernels
+{
+    FilterFunction filter;
+    DecodeFunction decode;
+    ConvertFunction convertToInt16;
+};
+
+// returns the fastest kernels supported by the CPU
+Q_SPATIALAUDIO_EXPORT const Kernels &kernels();
+// the plain C++ implementation, used as a reference
+Q_SPATIALAUDIO_EXPORT const Kernels &genericKernels();
+
+struct NamedKernels
+{
+    const char *name;
+    const Kernels *kernels;
+};
+// all SIMD kernels the CPU can run, for testing
+Q_SPATIALAUDIO_EXPORT QList<NamedKernels> simdKernels();
+}
+
+class Q_SPATIALAUDIO_EXPORT QAmbisonicDecoder
 {
 public:
     enum AmbisonicLevel
@@ -82,19 +153,38 @@ public:
     void processBuffer(const float *input[], float *output, int nSamples);
     void processBuffer(const float *input[], short *output, int nSamples);
 
+    void processBufferWithReverb(const float *input[], const float *reverb[2], float *output, int nSamples);
     void processBufferWithReverb(const float *input[], const float *reverb[2], short *output, int nSamples);
 
+    // for testing and benchmarking
+    void setKernels(const QAmbisonicDecoderKernels::Kernels &k) { kernels = &k; }
+
     static constexpr int maxAmbisonicChannels = 16;
     static constexpr int maxAmbisonicLevel = 3;
 private:
+    static constexpr int blockSize = 128;
+    void decodeBlock(const float *input[], const float *reverb[2], int offset, int nSamples);
+
     QAudioFormat::ChannelConfig channelConfig;
     AmbisonicLevel level = AmbisonicLevel1;
     int inputChannels = 0;
     int outputChannels = 0;
-    const QAmbisonicDecoderData *decoderData = nullptr;
-    QAmbisonicDecoderFilter *filters = nullptr;
-    float *simpleDecoderFactors = nullptr;
-    const float *reverbFactors = nullptr;
+    // number of input channels used for decoding, rounded up to a multiple of 4
+    int channelStride = 0;
+    bool simpleDecoder = false;
+    const QAmbisonicDecoderKernels::Kernels *kernels = nullptr;
+    QAmbisonicDecoderFilter filter;
+
+    // transposed decoder matrices and reverb factors, padded to maxOutputChannels columns
+    alignas(32) float matrixLf[maxAmbisonicChannels*QAmbisonicDecoderKernels::maxOutputChannels] = {};
+    alignas(32) float matrixHf[maxAmbisonicChannels*QAmbisonicDecoderKernels::maxOutputChannels] = {};
+    alignas(32) float reverbFactors[2*QAmbisonicDecoderKernels::maxOutputChannels] = {};
+
+    // scratch buffers for one block
+    alignas(32) float inputBlock[blockSize*maxAmbisonicChannels] = {};
+    alignas(32) float lfBlock[blockSize*maxAmbisonicChannels] = {};
+    alignas(32) float hfBlock[blockSize*maxAmbisonicChannels] = {};
+    alignas(32) float outputBlock[blockSize*QAmbisonicDecoderKernels::maxOutputChannels] = {};
 };
 
 
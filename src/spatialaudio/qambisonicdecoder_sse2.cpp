@@ -0,0 +1,162 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include "qambisonicdecoder_p.h"
+
+#ifdef QT_COMPILER_SUPPORTS_SSE2
+
+QT_BEGIN_NAMESPACE
+
+namespace QAmbisonicDecoderKernels
+{
+
+// Filters 4 channels at a time, keeping their state in registers for the whole block
+static void QT_FASTCALL filter_sse2(QAmbisonicDecoderFilter &f, const float *input, float *lf, float *hf,
+                                    int channelStride, int nSamples)
+{
+    const __m128 a1 = _mm_set1_ps(f.a1);
+    const __m128 a2 = _mm_set1_ps(f.a2);
+    const __m128 b0_lf = _mm_set1_ps(f.b0_lf);
+    const __m128 b1_lf = _mm_set1_ps(f.b1_lf);
+    const __m128 b0_hf = _mm_set1_ps(f.b0_hf);
+    const __m128 b1_hf = _mm_set1_ps(f.b1_hf);
+
+    for (int j = 0; j < channelStride; j += 4) {
+        __m128 x1 = _mm_load_ps(f.prevX[0] + j);
+        __m128 x2 = _mm_load_ps(f.prevX[1] + j);
+        __m128 lf1 = _mm_load_ps(f.prevR_lf[0] + j);
+        __m128 lf2 = _mm_load_ps(f.prevR_lf[1] + j);
+        __m128 hf1 = _mm_load_ps(f.prevR_hf[0] + j);
+        __m128 hf2 = _mm_load_ps(f.prevR_hf[1] + j);
+
+        for (int i = 0; i < nSamples; ++i) {
+            const int index = i*channelStride + j;
+            const __m128 x = _mm_load_ps(input + index);
+            __m128 r_lf = _mm_add_ps(_mm_mul_ps(_mm_add_ps(x, x2), b0_lf), _mm_mul_ps(x1, b1_lf));
+            r_lf = _mm_sub_ps(r_lf, _mm_add_ps(_mm_mul_ps(lf1, a1), _mm_mul_ps(lf2, a2)));
+            __m128 r_hf = _mm_add_ps(_mm_mul_ps(_mm_add_ps(x, x2), b0_hf), _mm_mul_ps(x1, b1_hf));
+            r_hf = _mm_sub_ps(r_hf, _mm_add_ps(_mm_mul_ps(hf1, a1), _mm_mul_ps(hf2, a2)));
+            _mm_store_ps(lf + index, r_lf);
+            _mm_store_ps(hf + index, r_hf);
+            x2 = x1;
+            x1 = x;
+            lf2 = lf1;
+            lf1 = r_lf;
+            hf2 = hf1;
+            hf1 = r_hf;
+        }
+
+        _mm_store_ps(f.prevX[0] + j, x1);
+        _mm_store_ps(f.prevX[1] + j, x2);
+        _mm_store_ps(f.prevR_lf[0] + j, lf1);
+        _mm_store_ps(f.prevR_lf[1] + j, lf2);
+        _mm_store_ps(f.prevR_hf[0] + j, hf1);
+        _mm_store_ps(f.prevR_hf[1] + j, hf2);
+    }
+}
+
+static void QT_FASTCALL decode_sse2(const float *lf, const float *hf, int channelStride, int nInputChannels,
+                                    const float *matrixLf, const float *matrixHf,
+                                    const float *reverb0, const float *reverb1, const float *reverbFactors,
+                                    float *output, int nSamples)
+{
+    for (int i = 0; i < nSamples; ++i) {
+        __m128 o0 = _mm_setzero_ps();
+        __m128 o1 = _mm_setzero_ps();
+        for (int j = 0; j < nInputChannels; ++j) {
+            const __m128 l = _mm_set1_ps(lf[j]);
+            o0 = _mm_add_ps(o0, _mm_mul_ps(l, _mm_load_ps(matrixLf + j*maxOutputChannels)));
+            o1 = _mm_add_ps(o1, _mm_mul_ps(l, _mm_load_ps(matrixLf + j*maxOutputChannels + 4)));
+        }
+        if (matrixHf) {
+            for (int j = 0; j < nInputChannels; ++j) {
+                const __m128 h = _mm_set1_ps(hf[j]);
+                o0 = _mm_add_ps(o0, _mm_mul_ps(h, _mm_load_ps(matrixHf + j*maxOutputChannels)));
+                o1 = _mm_add_ps(o1, _mm_mul_ps(h, _mm_load_ps(matrixHf + j*maxOutputChannels + 4)));
+            }
+        }
+        if (reverb0) {
+            const __m128 r0 = _mm_set1_ps(reverb0[i]);
+            const __m128 r1 = _mm_set1_ps(reverb1[i]);
+            o0 = _mm_add_ps(o0, _mm_add_ps(_mm_mul_ps(r0, _mm_load_ps(reverbFactors)),
+                                           _mm_mul_ps(r1, _mm_load_ps(reverbFactors + maxOutputChannels))));
+            o1 = _mm_add_ps(o1, _mm_add_ps(_mm_mul_ps(r0, _mm_load_ps(reverbFactors + 4)),
+                                           _mm_mul_ps(r1, _mm_load_ps(reverbFactors + maxOutputChannels + 4))));
+        }
+        _mm_store_ps(output, o0);
+        _mm_store_ps(output + 4, o1);
+        lf += channelStride;
+        hf += channelStride;
+        output += maxOutputChannels;
+    }
+}
+
+static void QT_FASTCALL convertToInt16_sse2(const float *input, short *output, int nOutputChannels, int nSamples)
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    for (int i = 0; i < nSamples; ++i) {
+        __m128 o0 = _mm_mul_ps(_mm_load_ps(input), scale);
+        __m128 o1 = _mm_mul_ps(_mm_load_ps(input + 4), scale);
+        o0 = _mm_min_ps(_mm_max_ps(o0, min), max);
+        o1 = _mm_min_ps(_mm_max_ps(o1, min), max);
+        const __m128i s = _mm_packs_epi32(_mm_cvttps_epi32(o0), _mm_cvttps_epi32(o1));
+        if (nOutputChannels == maxOutputChannels) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(output), s);
+        } else {
+            alignas(16) short tmp[maxOutputChannels];
+            _mm_store_si128(reinterpret_cast<__m128i *>(tmp), s);
+            memcpy(output, tmp, nOutputChannels*sizeof(short));
+        }
+        input += maxOutputChannels;
+        output += nOutputChannels;
+    }
+}
+
+const Kernels &sse2Kernels()
+{
+    static const Kernels k = { filter_sse2, decode_sse2, convertToInt16_sse2 };
+    return k;
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,221 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudioassetcache_p.h"
+#include <qaudiodecoder.h>
+#include <qaudiobuffer.h>
+#include <qdebug.h>
+
+QT_BEGIN_NAMESPACE
+
+QAudioAsset::QAudioAsset(QAudioAssetCache *cache, const QUrl &url, int sampleRate, int channels)
+    : m_cache(cache)
+    , m_url(url)
+    , m_sampleRate(sampleRate)
+    , m_channels(channels)
+{
+}
+
+QAudioAsset::~QAudioAsset() = default;
+
+void QAudioAsset::load()
+{
+    m_decoder.reset(new QAudioDecoder);
+    QAudioFormat f;
+    f.setSampleFormat(QAudioFormat::Float);
+    f.setSampleRate(m_sampleRate);
+    f.setChannelConfig(m_channels == 2 ? QAudioFormat::ChannelConfigStereo : QAudioFormat::ChannelConfigMono);
+    m_decoder->setAudioFormat(f);
+    m_decoder->setSource(m_url);
+
+    connect(m_decoder.get(), &QAudioDecoder::bufferReady, this, &QAudioAsset::bufferReady);
+    connect(m_decoder.get(), &QAudioDecoder::finished, this, &QAudioAsset::decodingFinished);
+    connect(m_decoder.get(), &QAudioDecoder::error, this, &QAudioAsset::decodingError);
+    m_decoder->start();
+}
+
+void QAudioAsset::release()
+{
+    Q_ASSERT(m_ref > 0);
+    if (--m_ref)
+        return;
+    if (m_cache)
+        m_cache->assetUnreferenced(this);
+    else
+        deleteLater();
+}
+
+void QAudioAsset::bufferReady()
+{
+    auto b = m_decoder->read();
+    if (!b.isValid())
+        return;
+    Q_ASSERT(b.format().channelCount() == m_channels);
+    // The audio thread doesn't look at the data before we're done,
+    // so we can simply append to one contiguous buffer here
+    const qsizetype offset = m_data.size();
+    m_data.resize(offset + b.frameCount()*m_channels);
+    memcpy(m_data.data() + offset, b.constData<float>(), b.frameCount()*m_channels*sizeof(float));
+}
+
+void QAudioAsset::decodingFinished()
+{
+    m_decoder.reset();
+    m_data.squeeze();
+    m_frameCount = m_data.size()/m_channels;
+    m_state.storeRelease(Ready);
+    if (m_cache)
+        m_cache->assetLoaded(this);
+    emit ready();
+}
+
+void QAudioAsset::decodingError()
+{
+    qWarning() << "QAudioAsset: Could not decode" << m_url << m_decoder->errorString();
+    m_decoder.reset();
+    m_data.clear();
+    m_state.storeRelease(Error);
+    // don't keep failed assets around, requesting the url again will retry loading it
+    if (m_cache)
+        m_cache->removeAsset(this);
+    emit error();
+}
+
+QAudioAssetCache::~QAudioAssetCache()
+{
+    for (auto *asset : qAsConst(m_assets)) {
+        if (asset->m_ref) {
+            // still in use by a sound source, deletes itself on the last release()
+            asset->m_cache = nullptr;
+        } else {
+            delete asset;
+        }
+    }
+}
+
+QAudioAsset *QAudioAssetCache::requestAsset(const QUrl &url, int sampleRate, int channels)
+{
+    const Key key{ url, sampleRate, channels };
+    QAudioAsset *asset = m_assets.value(key);
+    if (asset) {
+        ++m_hits;
+        if (!asset->m_ref)
+            m_unused.removeOne(asset);
+    } else {
+        ++m_misses;
+        asset = new QAudioAsset(this, url, sampleRate, channels);
+        m_assets.insert(key, asset);
+        asset->load();
+    }
+    asset->addRef();
+    return asset;
+}
+
+/*
+    Sets the amount of memory in bytes that decoded sound files can use. Assets that
+    are in use are never evicted, so the actual usage can be higher than the budget.
+*/
+void QAudioAssetCache::setMemoryBudget(qint64 bytes)
+{
+    if (m_budget == bytes)
+        return;
+    m_budget = bytes;
+    evict();
+}
+
+QAudioAssetCache::Statistics QAudioAssetCache::statistics() const
+{
+    Statistics s;
+    s.hits = m_hits;
+    s.misses = m_misses;
+    s.evictions = m_evictions;
+    s.memoryUsage = m_usage;
+    s.assets = m_assets.size();
+    return s;
+}
+
+void QAudioAssetCache::resetStatistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_evictions = 0;
+}
+
+void QAudioAssetCache::assetLoaded(QAudioAsset *asset)
+{
+    m_usage += asset->byteSize();
+    evict();
+}
+
+void QAudioAssetCache::assetUnreferenced(QAudioAsset *asset)
+{
+    if (asset->state() == QAudioAsset::Ready && m_assets.value(keyOf(asset)) == asset) {
+        m_unused.append(asset);
+        evict();
+        return;
+    }
+    // still loading or failed to load, nobody is interested in it anymore
+    removeAsset(asset);
+    asset->deleteLater();
+}
+
+void QAudioAssetCache::removeAsset(QAudioAsset *asset)
+{
+    // the asset isn't ours anymore, it deletes itself on the last release()
+    asset->m_cache = nullptr;
+    const Key key = keyOf(asset);
+    // a failed asset might already have been replaced by a new attempt to load the url
+    if (m_assets.value(key) != asset)
+        return;
+    m_assets.remove(key);
+    if (asset->state() == QAudioAsset::Ready)
+        m_usage -= asset->byteSize();
+}
+
+void QAudioAssetCache::evict()
+{
+    while (m_usage > m_budget && !m_unused.isEmpty()) {
+        QAudioAsset *asset = m_unused.takeFirst();
+        removeAsset(asset);
+        ++m_evictions;
+        delete asset;
+    }
+}
+
+QT_END_NAMESPACE
+
+#include "moc_qaudioassetcache_p.cpp"
@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QAUDIOASSETCACHE_P_H
+#define QAUDIOASSETCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <qtspatialaudioglobal_p.h>
+#include <qobject.h>
+#include <qurl.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qatomic.h>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QAudioDecoder;
+class QAudioAssetCache;
+
+// Decoded PCM data of one sound file, shared by all sources playing it.
+// Lives in the thread of the engine. Once state() returns Ready, the data is
+// immutable and can be read from any thread as long as a reference is held.
+class Q_SPATIALAUDIO_EXPORT QAudioAsset : public QObject
+{
+    Q_OBJECT
+public:
+    enum State {
+        Loading,
+        Error,
+        Ready
+    };
+
+    State state() const { return State(m_state.loadAcquire()); }
+
+    // interleaved float samples, only valid in the Ready state
+    const float *data() const { Q_ASSERT(state() == Ready); return m_data.constData(); }
+    qint64 frameCount() const { Q_ASSERT(state() == Ready); return m_frameCount; }
+    int channelCount() const { return m_channels; }
+    qint64 byteSize() const { return m_data.size()*qint64(sizeof(float)); }
+
+    void release();
+
+Q_SIGNALS:
+    void ready();
+    void error();
+
+private Q_SLOTS:
+    void bufferReady();
+    void decodingFinished();
+    void decodingError();
+
+private:
+    friend class QAudioAssetCache;
+    QAudioAsset(QAudioAssetCache *cache, const QUrl &url, int sampleRate, int channels);
+    ~QAudioAsset();
+
+    void addRef() { ++m_ref; }
+    void load();
+
+    QAudioAssetCache *m_cache = nullptr;
+    QUrl m_url;
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    int m_ref = 0;
+    QAtomicInt m_state = Loading;
+    std::unique_ptr<QAudioDecoder> m_decoder;
+    QList<float> m_data;
+    qint64 m_frameCount = 0;
+};
+
+// Engine wide cache of decoded sound files, keyed by url and output format.
+// Assets stay in the cache after their last user released them, until the memory
+// budget is exceeded. Unused assets are then evicted in least recently used order.
+class Q_SPATIALAUDIO_EXPORT QAudioAssetCache
+{
+public:
+    struct Statistics {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+        qint64 memoryUsage = 0;
+        int assets = 0;
+    };
+
+    QAudioAssetCache() = default;
+    ~QAudioAssetCache();
+    Q_DISABLE_COPY(QAudioAssetCache)
+
+    // Returns a referenced asset, call QAudioAsset::release() when done with it.
+    QAudioAsset *requestAsset(const QUrl &url, int sampleRate, int channels);
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return m_budget; }
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private:
+    friend class QAudioAsset;
+
+    struct Key {
+        QUrl url;
+        int sampleRate;
+        int channels;
+        bool operator==(const Key &other) const
+        {
+            return url == other.url && sampleRate == other.sampleRate && channels == other.channels;
+        }
+    };
+    friend size_t qHash(const Key &key, size_t seed = 0)
+    {
+        return qHashMulti(seed, key.url, key.sampleRate, key.channels);
+    }
+
+    static Key keyOf(const QAudioAsset *asset)
+    {
+        return { asset->m_url, asset->m_sampleRate, asset->m_channels };
+    }
+    void assetLoaded(QAudioAsset *asset);
+    void assetUnreferenced(QAudioAsset *asset);
+    void removeAsset(QAudioAsset *asset);
+    void evict();
+
+    QHash<Key, QAudioAsset *> m_assets;
+    // unreferenced assets, least recently used first
+    QList<QAudioAsset *> m_unused;
+    qint64 m_budget = 64*1024*1024;
+    qint64 m_usage = 0;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+    qint64 m_evictions = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
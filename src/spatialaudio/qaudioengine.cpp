@@ -41,48 +41,28 @@
 #include <qaudiolistener.h>
 #include <resonance_audio.h>
 #include <qambisonicdecoder_p.h>
-#include <qaudiodecoder.h>
+#include <qaudiorenderthreadpool_p.h>
 #include <qmediadevices.h>
-#include <qiodevice.h>
 #include <qaudiosink.h>
+#include <private/qaudiosystem_p.h>
 #include <qdebug.h>
 #include <qelapsedtimer.h>
 
-QT_BEGIN_NAMESPACE
+#include <algorithm>
 
-// We'd like to have short buffer times, so the sound adjusts itself to changes
-// quickly, but times below 100ms seem to give stuttering on macOS.
-// It might be possible to set this value lower on other OSes.
-const int bufferTimeMs = 100;
+QT_BEGIN_NAMESPACE
 
-class QAudioOutputStream : public QIODevice
+class QAudioOutputStream : public QObject
 {
     Q_OBJECT
 public:
     explicit QAudioOutputStream(QAudioEnginePrivate *d)
         : d(d)
     {
-        open(QIODevice::ReadOnly);
     }
     ~QAudioOutputStream();
 
-    qint64 readData(char *data, qint64 len) override;
-
-    qint64 writeData(const char *, qint64) override;
-
-    qint64 size() const override { return 0; }
-    qint64 bytesAvailable() const override {
-        return std::numeric_limits<qint64>::max();
-    }
-    bool isSequential() const override {
-        return true;
-    }
-    bool atEnd() const override {
-        return false;
-    }
-    qint64 pos() const override {
-        return m_pos;
-    }
+    void render(float *out, int frames);
 
     Q_INVOKABLE void startOutput() {
         QMutexLocker l(&d->mutex);
@@ -91,17 +71,42 @@ public:
         format.setChannelConfig(d->outputMode == QAudioEngine::Surround ?
                                     d->device.channelConfiguration() : QAudioFormat::ChannelConfigStereo);
         format.setSampleRate(d->sampleRate);
-        format.setSampleFormat(QAudioFormat::Int16);
+        // Resonance Audio renders float, so avoid converting to int16 if the
+        // device can take float directly
+        const auto sampleFormats = d->device.supportedSampleFormats();
+        format.setSampleFormat(sampleFormats.contains(QAudioFormat::Float) ? QAudioFormat::Float : QAudioFormat::Int16);
         d->ambisonicDecoder.reset(new QAmbisonicDecoder(QAmbisonicDecoder::HighQuality, format));
+        voiceBuffer.resize(2*d->periodSize);
+        outputChannels = format.channelCount();
+        outputBuffer.resize(qMax(2, outputChannels)*d->periodSize);
+        if (d->renderThreadCount > 1) {
+            renderThreadPool.reset(new QAudioRenderThreadPool(d->renderThreadCount - 1));
+            d->resonanceAudio->setParallelExecutor(renderThreadPool.get());
+        }
         sink.reset(new QAudioSink(d->device, format));
-        sink->setBufferSize(d->sampleRate*bufferTimeMs/1000*sizeof(qint16)*format.channelCount());
-        sink->start(this);
+        platformSink = QPlatformAudioSink::get(*sink);
+        // a new sink counts from 0, keep the underruns of the previous ones
+        underrunBase = d->underruns.loadRelaxed();
+        const int bytesPerFrame = format.bytesPerFrame();
+        sink->setBufferSize(qMax(d->sampleRate*d->bufferTimeMs/1000, 2*d->periodSize)*bytesPerFrame);
+        // Render directly from the backend's audio thread, one period per call.
+        // Resonance Audio produces interleaved output, so skip the planar callback.
+        if (platformSink)
+            platformSink->startWithInterleavedCallback(
+                    [this](float *out, int frames) { render(out, frames); }, d->periodSize);
+        // the backend might not have been able to use the requested buffer size
+        setOutputLatency(qint64(sink->bufferSize()/bytesPerFrame)*1000/d->sampleRate);
     }
 
     Q_INVOKABLE void stopOutput() {
         sink->stop();
+        updateUnderruns();
+        platformSink = nullptr;
         sink.reset();
+        d->resonanceAudio->setParallelExecutor(nullptr);
+        renderThreadPool.reset();
         d->ambisonicDecoder.reset();
+        setOutputLatency(0);
     }
 
     Q_INVOKABLE void restartOutput() {
@@ -117,9 +122,24 @@ public:
     }
 
 private:
-    qint64 m_pos = 0;
+    void updateUnderruns() {
+        if (platformSink)
+            d->underruns.storeRelaxed(underrunBase + platformSink->ioMetrics().underruns);
+    }
+
+    void setOutputLatency(int latency) {
+        if (d->outputLatency.fetchAndStoreRelaxed(latency) != latency)
+            QMetaObject::invokeMethod(d->q, &QAudioEngine::outputLatencyChanged);
+    }
+
     QAudioEnginePrivate *d = nullptr;
     std::unique_ptr<QAudioSink> sink;
+    QPlatformAudioSink *platformSink = nullptr;
+    qint64 underrunBase = 0;
+    std::unique_ptr<QAudioRenderThreadPool> renderThreadPool;
+    QList<float> voiceBuffer;
+    QList<float> outputBuffer;
+    int outputChannels = 0;
 };
 
 
@@ -127,59 +147,78 @@ QAudioOutputStream::~QAudioOutputStream()
 {
 }
 
-qint64 QAudioOutputStream::writeData(const char *, qint64)
+static void applyFade(float *buf, int channels, int frames, bool fadeIn)
 {
-    return 0;
+    const float step = 1.f/frames;
+    for (int i = 0; i < frames; ++i) {
+        const float gain = fadeIn ? i*step : 1.f - i*step;
+        for (int c = 0; c < channels; ++c)
+            *buf++ *= gain;
+    }
 }
 
-qint64 QAudioOutputStream::readData(char *data, qint64 len)
+// Called by the sink on its audio thread with one period of interleaved frames
+// in out
+void QAudioOutputStream::render(float *out, int frames)
 {
-    if (d->paused.loadRelaxed())
-        return 0;
-
-    d->updateRooms();
+    // pick up changes from the application thread, also while paused
+    d->processCommands();
 
-    int nChannels = d->ambisonicDecoder ? d->ambisonicDecoder->nOutputChannels() : 2;
-    if (len < nChannels*int(sizeof(float))*QAudioEnginePrivate::bufferSize)
-        return 0;
+    const int nChannels = d->ambisonicDecoder ? d->ambisonicDecoder->nOutputChannels() : 2;
+    const int periodSize = d->periodSize;
+    Q_ASSERT(frames == periodSize);
 
-    short *fd = (short *)data;
-    qint64 frames = len / nChannels / sizeof(short);
-    bool ok = true;
-    while (frames >= qint64(QAudioEnginePrivate::bufferSize)) {
+    bool ok = !d->paused.loadRelaxed();
+    if (ok) {
         // Fill input buffers
-        for (auto *source : qAsConst(d->sources)) {
-            auto *sp = QSpatialSoundPrivate::get(source);
-            float buf[QAudioEnginePrivate::bufferSize];
-            sp->getBuffer(buf, QAudioEnginePrivate::bufferSize, 1);
-            d->resonanceAudio->api->SetInterleavedBuffer(sp->sourceId, buf, 1, QAudioEnginePrivate::bufferSize);
-        }
-        for (auto *source : qAsConst(d->stereoSources)) {
-            auto *sp = QAmbientSoundPrivate::get(source);
-            float buf[2*QAudioEnginePrivate::bufferSize];
-            sp->getBuffer(buf, QAudioEnginePrivate::bufferSize, 2);
-            d->resonanceAudio->api->SetInterleavedBuffer(sp->sourceId, buf, 2, QAudioEnginePrivate::bufferSize);
+        d->updateAudibleVoices();
+        for (auto *voice : qAsConst(d->voices)) {
+            if (voice->isVirtual && !voice->audible) {
+                // Resonance Audio skips sources that didn't get a new buffer
+                voice->skip(periodSize);
+                continue;
+            }
+            float *buf = voiceBuffer.data();
+            voice->render(buf, periodSize);
+            if (!voice->audible) {
+                // render one more period to fade out, then go virtual
+                applyFade(buf, voice->channels, periodSize, false);
+                voice->skipped = voice->playing;
+            } else if (voice->skipped) {
+                applyFade(buf, voice->channels, periodSize, true);
+                voice->skipped = false;
+            }
+            voice->isVirtual = !voice->audible;
+            voice->audibilityKnown = true;
+            d->resonanceAudio->api->SetInterleavedBuffer(voice->sourceId, buf, voice->channels, periodSize);
         }
 
+        // render in place unless the decoder's channels don't match the device
+        float *interleaved = nChannels == outputChannels ? out : outputBuffer.data();
         if (d->ambisonicDecoder && d->outputMode == QAudioEngine::Surround) {
             const float *channels[QAmbisonicDecoder::maxAmbisonicChannels];
             const float *reverbBuffers[2];
             int nSamples = d->resonanceAudio->getAmbisonicOutput(channels, reverbBuffers, d->ambisonicDecoder->nInputChannels());
             Q_ASSERT(d->ambisonicDecoder->nOutputChannels() <= 8);
-            d->ambisonicDecoder->processBufferWithReverb(channels, reverbBuffers, fd, nSamples);
+            d->ambisonicDecoder->processBufferWithReverb(channels, reverbBuffers, interleaved, nSamples);
         } else {
-            ok = d->resonanceAudio->api->FillInterleavedOutputBuffer(2, QAudioEnginePrivate::bufferSize, fd);
-            if (!ok) {
+            ok = d->resonanceAudio->api->FillInterleavedOutputBuffer(2, periodSize, interleaved);
+            if (!ok)
                 qWarning() << "    Reading failed!";
-                break;
-            }
         }
-        fd += nChannels*QAudioEnginePrivate::bufferSize;
-        frames -= QAudioEnginePrivate::bufferSize;
     }
-    const int bytesProcessed = ((char *)fd - data);
-    m_pos += bytesProcessed;
-    return bytesProcessed;
+
+    if (!ok) {
+        std::fill(out, out + size_t(frames)*outputChannels, 0.f);
+    } else if (nChannels != outputChannels) {
+        const float *src = outputBuffer.constData();
+        for (int i = 0; i < frames; ++i, src += nChannels) {
+            for (int c = 0; c < outputChannels; ++c)
+                *out++ = c < nChannels ? src[c] : 0.f;
+        }
+    }
+
+    updateUnderruns();
 }
 
 
@@ -187,10 +226,29 @@ QAudioEnginePrivate::QAudioEnginePrivate()
 {
     device = QMediaDevices::defaultAudioOutput();
     audioThread.setPriority(QThread::TimeCriticalPriority);
+
+    roomUpdateTimer.setSingleShot(true);
+    roomUpdateTimer.setInterval(0);
+    QObject::connect(&roomUpdateTimer, &QTimer::timeout, [this]() { updateRooms(); });
+
+    // retires data and hands over commands that didn't fit into the queue
+    commandTimer.setInterval(20);
+    QObject::connect(&commandTimer, &QTimer::timeout, [this]() {
+        collectRetired();
+        flushCommands();
+    });
 }
 
 QAudioEnginePrivate::~QAudioEnginePrivate()
 {
+    // apply everything that's still queued, so that all data gets retired
+    do {
+        flushCommands();
+        processCommands();
+        collectRetired();
+    } while (!pendingCommands.isEmpty());
+    streamingThread.quit();
+    streamingThread.wait();
     delete resonanceAudio;
 }
 
@@ -198,44 +256,225 @@ void QAudioEnginePrivate::addSpatialSound(QSpatialSound *sound)
 {
     QAmbientSoundPrivate *sd = QAmbientSoundPrivate::get(sound);
 
-    sd->sourceId = resonanceAudio->api->CreateSoundObjectSource(vraudio::kBinauralHighQuality);
+    auto *voice = sd->attachVoice(resonanceAudio->api->CreateSoundObjectSource(vraudio::kBinauralHighQuality));
+    voice->spatial = true;
     sources.append(sound);
+    reserveVoice();
+    postCommand({ QAudioEngineCommand::AddVoice, voice });
 }
 
 void QAudioEnginePrivate::removeSpatialSound(QSpatialSound *sound)
 {
     QAmbientSoundPrivate *sd = QAmbientSoundPrivate::get(sound);
 
-    resonanceAudio->api->DestroySource(sd->sourceId);
-    sd->sourceId = vraudio::ResonanceAudioApi::kInvalidSourceId;
+    // the source gets destroyed once the audio thread is done with the voice
     sources.removeOne(sound);
+    postCommand({ QAudioEngineCommand::RemoveVoice, sd->detachVoice() });
 }
 
 void QAudioEnginePrivate::addStereoSound(QAmbientSound *sound)
 {
     QAmbientSoundPrivate *sd = QAmbientSoundPrivate::get(sound);
 
-    sd->sourceId = resonanceAudio->api->CreateStereoSource(2);
+    auto *voice = sd->attachVoice(resonanceAudio->api->CreateStereoSource(2));
     stereoSources.append(sound);
+    reserveVoice();
+    postCommand({ QAudioEngineCommand::AddVoice, voice });
 }
 
 void QAudioEnginePrivate::removeStereoSound(QAmbientSound *sound)
 {
     QAmbientSoundPrivate *sd = QAmbientSoundPrivate::get(sound);
 
-    resonanceAudio->api->DestroySource(sd->sourceId);
-    sd->sourceId = vraudio::ResonanceAudioApi::kInvalidSourceId;
     stereoSources.removeOne(sound);
+    postCommand({ QAudioEngineCommand::RemoveVoice, sd->detachVoice() });
+}
+
+// Makes sure the audio thread can take one more voice without allocating. Commands
+// are applied in order, so all voices removed so far are gone by the time the new
+// voice gets added.
+void QAudioEnginePrivate::reserveVoice()
+{
+    const qsizetype count = sources.size() + stereoSources.size();
+    if (count <= voiceCapacity)
+        return;
+    voiceCapacity = qMax(qsizetype(16), 2*count);
+    QAudioEngineCommand command{ QAudioEngineCommand::SetVoiceList };
+    command.voiceList = new QAudioVoiceList(voiceCapacity);
+    postCommand(command);
+}
+
+void QAudioEnginePrivate::createResonanceAudio()
+{
+    auto *old = resonanceAudio;
+    resonanceAudio = new vraudio::ResonanceAudio(2, periodSize, sampleRate);
+    if (!old)
+        return;
+
+    // carry over the state that isn't part of a sound source
+    resonanceAudio->roomEffectsEnabled = old->roomEffectsEnabled;
+    delete old;
+    if (listener) {
+        const QVector3D pos = listener->position()*distanceScale;
+        const QQuaternion rotation = listener->rotation();
+        resonanceAudio->api->SetHeadPosition(pos.x(), pos.y(), pos.z());
+        resonanceAudio->api->SetHeadRotation(rotation.x(), rotation.y(), rotation.z(), rotation.scalar());
+    }
+    currentRoom = nullptr;
+    listenerPositionDirty = true;
+    scheduleRoomUpdate();
 }
 
 void QAudioEnginePrivate::addRoom(QAudioRoom *room)
 {
     rooms.append(room);
+    scheduleRoomUpdate();
 }
 
 void QAudioEnginePrivate::removeRoom(QAudioRoom *room)
 {
     rooms.removeOne(room);
+    if (currentRoom == room) {
+        currentRoom = nullptr;
+        listenerPositionDirty = true;
+    }
+    scheduleRoomUpdate();
+}
+
+void QAudioEnginePrivate::scheduleRoomUpdate()
+{
+    if (!roomUpdateTimer.isActive())
+        roomUpdateTimer.start();
+}
+
+void QAudioEnginePrivate::postCommand(const QAudioEngineCommand &command)
+{
+    collectRetired();
+    pendingCommands.append(command);
+    if (isRendering()) {
+        flushCommands();
+    } else {
+        // nobody else is processing commands, apply them right away
+        flushCommands();
+        processCommands();
+        collectRetired();
+    }
+}
+
+void QAudioEnginePrivate::flushCommands()
+{
+    int i = 0;
+    while (i < pendingCommands.size() && commands.push(pendingCommands.at(i)))
+        ++i;
+    pendingCommands.remove(0, i);
+}
+
+void QAudioEnginePrivate::processCommands()
+{
+    QAudioEngineCommand command;
+    // only take a command if we're sure we can retire what it replaces
+    while (retired.freeSpace() > 0 && commands.pop(command))
+        applyCommand(command);
+}
+
+void QAudioEnginePrivate::applyCommand(const QAudioEngineCommand &command)
+{
+    auto *voice = command.voice;
+    switch (command.type) {
+    case QAudioEngineCommand::AddVoice:
+        Q_ASSERT(voices.size() < voices.capacity() && voices.size() < voiceRanks.size());
+        voices.append(voice);
+        break;
+    case QAudioEngineCommand::RemoveVoice:
+        voices.removeOne(voice);
+        // a stopped engine has already destroyed all sources with the api
+        if (resonanceAudio->api)
+            resonanceAudio->api->DestroySource(voice->sourceId);
+        retired.push({ QAudioEngineCommand::RemoveVoice, voice });
+        break;
+    case QAudioEngineCommand::SetVoiceData:
+        if (voice->asset || voice->stream)
+            retired.push({ QAudioEngineCommand::SetVoiceData, nullptr, voice->asset, voice->stream });
+        voice->asset = command.asset;
+        voice->stream = command.stream;
+        voice->framePos = 0;
+        voice->currentLoop = 0;
+        break;
+    case QAudioEngineCommand::RewindVoice:
+        voice->framePos = 0;
+        voice->currentLoop = 0;
+        break;
+    case QAudioEngineCommand::SetVoicePriority:
+        voice->priority = command.priority;
+        break;
+    case QAudioEngineCommand::SetVoiceList: {
+        // the new list has room for all voices, so this doesn't allocate
+        auto *list = command.voiceList;
+        list->voices.append(voices);
+        voices.swap(list->voices);
+        voiceRanks.swap(list->ranks);
+        retired.push({ QAudioEngineCommand::SetVoiceList, nullptr, nullptr, nullptr, 1.f, list });
+        break;
+    }
+    }
+}
+
+void QAudioEnginePrivate::updateAudibleVoices()
+{
+    // below -60dB, a source doesn't contribute anything audible
+    constexpr float minimumAudibility = 0.001f;
+    // keep voices that are being rendered a bit longer, so that voices with
+    // similar audibility don't keep switching
+    constexpr float hysteresis = 1.5f;
+
+    int nRanked = 0;
+    for (auto *voice : qAsConst(voices)) {
+        if (!voice->spatial) {
+            voice->audible = true;
+            continue;
+        }
+        float audibility = 0.f;
+        if (voice->playing) {
+            audibility = voice->audibilityKnown
+                    ? resonanceAudio->sourceAudibility(voice->sourceId)*voice->priority
+                    : std::numeric_limits<float>::max();
+        }
+        if (audibility < minimumAudibility) {
+            voice->audible = false;
+            continue;
+        }
+        if (!voice->isVirtual)
+            audibility *= hysteresis;
+        voiceRanks[nRanked++] = { audibility, voice };
+    }
+
+    const int maxVoices = maximumVoiceCount.loadRelaxed();
+    auto begin = voiceRanks.begin();
+    auto end = begin + nRanked;
+    auto last = end;
+    if (maxVoices > 0 && nRanked > maxVoices) {
+        last = begin + maxVoices;
+        std::nth_element(begin, last, end, [](const auto &a, const auto &b) { return a.first > b.first; });
+    }
+    for (auto it = begin; it != end; ++it)
+        it->second->audible = it < last;
+}
+
+void QAudioEnginePrivate::collectRetired()
+{
+    QAudioEngineCommand item;
+    while (retired.pop(item)) {
+        if (item.voice) {
+            item.asset = item.voice->asset;
+            item.stream = item.voice->stream;
+            delete item.voice;
+        }
+        if (item.asset)
+            item.asset->release();
+        if (item.stream)
+            item.stream->deleteLater();
+        delete item.voiceList;
+    }
 }
 
 void QAudioEnginePrivate::updateRooms()
@@ -363,15 +602,27 @@ QAudioEngine::QAudioEngine(QObject *parent, int sampleRate)
     : QObject(parent)
     , d(new QAudioEnginePrivate)
 {
+    d->q = this;
     d->sampleRate = sampleRate;
-    d->resonanceAudio = new vraudio::ResonanceAudio(2, QAudioEnginePrivate::bufferSize, d->sampleRate);
+    d->createResonanceAudio();
 }
 
 /*!
     Destroys the spatial audio engine.
+
+    Sounds that still use the engine stop playing, and engine() returns
+    \nullptr for them afterwards.
  */
 QAudioEngine::~QAudioEngine()
 {
+    // sounds outliving the engine keep their settings, but aren't part of an engine
+    // anymore. Detach them while the api still exists, stop() applies their removal.
+    const auto spatialSounds = d->sources;
+    for (auto *sound : spatialSounds)
+        QAmbientSoundPrivate::removeFromEngine(sound);
+    const auto stereoSounds = d->stereoSources;
+    for (auto *sound : stereoSounds)
+        QAmbientSoundPrivate::removeFromEngine(sound);
     stop();
     delete d;
 }
@@ -472,11 +723,13 @@ void QAudioEngine::start()
     d->resonanceAudio->api->SetStereoSpeakerMode(d->outputMode != Headphone);
     d->resonanceAudio->api->SetMasterVolume(d->masterVolume);
 
+    d->processCommands();
     d->outputStream.reset(new QAudioOutputStream(d));
     d->outputStream->moveToThread(&d->audioThread);
     d->audioThread.start();
 
     QMetaObject::invokeMethod(d->outputStream.get(), "startOutput");
+    d->commandTimer.start();
 }
 
 /*!
@@ -488,6 +741,11 @@ void QAudioEngine::stop()
     d->outputStream.reset();
     d->audioThread.exit(0);
     d->audioThread.wait();
+    // we're processing commands ourselves from now on
+    d->commandTimer.stop();
+    d->flushCommands();
+    d->processCommands();
+    d->collectRetired();
     delete d->resonanceAudio->api;
     d->resonanceAudio->api = nullptr;
 }
@@ -526,6 +784,8 @@ void QAudioEngine::setRoomEffectsEnabled(bool enabled)
         return;
     d->roomEffectsEnabled = enabled;
     d->resonanceAudio->roomEffectsEnabled = enabled;
+    d->listenerPositionDirty = true;
+    d->scheduleRoomUpdate();
 }
 
 /*!
@@ -564,80 +824,421 @@ float QAudioEngine::distanceScale() const
     return d->distanceScale*100.f;
 }
 
+/*!
+    \property QAudioEngine::periodSize
+
+    Defines the number of frames the engine processes at a time. The default is 128.
+
+    Smaller periods allow for a lower output latency, but increase the
+    processing overhead. The period size can only be changed while the engine is
+    stopped and before any sound sources have been added to it.
+
+    \sa bufferTime, outputLatency
+*/
+void QAudioEngine::setPeriodSize(int frames)
+{
+    if (frames <= 0) {
+        qWarning() << "QAudioEngine: Invalid period size.";
+        return;
+    }
+    if (d->periodSize == frames)
+        return;
+    if (d->outputStream || !d->sources.isEmpty() || !d->stereoSources.isEmpty()) {
+        qWarning() << "Changing the period size on a running engine or an engine with sound sources not implemented";
+        return;
+    }
+    d->periodSize = frames;
+    // Resonance Audio can't change its buffer size, so we need a new instance
+    d->createResonanceAudio();
+    emit periodSizeChanged();
+}
+
+int QAudioEngine::periodSize() const
+{
+    return d->periodSize;
+}
+
+/*!
+    \property QAudioEngine::bufferTime
+
+    Defines the amount of audio in milliseconds that is buffered by the output
+    device. The default is 100ms.
+
+    Lower values make the sound react to changes more quickly, but increase the risk
+    of audible drop-outs when the system is under load. The buffer is always at least two
+    periods long, and the output device might not be able to use the requested size. Use
+    outputLatency to find out what the device actually uses.
+
+    \sa periodSize, outputLatency
+*/
+void QAudioEngine::setBufferTime(int ms)
+{
+    if (ms <= 0) {
+        qWarning() << "QAudioEngine: Invalid buffer time.";
+        return;
+    }
+    if (d->bufferTimeMs == ms)
+        return;
+    d->bufferTimeMs = ms;
+    QMetaObject::invokeMethod(d->outputStream.get(), "restartOutput", Qt::BlockingQueuedConnection);
+    emit bufferTimeChanged();
+}
+
+int QAudioEngine::bufferTime() const
+{
+    return d->bufferTimeMs;
+}
+
+/*!
+    \property QAudioEngine::outputLatency
+
+    Returns the latency of the audio output in milliseconds, as negotiated with the
+    output device. Returns 0 when the engine is not running.
+
+    \sa bufferTime, periodSize
+*/
+int QAudioEngine::outputLatency() const
+{
+    return d->outputLatency.loadRelaxed();
+}
+
+/*!
+    Returns how often the audio output ran out of data since the engine was
+    created, because rendering a period took longer than the device could wait.
+
+    Use this together with maximumVoiceCount and renderThreadCount to find a
+    setting that plays a scene without glitches. Only backends that drive the
+    audio device from their own audio thread report underruns, the count stays
+    at 0 on the others.
+
+    \sa outputLatency
+*/
+qint64 QAudioEngine::underrunCount() const
+{
+    return d->underruns.loadRelaxed();
+}
+
+/*!
+    \property QAudioEngine::renderThreadCount
+
+    Defines the number of threads the engine uses to process sound sources.
+    The default is 1, processing everything on the engine's audio thread.
+
+    With a count larger than 1, the engine starts additional real time threads
+    and distributes the per source processing of QSpatialSound objects over them.
+    This is useful for scenes with a large number of sound sources, that would not
+    get processed in time on a single core otherwise. The mixing and room effects
+    are still processed on a single thread, so more threads than CPU cores, or
+    multiple threads for a few sound sources, will not improve performance.
+
+    \sa periodSize
+*/
+void QAudioEngine::setRenderThreadCount(int count)
+{
+    if (count < 1) {
+        qWarning() << "QAudioEngine: Invalid render thread count.";
+        return;
+    }
+    if (d->renderThreadCount == count)
+        return;
+    d->renderThreadCount = count;
+    QMetaObject::invokeMethod(d->outputStream.get(), "restartOutput", Qt::BlockingQueuedConnection);
+    emit renderThreadCountChanged();
+}
+
+int QAudioEngine::renderThreadCount() const
+{
+    return d->renderThreadCount;
+}
+
+/*!
+    \property QAudioEngine::maximumVoiceCount
+
+    Defines the maximum number of QSpatialSound objects that are rendered at the
+    same time. The default is 0, meaning there is no limit.
+
+    When more sounds are playing, the engine only renders the ones that are the
+    most audible at the listener's position, taking their volume, distance
+    attenuation and QSpatialSound::priority into account. The other sounds
+    continue playing silently, and fade back in once they are among the most
+    audible ones again. Sounds that are too far away to be heard are never
+    rendered, independent of this limit.
+
+    Use this to keep the processing time bounded in scenes with many sound sources.
+*/
+void QAudioEngine::setMaximumVoiceCount(int count)
+{
+    count = qMax(count, 0);
+    if (d->maximumVoiceCount.fetchAndStoreRelaxed(count) == count)
+        return;
+    emit maximumVoiceCountChanged();
+}
+
+int QAudioEngine::maximumVoiceCount() const
+{
+    return d->maximumVoiceCount.loadRelaxed();
+}
+
+/*!
+    \property QAudioEngine::soundCacheSize
+
+    Defines the amount of memory in bytes that decoded sound files can use.
+    The default is 64 MB.
+
+    Sound files are decoded once, and shared by all sounds of the engine
+    playing the same file. Files that are not used by any sound anymore are
+    kept in memory, so that playing them again doesn't require decoding them
+    again. Once the memory used exceeds this size, the least recently used
+    of them are released. Files that are in use are never released, so the
+    memory used can be larger than this size.
+
+    Sounds in streaming mode are not cached.
+
+    \sa soundCacheUsage()
+*/
+void QAudioEngine::setSoundCacheSize(qint64 bytes)
+{
+    bytes = qMax(bytes, qint64(0));
+    if (d->assetCache.memoryBudget() == bytes)
+        return;
+    d->assetCache.setMemoryBudget(bytes);
+    emit soundCacheSizeChanged();
+}
+
+qint64 QAudioEngine::soundCacheSize() const
+{
+    return d->assetCache.memoryBudget();
+}
+
+/*!
+    Returns the amount of memory in bytes currently used by decoded sound files.
+
+    \sa soundCacheSize
+*/
+qint64 QAudioEngine::soundCacheUsage() const
+{
+    return d->assetCache.statistics().memoryUsage;
+}
+
+/*!
+    Returns how often a sound file was found in the cache since the engine
+    was created, so that it didn't have to be decoded again.
+
+    \sa soundCacheMisses(), soundCacheEvictions()
+*/
+qint64 QAudioEngine::soundCacheHits() const
+{
+    return d->assetCache.statistics().hits;
+}
+
+/*!
+    Returns how often a sound file had to be decoded since the engine was
+    created, because it wasn't in the cache.
+
+    \sa soundCacheHits(), soundCacheEvictions()
+*/
+qint64 QAudioEngine::soundCacheMisses() const
+{
+    return d->assetCache.statistics().misses;
+}
+
+/*!
+    Returns how many decoded sound files were released since the engine was
+    created, to keep the memory used within soundCacheSize.
+
+    \sa soundCacheHits(), soundCacheMisses()
+*/
+qint64 QAudioEngine::soundCacheEvictions() const
+{
+    return d->assetCache.statistics().evictions;
+}
+
+
+QAmbientSoundPrivate::~QAmbientSoundPrivate()
+{
+    // we're not part of an engine anymore, so the voice and its data are ours
+    if (voice->asset)
+        voice->asset->release();
+    if (voice->stream)
+        voice->stream->deleteLater();
+    delete voice;
+}
 
 void QAmbientSoundPrivate::load()
 {
-    decoder.reset(new QAudioDecoder);
-    buffers.clear();
-    currentBuffer = 0;
-    bufPos = 0;
-    m_playing = false;
-    m_loading = true;
+    voice->playing = false;
     auto *ep = QAudioEnginePrivate::get(engine);
-    QAudioFormat f;
-    f.setSampleFormat(QAudioFormat::Float);
-    f.setSampleRate(ep->sampleRate);
-    f.setChannelConfig(nchannels == 2 ? QAudioFormat::ChannelConfigStereo : QAudioFormat::ChannelConfigMono);
-    decoder->setAudioFormat(f);
-    decoder->setSource(url);
+    if (!ep)
+        return;
+    if (url.isEmpty()) {
+        if (asset || stream)
+            setVoiceData(nullptr, nullptr);
+        return;
+    }
 
-    connect(decoder.get(), &QAudioDecoder::bufferReady, this, &QAmbientSoundPrivate::bufferReady);
-    connect(decoder.get(), &QAudioDecoder::finished, this, &QAmbientSoundPrivate::finished);
-    decoder->start();
+    if (streaming) {
+        auto *s = new QAudioStreamReader(url, ep->sampleRate, nchannels, m_loops);
+        if (!ep->streamingThread.isRunning())
+            ep->streamingThread.start();
+        s->moveToThread(&ep->streamingThread);
+        QMetaObject::invokeMethod(s, &QAudioStreamReader::start);
+        setVoiceData(nullptr, s);
+        if (m_autoPlay)
+            voice->playing = true;
+        return;
+    }
+
+    QAudioAsset *a = ep->assetCache.requestAsset(url, ep->sampleRate, nchannels);
+    setVoiceData(a, nullptr);
+    if (a->state() == QAudioAsset::Ready)
+        assetReady();
+    else
+        connect(a, &QAudioAsset::ready, this, &QAmbientSoundPrivate::assetReady);
 }
 
-void QAmbientSoundPrivate::getBuffer(float *buf, int nframes, int channels)
+// Hands new data to the voice. The old data gets released once the audio
+// thread doesn't use it anymore.
+void QAmbientSoundPrivate::setVoiceData(QAudioAsset *a, QAudioStreamReader *s)
 {
-    Q_ASSERT(channels == nchannels);
-    QMutexLocker l(&mutex);
-    if (!m_playing || currentBuffer >= buffers.size()) {
-        memset(buf, 0, nframes*sizeof(float));
-    } else {
-        int frames = nframes;
-        float *ff = buf;
-        while (frames) {
-            const QAudioBuffer &b = buffers.at(currentBuffer);
-//            qDebug() << s << b.format().sampleRate() << b.format().channelCount() << b.format().sampleFormat();
-            auto *f = b.constData<float>() + bufPos*nchannels;
-            int toCopy = qMin(b.frameCount() - bufPos, frames);
-            memcpy(ff, f, toCopy*sizeof(float)*nchannels);
-            ff += toCopy*nchannels;
-            frames -= toCopy;
-            bufPos += toCopy;
-            Q_ASSERT(bufPos <= b.frameCount());
-            if (bufPos == b.frameCount()) {
-                ++currentBuffer;
-                bufPos = 0;
-            }
-            if (!m_loading) {
-                if (currentBuffer == buffers.size()) {
-                    currentBuffer = 0;
-                    ++m_currentLoop;
-                }
-                if (m_loops > 0 && m_currentLoop >= m_loops) {
-                    m_playing = false;
-                    m_currentLoop = 0;
-                }
-            }
-        }
-        Q_ASSERT(ff - buf == channels*nframes);
-    }
+    auto *ep = QAudioEnginePrivate::get(engine);
+    Q_ASSERT(ep);
+    if (asset)
+        disconnect(asset, nullptr, this, nullptr);
+    asset = a;
+    stream = s;
+    ep->postCommand({ QAudioEngineCommand::SetVoiceData, voice, a, s });
 }
 
-void QAmbientSoundPrivate::bufferReady()
+QAudioVoice *QAmbientSoundPrivate::attachVoice(int id)
+{
+    sourceId = id;
+    voice->sourceId = id;
+    voice->channels = nchannels;
+    voice->priority = priority;
+    voice->loops.storeRelaxed(m_loops.loadRelaxed());
+    return voice;
+}
+
+QAudioVoice *QAmbientSoundPrivate::detachVoice()
+{
+    // the old voice and its data now belong to the engine, that deletes them once
+    // the audio thread is done with them
+    if (asset)
+        disconnect(asset, nullptr, this, nullptr);
+    asset = nullptr;
+    stream = nullptr;
+    sourceId = -1;
+    auto *old = voice;
+    voice = new QAudioVoice;
+    voice->channels = nchannels;
+    voice->priority = priority;
+    voice->loops.storeRelaxed(m_loops.loadRelaxed());
+    return old;
+}
+
+void QAmbientSoundPrivate::stop()
+{
+    voice->playing = false;
+    if (auto *ep = QAudioEnginePrivate::get(engine))
+        ep->postCommand({ QAudioEngineCommand::RewindVoice, voice });
+    if (stream)
+        QMetaObject::invokeMethod(stream, &QAudioStreamReader::rewind);
+}
+
+void QAmbientSoundPrivate::setLoops(int loops)
+{
+    m_loops.storeRelaxed(loops);
+    voice->loops.storeRelaxed(loops);
+    if (stream)
+        stream->setLoops(loops);
+}
+
+void QAmbientSoundPrivate::setPriority(float p)
+{
+    priority = p;
+    if (auto *ep = QAudioEnginePrivate::get(engine))
+        ep->postCommand({ QAudioEngineCommand::SetVoicePriority, voice, nullptr, nullptr, p });
+    else
+        voice->priority = p;
+}
+
+void QAmbientSoundPrivate::assetReady()
 {
-    QMutexLocker l(&mutex);
-    auto b = decoder->read();
-//    qDebug() << "read buffer" << b.format() << b.startTime() << b.duration();
-    buffers.append(b);
     if (m_autoPlay)
-        m_playing = true;
+        voice->playing = true;
+}
+
+void QAudioVoice::render(float *buf, int nframes)
+{
+    process(buf, nframes);
+}
+
+// Advances the voice like render() does, without producing any output
+void QAudioVoice::skip(int nframes)
+{
+    if (playing)
+        skipped = true;
+    process(nullptr, nframes);
 }
 
-void QAmbientSoundPrivate::finished()
+void QAudioVoice::process(float *buf, int nframes)
 {
-//    qDebug() << "finished";
-    m_loading = false;
+    if (stream) {
+        // streaming mode, the stream reader takes care of looping
+        auto &ring = stream->ring();
+        if (!playing) {
+            ring.dropDiscarded();
+            if (buf)
+                memset(buf, 0, nframes*channels*sizeof(float));
+            return;
+        }
+        const qsizetype read = buf ? ring.read(buf, nframes) : ring.skip(nframes);
+        if (read < nframes) {
+            if (buf)
+                memset(buf + read*channels, 0, (nframes - read)*channels*sizeof(float));
+            // otherwise the reader didn't keep up with us
+            if (stream->atEnd() && ring.isEmpty()) {
+                playing = false;
+                stream->setEndReached();
+            }
+        }
+        return;
+    }
+
+    if (!playing || !asset || asset->state() != QAudioAsset::Ready || !asset->frameCount()) {
+        if (buf)
+            memset(buf, 0, nframes*channels*sizeof(float));
+        return;
+    }
+
+    const float *data = asset->data();
+    const qint64 frameCount = asset->frameCount();
+    int frames = nframes;
+    float *ff = buf;
+    while (frames) {
+        if (!playing) {
+            if (ff)
+                memset(ff, 0, frames*channels*sizeof(float));
+            break;
+        }
+        int toCopy = qMin(frameCount - framePos, qint64(frames));
+        if (ff) {
+            memcpy(ff, data + framePos*channels, toCopy*sizeof(float)*channels);
+            ff += toCopy*channels;
+        }
+        frames -= toCopy;
+        framePos += toCopy;
+        Q_ASSERT(framePos <= frameCount);
+        if (framePos == frameCount) {
+            framePos = 0;
+            ++currentLoop;
+            const int l = loops.loadRelaxed();
+            if (l > 0 && currentLoop >= l) {
+                playing = false;
+                currentLoop = 0;
+            }
+        }
+    }
 }
 
 QT_END_NAMESPACE
@@ -54,6 +54,12 @@ class Q_SPATIALAUDIO_EXPORT QAudioEngine : public QObject
     Q_PROPERTY(float masterVolume READ masterVolume WRITE setMasterVolume NOTIFY masterVolumeChanged)
     Q_PROPERTY(bool paused READ paused WRITE setPaused NOTIFY pausedChanged)
     Q_PROPERTY(float distanceScale READ distanceScale WRITE setDistanceScale NOTIFY distanceScaleChanged)
+    Q_PROPERTY(int periodSize READ periodSize WRITE setPeriodSize NOTIFY periodSizeChanged)
+    Q_PROPERTY(int bufferTime READ bufferTime WRITE setBufferTime NOTIFY bufferTimeChanged)
+    Q_PROPERTY(int outputLatency READ outputLatency NOTIFY outputLatencyChanged)
+    Q_PROPERTY(int renderThreadCount READ renderThreadCount WRITE setRenderThreadCount NOTIFY renderThreadCountChanged)
+    Q_PROPERTY(int maximumVoiceCount READ maximumVoiceCount WRITE setMaximumVoiceCount NOTIFY maximumVoiceCountChanged)
+    Q_PROPERTY(qint64 soundCacheSize READ soundCacheSize WRITE setSoundCacheSize NOTIFY soundCacheSizeChanged)
 public:
     explicit QAudioEngine(QObject *parent = nullptr, int sampleRate = 44100);
     ~QAudioEngine();
@@ -91,12 +97,40 @@ public:
     void setDistanceScale(float scale);
     float distanceScale() const;
 
+    void setPeriodSize(int frames);
+    int periodSize() const;
+
+    void setBufferTime(int ms);
+    int bufferTime() const;
+
+    int outputLatency() const;
+    qint64 underrunCount() const;
+
+    void setRenderThreadCount(int count);
+    int renderThreadCount() const;
+
+    void setMaximumVoiceCount(int count);
+    int maximumVoiceCount() const;
+
+    void setSoundCacheSize(qint64 bytes);
+    qint64 soundCacheSize() const;
+    qint64 soundCacheUsage() const;
+    qint64 soundCacheHits() const;
+    qint64 soundCacheMisses() const;
+    qint64 soundCacheEvictions() const;
+
 Q_SIGNALS:
     void outputModeChanged();
     void outputDeviceChanged();
     void masterVolumeChanged();
     void pausedChanged();
     void distanceScaleChanged();
+    void periodSizeChanged();
+    void bufferTimeChanged();
+    void outputLatencyChanged();
+    void renderThreadCountChanged();
+    void maximumVoiceCountChanged();
+    void soundCacheSizeChanged();
 
 public Q_SLOTS:
     void pause() { setPaused(true); }
@@ -58,6 +58,9 @@
 #include <qurl.h>
 #include <qaudiobuffer.h>
 #include <qvector3d.h>
+#include <qtimer.h>
+#include <qaudioassetcache_p.h>
+#include <qaudiostreamreader_p.h>
 
 namespace vraudio {
 class ResonanceAudio;
@@ -74,17 +77,126 @@ class QAudioDecoder;
 class QAudioRoom;
 class QAudioListener;
 
+// Bounded single producer/single consumer queue, used to pass data between the
+// application and the audio thread without locking.
+template<typename T, int Capacity>
+class QAudioSpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+public:
+    bool push(const T &value)
+    {
+        const quintptr head = m_head.loadRelaxed();
+        if (head - m_tail.loadAcquire() >= quintptr(Capacity))
+            return false;
+        m_items[head & (Capacity - 1)] = value;
+        m_head.storeRelease(head + 1);
+        return true;
+    }
+    bool pop(T &value)
+    {
+        const quintptr tail = m_tail.loadRelaxed();
+        if (tail == m_head.loadAcquire())
+            return false;
+        value = m_items[tail & (Capacity - 1)];
+        m_tail.storeRelease(tail + 1);
+        return true;
+    }
+    // producer side
+    int freeSpace() const { return Capacity - int(m_head.loadRelaxed() - m_tail.loadAcquire()); }
+
+private:
+    alignas(64) QAtomicInteger<quintptr> m_head = 0;
+    alignas(64) QAtomicInteger<quintptr> m_tail = 0;
+    T m_items[Capacity] = {};
+};
+
+// The part of a sound source that the audio thread works with. Apart from the
+// atomics, it's only changed through engine commands once it has been added to
+// an engine, so rendering never has to wait for the application thread.
+class QAudioVoice
+{
+public:
+    int sourceId = -1;
+    int channels = 2;
+    QAudioAsset *asset = nullptr;
+    QAudioStreamReader *stream = nullptr;
+    qint64 framePos = 0;
+    int currentLoop = 0;
+
+    QAtomicInteger<bool> playing = false;
+    QAtomicInt loops = 1;
+
+    // Spatial voices are managed by the engine's voice limit. A virtual voice
+    // keeps advancing without being rendered.
+    bool spatial = false;
+    float priority = 1.f;
+    bool isVirtual = false;
+    // chosen to be rendered in the current period
+    bool audible = true;
+    // audio got skipped while virtual, so we need to fade in
+    bool skipped = false;
+    // Resonance Audio has calculated the attenuation of the source
+    bool audibilityKnown = false;
+
+    void render(float *buf, int frames);
+    void skip(int frames);
+
+private:
+    void process(float *buf, int frames);
+};
+
+// Storage for the voices of the audio thread. It gets allocated in the application
+// thread and handed over with a command, so adding a voice never allocates while rendering.
+struct QAudioVoiceList
+{
+    explicit QAudioVoiceList(qsizetype capacity)
+    {
+        voices.reserve(capacity);
+        ranks.resize(capacity);
+    }
+    QList<QAudioVoice *> voices;
+    QList<QPair<float, QAudioVoice *>> ranks;
+};
+
+struct QAudioEngineCommand
+{
+    enum Type {
+        AddVoice,
+        RemoveVoice,
+        SetVoiceData,
+        RewindVoice,
+        SetVoicePriority,
+        SetVoiceList
+    };
+    Type type = AddVoice;
+    QAudioVoice *voice = nullptr;
+    QAudioAsset *asset = nullptr;
+    QAudioStreamReader *stream = nullptr;
+    float priority = 1.f;
+    QAudioVoiceList *voiceList = nullptr;
+};
+
 class QAudioEnginePrivate
 {
 public:
     static QAudioEnginePrivate *get(QAudioEngine *engine) { return engine ? engine->d : nullptr; }
 
-    static constexpr int bufferSize = 128;
-
     QAudioEnginePrivate();
     ~QAudioEnginePrivate();
+    QAudioEngine *q = nullptr;
     vraudio::ResonanceAudio *resonanceAudio = nullptr;
     int sampleRate = 44100;
+    // number of frames Resonance Audio processes at a time
+    int periodSize = 128;
+    // We'd like to have short buffer times, so the sound adjusts itself to changes
+    // quickly, but times below 100ms seem to give stuttering on macOS.
+    // It might be possible to set this value lower on other OSes.
+    int bufferTimeMs = 100;
+    // the latency of the running audio sink, in ms
+    QAtomicInt outputLatency = 0;
+    // number of threads sound sources are processed on, including the audio thread
+    int renderThreadCount = 1;
     float masterVolume = 1.;
     QAudioEngine::OutputMode outputMode = QAudioEngine::Surround;
     bool roomEffectsEnabled = true;
@@ -99,25 +211,68 @@ public:
     QAtomicInteger<bool> paused = false;
 
     QThread audioThread;
+    // decodes sources in streaming mode, started on first use
+    QThread streamingThread;
     std::unique_ptr<QAudioOutputStream> outputStream;
     std::unique_ptr<QAmbisonicDecoder> ambisonicDecoder;
 
+    // decoded sound files, shared between all sources of this engine
+    QAudioAssetCache assetCache;
+
     QAudioListener *listener = nullptr;
     QList<QSpatialSound *> sources;
     QList<QAmbientSound *> stereoSources;
     QList<QAudioRoom *> rooms;
     mutable bool listenerPositionDirty = true;
     QAudioRoom *currentRoom = nullptr;
+    // coalesces room and listener changes, rooms are updated in the application thread
+    QTimer roomUpdateTimer;
+
+    // Commands from the application thread to the audio thread. Commands that don't fit
+    // into the queue are kept in pendingCommands until the audio thread catches up.
+    enum { CommandQueueSize = 1024 };
+    QAudioSpscQueue<QAudioEngineCommand, CommandQueueSize> commands;
+    QList<QAudioEngineCommand> pendingCommands;
+    // Data the audio thread doesn't use anymore, released in the application thread.
+    // Every command can retire at most one item, so this can't overflow.
+    QAudioSpscQueue<QAudioEngineCommand, CommandQueueSize> retired;
+    QTimer commandTimer;
+    // only accessed by the thread processing commands, never reallocated there
+    QList<QAudioVoice *> voices;
+    // scratch space to rank the voices by audibility
+    QList<QPair<float, QAudioVoice *>> voiceRanks;
+    // number of voices the voice list of the audio thread can hold, only
+    // accessed by the application thread
+    qsizetype voiceCapacity = 0;
+    // maximum number of spatial voices rendered at a time, 0 for no limit
+    QAtomicInt maximumVoiceCount = 0;
+    // number of times the audio device ran out of data, as reported by the
+    // audio thread of the sink. Updated by the render callback.
+    QAtomicInteger<qint64> underruns = 0;
 
     void addSpatialSound(QSpatialSound *sound);
     void removeSpatialSound(QSpatialSound *sound);
     void addStereoSound(QAmbientSound *sound);
     void removeStereoSound(QAmbientSound *sound);
 
+    void reserveVoice();
+    void createResonanceAudio();
+
     void addRoom(QAudioRoom *room);
     void removeRoom(QAudioRoom *room);
+    void scheduleRoomUpdate();
     void updateRooms();
 
+    void postCommand(const QAudioEngineCommand &command);
+    void flushCommands();
+    // called from the audio thread while rendering, or the application thread otherwise
+    void processCommands();
+    void applyCommand(const QAudioEngineCommand &command);
+    void collectRetired();
+    // called from the audio thread before rendering a period
+    void updateAudibleVoices();
+    bool isRendering() const { return outputStream != nullptr; }
+
     QVector3D listenerPosition() const;
 };
 
@@ -127,51 +282,56 @@ public:
     QAmbientSoundPrivate(QObject *parent, int nchannels = 2)
         : QObject(parent)
         , nchannels(nchannels)
-    {}
+        , voice(new QAudioVoice)
+    {
+        voice->channels = nchannels;
+    }
+    ~QAmbientSoundPrivate();
 
     template<typename T>
     static QAmbientSoundPrivate *get(T *soundSource) { return soundSource ? soundSource->d : nullptr; }
+    template<typename T>
+    static void removeFromEngine(T *soundSource) { soundSource->setEngine(nullptr); }
 
 
     QUrl url;
     float volume = 1.;
     int nchannels = 2;
-    std::unique_ptr<QAudioDecoder> decoder;
     QAudioEngine *engine = nullptr;
 
-    QMutex mutex;
-    int currentBuffer = 0;
-    int bufPos = 0;
-    int m_currentLoop = 0;
-    QList<QAudioBuffer> buffers;
+    // Owned by us while we're not part of an engine, the engine's audio thread
+    // renders it otherwise. Replaced by a new one when removed from the engine.
+    QAudioVoice *voice = nullptr;
+    // the data currently handed to the voice. The asset is shared with all other
+    // sources playing the same file, the stream reader is only used in streaming mode.
+    QAudioAsset *asset = nullptr;
+    QAudioStreamReader *stream = nullptr;
+    bool streaming = false;
     int sourceId = -1; // kInvalidSourceId
 
     QAtomicInteger<bool> m_autoPlay = true;
-    QAtomicInteger<bool> m_playing = false;
     QAtomicInt m_loops = 1;
-    bool m_loading = false;
+    float priority = 1.f;
 
     void play() {
-        m_playing = true;
+        voice->playing = true;
     }
     void pause() {
-        m_playing = false;
-    }
-    void stop() {
-        QMutexLocker locker(&mutex);
-        m_playing = false;
-        currentBuffer = 0;
-        bufPos = 0;
-        m_currentLoop = 0;
+        voice->playing = false;
     }
+    void stop();
+    void setLoops(int loops);
+    void setPriority(float priority);
 
     void load();
-    void getBuffer(float *buf, int frames, int channels);
+    QAudioVoice *attachVoice(int sourceId);
+    QAudioVoice *detachVoice();
 
 private Q_SLOTS:
-    void bufferReady();
-    void finished();
+    void assetReady();
 
+private:
+    void setVoiceData(QAudioAsset *asset, QAudioStreamReader *stream);
 };
 
 QT_END_NAMESPACE
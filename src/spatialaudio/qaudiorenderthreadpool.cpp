@@ -0,0 +1,94 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiorenderthreadpool_p.h"
+
+QT_BEGIN_NAMESPACE
+
+QAudioRenderThreadPool::QAudioRenderThreadPool(int nWorkers)
+{
+    for (int i = 0; i < nWorkers; ++i) {
+        auto *worker = QThread::create([this]() { workerLoop(); });
+        worker->setObjectName(QStringLiteral("QAudioRenderThread"));
+        worker->start(QThread::TimeCriticalPriority);
+        workers.append(worker);
+    }
+}
+
+QAudioRenderThreadPool::~QAudioRenderThreadPool()
+{
+    quit = true;
+    startSemaphore.release(workers.size());
+    for (auto *worker : qAsConst(workers)) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+void QAudioRenderThreadPool::Execute(size_t num_tasks, TaskFunction f, void *c)
+{
+    function = f;
+    context = c;
+    nTasks = int(num_tasks);
+    nextTask.storeRelaxed(0);
+
+    startSemaphore.release(workers.size());
+    runTasks();
+    // the tasks write into state owned by the caller, so we have to wait
+    // for all workers, not just for all tasks to be taken
+    doneSemaphore.acquire(workers.size());
+}
+
+void QAudioRenderThreadPool::workerLoop()
+{
+    for (;;) {
+        startSemaphore.acquire();
+        if (quit)
+            return;
+        runTasks();
+        doneSemaphore.release();
+    }
+}
+
+void QAudioRenderThreadPool::runTasks()
+{
+    int task;
+    while ((task = nextTask.fetchAndAddRelaxed(1)) < nTasks)
+        function(context, size_t(task));
+}
+
+QT_END_NAMESPACE
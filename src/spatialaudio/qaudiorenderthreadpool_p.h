@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QAUDIORENDERTHREADPOOL_P_H
+#define QAUDIORENDERTHREADPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <qtspatialaudioglobal_p.h>
+#include <qthread.h>
+#include <qsemaphore.h>
+#include <qatomic.h>
+#include <qlist.h>
+#include <base/parallel_executor.h>
+
+QT_BEGIN_NAMESPACE
+
+// A fixed set of real time worker threads, used by Resonance Audio to process
+// sound sources in parallel. The thread calling Execute() takes part in the
+// work, so a pool with n workers processes on n + 1 threads.
+class QAudioRenderThreadPool : public vraudio::ParallelExecutor
+{
+public:
+    explicit QAudioRenderThreadPool(int nWorkers);
+    ~QAudioRenderThreadPool();
+
+    size_t GetNumThreads() const override { return workers.size() + 1; }
+    void Execute(size_t num_tasks, TaskFunction function, void *context) override;
+
+private:
+    void workerLoop();
+    void runTasks();
+
+    QList<QThread *> workers;
+    QSemaphore startSemaphore;
+    QSemaphore doneSemaphore;
+    bool quit = false;
+
+    // the current job, only written while the workers are waiting
+    TaskFunction function = nullptr;
+    void *context = nullptr;
+    int nTasks = 0;
+    QAtomicInt nextTask = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif
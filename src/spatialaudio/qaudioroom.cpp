@@ -122,6 +122,13 @@ float QAudioRoomPrivate::wallDampening(QAudioRoom::Wall wall) const
     return m_wallDampening[wall] < 0 ? occlusionAndDampening[roomProperties.material_names[wall]].dampening : m_wallDampening[wall];
 }
 
+void QAudioRoomPrivate::markDirty()
+{
+    dirty = true;
+    if (auto *ep = QAudioEnginePrivate::get(engine))
+        ep->scheduleRoomUpdate();
+}
+
 void QAudioRoomPrivate::update()
 {
     if (!dirty)
@@ -234,7 +241,7 @@ void QAudioRoom::setPosition(QVector3D pos)
     if (toVector(d->roomProperties.position) == pos)
         return;
     toFloats(pos, d->roomProperties.position);
-    d->dirty = true;
+    d->markDirty();
     emit positionChanged();
 }
 
@@ -261,7 +268,7 @@ void QAudioRoom::setDimensions(QVector3D dim)
     if (toVector(d->roomProperties.dimensions) == dim)
         return;
     toFloats(dim, d->roomProperties.dimensions);
-    d->dirty = true;
+    d->markDirty();
     emit dimensionsChanged();
 }
 
@@ -283,7 +290,7 @@ void QAudioRoom::setRotation(const QQuaternion &q)
     if (toQuaternion(d->roomProperties.rotation) == q)
         return;
     toFloats(q, d->roomProperties.rotation);
-    d->dirty = true;
+    d->markDirty();
     emit rotationChanged();
 }
 
@@ -308,7 +315,7 @@ void QAudioRoom::setWallMaterial(Wall wall, Material material)
     if (d->roomProperties.material_names[int(wall)] == int(material))
         return;
     d->roomProperties.material_names[int(wall)] = vraudio::MaterialName(int(material));
-    d->dirty = true;
+    d->markDirty();
     emit wallsChanged();
 }
 
@@ -339,7 +346,7 @@ void QAudioRoom::setReflectionGain(float factor)
     if (d->roomProperties.reflection_scalar == factor)
         return;
     d->roomProperties.reflection_scalar = factor;
-    d->dirty = true;
+    d->markDirty();
     reflectionGainChanged();
 }
 
@@ -365,7 +372,7 @@ void QAudioRoom::setReverbGain(float factor)
     if (d->roomProperties.reverb_gain == factor)
         return;
     d->roomProperties.reverb_gain = factor;
-    d->dirty = true;
+    d->markDirty();
     reverbGainChanged();
 }
 
@@ -390,7 +397,7 @@ void QAudioRoom::setReverbTime(float factor)
     if (d->roomProperties.reverb_time == factor)
         return;
     d->roomProperties.reverb_time = factor;
-    d->dirty = true;
+    d->markDirty();
     reverbTimeChanged();
 }
 
@@ -413,7 +420,7 @@ void QAudioRoom::setReverbBrightness(float factor)
     if (d->roomProperties.reverb_brightness == factor)
         return;
     d->roomProperties.reverb_brightness = factor;
-    d->dirty = true;
+    d->markDirty();
     reverbBrightnessChanged();
 }
 
@@ -76,6 +76,7 @@ public:
     float wallOcclusion(QAudioRoom::Wall wall) const;
     float wallDampening(QAudioRoom::Wall wall) const;
 
+    void markDirty();
     void update();
 };
 
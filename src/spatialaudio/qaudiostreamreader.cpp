@@ -0,0 +1,227 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiostreamreader_p.h"
+#include <qaudiodecoder.h>
+#include <qdebug.h>
+
+QT_BEGIN_NAMESPACE
+
+// Size of the ring buffer and interval in which it gets refilled. With the default
+// sample rate, the ring holds around 1.5 seconds of audio.
+static constexpr qsizetype ringBufferFrames = 65536;
+static constexpr int refillIntervalMs = 50;
+
+QAudioRingBuffer::QAudioRingBuffer(qsizetype minimumFrames, int channels)
+    : m_channels(channels)
+{
+    quintptr capacity = 2;
+    while (capacity < quintptr(minimumFrames))
+        capacity <<= 1;
+    m_mask = capacity - 1;
+    m_data.reset(new float[capacity*channels]);
+}
+
+qsizetype QAudioRingBuffer::write(const float *data, qsizetype frames)
+{
+    const quintptr writePos = m_writePos.loadRelaxed();
+    const quintptr available = capacity() - (writePos - m_readPos.loadAcquire());
+    frames = qMin(frames, qsizetype(available));
+
+    qsizetype written = 0;
+    while (written < frames) {
+        const quintptr index = (writePos + written) & m_mask;
+        const qsizetype toCopy = qMin(frames - written, qsizetype(capacity() - index));
+        memcpy(m_data.get() + index*m_channels, data + written*m_channels, toCopy*m_channels*sizeof(float));
+        written += toCopy;
+    }
+    m_writePos.storeRelease(writePos + written);
+    return written;
+}
+
+qsizetype QAudioRingBuffer::read(float *data, qsizetype frames)
+{
+    dropDiscarded();
+    const quintptr readPos = m_readPos.loadRelaxed();
+    const quintptr available = m_writePos.loadAcquire() - readPos;
+    frames = qMin(frames, qsizetype(available));
+
+    qsizetype read = 0;
+    while (read < frames) {
+        const quintptr index = (readPos + read) & m_mask;
+        const qsizetype toCopy = qMin(frames - read, qsizetype(capacity() - index));
+        memcpy(data + read*m_channels, m_data.get() + index*m_channels, toCopy*m_channels*sizeof(float));
+        read += toCopy;
+    }
+    m_readPos.storeRelease(readPos + read);
+    return read;
+}
+
+qsizetype QAudioRingBuffer::skip(qsizetype frames)
+{
+    dropDiscarded();
+    const quintptr readPos = m_readPos.loadRelaxed();
+    const quintptr available = m_writePos.loadAcquire() - readPos;
+    frames = qMin(frames, qsizetype(available));
+    m_readPos.storeRelease(readPos + frames);
+    return frames;
+}
+
+void QAudioRingBuffer::dropDiscarded()
+{
+    const quintptr discardPos = m_discardPos.loadAcquire();
+    if (qintptr(discardPos - m_readPos.loadRelaxed()) > 0)
+        m_readPos.storeRelease(discardPos);
+}
+
+QAudioStreamReader::QAudioStreamReader(const QUrl &url, int sampleRate, int channels, int loops)
+    : m_url(url)
+    , m_sampleRate(sampleRate)
+    , m_channels(channels)
+    , m_loops(loops)
+    , m_ring(ringBufferFrames, channels)
+    , m_refillTimer(this)
+{
+}
+
+QAudioStreamReader::~QAudioStreamReader() = default;
+
+// Called in the streaming thread after the reader has been moved there, so that
+// the decoder lives in that thread as well
+void QAudioStreamReader::start()
+{
+    m_decoder.reset(new QAudioDecoder);
+    QAudioFormat f;
+    f.setSampleFormat(QAudioFormat::Float);
+    f.setSampleRate(m_sampleRate);
+    f.setChannelConfig(m_channels == 2 ? QAudioFormat::ChannelConfigStereo : QAudioFormat::ChannelConfigMono);
+    m_decoder->setAudioFormat(f);
+    m_decoder->setSource(m_url);
+
+    connect(m_decoder.get(), &QAudioDecoder::bufferReady, this, &QAudioStreamReader::refill);
+    connect(m_decoder.get(), &QAudioDecoder::finished, this, &QAudioStreamReader::decodingFinished);
+    connect(m_decoder.get(), &QAudioDecoder::error, this, &QAudioStreamReader::decodingError);
+
+    // the decoder only notifies us about new data, poll for space in the ring
+    connect(&m_refillTimer, &QTimer::timeout, this, &QAudioStreamReader::refill);
+    m_refillTimer.start(refillIntervalMs);
+
+    m_decoder->start();
+}
+
+void QAudioStreamReader::rewind()
+{
+    if (!m_decoder)
+        return;
+    m_ring.discard();
+    m_currentLoop = 0;
+    m_atEnd.storeRelease(false);
+    m_endReached.storeRelease(false);
+    restartDecoder();
+}
+
+void QAudioStreamReader::restartDecoder()
+{
+    m_pending = {};
+    m_pendingOffset = 0;
+    m_decoderFinished = false;
+    // stopping emits finished(), which we don't want to handle here
+    m_restarting = true;
+    m_decoder->stop();
+    m_decoder->start();
+    m_restarting = false;
+}
+
+void QAudioStreamReader::refill()
+{
+    if (!m_decoder)
+        return;
+    if (m_endReached.loadAcquire()) {
+        // prepare for the next play()
+        rewind();
+        return;
+    }
+
+    while (true) {
+        if (!m_pending.isValid()) {
+            if (!m_decoder->bufferAvailable())
+                break;
+            // reading lets the decoder start working on the next buffer
+            m_pending = m_decoder->read();
+            m_pendingOffset = 0;
+            if (!m_pending.isValid())
+                break;
+        }
+        const qsizetype frames = m_pending.frameCount() - m_pendingOffset;
+        const qsizetype written = m_ring.write(m_pending.constData<float>() + m_pendingOffset*m_channels, frames);
+        m_pendingOffset += written;
+        if (written < frames)
+            return; // ring is full
+        m_pending = {};
+    }
+
+    if (!m_decoderFinished || m_atEnd.loadRelaxed())
+        return;
+
+    ++m_currentLoop;
+    const int loops = m_loops.loadRelaxed();
+    if (loops > 0 && m_currentLoop >= loops) {
+        m_atEnd.storeRelease(true);
+        return;
+    }
+    // start over instead of keeping the decoded data around
+    restartDecoder();
+}
+
+void QAudioStreamReader::decodingFinished()
+{
+    if (m_restarting)
+        return;
+    m_decoderFinished = true;
+    refill();
+}
+
+void QAudioStreamReader::decodingError()
+{
+    qWarning() << "QAudioStreamReader: Could not decode" << m_url << m_decoder->errorString();
+    m_refillTimer.stop();
+    m_atEnd.storeRelease(true);
+}
+
+QT_END_NAMESPACE
+
+#include "moc_qaudiostreamreader_p.cpp"
@@ -0,0 +1,151 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL-NOGPL2$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 or (at your option) any later version
+** approved by the KDE Free Qt Foundation. The licenses are as published by
+** the Free Software Foundation and appearing in the file LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#ifndef QAUDIOSTREAMREADER_P_H
+#define QAUDIOSTREAMREADER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <qtspatialaudioglobal_p.h>
+#include <qobject.h>
+#include <qurl.h>
+#include <qtimer.h>
+#include <qatomic.h>
+#include <qaudiobuffer.h>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QAudioDecoder;
+
+// Single producer/single consumer ring buffer of interleaved float samples.
+// write() and discard() may only be called from the producer thread, read()
+// and dropDiscarded() only from the consumer thread.
+class QAudioRingBuffer
+{
+public:
+    QAudioRingBuffer(qsizetype minimumFrames, int channels);
+    Q_DISABLE_COPY(QAudioRingBuffer)
+
+    qsizetype capacity() const { return qsizetype(m_mask + 1); }
+
+    // producer side, returns the number of frames written
+    qsizetype write(const float *data, qsizetype frames);
+    // Drops everything that has been written so far. The consumer releases the
+    // space on its next call to read() or dropDiscarded().
+    void discard() { m_discardPos.storeRelease(m_writePos.loadRelaxed()); }
+
+    // consumer side, returns the number of frames read or skipped
+    qsizetype read(float *data, qsizetype frames);
+    qsizetype skip(qsizetype frames);
+    void dropDiscarded();
+
+    bool isEmpty() const { return m_writePos.loadAcquire() == m_readPos.loadAcquire(); }
+
+private:
+    alignas(64) QAtomicInteger<quintptr> m_writePos = 0;
+    alignas(64) QAtomicInteger<quintptr> m_readPos = 0;
+    alignas(64) QAtomicInteger<quintptr> m_discardPos = 0;
+    quintptr m_mask = 0;
+    int m_channels = 0;
+    std::unique_ptr<float[]> m_data;
+};
+
+// Decodes a sound file incrementally into a fixed size ring buffer, so that the
+// memory used does not depend on the length of the file. Lives in the streaming
+// thread of the engine, the audio thread only reads from ring().
+class QAudioStreamReader : public QObject
+{
+    Q_OBJECT
+public:
+    QAudioStreamReader(const QUrl &url, int sampleRate, int channels, int loops);
+    ~QAudioStreamReader();
+
+    QAudioRingBuffer &ring() { return m_ring; }
+
+    // Can be called from any thread
+    void setLoops(int loops) { m_loops.storeRelaxed(loops); }
+
+    // All data of the last loop has been written to the ring
+    bool atEnd() const { return m_atEnd.loadAcquire(); }
+    // called from the audio thread once it has played everything, rewinds the stream
+    void setEndReached() { m_endReached.storeRelease(true); }
+
+public Q_SLOTS:
+    void start();
+    void rewind();
+
+private Q_SLOTS:
+    void refill();
+    void decodingFinished();
+    void decodingError();
+
+private:
+    void restartDecoder();
+
+    QUrl m_url;
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    QAtomicInt m_loops = 1;
+    int m_currentLoop = 0;
+
+    QAudioRingBuffer m_ring;
+    std::unique_ptr<QAudioDecoder> m_decoder;
+    QTimer m_refillTimer;
+    // partially written decoder output
+    QAudioBuffer m_pending;
+    qsizetype m_pendingOffset = 0;
+    bool m_decoderFinished = false;
+    bool m_restarting = false;
+
+    QAtomicInteger<bool> m_atEnd = false;
+    QAtomicInteger<bool> m_endReached = false;
+};
+
+QT_END_NAMESPACE
+
+#endif
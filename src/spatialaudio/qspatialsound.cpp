@@ -528,7 +528,8 @@ int QSpatialSound::loops() const
 
 void QSpatialSound::setLoops(int loops)
 {
-    int oldLoops = d->m_loops.fetchAndStoreRelaxed(loops);
+    int oldLoops = d->m_loops.loadRelaxed();
+    d->setLoops(loops);
     if (oldLoops != loops)
         emit loopsChanged();
 }
@@ -553,6 +554,62 @@ void QSpatialSound::setAutoPlay(bool autoPlay)
         emit autoPlayChanged();
 }
 
+/*!
+   \property QSpatialSound::streaming
+
+    Determines whether the sound file is decoded while playing instead of
+    being decoded completely up front.
+
+    In streaming mode, only a small amount of decoded audio is kept in memory,
+    independent of the length of the file. Looping restarts decoding from the
+    beginning of the file. This is well suited for long sounds such as background
+    music. Short sounds that are played by many sources should not be streamed,
+    as their decoded data is shared between all sources playing the same file.
+
+    Changing this property reloads the source.
+
+    The default value is \c false.
+ */
+bool QSpatialSound::streaming() const
+{
+    return d->streaming;
+}
+
+void QSpatialSound::setStreaming(bool streaming)
+{
+    if (d->streaming == streaming)
+        return;
+    d->streaming = streaming;
+    if (!d->url.isEmpty())
+        d->load();
+    emit streamingChanged();
+}
+
+/*!
+   \property QSpatialSound::priority
+
+    Weights the audibility of the sound when the engine has to choose which
+    sounds to render. Sounds with a higher priority are kept audible over
+    sounds with a lower priority that are just as loud at the listener's position.
+
+    The default value is \c 1.
+
+    \sa QAudioEngine::maximumVoiceCount
+ */
+float QSpatialSound::priority() const
+{
+    return d->priority;
+}
+
+void QSpatialSound::setPriority(float priority)
+{
+    priority = qMax(priority, 0.f);
+    if (d->priority == priority)
+        return;
+    d->setPriority(priority);
+    emit priorityChanged();
+}
+
 /*!
     Starts playing back the sound. Does nothing if the sound is already playing.
  */
@@ -585,11 +642,14 @@ void QSpatialSound::setEngine(QAudioEngine *engine)
 {
     if (d->engine == engine)
         return;
-    auto *ep = QAudioEnginePrivate::get(engine);
+    auto *ep = QAudioEnginePrivate::get(d->engine);
 
     if (ep)
         ep->removeSpatialSound(this);
     d->engine = engine;
+    // decoded data is cached per engine, so we need to fetch it again
+    if (!d->url.isEmpty())
+        d->load();
 
     ep = QAudioEnginePrivate::get(engine);
     if (ep) {
@@ -65,6 +65,8 @@ class Q_SPATIALAUDIO_EXPORT QSpatialSound : public QObject
     Q_PROPERTY(float nearFieldGain READ nearFieldGain WRITE setNearFieldGain NOTIFY nearFieldGainChanged)
     Q_PROPERTY(int loops READ loops WRITE setLoops NOTIFY loopsChanged)
     Q_PROPERTY(bool autoPlay READ autoPlay WRITE setAutoPlay NOTIFY autoPlayChanged)
+    Q_PROPERTY(bool streaming READ streaming WRITE setStreaming NOTIFY streamingChanged)
+    Q_PROPERTY(float priority READ priority WRITE setPriority NOTIFY priorityChanged)
 
 public:
     explicit QSpatialSound(QAudioEngine *engine);
@@ -86,6 +88,12 @@ public:
     bool autoPlay() const;
     void setAutoPlay(bool autoPlay);
 
+    bool streaming() const;
+    void setStreaming(bool streaming);
+
+    float priority() const;
+    void setPriority(float priority);
+
     void setPosition(QVector3D pos);
     QVector3D position() const;
 
@@ -132,6 +140,8 @@ Q_SIGNALS:
     void sourceChanged();
     void loopsChanged();
     void autoPlayChanged();
+    void streamingChanged();
+    void priorityChanged();
     void positionChanged();
     void rotationChanged();
     void volumeChanged();
@@ -80,6 +80,7 @@ QQuick3DAudioEngine::QQuick3DAudioEngine()
     connect(e, &QAudioEngine::outputModeChanged, this, &QQuick3DAudioEngine::outputModeChanged);
     connect(e, &QAudioEngine::outputDeviceChanged, this, &QQuick3DAudioEngine::outputDeviceChanged);
     connect(e, &QAudioEngine::masterVolumeChanged, this, &QQuick3DAudioEngine::masterVolumeChanged);
+    connect(e, &QAudioEngine::maximumVoiceCountChanged, this, &QQuick3DAudioEngine::maximumVoiceCountChanged);
 }
 
 QQuick3DAudioEngine::~QQuick3DAudioEngine()
@@ -147,6 +148,26 @@ float QQuick3DAudioEngine::masterVolume() const
     return globalEngine->masterVolume();
 }
 
+/*!
+    \qmlproperty int AudioEngine::maximumVoiceCount
+
+    Sets or returns the maximum number of SpatialSound objects that are rendered at
+    the same time. Additional sounds continue playing silently, and the engine renders
+    the ones that are most audible at the listener's position. The default is 0,
+    meaning there is no limit.
+
+    \sa SpatialSound::priority
+ */
+void QQuick3DAudioEngine::setMaximumVoiceCount(int count)
+{
+    globalEngine->setMaximumVoiceCount(count);
+}
+
+int QQuick3DAudioEngine::maximumVoiceCount() const
+{
+    return globalEngine->maximumVoiceCount();
+}
+
 QAudioEngine *QQuick3DAudioEngine::getEngine()
 {
     if (!globalEngine) {
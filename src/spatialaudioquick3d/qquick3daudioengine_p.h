@@ -52,6 +52,7 @@ class QQuick3DAudioEngine : public QObject
     Q_PROPERTY(OutputMode outputMode READ outputMode WRITE setOutputMode NOTIFY outputModeChanged)
     Q_PROPERTY(QAudioDevice outputDevice READ outputDevice WRITE setOutputDevice NOTIFY outputDeviceChanged)
     Q_PROPERTY(float masterVolume READ masterVolume WRITE setMasterVolume NOTIFY masterVolumeChanged)
+    Q_PROPERTY(int maximumVoiceCount READ maximumVoiceCount WRITE setMaximumVoiceCount NOTIFY maximumVoiceCountChanged)
 
 public:
     // Keep in sync with QAudioEngine::OutputMode
@@ -74,12 +75,16 @@ public:
     void setMasterVolume(float volume);
     float masterVolume() const;
 
+    void setMaximumVoiceCount(int count);
+    int maximumVoiceCount() const;
+
     static QAudioEngine *getEngine();
 
 Q_SIGNALS:
     void outputModeChanged();
     void outputDeviceChanged();
     void masterVolumeChanged();
+    void maximumVoiceCountChanged();
 };
 
 QT_END_NAMESPACE
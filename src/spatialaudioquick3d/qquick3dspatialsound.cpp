@@ -75,6 +75,7 @@ QQuick3DSpatialSound::QQuick3DSpatialSound()
     connect(m_sound, &QSpatialSound::nearFieldGainChanged, this, &QQuick3DSpatialSound::nearFieldGainChanged);
     connect(m_sound, &QSpatialSound::loopsChanged, this, &QQuick3DSpatialSound::loopsChanged);
     connect(m_sound, &QSpatialSound::autoPlayChanged, this, &QQuick3DSpatialSound::autoPlayChanged);
+    connect(m_sound, &QSpatialSound::priorityChanged, this, &QQuick3DSpatialSound::priorityChanged);
 }
 
 QQuick3DSpatialSound::~QQuick3DSpatialSound()
@@ -315,6 +316,27 @@ void QQuick3DSpatialSound::setAutoPlay(bool autoPlay)
     m_sound->setAutoPlay(autoPlay);
 }
 
+/*!
+    \qmlproperty float SpatialSound::priority
+
+    Weights the audibility of the sound when the engine has to choose which
+    sounds to render. Sounds with a higher priority are kept audible over
+    sounds with a lower priority that are just as loud at the listener's position.
+
+    The default value is \c 1.
+
+    \sa AudioEngine::maximumVoiceCount
+ */
+float QQuick3DSpatialSound::priority() const
+{
+    return m_sound->priority();
+}
+
+void QQuick3DSpatialSound::setPriority(float priority)
+{
+    m_sound->setPriority(priority);
+}
+
 /*!
     \qmlmethod SpatialSound::play()
 
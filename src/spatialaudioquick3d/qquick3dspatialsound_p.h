@@ -59,6 +59,7 @@ class QQuick3DSpatialSound : public QQuick3DNode
     Q_PROPERTY(float nearFieldGain READ nearFieldGain WRITE setNearFieldGain NOTIFY nearFieldGainChanged)
     Q_PROPERTY(int loops READ loops WRITE setLoops NOTIFY loopsChanged)
     Q_PROPERTY(bool autoPlay READ autoPlay WRITE setAutoPlay NOTIFY autoPlayChanged)
+    Q_PROPERTY(float priority READ priority WRITE setPriority NOTIFY priorityChanged)
     QML_NAMED_ELEMENT(SpatialSound)
 
 public:
@@ -115,6 +116,9 @@ public:
     bool autoPlay() const;
     void setAutoPlay(bool autoPlay);
 
+    float priority() const;
+    void setPriority(float priority);
+
 public Q_SLOTS:
     void play();
     void pause();
@@ -133,6 +137,7 @@ Q_SIGNALS:
     void nearFieldGainChanged();
     void loopsChanged();
     void autoPlayChanged();
+    void priorityChanged();
 
 private Q_SLOTS:
     void updatePosition();
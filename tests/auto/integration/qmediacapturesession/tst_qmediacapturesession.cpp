@@ -31,6 +31,7 @@
 #include <QtTest/QtTest>
 #include <QtGui/QImageReader>
 #include <QtCore/qurl.h>
+#include <QtCore/qtemporarydir.h>
 #include <QDebug>
 #include <QVideoSink>
 #include <QVideoWidget>
@@ -95,6 +96,7 @@ private slots:
     void can_record_AudioInput_with_null_AudioDevice();
     void can_record_Camera_with_null_CameraDevice();
     void recording_stops_when_recorder_removed();
+    void recording_is_split_into_segments();
 
     void can_add_and_remove_ImageCapture();
     void can_move_ImageCapture_between_sessions();
@@ -785,6 +787,62 @@ void tst_QMediaCaptureSession::recording_stops_when_recorder_removed()
     QFile(fileName).remove();
 }
 
+void tst_QMediaCaptureSession::recording_is_split_into_segments()
+{
+    QCamera camera;
+    QAudioInput input;
+    if (!camera.isAvailable() || input.device().isNull())
+        QSKIP("Camera and audio input are not available");
+
+    QMediaRecorder recorder;
+    QMediaCaptureSession session;
+    session.setCamera(&camera);
+    session.setAudioInput(&input);
+    session.setRecorder(&recorder);
+    camera.setActive(true);
+    QTRY_VERIFY(camera.isActive());
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    recorder.setOutputLocation(QUrl::fromLocalFile(dir.filePath(QStringLiteral("segments.mp4"))));
+    recorder.setMediaFormat(QMediaFormat(QMediaFormat::MPEG4));
+    recorder.setSegmentDuration(1000);
+
+    QSignalSpy recorderErrorSignal(&recorder, SIGNAL(errorOccurred(Error, const QString &)));
+    QSignalSpy segmentFinished(&recorder, &QMediaRecorder::segmentFinished);
+
+    recorder.record();
+    QTRY_VERIFY_WITH_TIMEOUT(recorder.recorderState() == QMediaRecorder::RecordingState, 2000);
+    // the cut happens at the first key frame after a second
+    const bool split = segmentFinished.wait(10000);
+    recorder.stop();
+    QTRY_VERIFY_WITH_TIMEOUT(recorder.recorderState() == QMediaRecorder::StoppedState, 2000);
+    if (!split)
+        QSKIP("The backend doesn't split recordings into segments");
+    QVERIFY(recorderErrorSignal.isEmpty());
+
+    // stopping finishes the last segment
+    QTRY_VERIFY(segmentFinished.count() >= 2);
+
+    QSet<QUrl> locations;
+    for (const auto &arguments : qAsConst(segmentFinished)) {
+        const QUrl location = arguments.at(0).toUrl();
+        QVERIFY(!locations.contains(location));
+        locations.insert(location);
+        QVERIFY(QFileInfo(location.toLocalFile()).size() > 0);
+
+        // Every segment has to play on its own. Audio encoded before the key frame
+        // a segment starts at goes to the previous one, so each of them has audio
+        // that doesn't start before its video.
+        QMediaPlayer player;
+        player.setSource(location);
+        QTRY_VERIFY_WITH_TIMEOUT(player.mediaStatus() == QMediaPlayer::LoadedMedia, 2000);
+        QVERIFY(player.hasVideo());
+        QVERIFY(player.hasAudio());
+        QVERIFY(player.duration() > 0);
+    }
+}
+
 void tst_QMediaCaptureSession::can_add_and_remove_ImageCapture()
 {
     QCamera camera;
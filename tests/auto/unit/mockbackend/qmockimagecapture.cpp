@@ -43,13 +43,19 @@ bool QMockImageCapture::isReadyForCapture() const
 }
 
 int QMockImageCapture::capture(const QString &fileName)
+{
+    return captureBurst(fileName, 1);
+}
+
+int QMockImageCapture::captureBurst(const QString &fileName, int count)
 {
     if (isReadyForCapture()) {
         m_fileName = fileName;
-        m_captureRequest++;
+        m_firstRequest = m_captureRequest + 1;
+        m_captureRequest += count;
         emit readyForCaptureChanged(m_ready = false);
         QTimer::singleShot(5, this, SLOT(captured()));
-        return m_captureRequest;
+        return m_firstRequest;
     } else {
         emit error(-1, QImageCapture::NotReadyError,
                    QLatin1String("Could not capture in stopped state"));
@@ -60,19 +66,23 @@ int QMockImageCapture::capture(const QString &fileName)
 
 void QMockImageCapture::captured()
 {
-    emit imageCaptured(m_captureRequest, QImage());
+    for (int id = m_firstRequest; id <= m_captureRequest; ++id)
+        emit imageCaptured(id, QImage());
 
     QMediaMetaData metaData;
     metaData.insert(QMediaMetaData::Author, QString::fromUtf8("Author"));
     metaData.insert(QMediaMetaData::Date, QDateTime(QDate(2021, 1, 1), QTime()));
 
-    emit imageMetadataAvailable(m_captureRequest, metaData);
+    for (int id = m_firstRequest; id <= m_captureRequest; ++id)
+        emit imageMetadataAvailable(id, metaData);
 
     if (!m_ready)
     {
         emit readyForCaptureChanged(m_ready = true);
-        emit imageExposed(m_captureRequest);
+        for (int id = m_firstRequest; id <= m_captureRequest; ++id)
+            emit imageExposed(id);
     }
 
-    emit imageSaved(m_captureRequest, m_fileName);
+    for (int id = m_firstRequest; id <= m_captureRequest; ++id)
+        emit imageSaved(id, m_fileName);
 }
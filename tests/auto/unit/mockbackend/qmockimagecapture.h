@@ -54,6 +54,7 @@ public:
 
     int capture(const QString &fileName) override;
     int captureToBuffer() override { return -1; }
+    int captureBurst(const QString &fileName, int count) override;
 
     QImageEncoderSettings imageSettings() const override { return m_settings; }
     void setImageSettings(const QImageEncoderSettings &settings) override { m_settings = settings; }
@@ -64,6 +65,7 @@ private Q_SLOTS:
 private:
     QString m_fileName;
     int m_captureRequest = 0;
+    int m_firstRequest = 0;
     bool m_ready = true;
     QImageEncoderSettings m_settings;
 };
@@ -66,7 +66,10 @@ public:
     }
     virtual QMediaMetaData metaData() const override { return m_metaData; }
 
+    EncodingStatistics encodingStatistics() const override { return m_statistics; }
+
     using QPlatformMediaRecorder::error;
+    using QPlatformMediaRecorder::segmentFinished;
 
 public:
     void record(QMediaEncoderSettings &settings) override
@@ -93,6 +96,12 @@ public:
         emit stateChanged(m_state);
     }
 
+    void triggerPreEventRecording() override
+    {
+        if (m_state == QMediaRecorder::RecordingState)
+            ++m_preEventTriggers;
+    }
+
     void stop() override
     {
         m_position=0;
@@ -105,6 +114,9 @@ public:
         m_state = QMediaRecorder::StoppedState;
         m_settings = QMediaEncoderSettings();
         m_position = 0;
+        m_statistics = {};
+        m_preEventTriggers = 0;
+        clearAdditionalOutputs();
         emit stateChanged(m_state);
         emit durationChanged(m_position);
         clearActualLocation();
@@ -115,6 +127,8 @@ public:
     QMediaRecorder::RecorderState m_state;
     QMediaEncoderSettings m_settings;
     qint64     m_position;
+    EncodingStatistics m_statistics;
+    int m_preEventTriggers = 0;
 };
 
 #endif // MOCKRECORDERCONTROL_H
@@ -105,6 +105,8 @@ public:
         mediaStatusChanged(_media.isEmpty() ? QMediaPlayer::NoMedia : QMediaPlayer::LoadingMedia);
     }
     QIODevice *mediaStream() const override { return _stream; }
+    void setNextMedia(const QUrl &media) override { _nextMedia = media; }
+    SeekStatistics seekStatistics() const override { return _seekStatistics; }
 
     bool streamPlaybackSupported() const override { return m_supportsStreamPlayback; }
     void setStreamPlaybackSupported(bool b) { m_supportsStreamPlayback = b; }
@@ -158,6 +160,8 @@ public:
         _isSeekable = false;
         _playbackRate = 0.0;
         _media = QUrl();
+        _nextMedia = QUrl();
+        _seekStatistics = {};
         _stream = 0;
         _isValid = false;
         _errorString = QString();
@@ -175,6 +179,8 @@ public:
     QPair<qint64, qint64> _seekRange;
     qreal _playbackRate;
     QUrl _media;
+    QUrl _nextMedia;
+    SeekStatistics _seekStatistics;
     QIODevice *_stream;
     bool _isValid;
     QString _errorString;
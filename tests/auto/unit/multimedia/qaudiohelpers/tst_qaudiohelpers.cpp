@@ -0,0 +1,300 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+//TESTED_COMPONENT=src/multimedia
+
+#include <QtTest/QtTest>
+
+#include <QtMultimedia/qaudioformat.h>
+#include <QtMultimedia/private/qaudiohelpers_p.h>
+
+#include <iterator>
+#include <random>
+
+using namespace QAudioHelperInternal;
+
+Q_DECLARE_METATYPE(QAudioFormat::SampleFormat)
+
+// An odd count, so the kernels also go through their scalar tails
+static constexpr int sampleCount = 1003;
+
+class tst_QAudioHelpers : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void gain_data();
+    void gain();
+    void fromFloat_data();
+    void fromFloat();
+    void toFloat_data();
+    void toFloat();
+
+    void conversionScale();
+    void int32Precision();
+};
+
+static QByteArray randomSamples(QAudioFormat::SampleFormat format, int count)
+{
+    std::mt19937 random(count);
+    QAudioFormat audioFormat;
+    audioFormat.setSampleFormat(format);
+    QByteArray data(count*audioFormat.bytesPerSample(), Qt::Uninitialized);
+
+    if (format == QAudioFormat::Float) {
+        std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+        auto *samples = reinterpret_cast<float *>(data.data());
+        for (int i = 0; i < count; ++i)
+            samples[i] = distribution(random);
+    } else {
+        auto *bytes = reinterpret_cast<uchar *>(data.data());
+        for (int i = 0; i < data.size(); ++i)
+            bytes[i] = uchar(random());
+    }
+    return data;
+}
+
+static QVector<float> randomFloats(int count)
+{
+    std::mt19937 random(count);
+    // also goes beyond full scale, to check saturation
+    std::uniform_real_distribution<float> distribution(-1.2f, 1.2f);
+    QVector<float> samples(count);
+    for (float &sample : samples)
+        sample = distribution(random);
+    return samples;
+}
+
+// The SIMD kernels compute the gain of a ramp per lane, so they can end up
+// one step off the scalar rounding for integer formats.
+static double maxDifference(QAudioFormat::SampleFormat format, const void *a, const void *b, int count)
+{
+    double difference = 0;
+    for (int i = 0; i < count; ++i) {
+        switch (format) {
+        case QAudioFormat::UInt8:
+            difference = qMax(difference, qAbs(double(static_cast<const quint8 *>(a)[i])
+                                               - double(static_cast<const quint8 *>(b)[i])));
+            break;
+        case QAudioFormat::Int16:
+            difference = qMax(difference, qAbs(double(static_cast<const qint16 *>(a)[i])
+                                               - double(static_cast<const qint16 *>(b)[i])));
+            break;
+        case QAudioFormat::Int32:
+            difference = qMax(difference, qAbs(double(static_cast<const qint32 *>(a)[i])
+                                               - double(static_cast<const qint32 *>(b)[i])));
+            break;
+        case QAudioFormat::Float:
+            difference = qMax(difference, qAbs(double(static_cast<const float *>(a)[i])
+                                               - double(static_cast<const float *>(b)[i])));
+            break;
+        default:
+            break;
+        }
+    }
+    return difference;
+}
+
+static double tolerance(QAudioFormat::SampleFormat format)
+{
+    return format == QAudioFormat::Float ? 1e-6 : 1.;
+}
+
+static void addKernelRows()
+{
+    QTest::addColumn<QByteArray>("kernels");
+    QTest::addColumn<QAudioFormat::SampleFormat>("format");
+    QTest::addColumn<float>("gain");
+    QTest::addColumn<float>("endGain");
+
+    static const std::pair<const char *, QAudioFormat::SampleFormat> formats[] = {
+        { "UInt8", QAudioFormat::UInt8 },
+        { "Int16", QAudioFormat::Int16 },
+        { "Int32", QAudioFormat::Int32 },
+        { "Float", QAudioFormat::Float },
+    };
+    static const std::pair<float, float> gains[] = {
+        { 1.f, 1.f }, { 0.5f, 0.5f }, { 0.123f, 0.123f }, { 1.7f, 1.7f }, { 0.f, 1.f }, { 1.f, 0.2f },
+    };
+
+    for (const NamedKernels &k : simdKernels()) {
+        for (const auto &format : formats) {
+            for (const auto &gain : gains) {
+                QTest::addRow("%s %s %g-%g", k.name, format.first, gain.first, gain.second)
+                        << QByteArray(k.name) << format.second << gain.first << gain.second;
+            }
+        }
+    }
+}
+
+static const Kernels &kernelsByName(const QByteArray &name)
+{
+    static const QList<NamedKernels> simd = simdKernels();
+    for (const NamedKernels &k : simd) {
+        if (name == k.name)
+            return k.kernels;
+    }
+    return genericKernels();
+}
+
+void tst_QAudioHelpers::gain_data()
+{
+    if (simdKernels().isEmpty())
+        QSKIP("No SIMD kernels available on this CPU");
+    addKernelRows();
+}
+
+void tst_QAudioHelpers::gain()
+{
+    QFETCH(QByteArray, kernels);
+    QFETCH(QAudioFormat::SampleFormat, format);
+    QFETCH(float, gain);
+    QFETCH(float, endGain);
+
+    const QByteArray input = randomSamples(format, sampleCount);
+    QByteArray expected(input.size(), Qt::Uninitialized);
+    QByteArray actual(input.size(), Qt::Uninitialized);
+    const float step = (endGain - gain)/sampleCount;
+
+    genericKernels().gain[format](input.constData(), expected.data(), sampleCount, gain, step);
+    kernelsByName(kernels).gain[format](input.constData(), actual.data(), sampleCount, gain, step);
+
+    const double difference = maxDifference(format, expected.constData(), actual.constData(), sampleCount);
+    QVERIFY2(difference <= tolerance(format), qPrintable(QString::number(difference)));
+    if (gain == endGain && format != QAudioFormat::Float)
+        QCOMPARE(actual, expected);
+}
+
+void tst_QAudioHelpers::fromFloat_data()
+{
+    if (simdKernels().isEmpty())
+        QSKIP("No SIMD kernels available on this CPU");
+    addKernelRows();
+}
+
+void tst_QAudioHelpers::fromFloat()
+{
+    QFETCH(QByteArray, kernels);
+    QFETCH(QAudioFormat::SampleFormat, format);
+    QFETCH(float, gain);
+    QFETCH(float, endGain);
+
+    QAudioFormat audioFormat;
+    audioFormat.setSampleFormat(format);
+    const QVector<float> input = randomFloats(sampleCount);
+    QByteArray expected(sampleCount*audioFormat.bytesPerSample(), Qt::Uninitialized);
+    QByteArray actual(expected.size(), Qt::Uninitialized);
+    const float step = (endGain - gain)/sampleCount;
+
+    genericKernels().fromFloat[format](input.constData(), expected.data(), sampleCount, gain, step);
+    kernelsByName(kernels).fromFloat[format](input.constData(), actual.data(), sampleCount, gain, step);
+
+    const double difference = maxDifference(format, expected.constData(), actual.constData(), sampleCount);
+    QVERIFY2(difference <= tolerance(format), qPrintable(QString::number(difference)));
+}
+
+void tst_QAudioHelpers::toFloat_data()
+{
+    if (simdKernels().isEmpty())
+        QSKIP("No SIMD kernels available on this CPU");
+    addKernelRows();
+}
+
+void tst_QAudioHelpers::toFloat()
+{
+    QFETCH(QByteArray, kernels);
+    QFETCH(QAudioFormat::SampleFormat, format);
+    QFETCH(float, gain);
+    QFETCH(float, endGain);
+
+    const QByteArray input = randomSamples(format, sampleCount);
+    QVector<float> expected(sampleCount);
+    QVector<float> actual(sampleCount);
+    const float step = (endGain - gain)/sampleCount;
+
+    genericKernels().toFloat[format](input.constData(), expected.data(), sampleCount, gain, step);
+    kernelsByName(kernels).toFloat[format](input.constData(), actual.data(), sampleCount, gain, step);
+
+    const double difference = maxDifference(QAudioFormat::Float, expected.constData(), actual.constData(), sampleCount);
+    QVERIFY2(difference <= 1e-6 * qMax(gain, endGain), qPrintable(QString::number(difference)));
+}
+
+// Silence and full scale map to the same sample values in both directions,
+// with UInt8 biased around 0x80
+void tst_QAudioHelpers::conversionScale()
+{
+    const float input[] = { 0.f, 1.f, -1.f };
+
+    QAudioFormat format;
+    format.setSampleFormat(QAudioFormat::UInt8);
+    quint8 uint8[3];
+    qConvertFromFloat(input, format, uint8, 3);
+    QCOMPARE(uint8[0], quint8(0x80));
+    QCOMPARE(uint8[1], quint8(0xff));
+    QCOMPARE(uint8[2], quint8(0x01));
+
+    float output[3];
+    qConvertToFloat(format, uint8, output, 3);
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(output[i], input[i]);
+
+    format.setSampleFormat(QAudioFormat::Int16);
+    qint16 int16[3];
+    qConvertFromFloat(input, format, int16, 3);
+    QCOMPARE(int16[0], qint16(0));
+    QCOMPARE(int16[1], qint16(32767));
+    QCOMPARE(int16[2], qint16(-32767));
+
+    qConvertToFloat(format, int16, output, 3);
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(output[i], input[i]);
+}
+
+// 32 bit samples keep all of their bits when the gain doesn't change them
+void tst_QAudioHelpers::int32Precision()
+{
+    QAudioFormat format;
+    format.setSampleFormat(QAudioFormat::Int32);
+
+    const qint32 input[] = { 0x7fffff01, -0x7fffff01, 0x12345678, 1, -1, 0x7fffffff,
+                             qint32(0x80000000), 0x01000001 };
+    constexpr int count = int(std::size(input));
+    qint32 output[count];
+
+    qMultiplySamples(1., format, input, output, int(sizeof(input)));
+    for (int i = 0; i < count; ++i)
+        QCOMPARE(output[i], input[i]);
+
+    qMultiplySamples(0.5, format, input, output, int(sizeof(input)));
+    QCOMPARE(output[2], qint32(0x12345678/2));
+}
+
+QTEST_MAIN(tst_QAudioHelpers)
+
+#include "tst_qaudiohelpers.moc"
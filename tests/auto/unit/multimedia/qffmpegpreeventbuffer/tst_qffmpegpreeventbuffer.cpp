@@ -0,0 +1,158 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+#include <QtTest/QtTest>
+
+#include "qffmpegpreeventbuffer_p.h"
+
+using namespace QFFmpeg;
+
+class tst_QFFmpegPreEventBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void disabledByDefault();
+    void startsAtKeyFrame();
+    void dropsWholeGopsBeyondDuration();
+    void keepsPacketsWithoutTimestamps();
+    void takeHandsOutPacketsInOrder();
+};
+
+namespace {
+
+constexpr qint64 Second = AV_TIME_BASE;
+constexpr qint64 FrameInterval = Second/10;
+
+// Adds a packet every FrameInterval in [from, to), starting a new GOP every
+// gopSize packets. The packets carry their time as pts to tell them apart.
+void addPackets(PreEventBuffer &buffer, qint64 from, qint64 to, int gopSize)
+{
+    int index = 0;
+    for (qint64 time = from; time < to; time += FrameInterval, ++index) {
+        AVPacket *packet = av_packet_alloc();
+        packet->pts = time;
+        buffer.add(packet, index % gopSize == 0, time);
+    }
+}
+
+}
+
+void tst_QFFmpegPreEventBuffer::disabledByDefault()
+{
+    PreEventBuffer buffer;
+    QVERIFY(!buffer.isEnabled());
+
+    buffer.setDuration(-Second);
+    QVERIFY(!buffer.isEnabled());
+    QCOMPARE(buffer.duration(), qint64(0));
+
+    buffer.setDuration(Second);
+    QVERIFY(buffer.isEnabled());
+}
+
+void tst_QFFmpegPreEventBuffer::startsAtKeyFrame()
+{
+    PreEventBuffer buffer;
+    buffer.setDuration(Second);
+
+    // nothing can be decoded before the first key frame
+    AVPacket *packet = av_packet_alloc();
+    buffer.add(packet, false, 0);
+    QVERIFY(buffer.isEmpty());
+
+    packet = av_packet_alloc();
+    packet->pts = FrameInterval;
+    buffer.add(packet, true, FrameInterval);
+    packet = av_packet_alloc();
+    buffer.add(packet, false, 2*FrameInterval);
+    QCOMPARE(buffer.size(), qsizetype(2));
+    QCOMPARE(buffer.first()->pts, FrameInterval);
+}
+
+void tst_QFFmpegPreEventBuffer::dropsWholeGopsBeyondDuration()
+{
+    PreEventBuffer buffer;
+    buffer.setDuration(2*Second);
+
+    // one second GOPs up to 4.9s: the GOP at 2s is the last one that still
+    // covers two seconds on its own
+    addPackets(buffer, 0, 5*Second, 10);
+    QCOMPARE(buffer.first()->pts, 2*Second);
+    QCOMPARE(buffer.size(), qsizetype(30));
+
+    // the key frame at 5s makes the GOP at 3s cover the full duration
+    addPackets(buffer, 5*Second, 5*Second + FrameInterval, 10);
+    QCOMPARE(buffer.first()->pts, 3*Second);
+    QCOMPARE(buffer.size(), qsizetype(21));
+
+    // a GOP longer than the duration is never cut in the middle
+    buffer.clear();
+    addPackets(buffer, 0, 5*Second, 50);
+    QCOMPARE(buffer.first()->pts, qint64(0));
+    QCOMPARE(buffer.size(), qsizetype(50));
+}
+
+void tst_QFFmpegPreEventBuffer::keepsPacketsWithoutTimestamps()
+{
+    PreEventBuffer buffer;
+    buffer.setDuration(Second);
+
+    for (int i = 0; i < 5; ++i)
+        buffer.add(av_packet_alloc(), true, AV_NOPTS_VALUE);
+    QCOMPARE(buffer.size(), qsizetype(5));
+
+    // trimming resumes with the next timestamp, but not past a key frame without one
+    AVPacket *packet = av_packet_alloc();
+    buffer.add(packet, true, 10*Second);
+    QCOMPARE(buffer.size(), qsizetype(6));
+}
+
+void tst_QFFmpegPreEventBuffer::takeHandsOutPacketsInOrder()
+{
+    PreEventBuffer buffer;
+    buffer.setDuration(Second);
+    addPackets(buffer, 0, 3*Second, 5);
+
+    // what the muxer writes once the event got triggered
+    const qint64 first = buffer.first()->pts;
+    QCOMPARE(first, 2*Second - 5*FrameInterval);
+    qint64 expected = first;
+    while (!buffer.isEmpty()) {
+        AVPacket *packet = buffer.take();
+        QCOMPARE(packet->pts, expected);
+        expected += FrameInterval;
+        av_packet_free(&packet);
+    }
+    QCOMPARE(expected, 3*Second);
+}
+
+QTEST_GUILESS_MAIN(tst_QFFmpegPreEventBuffer)
+
+#include "tst_qffmpegpreeventbuffer.moc"
@@ -63,6 +63,8 @@ private slots:
     void imageExposed();
     void imageSaved();
     void readyForCaptureChanged();
+    void captureBurst();
+    void captureBurstNotReady();
 
 private:
     QMockIntegration *mockIntegration;
@@ -329,6 +331,59 @@ void tst_QImageCapture::readyForCaptureChanged()
     spy.clear();
 }
 
+void tst_QImageCapture::captureBurst()
+{
+    QMediaCaptureSession session;
+    QCamera camera;
+    QImageCapture imageCapture;
+    session.setCamera(&camera);
+    session.setImageCapture(&imageCapture);
+
+    QSignalSpy capturedSpy(&imageCapture, SIGNAL(imageCaptured(int,QImage)));
+    QSignalSpy savedSpy(&imageCapture, SIGNAL(imageSaved(int,QString)));
+    camera.start();
+    QVERIFY(imageCapture.isReadyForCapture());
+
+    const int firstId = imageCapture.captureBurst(3, QString::fromLatin1("/usr/share"));
+    QVERIFY(firstId > 0);
+    QVERIFY(!imageCapture.isReadyForCapture());
+    QTRY_VERIFY(imageCapture.isReadyForCapture());
+
+    QCOMPARE(capturedSpy.count(), 3);
+    QCOMPARE(savedSpy.count(), 3);
+    for (int i = 0; i < 3; ++i) {
+        QCOMPARE(qvariant_cast<int>(capturedSpy.at(i).at(0)), firstId + i);
+        QCOMPARE(qvariant_cast<int>(savedSpy.at(i).at(0)), firstId + i);
+        QCOMPARE(qvariant_cast<QString>(savedSpy.at(i).at(1)), QString::fromLatin1("/usr/share"));
+    }
+
+    // the next capture continues after the burst
+    savedSpy.clear();
+    QCOMPARE(imageCapture.captureToFile(), firstId + 3);
+    QTRY_COMPARE(savedSpy.count(), 1);
+    camera.stop();
+}
+
+void tst_QImageCapture::captureBurstNotReady()
+{
+    QMediaCaptureSession session;
+    QCamera camera;
+    QImageCapture imageCapture;
+    session.setCamera(&camera);
+    session.setImageCapture(&imageCapture);
+
+    QSignalSpy errorSpy(&imageCapture, SIGNAL(errorOccurred(int,QImageCapture::Error,QString)));
+    QSignalSpy savedSpy(&imageCapture, SIGNAL(imageSaved(int,QString)));
+    QVERIFY(!imageCapture.isReadyForCapture());
+
+    QCOMPARE(imageCapture.captureBurst(3), -1);
+    QCOMPARE(imageCapture.error(), QImageCapture::NotReadyError);
+    QCOMPARE(errorSpy.count(), 1);
+    QCOMPARE(qvariant_cast<int>(errorSpy.at(0).at(0)), -1);
+    QTest::qWait(100);
+    QCOMPARE(savedSpy.count(), 0);
+}
+
 QTEST_MAIN(tst_QImageCapture)
 
 #include "tst_qimagecapture.moc"
@@ -119,6 +119,12 @@ private slots:
     void testDestructor();
     void testQrc_data();
     void testQrc();
+    void testNextSource();
+    void testNextSourceNotPassedToBackend();
+    void testNextSourceStartedByBackend();
+    void testNextSourceAtEndOfMedia();
+    void testNextSourceSeek();
+    void testSeekLatency();
 
 private:
     void setupCommonTestData();
@@ -822,5 +828,141 @@ void tst_QMediaPlayer::testQrc()
     QCOMPARE(bool(mockPlayer->mediaStream()), backendHasStream);
 }
 
+void tst_QMediaPlayer::testNextSource()
+{
+    QSignalSpy nextSpy(player, SIGNAL(nextSourceChanged(QUrl)));
+    QCOMPARE(player->nextSource(), QUrl());
+
+    const QUrl next(QStringLiteral("file:///next.mp3"));
+    player->setNextSource(next);
+    QCOMPARE(player->nextSource(), next);
+    QCOMPARE(nextSpy.count(), 1);
+    QCOMPARE(qvariant_cast<QUrl>(nextSpy.last().value(0)), next);
+    QCOMPARE(mockPlayer->_nextMedia, next);
+
+    // setting the same source again doesn't change anything
+    player->setNextSource(next);
+    QCOMPARE(nextSpy.count(), 1);
+
+    // relative paths get resolved before they reach the backend
+    player->setNextSource(QUrl(QStringLiteral("next.mp3")));
+    QCOMPARE(nextSpy.count(), 2);
+    QVERIFY(mockPlayer->_nextMedia.isLocalFile());
+    QCOMPARE(mockPlayer->_nextMedia.toLocalFile(), QDir::current().absoluteFilePath(QStringLiteral("next.mp3")));
+
+    player->setNextSource(QUrl());
+    QCOMPARE(nextSpy.count(), 3);
+    QCOMPARE(mockPlayer->_nextMedia, QUrl());
+
+    // setting the next source as the current one consumes it
+    player->setNextSource(next);
+    player->setSource(next);
+    QCOMPARE(player->nextSource(), QUrl());
+    QCOMPARE(nextSpy.count(), 5);
+}
+
+void tst_QMediaPlayer::testNextSourceNotPassedToBackend()
+{
+    // resources and looped media are switched at the end of media instead
+    player->setNextSource(QUrl(QStringLiteral("qrc:/testdata/nokia-tune.mp3")));
+    QCOMPARE(mockPlayer->_nextMedia, QUrl());
+
+    const QUrl next(QStringLiteral("file:///next.mp3"));
+    player->setNextSource(next);
+    QCOMPARE(mockPlayer->_nextMedia, next);
+    player->setLoops(2);
+    QCOMPARE(mockPlayer->_nextMedia, QUrl());
+    player->setLoops(1);
+    QCOMPARE(mockPlayer->_nextMedia, next);
+}
+
+void tst_QMediaPlayer::testNextSourceStartedByBackend()
+{
+    const QUrl current(QStringLiteral("file:///current.mp3"));
+    const QUrl next(QStringLiteral("file:///next.mp3"));
+    player->setSource(current);
+    player->setNextSource(next);
+
+    QSignalSpy sourceSpy(player, SIGNAL(sourceChanged(QUrl)));
+    QSignalSpy nextSpy(player, SIGNAL(nextSourceChanged(QUrl)));
+
+    // the backend continued with the next media without a gap
+    mockPlayer->nextMediaStarted();
+
+    QCOMPARE(player->source(), next);
+    QCOMPARE(player->nextSource(), QUrl());
+    QCOMPARE(sourceSpy.count(), 1);
+    QCOMPARE(qvariant_cast<QUrl>(sourceSpy.last().value(0)), next);
+    QCOMPARE(nextSpy.count(), 1);
+    QCOMPARE(qvariant_cast<QUrl>(nextSpy.last().value(0)), QUrl());
+}
+
+void tst_QMediaPlayer::testNextSourceAtEndOfMedia()
+{
+    const QUrl current(QStringLiteral("file:///current.mp3"));
+    const QUrl next(QStringLiteral("file:///next.mp3"));
+    mockPlayer->setIsValid(true);
+    player->setSource(current);
+    player->setNextSource(next);
+    player->play();
+    QCOMPARE(player->playbackState(), QMediaPlayer::PlayingState);
+
+    QSignalSpy sourceSpy(player, SIGNAL(sourceChanged(QUrl)));
+
+    // the backend didn't switch on its own, the player does it
+    mockPlayer->setState(QMediaPlayer::StoppedState, QMediaPlayer::EndOfMedia);
+    QTRY_COMPARE(player->source(), next);
+    QCOMPARE(sourceSpy.count(), 1);
+    QCOMPARE(mockPlayer->media(), next);
+    QCOMPARE(player->nextSource(), QUrl());
+    QCOMPARE(player->playbackState(), QMediaPlayer::PlayingState);
+
+    // without a next source, the player stays at the end
+    mockPlayer->setState(QMediaPlayer::StoppedState, QMediaPlayer::EndOfMedia);
+    QTest::qWait(10);
+    QCOMPARE(player->source(), next);
+    QCOMPARE(sourceSpy.count(), 1);
+}
+
+void tst_QMediaPlayer::testNextSourceSeek()
+{
+    const QUrl current(QStringLiteral("file:///current.mp3"));
+    const QUrl next(QStringLiteral("file:///next.mp3"));
+    mockPlayer->setIsValid(true);
+    mockPlayer->setSeekable(true);
+    player->setSource(current);
+    player->setNextSource(next);
+    player->play();
+
+    QSignalSpy sourceSpy(player, SIGNAL(sourceChanged(QUrl)));
+    QSignalSpy nextSpy(player, SIGNAL(nextSourceChanged(QUrl)));
+
+    // seeking in the current media keeps the next one queued
+    player->setPosition(500);
+    QCOMPARE(mockPlayer->position(), qint64(500));
+    QCOMPARE(player->source(), current);
+    QCOMPARE(player->nextSource(), next);
+    QCOMPARE(mockPlayer->_nextMedia, next);
+
+    // a backend that finished switching while seeking reports the new media
+    mockPlayer->nextMediaStarted();
+    player->setPosition(200);
+    QCOMPARE(player->source(), next);
+    QCOMPARE(player->nextSource(), QUrl());
+    QCOMPARE(mockPlayer->position(), qint64(200));
+    QCOMPARE(sourceSpy.count(), 1);
+    QCOMPARE(nextSpy.count(), 1);
+}
+
+void tst_QMediaPlayer::testSeekLatency()
+{
+    QCOMPARE(player->lastSeekLatency(), qint64(0));
+    QCOMPARE(player->maxSeekLatency(), qint64(0));
+
+    mockPlayer->_seekStatistics = { 12000, 45000 };
+    QCOMPARE(player->lastSeekLatency(), qint64(12000));
+    QCOMPARE(player->maxSeekLatency(), qint64(45000));
+}
+
 QTEST_GUILESS_MAIN(tst_QMediaPlayer)
 #include "tst_qmediaplayer.moc"
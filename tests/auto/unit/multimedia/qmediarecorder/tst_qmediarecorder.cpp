@@ -30,6 +30,7 @@
 
 #include <QtTest/QtTest>
 #include <QDebug>
+#include <QBuffer>
 #include <QtMultimedia/qmediametadata.h>
 #include <private/qplatformmediarecorder_p.h>
 #include "private/qguiapplication_p.h"
@@ -74,6 +75,13 @@ private slots:
 
     void testApplicationInative();
 
+    void testEncodingStatistics();
+    void testSegmentFinished();
+    void testSegmentSettings();
+    void testPreEventDuration();
+    void testTriggerPreEventRecording();
+    void testAdditionalOutputs();
+
 private:
     QMockIntegration *mockIntegration = nullptr;
     QMediaCaptureSession *captureSession;
@@ -490,5 +498,171 @@ void tst_QMediaRecorder::testApplicationInative()
     QCOMPARE(encoder.actualLocation().toString(), QString("test.tmp"));
 }
 
+void tst_QMediaRecorder::testEncodingStatistics()
+{
+    QCOMPARE(encoder->droppedVideoFrames(), qint64(0));
+    QCOMPARE(encoder->lateVideoFrames(), qint64(0));
+    QCOMPARE(encoder->droppedCaptureFrames(), qint64(0));
+    QCOMPARE(encoder->lateCaptureFrames(), qint64(0));
+    QCOMPARE(encoder->maxCaptureDequeueLatency(), qint64(0));
+    QCOMPARE(encoder->maxCaptureDeliveryLatency(), qint64(0));
+    QCOMPARE(encoder->droppedAudioBuffers(), qint64(0));
+    QCOMPARE(encoder->encodeFrameRate(), qreal(0));
+
+    encoder->record();
+    mock->m_statistics.droppedVideoFrames = 3;
+    mock->m_statistics.lateVideoFrames = 5;
+    mock->m_statistics.droppedCaptureFrames = 7;
+    mock->m_statistics.lateCaptureFrames = 4;
+    mock->m_statistics.maxCaptureDequeueLatency = 1500;
+    mock->m_statistics.maxCaptureDeliveryLatency = 800;
+    mock->m_statistics.droppedAudioBuffers = 2;
+    mock->m_statistics.encodeFrameRate = 29.5;
+
+    QCOMPARE(encoder->droppedVideoFrames(), qint64(3));
+    QCOMPARE(encoder->lateVideoFrames(), qint64(5));
+    QCOMPARE(encoder->droppedCaptureFrames(), qint64(7));
+    QCOMPARE(encoder->lateCaptureFrames(), qint64(4));
+    QCOMPARE(encoder->maxCaptureDequeueLatency(), qint64(1500));
+    QCOMPARE(encoder->maxCaptureDeliveryLatency(), qint64(800));
+    QCOMPARE(encoder->droppedAudioBuffers(), qint64(2));
+    QCOMPARE(encoder->encodeFrameRate(), qreal(29.5));
+
+    encoder->stop();
+    mock->reset();
+    QCOMPARE(encoder->droppedCaptureFrames(), qint64(0));
+}
+
+void tst_QMediaRecorder::testSegmentFinished()
+{
+    QSignalSpy spy(encoder, &QMediaRecorder::segmentFinished);
+
+    const QUrl first = QUrl::fromLocalFile(QStringLiteral("segments.mp4"));
+    const QUrl second = QUrl::fromLocalFile(QStringLiteral("segments_0001.mp4"));
+    encoder->setOutputLocation(first);
+    encoder->record();
+    mock->segmentFinished(first);
+    mock->segmentFinished(second);
+    encoder->stop();
+
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(0).at(0).toUrl(), first);
+    QCOMPARE(spy.at(1).at(0).toUrl(), second);
+
+    mock->reset();
+}
+
+void tst_QMediaRecorder::testSegmentSettings()
+{
+    QCOMPARE(encoder->segmentDuration(), qint64(0));
+    QCOMPARE(encoder->segmentSize(), qint64(0));
+    QVERIFY(!encoder->isFragmented());
+
+    QSignalSpy durationSpy(encoder, &QMediaRecorder::segmentDurationChanged);
+    QSignalSpy sizeSpy(encoder, &QMediaRecorder::segmentSizeChanged);
+    QSignalSpy fragmentedSpy(encoder, &QMediaRecorder::fragmentedChanged);
+
+    encoder->setSegmentDuration(10000);
+    encoder->setSegmentDuration(10000);
+    encoder->setSegmentSize(64*1024*1024);
+    encoder->setFragmented(true);
+    QCOMPARE(durationSpy.count(), 1);
+    QCOMPARE(sizeSpy.count(), 1);
+    QCOMPARE(fragmentedSpy.count(), 1);
+
+    // negative values disable splitting
+    encoder->setSegmentSize(-1);
+    QCOMPARE(encoder->segmentSize(), qint64(0));
+    encoder->setSegmentSize(64*1024*1024);
+
+    // handed to the backend when recording starts
+    encoder->record();
+    QCOMPARE(mock->m_settings.segmentDuration(), qint64(10000));
+    QCOMPARE(mock->m_settings.segmentSize(), qint64(64*1024*1024));
+    QVERIFY(mock->m_settings.isFragmented());
+    encoder->stop();
+
+    encoder->setSegmentDuration(0);
+    encoder->setSegmentSize(0);
+    encoder->setFragmented(false);
+    mock->reset();
+}
+
+void tst_QMediaRecorder::testPreEventDuration()
+{
+    QCOMPARE(encoder->preEventDuration(), qint64(0));
+
+    QSignalSpy spy(encoder, &QMediaRecorder::preEventDurationChanged);
+    encoder->setPreEventDuration(5000);
+    encoder->setPreEventDuration(5000);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(encoder->preEventDuration(), qint64(5000));
+
+    // negative values disable pre-event recording
+    encoder->setPreEventDuration(-1);
+    QCOMPARE(encoder->preEventDuration(), qint64(0));
+    QCOMPARE(spy.count(), 2);
+    encoder->setPreEventDuration(5000);
+
+    // handed to the backend when recording starts
+    encoder->record();
+    QCOMPARE(mock->m_settings.preEventDuration(), qint64(5000));
+    encoder->stop();
+
+    encoder->setPreEventDuration(0);
+    mock->reset();
+}
+
+void tst_QMediaRecorder::testTriggerPreEventRecording()
+{
+    // only does something while recording
+    encoder->triggerPreEventRecording();
+    QCOMPARE(mock->m_preEventTriggers, 0);
+
+    encoder->record();
+    encoder->triggerPreEventRecording();
+    QCOMPARE(mock->m_preEventTriggers, 1);
+    QCOMPARE(encoder->recorderState(), QMediaRecorder::RecordingState);
+
+    encoder->stop();
+    encoder->triggerPreEventRecording();
+    QCOMPARE(mock->m_preEventTriggers, 1);
+
+    mock->reset();
+}
+
+void tst_QMediaRecorder::testAdditionalOutputs()
+{
+    QVERIFY(mock->additionalOutputs().isEmpty());
+
+    const QUrl stream(QStringLiteral("udp://127.0.0.1:1234"));
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    encoder->addAdditionalOutput(stream);
+    encoder->addAdditionalOutput(&buffer, QMediaFormat::Matroska);
+    // a null device is ignored
+    encoder->addAdditionalOutput(nullptr, QMediaFormat::MPEG4);
+
+    auto outputs = mock->additionalOutputs();
+    QCOMPARE(outputs.size(), 2);
+    QCOMPARE(outputs.at(0).location, stream);
+    QVERIFY(!outputs.at(0).device);
+    QCOMPARE(outputs.at(0).format, QMediaFormat::UnspecifiedFormat);
+    QVERIFY(outputs.at(1).location.isEmpty());
+    QCOMPARE(outputs.at(1).device, &buffer);
+    QCOMPARE(outputs.at(1).format, QMediaFormat::Matroska);
+
+    // outputs are kept for following recordings
+    encoder->record();
+    encoder->stop();
+    QCOMPARE(mock->additionalOutputs().size(), 2);
+
+    encoder->clearAdditionalOutputs();
+    QVERIFY(mock->additionalOutputs().isEmpty());
+
+    mock->reset();
+}
+
 QTEST_GUILESS_MAIN(tst_QMediaRecorder)
 #include "tst_qmediarecorder.moc"
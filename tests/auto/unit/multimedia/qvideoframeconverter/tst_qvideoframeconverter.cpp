@@ -0,0 +1,222 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+
+//TESTED_COMPONENT=src/multimedia
+
+#include <QtTest/QtTest>
+
+#include <qvideoframe.h>
+#include <qvideoframeformat.h>
+#include <QtGui/QImage>
+#include <QtMultimedia/private/qvideoframeconverter_p.h>
+#include <QtMultimedia/private/qvideoframeconversionhelper_p.h>
+
+// Shader based conversion may round differently than the CPU converters
+static constexpr int maxChannelDifference = 8;
+
+class tst_QVideoFrameConverter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void convert_data();
+    void convert();
+    void convertRotated();
+    void convertBatch();
+    void convertAsync();
+};
+
+static const QVideoFrameFormat::PixelFormat testFormats[] = {
+    QVideoFrameFormat::Format_XRGB8888,
+    QVideoFrameFormat::Format_ARGB8888,
+    QVideoFrameFormat::Format_YUV420P,
+    QVideoFrameFormat::Format_NV12,
+    QVideoFrameFormat::Format_UYVY,
+};
+
+static const QSize testSizes[] = {
+    QSize(64, 64),
+    QSize(100, 40),
+    QSize(320, 240),
+};
+
+static QVideoFrame createFrame(const QSize &size, QVideoFrameFormat::PixelFormat pixelFormat)
+{
+    QVideoFrame frame(QVideoFrameFormat(size, pixelFormat));
+    if (!frame.map(QVideoFrame::WriteOnly))
+        return {};
+
+    for (int plane = 0; plane < frame.planeCount(); ++plane) {
+        uchar *bits = frame.bits(plane);
+        const int stride = frame.bytesPerLine(plane);
+        const int lines = frame.mappedBytes(plane) / stride;
+        for (int y = 0; y < lines; ++y) {
+            for (int x = 0; x < stride; ++x)
+                bits[y * stride + x] = uchar(x + 3 * y + 50 * plane);
+        }
+    }
+
+    frame.unmap();
+    return frame;
+}
+
+// What the converter produces when no QRhi is available
+static QImage cpuImage(const QVideoFrame &frame)
+{
+    VideoFrameConvertFunc convert = qConverterForFormat(frame.pixelFormat());
+    if (!convert)
+        return {};
+
+    QVideoFrame varFrame = frame;
+    if (!varFrame.map(QVideoFrame::ReadOnly))
+        return {};
+
+    const bool hasAlpha = frame.pixelFormat() == QVideoFrameFormat::Format_ARGB8888;
+    QImage image(frame.width(), frame.height(),
+                 hasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    convert(varFrame, image.bits());
+    varFrame.unmap();
+
+    if (frame.rotationAngle() != QVideoFrame::Rotation0)
+        image = image.transformed(QTransform().rotate(float(frame.rotationAngle())));
+    return image;
+}
+
+static int maxDifference(const QImage &actual, const QImage &expected)
+{
+    if (actual.size() != expected.size() || actual.format() != expected.format())
+        return std::numeric_limits<int>::max();
+
+    int difference = 0;
+    for (int y = 0; y < actual.height(); ++y) {
+        const QRgb *a = reinterpret_cast<const QRgb *>(actual.constScanLine(y));
+        const QRgb *e = reinterpret_cast<const QRgb *>(expected.constScanLine(y));
+        for (int x = 0; x < actual.width(); ++x) {
+            difference = qMax(difference, qAbs(qRed(a[x]) - qRed(e[x])));
+            difference = qMax(difference, qAbs(qGreen(a[x]) - qGreen(e[x])));
+            difference = qMax(difference, qAbs(qBlue(a[x]) - qBlue(e[x])));
+            difference = qMax(difference, qAbs(qAlpha(a[x]) - qAlpha(e[x])));
+        }
+    }
+    return difference;
+}
+
+#define COMPARE_TO_CPU(frame, image) \
+    do { \
+        const QImage expected = cpuImage(frame); \
+        QVERIFY(!expected.isNull()); \
+        QCOMPARE(image.size(), expected.size()); \
+        QCOMPARE(image.format(), expected.format()); \
+        QVERIFY2(maxDifference(image, expected) <= maxChannelDifference, \
+                 qPrintable(QStringLiteral("channel difference %1").arg(maxDifference(image, expected)))); \
+    } while (false)
+
+void tst_QVideoFrameConverter::convert_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QVideoFrameFormat::PixelFormat>("pixelFormat");
+
+    for (const QSize &size : testSizes) {
+        for (QVideoFrameFormat::PixelFormat pixelFormat : testFormats) {
+            const QString name = QStringLiteral("%1x%2 %3").arg(size.width()).arg(size.height())
+                    .arg(QVideoFrameFormat::pixelFormatToString(pixelFormat));
+            QTest::newRow(qPrintable(name)) << size << pixelFormat;
+        }
+    }
+}
+
+void tst_QVideoFrameConverter::convert()
+{
+    QFETCH(QSize, size);
+    QFETCH(QVideoFrameFormat::PixelFormat, pixelFormat);
+
+    const QVideoFrame frame = createFrame(size, pixelFormat);
+    QVERIFY(frame.isValid());
+
+    // The second conversion reuses the resources cached by the first one
+    for (int i = 0; i < 2; ++i) {
+        const QImage image = frame.toImage();
+        COMPARE_TO_CPU(frame, image);
+    }
+}
+
+void tst_QVideoFrameConverter::convertRotated()
+{
+    QVideoFrame frame = createFrame(QSize(100, 40), QVideoFrameFormat::Format_YUV420P);
+    QVERIFY(frame.isValid());
+
+    for (auto rotation : { QVideoFrame::Rotation90, QVideoFrame::Rotation180,
+                           QVideoFrame::Rotation270, QVideoFrame::Rotation0 }) {
+        frame.setRotationAngle(rotation);
+        const QImage image = frame.toImage();
+        COMPARE_TO_CPU(frame, image);
+    }
+}
+
+void tst_QVideoFrameConverter::convertBatch()
+{
+    // More distinct formats and sizes than the converter keeps cached
+    QList<QVideoFrame> frames;
+    for (int i = 0; i < 2; ++i) {
+        for (const QSize &size : testSizes) {
+            for (QVideoFrameFormat::PixelFormat pixelFormat : testFormats)
+                frames.append(createFrame(size, pixelFormat));
+        }
+    }
+
+    const QList<QImage> images = qImagesFromVideoFrames(frames);
+    QCOMPARE(images.size(), frames.size());
+    for (qsizetype i = 0; i < frames.size(); ++i)
+        COMPARE_TO_CPU(frames.at(i), images.at(i));
+}
+
+void tst_QVideoFrameConverter::convertAsync()
+{
+    QList<QVideoFrame> frames;
+    for (QVideoFrameFormat::PixelFormat pixelFormat : testFormats)
+        frames.append(createFrame(QSize(64, 64), pixelFormat));
+
+    QList<QFuture<QImage>> futures;
+    for (const QVideoFrame &frame : qAsConst(frames))
+        futures.append(qImageFromVideoFrameAsync(frame));
+
+    // Conversion happens once the event loop runs
+    for (const QFuture<QImage> &future : qAsConst(futures))
+        QVERIFY(!future.isFinished());
+
+    for (qsizetype i = 0; i < futures.size(); ++i) {
+        QTRY_VERIFY(futures.at(i).isFinished());
+        QCOMPARE(futures.at(i).resultCount(), 1);
+        COMPARE_TO_CPU(frames.at(i), futures.at(i).result());
+    }
+}
+
+QTEST_MAIN(tst_QVideoFrameConverter)
+
+#include "tst_qvideoframeconverter.moc"
@@ -0,0 +1,262 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtSpatialAudio/private/qambisonicdecoder_p.h>
+
+#include <memory>
+
+using namespace QAmbisonicDecoderKernels;
+
+namespace {
+
+constexpr int nSamples = 128;
+constexpr int maxChannels = QAmbisonicDecoder::maxAmbisonicChannels;
+
+struct Buffers
+{
+    alignas(32) float input[nSamples*maxChannels];
+    alignas(32) float lf[nSamples*maxChannels];
+    alignas(32) float hf[nSamples*maxChannels];
+    alignas(32) float reverb[2][nSamples];
+    alignas(32) float matrixLf[maxChannels*maxOutputChannels];
+    alignas(32) float matrixHf[maxChannels*maxOutputChannels];
+    alignas(32) float reverbFactors[2*maxOutputChannels];
+    alignas(32) float output[nSamples*maxOutputChannels];
+    short int16Output[nSamples*maxOutputChannels];
+};
+
+void fillRandom(float *data, int size, float range)
+{
+    auto *rng = QRandomGenerator::global();
+    for (int i = 0; i < size; ++i)
+        data[i] = float(rng->bounded(2*range) - range);
+}
+
+std::unique_ptr<Buffers> randomBuffers()
+{
+    auto b = std::make_unique<Buffers>();
+    fillRandom(b->input, nSamples*maxChannels, 1.f);
+    fillRandom(b->lf, nSamples*maxChannels, 1.f);
+    fillRandom(b->hf, nSamples*maxChannels, 1.f);
+    fillRandom(b->reverb[0], nSamples, 1.f);
+    fillRandom(b->reverb[1], nSamples, 1.f);
+    fillRandom(b->matrixLf, maxChannels*maxOutputChannels, .5f);
+    fillRandom(b->matrixHf, maxChannels*maxOutputChannels, .5f);
+    fillRandom(b->reverbFactors, 2*maxOutputChannels, .5f);
+    // go beyond [-1, 1] to test clipping
+    fillRandom(b->output, nSamples*maxOutputChannels, 1.5f);
+    return b;
+}
+
+// the kernels may use fused multiply-add or a different order of operations
+bool fuzzyCompare(const float *actual, const float *expected, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        if (qAbs(actual[i] - expected[i]) > 1e-4f*qMax(1.f, qAbs(expected[i]))) {
+            qWarning() << "mismatch at" << i << actual[i] << expected[i];
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+class tst_QAmbisonicDecoder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void filter_data();
+    void filter();
+    void decode_data();
+    void decode();
+    void convertToInt16_data();
+    void convertToInt16();
+    void processBuffer_data();
+    void processBuffer();
+
+private:
+    void addKernels();
+};
+
+void tst_QAmbisonicDecoder::addKernels()
+{
+    QTest::addColumn<const Kernels *>("kernels");
+    const auto simd = simdKernels();
+    if (simd.isEmpty())
+        QSKIP("No SIMD kernels supported on this CPU");
+    for (const auto &k : simd)
+        QTest::newRow(k.name) << k.kernels;
+}
+
+void tst_QAmbisonicDecoder::filter_data()
+{
+    addKernels();
+}
+
+void tst_QAmbisonicDecoder::filter()
+{
+    QFETCH(const Kernels *, kernels);
+
+    for (int channelStride : { 4, 8, 12, 16 }) {
+        QAmbisonicDecoderFilter expectedFilter;
+        expectedFilter.configure(48000);
+        QAmbisonicDecoderFilter filter = expectedFilter;
+        auto expected = randomBuffers();
+        auto actual = std::make_unique<Buffers>(*expected);
+
+        // run several blocks to check that the filter state carries over correctly
+        for (int block = 0; block < 3; ++block) {
+            genericKernels().filter(expectedFilter, expected->input, expected->lf, expected->hf, channelStride, nSamples);
+            kernels->filter(filter, actual->input, actual->lf, actual->hf, channelStride, nSamples);
+            QVERIFY(fuzzyCompare(actual->lf, expected->lf, channelStride*nSamples));
+            QVERIFY(fuzzyCompare(actual->hf, expected->hf, channelStride*nSamples));
+        }
+    }
+}
+
+void tst_QAmbisonicDecoder::decode_data()
+{
+    addKernels();
+}
+
+void tst_QAmbisonicDecoder::decode()
+{
+    QFETCH(const Kernels *, kernels);
+
+    const auto b = randomBuffers();
+    for (int nInputChannels : { 4, 9, 16 }) {
+        const int channelStride = (nInputChannels + 3) & ~3;
+        for (bool withHf : { false, true }) {
+            for (bool withReverb : { false, true }) {
+                alignas(32) float expected[nSamples*maxOutputChannels];
+                alignas(32) float actual[nSamples*maxOutputChannels];
+                const float *matrixHf = withHf ? b->matrixHf : nullptr;
+                const float *reverb0 = withReverb ? b->reverb[0] : nullptr;
+                const float *reverb1 = withReverb ? b->reverb[1] : nullptr;
+                genericKernels().decode(b->lf, b->hf, channelStride, nInputChannels, b->matrixLf, matrixHf,
+                                        reverb0, reverb1, b->reverbFactors, expected, nSamples);
+                kernels->decode(b->lf, b->hf, channelStride, nInputChannels, b->matrixLf, matrixHf,
+                                reverb0, reverb1, b->reverbFactors, actual, nSamples);
+                QVERIFY(fuzzyCompare(actual, expected, nSamples*maxOutputChannels));
+            }
+        }
+    }
+}
+
+void tst_QAmbisonicDecoder::convertToInt16_data()
+{
+    addKernels();
+}
+
+void tst_QAmbisonicDecoder::convertToInt16()
+{
+    QFETCH(const Kernels *, kernels);
+
+    const auto b = randomBuffers();
+    for (int nOutputChannels = 1; nOutputChannels <= maxOutputChannels; ++nOutputChannels) {
+        short expected[nSamples*maxOutputChannels] = {};
+        short actual[nSamples*maxOutputChannels] = {};
+        genericKernels().convertToInt16(b->output, expected, nOutputChannels, nSamples);
+        kernels->convertToInt16(b->output, actual, nOutputChannels, nSamples);
+        // both truncate, so the results have to be identical
+        QVERIFY(memcmp(actual, expected, sizeof(expected)) == 0);
+    }
+}
+
+void tst_QAmbisonicDecoder::processBuffer_data()
+{
+    QTest::addColumn<const Kernels *>("kernels");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("config");
+
+    const auto simd = simdKernels();
+    if (simd.isEmpty())
+        QSKIP("No SIMD kernels supported on this CPU");
+
+    const struct {
+        const char *name;
+        QAudioFormat::ChannelConfig config;
+    } configs[] = {
+        { "stereo", QAudioFormat::ChannelConfigStereo },
+        { "5.1", QAudioFormat::ChannelConfigSurround5Dot1 },
+        { "7.1", QAudioFormat::ChannelConfigSurround7Dot1 },
+    };
+    for (const auto &k : simd) {
+        for (int level = 1; level <= QAmbisonicDecoder::maxAmbisonicLevel; ++level) {
+            for (const auto &c : configs)
+                QTest::addRow("%s, level %d, %s", k.name, level, c.name) << k.kernels << level << int(c.config);
+        }
+    }
+}
+
+void tst_QAmbisonicDecoder::processBuffer()
+{
+    QFETCH(const Kernels *, kernels);
+    QFETCH(int, level);
+    QFETCH(int, config);
+
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setSampleFormat(QAudioFormat::Float);
+    format.setChannelConfig(QAudioFormat::ChannelConfig(config));
+
+    QAmbisonicDecoder expectedDecoder(QAmbisonicDecoder::AmbisonicLevel(level), format);
+    QAmbisonicDecoder decoder(QAmbisonicDecoder::AmbisonicLevel(level), format);
+    QVERIFY(decoder.hasValidConfig());
+    expectedDecoder.setKernels(genericKernels());
+    decoder.setKernels(*kernels);
+
+    // more than one block, and not a multiple of the block size
+    constexpr int frames = 3*nSamples + 17;
+    QList<float> input[maxChannels];
+    const float *channels[maxChannels];
+    for (int i = 0; i < maxChannels; ++i) {
+        input[i].resize(frames);
+        fillRandom(input[i].data(), frames, 1.f);
+        channels[i] = input[i].constData();
+    }
+    QList<float> reverb[2];
+    for (auto &r : reverb) {
+        r.resize(frames);
+        fillRandom(r.data(), frames, 1.f);
+    }
+    const float *reverbBuffers[2] = { reverb[0].constData(), reverb[1].constData() };
+
+    QList<float> expected(decoder.outputSize(frames));
+    QList<float> actual(decoder.outputSize(frames));
+    expectedDecoder.processBufferWithReverb(channels, reverbBuffers, expected.data(), frames);
+    decoder.processBufferWithReverb(channels, reverbBuffers, actual.data(), frames);
+    QVERIFY(fuzzyCompare(actual.constData(), expected.constData(), actual.size()));
+}
+
+QTEST_APPLESS_MAIN(tst_QAmbisonicDecoder)
+
+#include "tst_qambisonicdecoder.moc"
@@ -0,0 +1,227 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtSpatialAudio/qaudioengine.h>
+#include <QtSpatialAudio/qspatialsound.h>
+#include <QtSpatialAudio/qambientsound.h>
+#include <private/qaudioassetcache_p.h>
+#include <private/qaudioengine_p.h>
+
+#include "qmockaudiodecoder.h"
+#include "qmockintegration_p.h"
+
+class tst_QAudioAssetCache : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void sharedDecode();
+    void eviction();
+    void decodeError();
+    void decodeErrorOutlivesCache();
+    void engineCache();
+    void deleteEngineBeforeSounds();
+    void deleteSoundsAfterStop();
+
+private:
+    QMockIntegration mockIntegration;
+};
+
+static const QUrl testUrl(QStringLiteral("file:///test.wav"));
+
+void tst_QAudioAssetCache::sharedDecode()
+{
+    QAudioAssetCache cache;
+    QAudioAsset *first = cache.requestAsset(testUrl, 44100, 1);
+    QAudioAsset *second = cache.requestAsset(testUrl, 44100, 1);
+    QVERIFY(first);
+    QCOMPARE(first, second);
+    QCOMPARE(first->state(), QAudioAsset::Loading);
+
+    // a different output format needs its own decoded data
+    QAudioAsset *stereo = cache.requestAsset(testUrl, 44100, 2);
+    QVERIFY(stereo != first);
+
+    QTRY_COMPARE(first->state(), QAudioAsset::Ready);
+    QTRY_COMPARE(stereo->state(), QAudioAsset::Ready);
+    // the mock decoder delivers MOCK_DECODER_MAX_BUFFERS buffers of one int each
+    QCOMPARE(first->frameCount(), qint64(MOCK_DECODER_MAX_BUFFERS));
+    QCOMPARE(first->channelCount(), 1);
+
+    auto s = cache.statistics();
+    QCOMPARE(s.misses, qint64(2));
+    QCOMPARE(s.hits, qint64(1));
+    QCOMPARE(s.assets, 2);
+    QCOMPARE(s.memoryUsage, first->byteSize() + stereo->byteSize());
+
+    // released assets stay cached and get reused without decoding again
+    first->release();
+    second->release();
+    QAudioAsset *third = cache.requestAsset(testUrl, 44100, 1);
+    QCOMPARE(third, first);
+    QCOMPARE(third->state(), QAudioAsset::Ready);
+    s = cache.statistics();
+    QCOMPARE(s.misses, qint64(2));
+    QCOMPARE(s.hits, qint64(2));
+
+    third->release();
+    stereo->release();
+}
+
+void tst_QAudioAssetCache::eviction()
+{
+    QAudioAssetCache cache;
+    QAudioAsset *asset = cache.requestAsset(testUrl, 44100, 1);
+    QTRY_COMPARE(asset->state(), QAudioAsset::Ready);
+    const qint64 size = asset->byteSize();
+    QVERIFY(size > 0);
+
+    // assets in use are never evicted
+    cache.setMemoryBudget(0);
+    QCOMPARE(cache.statistics().evictions, qint64(0));
+    QCOMPARE(cache.statistics().memoryUsage, size);
+
+    asset->release();
+    auto s = cache.statistics();
+    QCOMPARE(s.evictions, qint64(1));
+    QCOMPARE(s.assets, 0);
+    QCOMPARE(s.memoryUsage, qint64(0));
+}
+
+void tst_QAudioAssetCache::decodeError()
+{
+    QAudioAssetCache cache;
+    // the mock decoder fails right away without a source
+    QAudioAsset *failed = cache.requestAsset(QUrl(), 44100, 1);
+    QCOMPARE(failed->state(), QAudioAsset::Error);
+    QCOMPARE(cache.statistics().assets, 0);
+
+    // asking again retries instead of handing out the failed asset
+    QAudioAsset *retry = cache.requestAsset(QUrl(), 44100, 1);
+    QVERIFY(retry != failed);
+    QCOMPARE(cache.statistics().misses, qint64(2));
+
+    QPointer<QAudioAsset> failedGuard(failed);
+    QPointer<QAudioAsset> retryGuard(retry);
+    failed->release();
+    retry->release();
+    QTRY_VERIFY(failedGuard.isNull());
+    QTRY_VERIFY(retryGuard.isNull());
+}
+
+void tst_QAudioAssetCache::decodeErrorOutlivesCache()
+{
+    auto cache = std::make_unique<QAudioAssetCache>();
+    QAudioAsset *failed = cache->requestAsset(QUrl(), 44100, 1);
+    QCOMPARE(failed->state(), QAudioAsset::Error);
+    QPointer<QAudioAsset> guard(failed);
+
+    // the failed asset isn't tracked by the cache anymore, releasing it after the
+    // cache is gone must not touch the cache
+    cache.reset();
+    failed->release();
+    QTRY_VERIFY(guard.isNull());
+}
+
+void tst_QAudioAssetCache::engineCache()
+{
+    QAudioEngine engine;
+    QCOMPARE(engine.soundCacheSize(), qint64(64*1024*1024));
+    QCOMPARE(engine.soundCacheUsage(), qint64(0));
+
+    QSpatialSound first(&engine);
+    QSpatialSound second(&engine);
+    first.setSource(testUrl);
+    second.setSource(testUrl);
+
+    auto &cache = QAudioEnginePrivate::get(&engine)->assetCache;
+    QCOMPARE(engine.soundCacheMisses(), qint64(1));
+    QCOMPARE(engine.soundCacheHits(), qint64(1));
+    QCOMPARE(engine.soundCacheEvictions(), qint64(0));
+    QTRY_VERIFY(engine.soundCacheUsage() > 0);
+
+    QSignalSpy spy(&engine, &QAudioEngine::soundCacheSizeChanged);
+    engine.setSoundCacheSize(1024);
+    QCOMPARE(engine.soundCacheSize(), qint64(1024));
+    QCOMPARE(cache.memoryBudget(), qint64(1024));
+    QCOMPARE(spy.count(), 1);
+    engine.setSoundCacheSize(1024);
+    QCOMPARE(spy.count(), 1);
+}
+
+void tst_QAudioAssetCache::deleteEngineBeforeSounds()
+{
+    auto *engine = new QAudioEngine;
+    auto *spatial = new QSpatialSound(engine);
+    auto *ambient = new QAmbientSound(engine);
+    auto *failing = new QSpatialSound(engine);
+    spatial->setSource(testUrl);
+    ambient->setSource(testUrl);
+    // keeps a reference to an asset that fails to decode below
+    failing->setSource(QUrl(QStringLiteral("file:///missing.wav")));
+    QVERIFY(mockIntegration.lastAudioDecoder());
+    mockIntegration.lastAudioDecoder()->error(QAudioDecoder::FormatError, QStringLiteral("broken"));
+
+    delete engine;
+    QVERIFY(!spatial->engine());
+    QVERIFY(!ambient->engine());
+    QVERIFY(!failing->engine());
+
+    // changing sounds that lost their engine is harmless
+    spatial->setPosition(QVector3D(1, 2, 3));
+    ambient->setVolume(0.5);
+    failing->setSource(testUrl);
+
+    delete spatial;
+    delete ambient;
+    delete failing;
+    // let deferred deletes of released assets run
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+void tst_QAudioAssetCache::deleteSoundsAfterStop()
+{
+    QAudioEngine engine;
+    auto *spatial = new QSpatialSound(&engine);
+    auto *ambient = new QAmbientSound(&engine);
+    spatial->setSource(testUrl);
+    ambient->setSource(testUrl);
+
+    // stopping destroys the sources of the api, removing the sounds afterwards
+    // must not touch it anymore
+    engine.stop();
+    delete spatial;
+    delete ambient;
+    QVERIFY(QAudioEnginePrivate::get(&engine)->sources.isEmpty());
+    QVERIFY(QAudioEnginePrivate::get(&engine)->stereoSources.isEmpty());
+}
+
+QTEST_MAIN(tst_QAudioAssetCache)
+
+#include "tst_qaudioassetcache.moc"
@@ -0,0 +1,263 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qelapsedtimer.h>
+#include <QtMultimedia/qaudiosink.h>
+#include <QtMultimedia/qaudiosource.h>
+#include <QtMultimedia/qmediadevices.h>
+#include <QtMultimedia/private/qaudiocallback_p.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+class tst_QAudioCallback : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void render_data();
+    void render();
+    void renderInterleaved_data();
+    void renderInterleaved();
+    void capture_data();
+    void capture();
+    void loopbackLatency_data();
+    void loopbackLatency();
+};
+
+namespace {
+
+constexpr int Channels = 2;
+constexpr int SampleRate = 48000;
+
+void addFormatRows()
+{
+    QTest::addColumn<int>("sampleFormat");
+    QTest::addColumn<int>("blockFrames");
+
+    const std::pair<QAudioFormat::SampleFormat, const char *> formats[] = {
+        { QAudioFormat::UInt8, "uint8" },
+        { QAudioFormat::Int16, "int16" },
+        { QAudioFormat::Int32, "int32" },
+        { QAudioFormat::Float, "float" },
+    };
+    for (const auto &format : formats) {
+        for (int blockFrames : { 64, 256 }) {
+            QTest::newRow(QByteArray(format.second) + ", " + QByteArray::number(blockFrames))
+                    << int(format.first) << blockFrames;
+        }
+    }
+}
+
+QAudioFormat audioFormat(QAudioFormat::SampleFormat sampleFormat, int channels = Channels)
+{
+    QAudioFormat format;
+    format.setSampleRate(SampleRate);
+    format.setChannelCount(channels);
+    format.setSampleFormat(sampleFormat);
+    return format;
+}
+
+}
+
+// Cost of feeding a device buffer from a render callback, one second of audio
+// per iteration in chunks that don't line up with the block size
+void tst_QAudioCallback::render_data()
+{
+    addFormatRows();
+}
+
+void tst_QAudioCallback::render()
+{
+    QFETCH(int, sampleFormat);
+    QFETCH(int, blockFrames);
+
+    const QAudioFormat format = audioFormat(QAudioFormat::SampleFormat(sampleFormat));
+    float phase = 0.f;
+    QAudioRenderAdapter adapter([&](float *const *out, int frames) {
+        for (int i = 0; i < frames; ++i) {
+            phase += 0.01f;
+            for (int c = 0; c < Channels; ++c)
+                out[c][i] = std::sin(phase);
+        }
+    }, format, blockFrames);
+
+    const int chunkFrames = 441;
+    QByteArray buffer(format.bytesForFrames(chunkFrames), Qt::Uninitialized);
+    QBENCHMARK {
+        for (int frames = 0; frames < SampleRate; frames += chunkFrames)
+            adapter.render(buffer.data(), buffer.size());
+    }
+}
+
+// Same as render(), but with a callback producing interleaved frames, as used by
+// QAudioEngine
+void tst_QAudioCallback::renderInterleaved_data()
+{
+    addFormatRows();
+}
+
+void tst_QAudioCallback::renderInterleaved()
+{
+    QFETCH(int, sampleFormat);
+    QFETCH(int, blockFrames);
+
+    const QAudioFormat format = audioFormat(QAudioFormat::SampleFormat(sampleFormat));
+    float phase = 0.f;
+    QAudioRenderAdapter adapter(QAudioRenderAdapter::InterleavedCallback([&](float *out, int frames) {
+        for (int i = 0; i < frames; ++i) {
+            phase += 0.01f;
+            for (int c = 0; c < Channels; ++c)
+                *out++ = std::sin(phase);
+        }
+    }), format, blockFrames);
+
+    const int chunkFrames = 441;
+    QByteArray buffer(format.bytesForFrames(chunkFrames), Qt::Uninitialized);
+    QBENCHMARK {
+        for (int frames = 0; frames < SampleRate; frames += chunkFrames)
+            adapter.render(buffer.data(), buffer.size());
+    }
+}
+
+void tst_QAudioCallback::capture_data()
+{
+    addFormatRows();
+}
+
+void tst_QAudioCallback::capture()
+{
+    QFETCH(int, sampleFormat);
+    QFETCH(int, blockFrames);
+
+    const QAudioFormat format = audioFormat(QAudioFormat::SampleFormat(sampleFormat));
+    float peak = 0.f;
+    QAudioCaptureAdapter adapter([&](const float *const *in, int frames) {
+        for (int c = 0; c < Channels; ++c)
+            peak = std::max(peak, *std::max_element(in[c], in[c] + frames));
+    }, format, blockFrames);
+
+    const int chunkFrames = 441;
+    QByteArray buffer(format.bytesForFrames(chunkFrames), '\0');
+    QBENCHMARK {
+        for (int frames = 0; frames < SampleRate; frames += chunkFrames)
+            adapter.capture(buffer.constData(), buffer.size());
+    }
+}
+
+// Round trip from the render callback of the default output to the capture
+// callback of the default input. Needs the output to be looped back into the
+// input, either by a cable or a monitor source set as the default input.
+void tst_QAudioCallback::loopbackLatency_data()
+{
+    QTest::addColumn<int>("blockFrames");
+    QTest::newRow("64") << 64;
+    QTest::newRow("256") << 256;
+}
+
+void tst_QAudioCallback::loopbackLatency()
+{
+    QFETCH(int, blockFrames);
+
+    const QAudioDevice output = QMediaDevices::defaultAudioOutput();
+    const QAudioDevice input = QMediaDevices::defaultAudioInput();
+    if (output.isNull() || input.isNull())
+        QSKIP("No audio devices available");
+
+    QAudioFormat outputFormat = output.preferredFormat();
+    QAudioFormat inputFormat = input.preferredFormat();
+    inputFormat.setSampleRate(outputFormat.sampleRate());
+    if (!input.isFormatSupported(inputFormat))
+        QSKIP("Input and output can't run at the same sample rate");
+
+    constexpr int Impulses = 20;
+    const qint64 impulseDistance = outputFormat.sampleRate()/4;
+    QElapsedTimer clock;
+    clock.start();
+
+    // The sink writes an impulse whenever the previous one was picked up by
+    // the source (or got lost), the source measures the time it took to come back
+    QAtomicInteger<qint64> emittedAt(-1);
+    qint64 framesSinceImpulse = 0;
+    QAudioSink sink(output, outputFormat);
+    sink.start([&](float *const *out, int frames) {
+        for (int c = 0; c < outputFormat.channelCount(); ++c)
+            std::fill(out[c], out[c] + frames, 0.f);
+        framesSinceImpulse += frames;
+        if (framesSinceImpulse < impulseDistance)
+            return;
+        framesSinceImpulse = 0;
+        for (int c = 0; c < outputFormat.channelCount(); ++c)
+            out[c][0] = 1.f;
+        emittedAt.storeRelease(clock.nsecsElapsed());
+    }, blockFrames);
+
+    // filled on whatever thread the source delivers on
+    std::vector<qint64> latencies(Impulses);
+    QAtomicInt measured = 0;
+    QAudioSource source(input, inputFormat);
+    source.start([&](const float *const *in, int frames) {
+        const qint64 emitted = emittedAt.loadAcquire();
+        const int index = measured.loadRelaxed();
+        if (emitted < 0 || index == Impulses)
+            return;
+        for (int i = 0; i < frames; ++i) {
+            if (std::abs(in[0][i]) > 0.5f) {
+                // the impulse was captured frames - i frames before the block got delivered
+                const qint64 captured = clock.nsecsElapsed()
+                        - qint64(frames - i)*1000000000/inputFormat.sampleRate();
+                latencies[index] = captured - emitted;
+                measured.storeRelease(index + 1);
+                emittedAt.testAndSetOrdered(emitted, -1);
+                return;
+            }
+        }
+    }, blockFrames);
+
+    if (sink.state() == QAudio::StoppedState || source.state() == QAudio::StoppedState)
+        QSKIP("Could not open the audio devices");
+
+    const bool done = QTest::qWaitFor([&] { return measured.loadAcquire() == Impulses; },
+                                      Impulses*1000);
+    source.stop();
+    sink.stop();
+    const int count = measured.loadAcquire();
+    if (count == 0)
+        QSKIP("No impulse came back, the output needs to be looped back into the input");
+    QVERIFY(done);
+
+    std::sort(latencies.begin(), latencies.begin() + count);
+    const qint64 median = latencies[count/2];
+    QTest::setBenchmarkResult(median/1e6, QTest::WalltimeMilliseconds);
+}
+
+QTEST_MAIN(tst_QAudioCallback)
+
+#include "tst_bench_qaudiocallback.moc"
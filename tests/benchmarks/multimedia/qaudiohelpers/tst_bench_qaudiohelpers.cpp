@@ -0,0 +1,195 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtMultimedia/private/qaudiohelpers_p.h>
+
+#include <vector>
+
+using namespace QAudioHelperInternal;
+
+namespace {
+
+// One second of 48 kHz stereo
+constexpr int Samples = 2*48000;
+
+QAudioFormat audioFormat(QAudioFormat::SampleFormat sampleFormat)
+{
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setChannelCount(2);
+    format.setSampleFormat(sampleFormat);
+    return format;
+}
+
+// What qMultiplySamples() did before it got vectorized: a qreal multiply
+// per sample, truncating and without saturation
+template<class T> void multiplyScalar(qreal factor, const void *src, void *dst, int samples)
+{
+    const T *pSrc = static_cast<const T *>(src);
+    T *pDst = static_cast<T *>(dst);
+    for (int i = 0; i < samples; i++)
+        pDst[i] = pSrc[i] * factor;
+}
+
+void multiplyScalarUInt8(qreal factor, const void *src, void *dst, int samples)
+{
+    const quint8 *pSrc = static_cast<const quint8 *>(src);
+    quint8 *pDst = static_cast<quint8 *>(dst);
+    for (int i = 0; i < samples; i++)
+        pDst[i] = 0x80 + (qint8(pSrc[i] - 0x80) * factor);
+}
+
+void multiplyScalar(qreal factor, const QAudioFormat &format, const void *src, void *dst, int len)
+{
+    const int samples = len/format.bytesPerSample();
+    switch (format.sampleFormat()) {
+    case QAudioFormat::UInt8:
+        multiplyScalarUInt8(factor, src, dst, samples);
+        break;
+    case QAudioFormat::Int16:
+        multiplyScalar<qint16>(factor, src, dst, samples);
+        break;
+    case QAudioFormat::Int32:
+        multiplyScalar<qint32>(factor, src, dst, samples);
+        break;
+    case QAudioFormat::Float:
+        multiplyScalar<float>(factor, src, dst, samples);
+        break;
+    default:
+        break;
+    }
+}
+
+}
+
+class tst_QAudioHelpers : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void multiply_data();
+    void multiply();
+    void convertFromFloat_data();
+    void convertFromFloat();
+    void convertToFloat_data();
+    void convertToFloat();
+};
+
+static void addSampleFormats()
+{
+    QTest::addColumn<int>("sampleFormat");
+    QTest::newRow("UInt8") << int(QAudioFormat::UInt8);
+    QTest::newRow("Int16") << int(QAudioFormat::Int16);
+    QTest::newRow("Int32") << int(QAudioFormat::Int32);
+    QTest::newRow("Float") << int(QAudioFormat::Float);
+}
+
+void tst_QAudioHelpers::multiply_data()
+{
+    QTest::addColumn<int>("sampleFormat");
+    QTest::addColumn<int>("mode");
+
+    // 0: the old scalar loop, 1: constant gain, 2: gain ramp
+    const std::pair<QAudioFormat::SampleFormat, const char *> formats[] = {
+        { QAudioFormat::UInt8, "UInt8" },
+        { QAudioFormat::Int16, "Int16" },
+        { QAudioFormat::Int32, "Int32" },
+        { QAudioFormat::Float, "Float" },
+    };
+    for (const auto &format : formats) {
+        QTest::newRow(QByteArray(format.second) + " scalar") << int(format.first) << 0;
+        QTest::newRow(QByteArray(format.second) + " constant") << int(format.first) << 1;
+        QTest::newRow(QByteArray(format.second) + " ramp") << int(format.first) << 2;
+    }
+}
+
+void tst_QAudioHelpers::multiply()
+{
+    QFETCH(int, sampleFormat);
+    QFETCH(int, mode);
+
+    const QAudioFormat format = audioFormat(QAudioFormat::SampleFormat(sampleFormat));
+    const int len = format.bytesPerSample()*Samples;
+    QByteArray src(len, '\x40');
+    QByteArray dst(len, Qt::Uninitialized);
+
+    QBENCHMARK {
+        switch (mode) {
+        case 0:
+            multiplyScalar(0.5, format, src.constData(), dst.data(), len);
+            break;
+        case 1:
+            qMultiplySamples(0.5, format, src.constData(), dst.data(), len);
+            break;
+        case 2:
+            qMultiplySamples(0.25f, 0.75f, format, src.constData(), dst.data(), len);
+            break;
+        }
+    }
+}
+
+void tst_QAudioHelpers::convertFromFloat_data()
+{
+    addSampleFormats();
+}
+
+void tst_QAudioHelpers::convertFromFloat()
+{
+    QFETCH(int, sampleFormat);
+
+    const QAudioFormat format = audioFormat(QAudioFormat::SampleFormat(sampleFormat));
+    std::vector<float> src(Samples, 0.5f);
+    QByteArray dst(format.bytesPerSample()*Samples, Qt::Uninitialized);
+
+    QBENCHMARK {
+        qConvertFromFloat(src.data(), format, dst.data(), Samples, 0.8f);
+    }
+}
+
+void tst_QAudioHelpers::convertToFloat_data()
+{
+    addSampleFormats();
+}
+
+void tst_QAudioHelpers::convertToFloat()
+{
+    QFETCH(int, sampleFormat);
+
+    const QAudioFormat format = audioFormat(QAudioFormat::SampleFormat(sampleFormat));
+    QByteArray src(format.bytesPerSample()*Samples, '\x40');
+    std::vector<float> dst(Samples);
+
+    QBENCHMARK {
+        qConvertToFloat(format, src.constData(), dst.data(), Samples, 0.8f);
+    }
+}
+
+QTEST_MAIN(tst_QAudioHelpers)
+
+#include "tst_bench_qaudiohelpers.moc"
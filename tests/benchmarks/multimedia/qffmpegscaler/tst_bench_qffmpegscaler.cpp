@@ -0,0 +1,125 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qelapsedtimer.h>
+
+#include "qffmpegscaler_p.h"
+
+using namespace QFFmpeg;
+
+namespace {
+
+constexpr int FrameCount = 60;
+
+AVFrame *createFrame(AVPixelFormat format, const QSize &size)
+{
+    AVFrame *frame = av_frame_alloc();
+    frame->format = format;
+    frame->width = size.width();
+    frame->height = size.height();
+    av_frame_get_buffer(frame, 0);
+    // some content, so the conversion doesn't run on uninitialized memory
+    for (int plane = 0; plane < AV_NUM_DATA_POINTERS && frame->buf[plane]; ++plane)
+        memset(frame->buf[plane]->data, 0x80, frame->buf[plane]->size);
+    return frame;
+}
+
+// What QFFmpegVideoBuffer did for every frame before the contexts and
+// buffers got reused.
+AVFrame *convertUncached(const AVFrame *frame, AVPixelFormat format)
+{
+    SwsContext *c = sws_getContext(frame->width, frame->height, AVPixelFormat(frame->format),
+                                   frame->width, frame->height, format,
+                                   SWS_BICUBIC, nullptr, nullptr, nullptr);
+    AVFrame *newFrame = av_frame_alloc();
+    newFrame->width = frame->width;
+    newFrame->height = frame->height;
+    newFrame->format = format;
+    av_frame_get_buffer(newFrame, 0);
+    sws_scale(c, frame->data, frame->linesize, 0, frame->height, newFrame->data, newFrame->linesize);
+    sws_freeContext(c);
+    return newFrame;
+}
+
+}
+
+class tst_QFFmpegScaler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void convert_data();
+    void convert();
+};
+
+void tst_QFFmpegScaler::convert_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("mode");
+
+    // 0: a new context and frame for each conversion, 1: Scaler, single
+    // threaded, 2: Scaler with slice threads
+    const QSize sizes[] = { { 1920, 1080 }, { 3840, 2160 } };
+    for (const auto &size : sizes) {
+        const QByteArray name = QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+        QTest::newRow(name + " uncached") << size << 0;
+        QTest::newRow(name + " cached") << size << 1;
+        QTest::newRow(name + " cached, threaded") << size << 2;
+    }
+}
+
+void tst_QFFmpegScaler::convert()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, mode);
+
+    // 4:2:2 isn't a format the video sink handles, like in QFFmpegVideoBuffer
+    // it gets converted to 4:2:0
+    AVFrame *source = createFrame(AV_PIX_FMT_YUV422P, size);
+
+    Scaler scaler;
+    scaler.setThreadCount(mode == 2 ? 0 : 1);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < FrameCount; ++i) {
+        AVFrame *converted = mode == 0 ? convertUncached(source, AV_PIX_FMT_YUV420P)
+                                       : scaler.convert(source, AV_PIX_FMT_YUV420P);
+        QVERIFY(converted);
+        av_frame_free(&converted);
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+    av_frame_free(&source);
+
+    QTest::setBenchmarkResult(FrameCount*1e9/elapsed, QTest::FramesPerSecond);
+}
+
+QTEST_MAIN(tst_QFFmpegScaler)
+
+#include "tst_bench_qffmpegscaler.moc"
@@ -0,0 +1,196 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qmutex.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qthread.h>
+#include <QtCore/qelapsedtimer.h>
+
+#include "qffmpegspscqueue_p.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace QFFmpeg;
+
+namespace {
+
+constexpr int ItemCount = 1000000;
+
+// Same shape as the QMutex + QQueue combination the decoder used before,
+// to have something to compare against.
+template<typename T>
+class LockedQueue
+{
+public:
+    explicit LockedQueue(int maxSize) : maxSize(maxSize) {}
+    bool push(T value)
+    {
+        QMutexLocker locker(&mutex);
+        if (queue.size() >= maxSize)
+            return false;
+        queue.enqueue(value);
+        return true;
+    }
+    bool pop(T &value)
+    {
+        QMutexLocker locker(&mutex);
+        if (queue.isEmpty())
+            return false;
+        value = queue.dequeue();
+        return true;
+    }
+
+private:
+    QMutex mutex;
+    QQueue<T> queue;
+    int maxSize;
+};
+
+// Pushes ItemCount items from a second thread and pops them on the current one.
+// If timestamps is set, every item carries the time it was pushed at and the
+// per item latency in nanoseconds is recorded on the consumer side.
+template<typename Queue>
+void transfer(Queue &queue, std::vector<qint64> *latencies = nullptr)
+{
+    QElapsedTimer clock;
+    clock.start();
+
+    QScopedPointer<QThread> producer(QThread::create([&] {
+        for (int i = 0; i < ItemCount; ++i) {
+            const qint64 value = latencies ? clock.nsecsElapsed() : i;
+            while (!queue.push(value))
+                QThread::yieldCurrentThread();
+        }
+    }));
+    producer->start();
+
+    qint64 value = 0;
+    for (int i = 0; i < ItemCount; ++i) {
+        while (!queue.pop(value))
+            QThread::yieldCurrentThread();
+        if (latencies)
+            latencies->push_back(clock.nsecsElapsed() - value);
+        else if (value != i)
+            QFAIL("items were reordered");
+    }
+    producer->wait();
+}
+
+qint64 percentile(std::vector<qint64> &sorted, double p)
+{
+    const size_t index = qMin(sorted.size() - 1, size_t(p * sorted.size()));
+    return sorted[index];
+}
+
+}
+
+class tst_QFFmpegSpscQueue : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void throughput_data();
+    void throughput();
+    void lockedQueueThroughput_data();
+    void lockedQueueThroughput();
+    void latency_data();
+    void latency();
+};
+
+void tst_QFFmpegSpscQueue::throughput_data()
+{
+    QTest::addColumn<int>("capacity");
+
+    // 16 matches the frame queues, 4096 the packet queues
+    QTest::newRow("16") << 16;
+    QTest::newRow("4096") << 4096;
+}
+
+void tst_QFFmpegSpscQueue::throughput()
+{
+    QFETCH(int, capacity);
+
+    QBENCHMARK {
+        SpscQueue<qint64> queue(capacity);
+        transfer(queue);
+    }
+}
+
+void tst_QFFmpegSpscQueue::lockedQueueThroughput_data()
+{
+    throughput_data();
+}
+
+void tst_QFFmpegSpscQueue::lockedQueueThroughput()
+{
+    QFETCH(int, capacity);
+
+    QBENCHMARK {
+        LockedQueue<qint64> queue(capacity);
+        transfer(queue);
+    }
+}
+
+void tst_QFFmpegSpscQueue::latency_data()
+{
+    QTest::addColumn<bool>("locked");
+    QTest::addColumn<double>("percentile");
+
+    QTest::newRow("spsc p50") << false << 0.5;
+    QTest::newRow("spsc p99") << false << 0.99;
+    QTest::newRow("spsc p99.9") << false << 0.999;
+    QTest::newRow("locked p50") << true << 0.5;
+    QTest::newRow("locked p99") << true << 0.99;
+    QTest::newRow("locked p99.9") << true << 0.999;
+}
+
+void tst_QFFmpegSpscQueue::latency()
+{
+    QFETCH(bool, locked);
+    QFETCH(double, percentile);
+
+    std::vector<qint64> latencies;
+    latencies.reserve(ItemCount);
+    if (locked) {
+        LockedQueue<qint64> queue(16);
+        transfer(queue, &latencies);
+    } else {
+        SpscQueue<qint64> queue(16);
+        transfer(queue, &latencies);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    // report the push to pop latency instead of the time taken by the test function
+    QTest::setBenchmarkResult(::percentile(latencies, percentile), QTest::WalltimeNanoseconds);
+}
+
+QTEST_MAIN(tst_QFFmpegSpscQueue)
+
+#include "tst_bench_qffmpegspscqueue.moc"
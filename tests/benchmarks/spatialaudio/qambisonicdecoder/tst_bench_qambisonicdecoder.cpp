@@ -0,0 +1,127 @@
+/****************************************************************************
+**
+** Copyright (C) 2022 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtSpatialAudio/private/qambisonicdecoder_p.h>
+
+#include <vector>
+
+namespace {
+
+constexpr int nSamples = 128;
+
+QAudioFormat formatFor(QAudioFormat::ChannelConfig config)
+{
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setSampleFormat(QAudioFormat::Int16);
+    format.setChannelConfig(config);
+    return format;
+}
+
+}
+
+class tst_QAmbisonicDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QAmbisonicDecoder()
+    {
+        // some noise, the content doesn't matter for the performance
+        quint32 seed = 1;
+        for (auto &channel : input) {
+            channel.resize(nSamples);
+            for (float &f : channel) {
+                seed = seed*1664525u + 1013904223u;
+                f = float(seed >> 8)/float(1 << 24) - .5f;
+            }
+        }
+        for (auto &r : reverb)
+            r = input[0];
+    }
+
+private slots:
+    void decode_data();
+    void decode();
+
+private:
+    std::vector<float> input[QAmbisonicDecoder::maxAmbisonicChannels];
+    std::vector<float> reverb[2];
+};
+
+void tst_QAmbisonicDecoder::decode_data()
+{
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("config");
+    QTest::addColumn<bool>("generic");
+
+    const struct {
+        const char *name;
+        QAudioFormat::ChannelConfig config;
+    } configs[] = {
+        { "stereo", QAudioFormat::ChannelConfigStereo },
+        { "5.1", QAudioFormat::ChannelConfigSurround5Dot1 },
+        { "7.1", QAudioFormat::ChannelConfigSurround7Dot1 },
+    };
+
+    for (int level = 1; level <= QAmbisonicDecoder::maxAmbisonicLevel; ++level) {
+        for (const auto &c : configs) {
+            for (bool generic : { true, false }) {
+                QTest::addRow("level %d, %s, %s", level, c.name, generic ? "generic" : "simd")
+                        << level << int(c.config) << generic;
+            }
+        }
+    }
+}
+
+void tst_QAmbisonicDecoder::decode()
+{
+    QFETCH(int, level);
+    QFETCH(int, config);
+    QFETCH(bool, generic);
+
+    QAmbisonicDecoder decoder(QAmbisonicDecoder::AmbisonicLevel(level), formatFor(QAudioFormat::ChannelConfig(config)));
+    QVERIFY(decoder.hasValidConfig());
+    if (generic)
+        decoder.setKernels(QAmbisonicDecoderKernels::genericKernels());
+
+    const float *channels[QAmbisonicDecoder::maxAmbisonicChannels];
+    for (int i = 0; i < QAmbisonicDecoder::maxAmbisonicChannels; ++i)
+        channels[i] = input[i].data();
+    const float *reverbBuffers[2] = { reverb[0].data(), reverb[1].data() };
+    std::vector<short> output(decoder.outputSize(nSamples));
+
+    QBENCHMARK {
+        decoder.processBufferWithReverb(channels, reverbBuffers, output.data(), nSamples);
+    }
+}
+
+QTEST_MAIN(tst_QAmbisonicDecoder)
+
+#include "tst_bench_qambisonicdecoder.moc"